@@ -121,6 +121,7 @@ protected:
 	size_t			iCurrentOutgoingBytes;				// how many bytes sent since last bandwidth calculation
 	size_t			iOutgoingBytes;
 	size_t			iIncomingBytes;
+	size_t			iReliableRetransmits;				// reliable packets which were sent again (only counted by CChannel3)
 
 	void			UpdateTransmitStatistics( int sentDataSize );
 	void			UpdateReceiveStatistics( int receivedDataSize );
@@ -144,8 +145,12 @@ public:
 	// It should return empty data from time to time when channel is inactive, so clients won't timeout.
 	virtual bool	Process( CBytestream *bs ) = 0;
 	virtual void	AddReliablePacketToSend(CBytestream& bs); // Common for CChannel_056b and CChannel2
+	// Appends the packets which were handed over without the socket, only used by CChannel_Local.
+	// Returns false if there are none.
+	virtual bool	ReceiveDirect( std::list<CBytestream>& packets ) { return false; }
 	
 	size_t			getPacketLoss()		{ return iPacketsDropped; }
+	size_t			getPacketsGood()	{ return iPacketsGood; }
 	AbsTime			getLastReceived()	{ return fLastPckRecvd; }
 	AbsTime			getLastSent()		{ return fLastSent; }
 	NetworkAddr		getAddress()		{ return RemoteAddr; }
@@ -158,6 +163,7 @@ public:
 
 	size_t			getOutgoing()		{ return iOutgoingBytes; }
 	size_t			getIncoming()		{ return iIncomingBytes; }
+	size_t			getRetransmits()	{ return iReliableRetransmits; }
 
 	int				getPing()			{ return iPing; }
 	void			setPing(int _p)		{ iPing = _p; }
@@ -313,6 +319,7 @@ private:
 	int				LastReliableIn_SentWithLastPacket;	// Required to check if we need to send empty packet with acknowledges
 	int				LastReliablePacketSent;				// To make packet flow smooth
 	int				NextReliablePacketToSend;			// To make packet flow smooth
+	int				HighestReliablePacketSent;			// For retransmit statistics
 	
 	// Constants to shape packet flow - in the future we may want to change them dynamically from connection characteristics
 	
@@ -354,6 +361,41 @@ public:
 	friend void TestCChannelRobustness();
 };
 
+// Channel between the server and the local client in the same process (Advanced.LocalLoopback).
+// The bytestreams are handed over directly to the other side, there is no sequencing,
+// no acknowledges and no socket involved. Connectionless packets still go over the socket.
+class CChannel_Local: public CChannel {
+public:
+	struct Link;
+
+private:
+	SmartPointer<Link>	link;
+	bool		serverSide;
+	NetworkSocket::Port	clientPort;
+
+	CChannel_Local(const SmartPointer<Link>& _link, bool _serverSide, NetworkSocket::Port _clientPort);
+
+public:
+	~CChannel_Local();
+
+	// The server creates a new link when the local client connects from clientPort
+	static CChannel_Local* createForServer(NetworkSocket::Port clientPort);
+	// NULL if our server has no link for clientPort
+	static CChannel_Local* createForClient(NetworkSocket::Port clientPort);
+	static bool	hasLink(NetworkSocket::Port clientPort);
+	// False if the server has dropped the link of this channel or made a new one since
+	bool		isCurrent();
+
+	void		Transmit( CBytestream *unreliableData );
+	// Nothing but connectionless packets comes over the socket, see ReceiveDirect()
+	bool		Process( CBytestream *bs ) { return false; }
+	bool		ReceiveDirect( std::list<CBytestream>& packets );
+	void		AddReliablePacketToSend(CBytestream& bs); // The same as in CChannel but without size limit
+
+	bool		getBufferEmpty()	{ return true; }
+	bool		getBufferFull()		{ return false; }
+};
+
 void TestCChannelRobustness();
 
 #endif  //  __CCHANNEL_H__
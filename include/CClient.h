@@ -50,6 +50,7 @@ class CChannel;
 class CClientNetEngine;
 class CBonus;
 class CMap;
+class RenderQueue;
 struct profile_t;
 class FlagInfo;
 struct ClientConnectionRequestInfo;
@@ -452,8 +453,8 @@ public:
 	void		Draw(SDL_Surface * bmpDest);
 	void		DrawViewport(SDL_Surface * bmpDest, int viewport_index);
 	void		DrawViewport_Game(SDL_Surface* bmpDest, CViewport* v);
-	void		DrawProjectiles(SDL_Surface * bmpDest, CViewport *v);
-    void        DrawProjectileShadows(SDL_Surface * bmpDest, CViewport *v);
+	void		DrawProjectiles(RenderQueue& queue, CViewport *v);
+    void        DrawProjectileShadows(RenderQueue& queue);
 	void		InitializeGameMenu();
 	void		DrawGameMenu(SDL_Surface * bmpDest);
 	void		DrawBonuses(SDL_Surface * bmpDest, CViewport *v);
@@ -505,6 +506,7 @@ public:
 
 	// Variables
 	CChannel	*getChannel()			{ return cNetChan; }
+	NetworkSocket *getSocket()			{ return tSocket.get(); }
 	CChannel	*createChannel(const Version& v);
 	int			getStatus()				{ return iNetStatus; }
 	void		setStatus(int _s)			{ iNetStatus = _s; }
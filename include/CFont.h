@@ -22,6 +22,9 @@
 
 #include <SDL.h>
 #include <vector>
+#include <list>
+#include <map>
+#include <string>
 #include "Unicode.h"
 #include "SmartPointer.h"
 #include "Color.h"
@@ -37,12 +40,13 @@ class CFont {
 public:
 	// Constructor
 	CFont() {
-		bmpFont = bmpWhite = bmpGreen = NULL;
+		bmpFont = NULL;
 		Colorize = false;
 		OutlineFont = false;
 		Spacing = 1;
 		VSpacing = 3;
 		NumCharacters = 0;
+		RunPixels = 0;
 	}
 
 
@@ -58,12 +62,48 @@ private:
 	int								VSpacing;
 	size_t							NumCharacters;
 
-	// Common colours
-	SmartPointer<SDL_Surface> bmpWhite;
-	SmartPointer<SDL_Surface> bmpGreen;
-
-	Color f_white;
-	Color f_green;
+	// Cache with string keys which forgets the least recently used entries
+	template<typename _Value>
+	struct LRUCache {
+		typedef std::list< std::pair<std::string, _Value> > List;
+		List entries; // most recently used first
+		std::map<std::string, typename List::iterator> index;
+
+		_Value* find(const std::string& key) {
+			typename std::map<std::string, typename List::iterator>::iterator i = index.find(key);
+			if (i == index.end()) return NULL;
+			entries.splice(entries.begin(), entries, i->second);
+			return &i->second->second;
+		}
+		_Value& insert(const std::string& key) {
+			entries.push_front(std::make_pair(key, _Value()));
+			index[key] = entries.begin();
+			return entries.front().second;
+		}
+		_Value& last() { return entries.back().second; }
+		void removeLast() { index.erase(entries.back().first); entries.pop_back(); }
+		size_t size() const { return index.size(); }
+		void clear() { entries.clear(); index.clear(); }
+	};
+
+	// A laid out string, the glyph positions are relative to the start of the text
+	struct Glyph { int index; int x; int line; };
+	struct Layout {
+		std::vector<Glyph> glyphs;
+		int width; // same as GetWidth()
+		int lines;
+	};
+
+	// A string rendered in one colour, drawn with a single blit
+	struct Run {
+		SmartPointer<SDL_Surface> surf; // only created when drawn the second time
+		int pixels;
+	};
+
+	LRUCache<Layout>				Layouts;
+	LRUCache< SmartPointer<SDL_Surface> > Atlases; // the whole font in one colour, keyed by colour
+	LRUCache<Run>					Runs; // keyed by colour and text
+	size_t							RunPixels;
 
 public:
 	// Methods
@@ -82,6 +122,7 @@ public:
 	void				Shutdown();
 
 	INLINE void			SetOutline(bool _o)  {
+		if (OutlineFont != _o) ClearCaches();
 		OutlineFont = _o;
 	}
 	INLINE bool			IsOutline()  {
@@ -108,12 +149,14 @@ public:
 	INLINE bool			CanDisplayCharacter (UnicodeChar c)  { return (c < FIRST_CHARACTER + NumCharacters) && (c >= FIRST_CHARACTER); }
 
 	INLINE void			SetSpacing(int _s)  {
+		if (Spacing != _s) ClearCaches();
 		Spacing = _s;
 	}
 	INLINE int			GetSpacing()		 {
 		return Spacing;
 	}
 	INLINE void			SetVSpacing(int _v) {
+		if (VSpacing != _v) ClearCaches();
 		VSpacing = _v;
 	}
 	INLINE int			GetVSpacing()	{
@@ -123,6 +166,10 @@ private:
 	bool				IsColumnFree(int x);
 	void				Parse();
 	void				PreCalculate(const SmartPointer<SDL_Surface> & bmpSurf, Color colour);
+	void				ClearCaches();
+	const Layout&		GetLayout(const std::string& txt);
+	SmartPointer<SDL_Surface> GetAtlas(Color col);
+	SmartPointer<SDL_Surface> GetRun(const std::string& txt, Color col, const SmartPointer<SDL_Surface>& atlas);
 	
 	// Internal functions for glyph drawing, first one for normal fonts, second one for outline fonts
 	// These do the fast glyph blit without any additional checks or clipping
@@ -86,6 +86,7 @@ public:
 		NumWeapons = 0;
 		Weapons = NULL;
         pModLog = NULL;
+		bQueueAssets = false;
 	}
 
 	~CGameScript() {
@@ -121,6 +122,18 @@ private:
 	std::vector< SmartPointer<SDL_Surface> > CachedImages;	// To safely delete the vars, along with CGameScript.
 	std::vector< SmartPointer<SoundSample> > CachedSamples;	// To safely delete the vars, along with CGameScript.
 
+	// While Load() parses the script, images and sounds are only requested here.
+	// LoadQueuedAssets() then decodes them on the thread pool, each distinct file only once.
+	struct AssetRequest {
+		std::string dir, filename;
+		SDL_Surface** image; SmartPointer<SDL_Surface>* shadow;
+		SoundSample** sample; bool* useSound; // useSound is reset if the sample cannot be loaded
+		std::string errorMsg; // written to the mod log if loading failed
+		AssetRequest() : image(NULL), shadow(NULL), sample(NULL), useSound(NULL) {}
+	};
+	bool		bQueueAssets;
+	std::vector<AssetRequest> queuedAssets;
+
 private:
 
 	void		Shutdown();
@@ -153,6 +166,14 @@ public:
 	SDL_Surface * LoadGSImage(const std::string& dir, const std::string& filename);
 	SoundSample * LoadGSSample(const std::string& dir, const std::string& filename);
 
+private:
+	// These load directly, or queue the request if we are in the parse phase of Load().
+	void		RequestGSImage(const std::string& dir, const std::string& filename, SDL_Surface** image, SmartPointer<SDL_Surface>* shadow, const std::string& errorMsg);
+	void		RequestGSSample(const std::string& dir, const std::string& filename, SoundSample** sample, bool* useSound, const std::string& errorMsg);
+	void		LoadQueuedAssets();
+
+public:
+
 	const gs_header_t	*GetHeader()				{ return &Header; }
 	static bool	isCompatibleWith(int scriptVer, const Version& ver) {
 		if(scriptVer < GS_FIRST_SUPPORTED_VERSION) return false;
@@ -27,6 +27,7 @@
 #include "game/CGameObject.h"
 
 struct SDL_Surface;
+class RenderQueue;
 class CWorm;
 class Sounds;
 class CViewport;
@@ -168,7 +169,8 @@ public:
 	
 	void	Spawn(proj_t *_proj, CVec _pos, CVec _vel, int _rot, int _owner, int _random, AbsTime time, AbsTime ignoreWormCollBeforeTime);
 
-    void	Draw(SDL_Surface * bmpDest, CViewport *view);
+    void	Draw(RenderQueue& queue, CViewport *view);
+    void	QueueShadow(RenderQueue& queue);
     void	DrawShadow(SDL_Surface * bmpDest, CViewport *view);
 
 	// Note: This is only used in AI and not in physics and it also should not be used in physics.
@@ -33,6 +33,7 @@
 #include "StaticAssert.h"
 #include "util/PODForClass.h"
 #include "util/Result.h"
+#include "NameIndex.h"
 
 
 class BaseObject;
@@ -641,6 +642,14 @@ public:
 	
 	static RegisteredVar* GetVar( const std::string & name );	// Case-insensitive search, returns NULL on fail
 	static RegisteredVar* GetVar( const std::string & name, ScriptVarType_t type );	// Case-insensitive search, returns NULL on fail
+
+	// A handle stays the same for a name, also when the var is (de)registered, so callers can keep it
+	typedef NameIndex<RegisteredVar>::Handle VarHandle;
+	static VarHandle GetVarHandle( const std::string & name );
+	static RegisteredVar* GetVar( VarHandle h );	// NULL if not registered right now
+
+	// All var names (without callbacks) starting with prefix, cut behind the next '.'
+	static void CompleteVarName( const std::string & prefix, std::vector<std::string>& out );
 	template<typename T>
 	static T* GetVarP(const std::string& name) {
 		RegisteredVar* var = GetVar(name, GetType<T>::value);
@@ -666,11 +675,11 @@ public:
 	{
 		friend class CScriptableVars;
 
-		VarMap& m_vars;	// Reference to CScriptableVars::m_vars
+		CScriptableVars* m_parent;
 		std::string m_prefix;
 
 		VarRegisterHelper( CScriptableVars * parent, const std::string & prefix ): 
-			m_vars( parent->m_vars ), m_prefix(prefix) {}
+			m_parent( parent ), m_prefix(prefix) {}
 
 		std::string Name( const std::string & c )
 		{
@@ -688,7 +697,7 @@ public:
 										const std::string & descr = "", const std::string & descrLong = "", GameInfoGroup group = GIG_Invalid, AdvancedLevel level = ALT_Basic,
 										bool unsig = false, const T& minval = T(), const T& maxval = T() )
 		{
-			m_vars[Name(c)] = RegisteredVar(v, std::string(c), T(def), descr, descrLong, group, level, unsig, minval, maxval);
+			m_parent->Register(Name(c), RegisteredVar(v, std::string(c), T(def), descr, descrLong, group, level, unsig, minval, maxval));
 			return *this; 
 		}
 
@@ -699,7 +708,7 @@ public:
 		}
 		
 		VarRegisterHelper& operator() (ScriptCallback_t cb, const std::string& c) {
-			m_vars[Name(c)] = RegisteredVar(cb, c);
+			m_parent->Register(Name(c), RegisteredVar(cb, c));
 			return *this;
 		}
 		
@@ -707,7 +716,7 @@ public:
 										const std::string & descr = "", const std::string & descrLong = "", GameInfoGroup group = GIG_Invalid, AdvancedLevel level = ALT_Basic,
 										bool unsig = false, const ScriptVar_t& minval = ScriptVar_t(), const ScriptVar_t& maxval = ScriptVar_t())
 			{
-				m_vars[Name(c)] = RegisteredVar(v, c, def, descr, descrLong, group, level, unsig, minval, maxval);
+				m_parent->Register(Name(c), RegisteredVar(v, c, def, descr, descrLong, group, level, unsig, minval, maxval));
 				return *this; 
 			}
 		
@@ -725,8 +734,11 @@ public:
 private:
 	friend class VarRegisterHelper;
 
+	void Register( const std::string & name, const RegisteredVar & var );
+
 	static CScriptableVars * m_instance;
 	VarMap m_vars;	// All in-game variables and callbacks	
+	NameIndex<RegisteredVar> m_index;	// Hashed lookup into m_vars
 };
 
 #endif
@@ -18,6 +18,7 @@
 #define	__CSERVER_H__
 
 #include <string>
+#include <vector>
 #include "Networking.h"
 #include "SmartPointer.h"
 #include "CBonus.h"
@@ -166,6 +167,7 @@ public:
 	void		SendPackets(bool sendPendingOnly = false);
 
 	bool		ReadPacketsFromSocket(const SmartPointer<NetworkSocket>& sock);
+	void		getSockets(std::vector<NetworkSocket*>& sockets); // the open ones which ReadPackets() reads
 
 	int			getPort() { return nPort; }
 	bool		checkBandwidth(CServerConnection *cl);
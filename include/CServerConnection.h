@@ -112,6 +112,7 @@ public:
 	CChannel	*getChannel()				{ return cNetChan; }
 	void		resetChannel();
 	CChannel	*createChannel(const Version& v);
+	CChannel	*createLocalChannel(NetworkSocket::Port clientPort); // see CChannel_Local
 	
 	CServerNetEngine * getNetEngine()		{ return cNetEngine; }
 	void		resetNetEngine();
@@ -26,6 +26,7 @@
 
 #include "CVec.h"
 #include "gusanos/luaapi/types.h"
+#include "gusanos/compositor.h"
 #include "util/BaseObject.h"
 
 // Viewport types
@@ -223,6 +224,7 @@ public:
 		
 	ALLEGRO_BITMAP* dest;
 	ALLEGRO_BITMAP* fadeBuffer;
+	LayerCompositor compositor;
 
 	static LuaReference metaTable;
 	virtual LuaReference getMetaTable() const { return metaTable; }
@@ -54,8 +54,9 @@ public:
 	// no copying is done, so it is required to use SmartPointer returned,
 	// if you don't want cache system to delete your image right after you've loaded it.
 	// Oh, don't ever call gfxFreeSurface() or FreeSoundSample() - cache will do that for you.
-	void	SaveImage__unsafe(const std::string& file, const SmartPointer<SDL_Surface> & img);
-	void	SaveSound(const std::string& file, const SmartPointer<SoundSample> & smp);
+	// If another thread has saved the same file in the meantime, the already cached entry is kept and returned.
+	SmartPointer<SDL_Surface>	SaveImage__unsafe(const std::string& file, const SmartPointer<SDL_Surface> & img);
+	SmartPointer<SoundSample>	SaveSound(const std::string& file, const SmartPointer<SoundSample> & smp);
 	void	SaveMod(const std::string& dir, const SmartPointer<CGameScript> & mod);
 	// Map is copied to cache, 'cause it will be modified during game - you should free your data yourself.
 	void	SaveMap(const std::string& file, CMap *map);
@@ -0,0 +1,32 @@
+/*
+ *  DedicatedLoop.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __DEDICATEDLOOP_H__
+#define __DEDICATEDLOOP_H__
+
+#include "olx-types.h"
+
+/*
+	Event-driven end of a frame for the dedicated server (Linux, epoll)
+
+	Instead of sleeping for the rest of the frame, CapFPS() blocks on an epoll
+	set with the sockets which GameServer::ReadPackets() reads, the socket of
+	the local client and an eventfd, which is signalled whenever a command is
+	queued (Execute()) or an event is pushed to the main queue (this includes
+	the timers). The next frame starts as soon as any of them is ready or when
+	it is due. Outside of a game no physics have to run, so then it waits up
+	to Advanced.DedicatedIdleWait ms.
+*/
+
+// Returns false if the event loop is not available, the caller should sleep as usual then
+bool DedicatedLoopWait(TimeDiff timeout);
+// Thread-safe. Interrupts a running DedicatedLoopWait().
+void DedicatedLoopWakeup();
+void DedicatedLoopShutdown();
+
+#endif // __DEDICATEDLOOP_H__
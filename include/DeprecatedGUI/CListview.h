@@ -18,6 +18,7 @@
 #define __CLISTVIEW_H__DEPRECATED_GUI__
 
 #include <string>
+#include <vector>
 #include "DeprecatedGUI/CWidget.h"
 #include "DeprecatedGUI/CScrollbar.h"
 #include "DynDraw.h"
@@ -140,6 +141,9 @@ public:
 		iType = wid_Listview;
 		fLastMouseUp = AbsTime();
 		iContentHeight = 0;
+		iLastItemHeight = 0;
+		tTopItem = NULL;
+		iTopItemPos = 0;
         iItemID = 0;
         bShowSelect = true;
 		iLastMouseX = 0;
@@ -185,7 +189,10 @@ private:
 	lv_item_t		*tSelected;
 	int				iItemCount;
     int             iItemID;
-	int				iContentHeight;
+	int				iContentHeight; // sum of the item heights
+	int				iLastItemHeight; // height of tLastItem as counted in iContentHeight
+	lv_item_t		*tTopItem; // first visible item of the last draw, NULL if unknown
+	int				iTopItemPos;
 	bool			bSubItemsAreAligned; // if the left item is too long, subitems are shifted right
 	
 	AbsTime			fLastMouseUp;
@@ -216,6 +223,9 @@ private:
 private:
 	void	ShowTooltip(const std::string& text, int ms_x, int ms_y);
 	void	UpdateItemIDs();
+	void	CountLastItemHeight();
+	void	SetScrollbarSize(int count, int size);
+	lv_item_t *getTopItem(int pos);
 
 public:
 	// Methods
@@ -248,6 +258,7 @@ public:
 
 	void	SortBy(int column, bool ascending); // One-time sort
 	void	ReSort();
+	void	SortItems(const std::vector<lv_item_t *>& items); // Moves the items to their places in the current sorting, the others have to be sorted
 	void	SetSortColumn(int column, bool ascending); // Permanent sort
 	int		GetSortColumn();
 
@@ -264,6 +275,7 @@ public:
 	}
 
 	void	RemoveItem(int iIndex);
+	void	RemoveItem(lv_item_t *item);
 	int		getIndex(int count);
 
 	int		GetColumnWidth(int id);
@@ -25,6 +25,7 @@
 
 class CMap;
 class CViewport;
+class RenderQueue;
 
 
 #define		MAX_ENTITIES	1024
@@ -132,7 +133,7 @@ void	ShutdownEntities();
 void	ClearEntities();
 
 void	SpawnEntity(int type, int type2, CVec pos, CVec vel, Color colour, SmartPointer<SDL_Surface> img);
-void	DrawEntities(SDL_Surface * bmpDest, CViewport *v);
+void	DrawEntities(RenderQueue& queue, CViewport *v);
 void	SimulateEntities(TimeDiff dt);
 void	EntityBounce(entity_t *ent);
 
@@ -164,6 +164,25 @@ INLINE bool GetExactFileName(const std::string& abs_searchname, std::string& fil
 extern searchpathlist	basesearchpaths;
 void	InitBaseSearchPaths();
 
+// In-memory index of all files in the searchpaths, see DirectoryIndex.cpp.
+// It is built in the background and kept up to date with inotify. Until a searchpath
+// is completely indexed (and on systems without inotify), lookups fall back to the filesystem.
+void	InitDirectoryIndex(); // call when the searchpaths are known
+void	UnInitDirectoryIndex();
+
+typedef char filemodes_t;
+struct DirectoryIndexEntry {
+	std::string name;
+	filemodes_t mode; // FM_DIR or FM_REG
+};
+
+// Case insensitive lookup of a full path (after ReplaceFileVariables).
+// Returns false if the index is not responsible for that path.
+// Otherwise, found tells if it exists and exactname is set like GetExactFileName would set it.
+bool	DirectoryIndexLookup(const std::string& abs_searchname, std::string& exactname, bool& found);
+// Lists all entries of the given (exact) directory. Returns false if the index is not responsible.
+bool	DirectoryIndexListDir(const std::string& abs_dir, std::vector<DirectoryIndexEntry>& entries);
+
 // this does a search on all searchpaths for the file and returns the first one found
 // if none was found, NULL will be returned
 // if searchpath!=NULL, it will place there the searchpath
@@ -228,7 +247,6 @@ const char* GetBinaryFilename();
 std::string	GetTempDir();
 
 
-typedef char filemodes_t;
 enum {
 	FM_DIR = 1,
 	FM_REG = 2,
@@ -301,6 +319,17 @@ public:
 		if(!GetExactFileName(path + dir, abs_path)) return true;
 		bool ret = true;
 
+		{
+			std::vector<DirectoryIndexEntry> entries;
+			if(DirectoryIndexListDir(abs_path, entries)) {
+				for(std::vector<DirectoryIndexEntry>::iterator i = entries.begin(); i != entries.end(); ++i)
+					if(i->mode & modefilter)
+						if(!filehandler(abs_path + "/" + i->name))
+							return false;
+				return true;
+			}
+		}
+
 #ifdef WIN32  // uses UTF16
 		struct _finddata_t fileinfo;
 		abs_path.append("/");
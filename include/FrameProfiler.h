@@ -0,0 +1,74 @@
+/*
+ *  FrameProfiler.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __FRAMEPROFILER_H__
+#define __FRAMEPROFILER_H__
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "CodeAttributes.h"
+
+/*
+	Frame profiler with scoped zones.
+
+	PROFILE_ZONE("name") records the time spent in the enclosing scope. While
+	the profiler is stopped, a zone costs only the check of a flag.
+
+	Each thread records into its own ring buffer, which keeps the last events,
+	so a trace written when a server lags shows the seconds before. The trace
+	is in the Chrome trace event format (chrome://tracing, Perfetto).
+
+	Zone names must be string literals (or otherwise live forever), only the
+	pointer is stored.
+*/
+
+namespace FrameProfiler {
+
+	extern bool running;
+
+	struct ZoneStats {
+		const char* name;
+		size_t calls;
+		Uint64 totalUs, maxUs;
+	};
+
+	// eventsPerThread is the size of each ring buffer
+	void start(size_t eventsPerThread = 65536);
+	void stop();
+	void reset();
+
+	Uint64 now(); // µs, monotonic. Also the clock of the Lua profiler and the metrics
+	void record(const char* name, Uint64 start);
+
+	// Zones over all buffered events, sorted by total time
+	void zoneStats(std::vector<ZoneStats>& out);
+	size_t eventCount();
+
+	void writeTrace(std::ostream& s);
+}
+
+struct ProfileZone : DontCopyTag {
+	const char* name;
+	Uint64 start;
+
+	ProfileZone(const char* n) : name(n), start(0) {
+		if(FrameProfiler::running) start = FrameProfiler::now();
+	}
+	~ProfileZone() {
+		// start is 0 if the profiler was started within the zone
+		if(start) FrameProfiler::record(name, start);
+	}
+};
+
+#define PROFILE_ZONE__CAT(a, b) a ## b
+#define PROFILE_ZONE__NAME(line) PROFILE_ZONE__CAT(profileZone_, line)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE__NAME(__LINE__) (name)
+
+#endif // __FRAMEPROFILER_H__
@@ -0,0 +1,88 @@
+/*
+ *  MPSCQueue.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __MPSCQUEUE_H__
+#define __MPSCQUEUE_H__
+
+#include <cstddef>
+
+/*
+	Unbounded multi-producer single-consumer queue without locks
+	(D. Vyukov's node based MPSC queue).
+
+	push() can be called from any thread and is one atomic exchange.
+	pop() must only be called from one thread at a time.
+
+	If a producer is interrupted within push(), pop() reports the queue as
+	empty until the producer continues, also for the elements pushed after it.
+	Nothing gets lost though, size() still counts them.
+*/
+template<typename T>
+class MPSCQueue {
+public:
+	MPSCQueue() : head(&stub), tail(&stub), count(0) { stub.next = NULL; }
+	~MPSCQueue() { T v; while(pop(v)) {} }
+
+	void push(const T& v) {
+		Node* n = new Node();
+		n->value = v;
+		__atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+		pushNode(n);
+	}
+
+	bool pop(T& v) {
+		Node* t = tail;
+		Node* next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+		if(t == &stub) {
+			if(next == NULL) return false;
+			tail = t = next;
+			next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+		}
+		if(next == NULL) {
+			if(t != __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+				return false; // a producer is in between
+			// t is the last one. Put the stub behind it so that we can take t.
+			pushNode(&stub);
+			next = __atomic_load_n(&t->next, __ATOMIC_ACQUIRE);
+			if(next == NULL) return false;
+		}
+		tail = next;
+		v = t->value;
+		delete t;
+		__atomic_sub_fetch(&count, 1, __ATOMIC_RELAXED);
+		return true;
+	}
+
+	// Can be a bit behind if called from a producer thread
+	size_t size() const { return __atomic_load_n(&count, __ATOMIC_RELAXED); }
+	bool empty() const { return size() == 0; }
+
+private:
+	struct Node {
+		Node* next;
+		T value;
+		Node() : next(NULL) {}
+	};
+
+	void pushNode(Node* n) {
+		n->next = NULL;
+		Node* prev = __atomic_exchange_n(&head, n, __ATOMIC_ACQ_REL);
+		__atomic_store_n(&prev->next, n, __ATOMIC_RELEASE);
+	}
+
+	Node* head; // producers push here
+	Node* tail; // only used by the consumer
+	Node stub;
+	size_t count;
+
+	// not copyable
+	MPSCQueue(const MPSCQueue&);
+	MPSCQueue& operator=(const MPSCQueue&);
+};
+
+#endif // __MPSCQUEUE_H__
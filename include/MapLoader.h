@@ -55,4 +55,28 @@ public:
 	void parseDataFinalize(CMap* m);
 };
 
+/*
+	On-disk cache of already parsed levels.
+
+	The result of a successful MapLoad::parseData is written to
+	cache/maps/<hash of the level file>.olxmap in the main pixel format of the
+	running game. The layers are stored as packed rows, so loading is just a
+	matter of mapping the file and copying the rows into the fresh surfaces.
+	This is the second cache level behind the in-memory map cache of CCache.
+	Dedicated servers don't load the hi-res images, so they bake separately.
+*/
+struct BakedMapCache {
+	// The hash of the level file, computed by load and reused by save
+	struct Key {
+		bool valid;
+		Uint64 hash, size;
+		Key() : valid(false), hash(0), size(0) {}
+	};
+
+	// Loads the level into m if there is a valid baked file for it. Sets key in any case.
+	static Result load(CMap* m, const std::string& filename, Key& key);
+	// Bakes the loaded level m; does nothing if it is already baked
+	static void save(CMap* m, const std::string& filename, const Key& key);
+};
+
 #endif
@@ -0,0 +1,101 @@
+/*
+ *  Metrics.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "CodeAttributes.h"
+
+/*
+	Server metrics: counters, gauges and histograms.
+
+	The metrics are global objects which register themselves, and are only
+	updated and read from the main thread. Values which already exist
+	elsewhere (client bandwidth, ping, packet loss, object counts) are not
+	duplicated, they are collected when the metrics are written.
+
+	The output is the Prometheus text format. It can be read with the
+	console / DedicatedControl command "metrics", and is served over HTTP
+	on 127.0.0.1 if Advanced.MetricsPort is set.
+*/
+
+namespace Metrics {
+
+	class Metric : DontCopyTag {
+	public:
+		Metric(const char* name, const char* help, const char* type);
+		virtual ~Metric() {}
+
+		const char* name() const { return m_name; }
+		virtual void write(std::ostream& s) const = 0;
+
+	protected:
+		const char* m_name;
+		const char* m_help;
+		const char* m_type;
+		void writeHeader(std::ostream& s) const;
+	};
+
+	class Counter : public Metric {
+	public:
+		Counter(const char* name, const char* help) : Metric(name, help, "counter"), m_value(0) {}
+		void inc(double v = 1) { m_value += v; }
+		double value() const { return m_value; }
+		void write(std::ostream& s) const;
+	private:
+		double m_value;
+	};
+
+	class Gauge : public Metric {
+	public:
+		Gauge(const char* name, const char* help) : Metric(name, help, "gauge"), m_value(0) {}
+		void set(double v) { m_value = v; }
+		double value() const { return m_value; }
+		void write(std::ostream& s) const;
+	private:
+		double m_value;
+	};
+
+	class Histogram : public Metric {
+	public:
+		// bounds are the upper bounds of the buckets, ascending
+		Histogram(const char* name, const char* help, const double* bounds, size_t count);
+		void observe(double v);
+		void write(std::ostream& s) const;
+	private:
+		std::vector<double> m_bounds;
+		std::vector<Uint64> m_counts; // one more than bounds, for +Inf
+		double m_sum;
+		Uint64 m_count;
+	};
+
+	// Game::frame reports its duration without the time waited in CapFPS
+	void frameDone(Uint64 durationUs);
+	// Reported for each simulation frame
+	void simulationDelay(int delayMs, bool high);
+	void simulationSkipped(int ms);
+
+	// Times the outermost Lua calls
+	struct LuaCallTimer : DontCopyTag {
+		Uint64 start;
+		LuaCallTimer();
+		~LuaCallTimer();
+	};
+
+	void writePrometheus(std::ostream& s);
+
+	// Serves the metrics on Advanced.MetricsPort, called every frame
+	void processServer();
+	void shutdownServer();
+}
+
+#endif // __METRICS_H__
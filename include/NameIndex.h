@@ -0,0 +1,144 @@
+/*
+ *  NameIndex.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __NAMEINDEX_H__
+#define __NAMEINDEX_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tr1/unordered_map>
+
+
+// Case-insensitive hash and equality, for hashed containers with string keys
+struct stringcasehash {
+	size_t operator()(const std::string& s) const;
+};
+
+struct stringcaseequalfct {
+	bool operator()(const std::string& s1, const std::string& s2) const;
+};
+
+
+/*
+	Case-insensitive prefix tree of names.
+
+	complete() only walks the part of the tree below the prefix. With a stop
+	char, it doesn't even walk the subtrees behind the first stop char, so
+	completing "GameOptions." gives the sections and not all the options.
+*/
+class PrefixTree {
+public:
+	PrefixTree() {}
+	~PrefixTree() { clear(); }
+
+	void insert(const std::string& name);
+	void erase(const std::string& name);
+	void clear();
+	bool empty() const { return root.count == 0; }
+
+	// Adds all names which start with prefix to out, sorted. If stop is set, the
+	// names are cut behind the first stop char after the prefix and the cut
+	// names are added only once.
+	void complete(const std::string& prefix, std::vector<std::string>& out, char stop = '\0') const;
+
+private:
+	struct Node {
+		typedef std::map<char, Node*> Children; // key is the lowercase char
+		Children children;
+		std::string name; // spelling as inserted, if a name ends here
+		bool terminal;
+		size_t count; // names in this subtree
+		Node() : terminal(false), count(0) {}
+	};
+
+	static void deleteChildren(Node& n);
+	static const std::string& anyName(const Node* n);
+	static void collect(const Node* n, size_t depth, std::vector<std::string>& out, char stop);
+
+	Node root;
+
+	// not copyable
+	PrefixTree(const PrefixTree&);
+	PrefixTree& operator=(const PrefixTree&);
+};
+
+
+/*
+	Case-insensitive hashed registry of interned names.
+
+	Every name gets a handle once and keeps it for the lifetime of the index,
+	also when its object gets unregistered and registered again. Callers can
+	keep the handle and skip the name lookup next time.
+*/
+template<typename T>
+class NameIndex {
+public:
+	typedef size_t Handle;
+	static const Handle Invalid = Handle(-1);
+
+	// Returns the handle for name, creates one if needed.
+	Handle intern(const std::string& name) {
+		typename Handles::iterator it = handles.find(name);
+		if(it != handles.end()) return it->second;
+		Handle h = entries.size();
+		entries.push_back(Entry(name));
+		handles[name] = h;
+		return h;
+	}
+
+	// Invalid if the name was never interned
+	Handle find(const std::string& name) const {
+		typename Handles::const_iterator it = handles.find(name);
+		if(it == handles.end()) return Invalid;
+		return it->second;
+	}
+
+	// obj == NULL unregisters the name
+	void set(Handle h, T* obj, bool completable = true) {
+		Entry& e = entries[h];
+		const bool inTree = obj && completable;
+		if(inTree && !e.inTree) tree.insert(e.name);
+		else if(!inTree && e.inTree) tree.erase(e.name);
+		e.inTree = inTree;
+		e.obj = obj;
+	}
+
+	// Like intern() and set(), but the name also takes this spelling
+	Handle add(const std::string& name, T* obj, bool completable = true) {
+		Handle h = intern(name);
+		set(h, NULL);
+		entries[h].name = name;
+		set(h, obj, completable);
+		return h;
+	}
+
+	T* get(Handle h) const { return (h < entries.size()) ? entries[h].obj : NULL; }
+	T* get(const std::string& name) const { return get(find(name)); }
+	const std::string& name(Handle h) const { return entries[h].name; }
+
+	// See PrefixTree::complete. Only registered completable names are completed.
+	void complete(const std::string& prefix, std::vector<std::string>& out, char stop = '\0') const {
+		tree.complete(prefix, out, stop);
+	}
+
+private:
+	struct Entry {
+		std::string name;
+		T* obj;
+		bool inTree;
+		Entry(const std::string& n) : name(n), obj(NULL), inTree(false) {}
+	};
+	typedef std::tr1::unordered_map<std::string, Handle, stringcasehash, stringcaseequalfct> Handles;
+
+	std::vector<Entry> entries;
+	Handles handles;
+	PrefixTree tree;
+};
+
+#endif // __NAMEINDEX_H__
@@ -0,0 +1,108 @@
+/*
+ *  NetworkImpairment.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __NETWORKIMPAIRMENT_H__
+#define __NETWORKIMPAIRMENT_H__
+
+#include <map>
+#include <string>
+#include <SDL.h>
+#include "olx-types.h"
+#include "Networking.h"
+#include "SmartPointer.h"
+
+/*
+	Simulates a bad network link on top of a NetworkSocket.
+
+	All outgoing UDP packets of a socket with an impairment attached are not sent
+	directly but put into a delay queue. They leave the queue when the simulated
+	link has delivered them (latency + jitter + bandwidth), or they are dropped,
+	duplicated or reordered. All random decisions are taken from an own seeded
+	generator and all times are based on tLX->currentTime, so a run with the same
+	seed and the same frame times is completely reproducible.
+*/
+
+struct NetworkImpairmentSettings {
+	int		latency;		// one-way delay in ms
+	int		jitter;			// additional random delay in [0,jitter] ms
+	float	loss;			// probability [0,1] that a packet gets lost
+	float	duplicate;		// probability [0,1] that a packet is sent twice
+	float	reorder;		// probability [0,1] that a packet gets held back behind the following ones
+	int		bandwidth;		// link capacity in bytes/sec, 0 = unlimited
+	int		queueLimit;		// max ms of data queued on a saturated link before tail-dropping
+	Uint32	seed;
+
+	NetworkImpairmentSettings() :
+		latency(0), jitter(0), loss(0), duplicate(0), reorder(0), bandwidth(0), queueLimit(1000), seed(0) {}
+
+	bool isActive() const { return latency > 0 || jitter > 0 || loss > 0 || duplicate > 0 || reorder > 0 || bandwidth > 0; }
+	std::string asString() const;
+
+	// Reads the Network.Sim* options
+	static NetworkImpairmentSettings fromOptions();
+};
+
+class NetworkImpairment {
+public:
+	struct Stats {
+		size_t	packetsIn;			// packets written by the user
+		size_t	packetsSent;		// packets which actually reached the real socket
+		size_t	packetsLost;
+		size_t	packetsDuplicated;
+		size_t	packetsReordered;
+		size_t	packetsTailDropped;	// dropped because the bandwidth queue was full
+		size_t	bytesIn;
+		size_t	bytesSent;
+		Stats() { reset(); }
+		void reset();
+		std::string asString() const;
+	};
+
+private:
+	struct Packet {
+		NetworkAddr addr;
+		std::string data;
+	};
+	// key is the delivery time in ms; multimap keeps insertion order for equal keys
+	typedef std::multimap<Uint64, Packet> Queue;
+
+	NetworkImpairmentSettings m_settings;
+	Queue	m_queue;
+	Uint64	m_linkFreeTime;		// time when the simulated link has sent all previous data
+	Uint32	m_rndState;
+	Stats	m_stats;
+
+	Uint32	nextRandom();
+	float	nextRandomPos(); // [0,1)
+	void	enqueue(Uint64 deliveryTime, const NetworkAddr& addr, const void* buffer, int nbytes);
+
+public:
+	NetworkImpairment(const NetworkImpairmentSettings& settings);
+
+	const NetworkImpairmentSettings& settings() const { return m_settings; }
+	const Stats& stats() const { return m_stats; }
+	size_t queuedPackets() const { return m_queue.size(); }
+
+	// Called by NetworkSocket::Write. Returns the number of bytes the user wrote,
+	// as the packet always "leaves" from the user point of view.
+	int		write(NetworkSocket& sock, const void* buffer, int nbytes);
+	// Sends all packets whose delivery time has come. Called by NetworkSocket::Read/Write.
+	void	flush(NetworkSocket& sock);
+	// Drops all queued packets (e.g. when the socket gets closed).
+	void	clear();
+};
+
+// Attaches a new impairment from the Network.Sim* options if any is active.
+// streamId is mixed into the seed so that different sockets get different but reproducible streams.
+void ApplyNetworkImpairmentFromOptions(NetworkSocket& sock, Uint32 streamId);
+
+// Runs a simulated server with numClients clients over impaired sockets, in simulated time,
+// and prints transfer statistics and state divergence.
+void TestNetworkSimulation(int numClients, const NetworkImpairmentSettings& settings);
+
+#endif // __NETWORKIMPAIRMENT_H__
@@ -78,6 +78,7 @@ bool	GetFromDnsCache(const std::string& name, NetworkAddr& addr);
 bool	InitNetworkSystem();
 bool	QuitNetworkSystem();
 
+class NetworkImpairment;
 
 class NetworkSocket {
 public:
@@ -112,6 +113,10 @@ private:
 	friend struct InternSocket;
 	struct EventHandler; friend struct EventHandler;
 	void checkEventHandling();
+	friend class NetworkImpairment;
+	int WriteDirect(const void* buffer, int nbytes);
+	bool writeLoopback(const void* buffer, int nbytes);
+	void updateLoopback();
 	
 	// Don't copy instances of this class! Use SmartPointer if you want to have multiple references to a socket.
 	// You can swap two NetworkSockets though.
@@ -153,6 +158,21 @@ public:
 	
 	bool isDataAvailable(); // Slow!
 
+	int systemSocket() const; // the OS socket, -1 if not open
+	static unsigned int closeCount(); // changes with every Close(), an OS socket might be reused since then
+
+	// In-process delivery of UDP packets between our own sockets, for the local client.
+	// If both this socket and the destination (127.0.0.1:port) have it set, Write() puts the
+	// packet directly into the queue of the other socket, which Read() returns before asking
+	// the OS, with 127.0.0.1:ourport as remote address. See Advanced.LocalLoopback.
+	void setLocalLoopback(bool v);
+	bool localLoopback() const;
+	Port localLoopbackPort() const; // 0 if the socket is not registered for the loopback
+
+	// Simulated bad network link, see NetworkImpairment.h. Only applies to UDP sockets.
+	void setImpairment(const SmartPointer<NetworkImpairment>& imp);
+	SmartPointer<NetworkImpairment> impairment() const;
+
 	// WARNING: Don't use!
 	void	WaitForSocketWrite(int timeout);
 	void	WaitForSocketRead(int timeout);
@@ -121,6 +121,16 @@ INLINE void Execute(CmdLineIntf* sender, const SmartPointer<CmdLineIntf::ExecSco
 
 bool havePendingCommands();
 
+struct CommandQueueStats {
+	size_t depth, maxDepth; // pending commands at the start of HandlePendingCommands()
+	uint64_t executed;
+	uint64_t latencySum; // in ms, from Execute() until the command runs
+	Uint32 lastLatency, maxLatency;
+	uint64_t budgetHits; // frames where Advanced.CommandTimeBudget left commands for the next frame
+	CommandQueueStats() : depth(0), maxDepth(0), executed(0), latencySum(0), lastLatency(0), maxLatency(0), budgetHits(0) {}
+};
+const CommandQueueStats& getCommandQueueStats();
+
 // Executes all commands in the queue. This is called from the gameloopthread.
 void HandlePendingCommands();
 
@@ -220,6 +220,7 @@ public:
 	// Video
 	bool	bFullscreen;
 	bool	bShowFPS;
+	bool	bRenderInterpolation;
 	bool	bOpenGL;
 	std::string	sResolution;
 	std::string sVideoPostProcessor;
@@ -234,6 +235,15 @@ public:
 	std::string	sHttpProxy;
 	bool	bAutoSetupHttpProxy;
 
+	// Simulated bad network link for all game sockets (see NetworkImpairment.h), for testing only
+	int		iNetSimLatency;			// ms
+	int		iNetSimJitter;			// ms
+	float	fNetSimLoss;			// [0,1]
+	float	fNetSimDuplicate;		// [0,1]
+	float	fNetSimReorder;			// [0,1]
+	int		iNetSimBandwidth;		// bytes/sec, 0 = unlimited
+	int		iNetSimSeed;
+
 	bool	bRegServer;
 	std::string	sServerName;
 	std::string	sWelcomeMessage;
@@ -303,7 +313,15 @@ public:
     int     nMaxFPS;
 	int		iJpegQuality;
 	int		iMaxCachedEntries;		// Amount of entries to cache, including maps, mods, images and sounds.
+	bool	bBakedMapCache;			// Keep parsed levels on disk for faster loading, see BakedMapCache
+	bool	bGusanosScriptCache;	// Keep compiled Gusanos scripts on disk, see ScriptCache
 	bool	bMatchLogging;			// Save screenshot of every game final score
+	int		iCommandTimeBudget;		// ms per frame for executing queued commands, 0 is unlimited
+	int		iLuaGCBudget;			// ms per frame for the Lua garbage collector, 0 lets Lua collect on its own
+	bool	bLocalLoopback;			// Local client and server exchange packets in-process, see CChannel_Local and NetworkSocket::setLocalLoopback
+	bool	bDedicatedEventLoop;	// Dedicated server waits on its sockets instead of sleeping, see DedicatedLoop
+	int		iDedicatedIdleWait;		// ms the dedicated server may wait for something to happen outside of a game
+	int		iMetricsPort;			// Serve the server metrics over HTTP on 127.0.0.1 at this port, 0 is off. See Metrics.h
 	bool	bRecoverAfterCrash;		// If we should try to recover after segfault etc, or generate coredump and quit
 	bool	bCheckForUpdates;		// Check for new development version on sourceforge.net
 
@@ -0,0 +1,98 @@
+/*
+ *  RenderQueue.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+#include <vector>
+#include <SDL.h>
+#include "Color.h"
+
+class CViewport;
+
+/*
+	Collects the draw commands of the game objects of one viewport (projectiles,
+	entities, shadows, Gusanos objects) and executes them together:
+
+	- everything which is completely outside of the clipping rect of the
+	  destination is dropped in one pass over the queue,
+	- the commands are sorted by layer, then by kind and texture (the order
+	  of commands with the same key is kept),
+	- runs of pixel commands are drawn with a single surface lock.
+
+	Things which don't fit into the simple commands (polygons, beams, Gusanos
+	objects with their blenders and Lua) are queued as custom commands which
+	call back into the object.
+*/
+
+class RenderQueue {
+public:
+	enum Layer {
+		L_Shadow = 0,
+		L_Entity,
+		L_Projectile,
+		L_Object,
+	};
+
+	typedef void (*DrawFunc)(void* obj, SDL_Surface* bmpDest, CViewport* v);
+
+	// Draws a 2x2 rect at x,y with the clipping rules of DrawRectFill2x2()
+	void addPixel2x2(Layer l, int x, int y, Color c);
+	// Same as DrawImageAdv()
+	void addImage(Layer l, SDL_Surface* img, int sx, int sy, int dx, int dy, int w, int h);
+	// Same as DrawRectFill()
+	void addRectFill(Layer l, int x, int y, int x2, int y2, Color c);
+	// Calls func(obj, bmpDest, v). It is never culled.
+	void addCustom(Layer l, DrawFunc func, void* obj);
+	// Calls func(obj, bmpDest, v) if x,y,w,h is (partly) visible.
+	void addCustom(Layer l, DrawFunc func, void* obj, int x, int y, int w, int h);
+
+	// Culls, sorts and draws all queued commands. The queue is empty afterwards.
+	void flush(SDL_Surface* bmpDest, CViewport* v);
+	void clear() { commands.clear(); }
+
+	size_t size() const { return commands.size(); }
+
+	// Of the last flush()
+	struct Stats {
+		size_t queued, culled, locks;
+		Stats() : queued(0), culled(0), locks(0) {}
+	};
+	const Stats& lastStats() const { return stats; }
+
+private:
+	enum Kind { K_Image = 0, K_RectFill, K_Pixel2x2, K_Custom };
+
+	struct Command {
+		Uint8 layer, kind;
+		bool cullable;
+		int x, y, w, h; // bounds in destination coordinates
+		Color color;
+		SDL_Surface* image;
+		int sx, sy;
+		DrawFunc func;
+		void* obj;
+	};
+
+	struct Order {
+		bool operator()(const Command& a, const Command& b) const {
+			if(a.layer != b.layer) return a.layer < b.layer;
+			if(a.kind != b.kind) return a.kind < b.kind;
+			return a.image < b.image;
+		}
+	};
+
+	Command& add(Layer l, Kind k);
+	void cull(const SDL_Surface* bmpDest);
+	void drawPixels(SDL_Surface* bmpDest, std::vector<Command>::const_iterator begin, std::vector<Command>::const_iterator end);
+
+	std::vector<Command> commands;
+	Stats stats;
+};
+
+#endif // __RENDERQUEUE_H__
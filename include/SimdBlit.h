@@ -0,0 +1,81 @@
+/*
+ *  SimdBlit.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#ifndef __SIMDBLIT_H__
+#define __SIMDBLIT_H__
+
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+/*
+	Row kernels for the hot 32bit blit loops, in a portable C version, an
+	SSE2 version and an AVX2 version. The best version the CPU supports is
+	selected once at runtime (see level()), so the binary itself doesn't need
+	to be compiled for a specific CPU.
+
+	All kernels work on a single row of 32bit pixels; clipping, locking and
+	format checks are left to the callers (GfxPrimitives, Gusanos blitters).
+	All versions of a kernel give exactly the same result.
+*/
+
+namespace SimdBlit {
+
+enum Level {
+	Scalar = 0,
+	SSE2,
+	AVX2
+};
+
+std::string levelName(Level l);
+
+// The level which is used right now
+Level level();
+// The best level this CPU supports
+Level detectedLevel();
+// Restricts the used level, e.g. because the user disabled SSE.
+void setMaxLevel(Level l);
+
+// Pixels which have (pixel & keyMask) == key are skipped.
+void copyRowKey(Uint32* dst, const Uint32* src, int n, Uint32 key, Uint32 keyMask);
+
+// SDL style alpha blending of RGBA source pixels (alpha in the upper 8 bits)
+// onto an opaque destination, like _PutPixel<false,true,4>:
+// d = ((255 - a) * d + a * s) >> 8 for each channel, then masked with dstMask.
+void blendRowAlpha(Uint32* dst, const Uint32* src, int n, Uint32 dstMask);
+
+// The Gusanos blenders. They work per channel (including the upper 8 bits)
+// with the same rounding as the former MMX versions:
+// blendFact: d += (s - d) * fact >> 8, source pixels equal to key are skipped
+void blendRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key);
+// blendAlphaFact: like blendFact, but fact is scaled with the alpha of each source pixel
+void blendRowAlphaFact(Uint32* dst, const Uint32* src, int n, int fact);
+// addFact: d = min(255, d + (s * fact >> 8)), source pixels equal to key are skipped
+void addRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key);
+// addColor: d = min(255, d + c) for a fixed color
+void addRowColor(Uint32* dst, int n, Uint32 color);
+// mult: d = d * s >> 8 with an 8bit source
+void multRow8(Uint32* dst, const Uint8* src, int n);
+
+// Every source pixel is written as 2x2 block into dst1 (upper row) and dst2 (lower row).
+void stretch2Row(Uint32* dst1, Uint32* dst2, const Uint32* src, int n);
+void stretch2RowKey(Uint32* dst1, Uint32* dst2, const Uint32* src, int n, Uint32 key, Uint32 keyMask);
+
+// One row of the Scale2x algorithm. above/below are the neighbour rows of src
+// (pass src itself at the image borders). The pixels left of src[0] and right of
+// src[n-1] are taken as src[0] and src[n-1].
+void scale2xRow(Uint32* dst1, Uint32* dst2, const Uint32* above, const Uint32* src, const Uint32* below, int n);
+
+// Measures the throughput of all kernels for all supported levels at common
+// surface sizes. Returns one line per kernel and size. kernelFilter selects
+// a single kernel by name (e.g. "blendAlpha"), all kernels if empty.
+std::vector<std::string> benchmark(const std::string& kernelFilter = "");
+
+}
+
+#endif // __SIMDBLIT_H__
@@ -127,6 +127,7 @@ INLINE bool		strStartsWith(const std::string& str, const std::string& start) { i
 INLINE bool		strCaseStartsWith(const std::string& str, const std::string& start) { if(start.size() > str.size()) return false; return subStrCaseEqual(str,start,start.size()); }
 size_t			maxStartingEqualStr(const std::list<std::string>& strs);
 size_t			maxStartingCaseEqualStr(const std::list<std::string>& strs);
+size_t			maxStartingCaseEqualStr(const std::vector<std::string>& strs);
 std::vector<std::string> splitstring(const std::string& str, size_t maxlen, size_t maxwidth, class CFont& font);
 std::string		splitStringWithNewLine(const std::string& str, size_t maxlen, size_t maxwidth, class CFont& font);
 std::string		GetFileExtension(const std::string& filename);
@@ -72,13 +72,16 @@ std::string		GetDateTime();
 /*
 	Timer class
 
-	After start(), there is a thread which will push frequently events to the
-	SDL event queue. It will use the settings at the time of starting the timer.
-	All later changes are ignored. If you hit start again, the current thread
-	will stop and a new one with the new settings will be started. stop() will
-	stop the timer.
+	After start(), the timer is in the global timer wheel, which will push
+	frequently events to the SDL event queue. It will use the settings at the
+	time of starting the timer. All later changes are ignored. If you hit start
+	again, the current timer will stop and a new one with the new settings will
+	be started. stop() will stop the timer.
 	
-	After stop() returns, no more events belonging to this thread
+	There are no threads per timer; a single ticker thread and the main loop
+	(ProcessTimers()) drive the wheel.
+	
+	After stop() returns, no more events belonging to this timer
 	will be handled (this is guaranteed). Though it's possible that there
 	is one last event handled exactly at the time of calling stop() when
 	calling it from another thread than the main thread. If you call stop()
@@ -87,10 +90,10 @@ std::string		GetDateTime();
 	The events itself will be handled in the main thread
 	(in the thread that calls ProcessEvents()).
 
-	If the callback-functions returns false, the thread will also stop.
+	If the callback-functions returns false, the timer will also stop.
 
 	You can also use startHeadless() which will run independently from the
-	object. That means that stop() has no effect on the thread. The only
+	object. That means that stop() has no effect on the timer. The only
 	possibility to break the timer is to return false from within the callback.
 	
 	userData can be used to point to some additional data. It's just a pointer,
@@ -140,6 +143,8 @@ private:
 
 void InitializeTimers();
 void ShutdownTimers();
+// Pushes the events of the expired timers, called from the main loop
+void ProcessTimers();
 
 
 // A class for profiling - measures the time between being constructed and destructed
@@ -76,6 +76,9 @@
 #include "CClient.h"
 #include "CServer.h"
 #include "Geometry.h"
+#include "DedicatedLoop.h"
+#include "game/Game.h"
+#include "MathLib.h"
 
 
 Null null;	// Used in timer class
@@ -539,6 +542,17 @@ void CapFPS() {
 	const AbsTime currentTime = GetTime();
 	// tLX->currentTime is old time
 
+	if(bDedicated) {
+		TimeDiff timeout;
+		if(currentTime - tLX->currentTime < fMaxFrameTime)
+			timeout = fMaxFrameTime - (currentTime - tLX->currentTime);
+		// No simulation to run, wait for packets or commands
+		if(game.state < Game::S_Preparing)
+			timeout = MAX(timeout, TimeDiff(tLXOptions->iDedicatedIdleWait));
+		if(DedicatedLoopWait(timeout))
+			return;
+	}
+
 	// Cap the FPS
 	if(currentTime - tLX->currentTime < fMaxFrameTime)
 		SDL_Delay((Uint32)(fMaxFrameTime - (currentTime - tLX->currentTime)).milliseconds());
@@ -33,6 +33,7 @@
 #include "CServer.h"
 #include "AuxLib.h"
 #include "Networking.h"
+#include "NetworkImpairment.h"
 #include "Timer.h"
 #include "XMLutils.h"
 #include "CClientNetEngine.h"
@@ -102,6 +103,7 @@ void CClient::Clear()
 	iLastKiller = -1;
 
 	tSocket = new NetworkSocket();
+	tSocket->setLocalLoopback(true); // in-process to our own server, if it is one
 	SetNetAddrValid( cServerAddr, false );
 
 	cChatbox.Clear();
@@ -255,6 +257,7 @@ CClient::CClient() {
 	iNetSpeed = 3;
 	fLastUpdateSent = AbsTime();
 	tSocket = new NetworkSocket();
+	tSocket->setLocalLoopback(true); // in-process to our own server, if it is one
 	SetNetAddrValid( cServerAddr, false );
 	bLocalClient = false;
 	
@@ -329,6 +332,7 @@ int CClient::Initialize()
 		SetError("Error: Could not open UDP socket!");
 		return false;
 	}
+	ApplyNetworkImpairmentFromOptions(*tSocket.get(), 1000);
 
 	if(bDedicated)
 		cChatList = NULL;
@@ -1066,6 +1070,10 @@ bool CClient::ReadPackets()
 		}
 	}
 
+	// Our own server hands its packets over directly, see CChannel_Local
+	if(cNetChan && iNetStatus != NET_DISCONNECTED && iNetStatus != NET_CONNECTING)
+		cNetChan->ReceiveDirect(outstandingPackets);
+
 	while(!outstandingPackets.empty()) {
 		anythingNew = true;
 		CBytestream& bs = outstandingPackets.front();
@@ -2143,6 +2151,10 @@ CChannel * CClient::createChannel(const Version& v)
 {
 	if( cNetChan )
 		delete cNetChan;
+	// Our own server hands the bytestreams over directly, see CChannel_Local
+	cNetChan = CChannel_Local::createForClient( tSocket.get() ? tSocket->localLoopbackPort() : 0 );
+	if( cNetChan )
+		return cNetChan;
 	if( v >= OLXBetaVersion(0,58,1) )
 		cNetChan = new CChannel3();
 	else if( v >= OLXBetaVersion(6) )
@@ -1251,21 +1251,25 @@ void CClient::DrawViewport(SDL_Surface * bmpDest, int viewport_index)
 }
 
 ///////////////////
-// Draw the projectiles
-void CClient::DrawProjectiles(SDL_Surface * bmpDest, CViewport *v)
+// Queue the projectiles for drawing
+void CClient::DrawProjectiles(RenderQueue& queue, CViewport *v)
 {
 	for(Iterator<CProjectile*>::Ref i = cProjectiles.begin(); i->isValid(); i->next()) {
-		i->get()->Draw(bmpDest, v);
+		i->get()->Draw(queue, v);
 	}
 }
 
 
 ///////////////////
-// Draw the projectile shadows
-void CClient::DrawProjectileShadows(SDL_Surface * bmpDest, CViewport *v)
+// Queue the projectile shadows for drawing
+void CClient::DrawProjectileShadows(RenderQueue& queue)
 {
+	// Don't draw projectile shadows with FPS <= 10 to get a little better performance
+	if (tLX->fDeltaTime >= 0.1f)
+		return;
+
 	for(Iterator<CProjectile*>::Ref i = cProjectiles.begin(); i->isValid(); i->next()) {
-		i->get()->DrawShadow(bmpDest, v);
+		i->get()->QueueShadow(queue);
 	}
 }
 
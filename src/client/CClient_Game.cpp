@@ -45,6 +45,7 @@
 #include "game/Sounds.h"
 #include "CGameScript.h"
 #include "util/Random.h"
+#include "FrameProfiler.h"
 
 
 CClient		*cClient = NULL;
@@ -60,6 +61,7 @@ bool CClient::shouldDoProjectileSimulation() {
 // Simulation
 void CClient::Simulation()
 {
+	PROFILE_ZONE("physics");
 	// Don't simulate if the physics engine is not ready
 	if (!PhysicsEngine::Get() || !PhysicsEngine::Get()->isInitialised())  {
 		errors << "WARNING: trying to simulate with non-initialized physics engine!" << endl;
@@ -330,6 +330,14 @@ void CClientNetEngine::ParseConnected(CBytestream *bs)
 		delete client->cNetChan;
 		client->cNetChan = NULL;
 	}
+	if( isReconnect && client->cNetChan ) {
+		// Our own server has made a new link on the reconnect, or the other way around, see CChannel_Local
+		CChannel_Local* local = dynamic_cast<CChannel_Local*>(client->cNetChan);
+		if( local ? !local->isCurrent() : CChannel_Local::hasLink(client->tSocket->localLoopbackPort()) ) {
+			delete client->cNetChan;
+			client->cNetChan = NULL;
+		}
+	}
 	
 	if( client->cNetChan == NULL ) {
 		if( ! client->createChannel( std::min( client->getServerVersion(), GetGameVersion() ) ) )
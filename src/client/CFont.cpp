@@ -34,6 +34,22 @@
 
 // For font drawing use FontGenerator tool in /tools/fontgenerator
 
+
+//
+// Caches: the whole font is precalculated for each used colour (the atlases), and each drawn string
+// is laid out once. A string which is drawn again in the same colour is rendered into an own surface,
+// so it is drawn with a single blit. All of them forget the least recently used entries.
+//
+static const size_t MAX_ATLASES = 32;
+static const size_t MAX_LAYOUTS = 1024;
+static const size_t MAX_RUNS = 1024;
+static const size_t MAX_RUN_PIXELS = 2 * 1024 * 1024; // 8 MB
+
+static std::string ColourKey(Color col) {
+	const Uint32 c = col.getDefault();
+	return std::string((const char *)&c, sizeof(c));
+}
+
 ///////////////////
 // Load a font
 int CFont::Load(const std::string& fontname, bool _colour) {
@@ -46,20 +62,15 @@ int CFont::Load(const std::string& fontname, bool _colour) {
 
 	Colorize = _colour;
 
-	bmpWhite = gfxCreateSurfaceAlpha(bmpFont.get()->w, bmpFont.get()->h);
-	bmpGreen = gfxCreateSurfaceAlpha(bmpFont.get()->w, bmpFont.get()->h);
+	ClearCaches();
 
 	// Calculate the width of each character and number of characters
 	Parse();
 
-	// Pre-calculate some colours
-	f_white = tLX->clNormalLabel;
-	f_green = tLX->clChatText;
-
 	// Precache some common font colors (but only if this font should be colorized)
 	if (Colorize) {
-		PreCalculate(bmpWhite, f_white);
-		PreCalculate(bmpGreen, f_green);
+		GetAtlas(tLX->clNormalLabel);
+		GetAtlas(tLX->clChatText);
 	}
 
 	return true;
@@ -69,6 +80,7 @@ int CFont::Load(const std::string& fontname, bool _colour) {
 ///////////////////
 // Shutdown the font
 void CFont::Shutdown() {
+	ClearCaches();
 }
 
 
@@ -166,7 +178,7 @@ void CFont::PreCalculate(const SmartPointer<SDL_Surface> & bmpSurf, Color colour
 	LOCK_OR_QUIT(bmpFont);
 
 	Uint8 R, G, B, A;
-	const Uint8 sr = colour.r, sg = colour.g, sb = colour.b;
+	const Uint8 sr = colour.r, sg = colour.g, sb = colour.b, sa = colour.a;
 
 	// Outline font: replace white pixels with appropriate color, put black pixels
 	if (OutlineFont) {
@@ -177,10 +189,10 @@ void CFont::PreCalculate(const SmartPointer<SDL_Surface> & bmpSurf, Color colour
 
 				if (R == 255 && G == 255 && B == 255)    // White
 					PutPixel(bmpSurf.get(), x, y,
-					         SDL_MapRGBA(bmpSurf.get()->format, sr, sg, sb, A));
+					         SDL_MapRGBA(bmpSurf.get()->format, sr, sg, sb, (A * sa) / 255));
 				else if (!R && !G && !B)   // Black
 					PutPixel(bmpSurf.get(), x, y,
-					         SDL_MapRGBA(bmpSurf.get()->format, 0, 0, 0, A));
+					         SDL_MapRGBA(bmpSurf.get()->format, 0, 0, 0, (A * sa) / 255));
 			}
 		}
 	// Not outline: replace black pixels with appropriate color
@@ -192,7 +204,7 @@ void CFont::PreCalculate(const SmartPointer<SDL_Surface> & bmpSurf, Color colour
 
 				if (!R && !G && !B)   // Black
 					PutPixel(bmpSurf.get(), x, y,
-					         SDL_MapRGBA(bmpSurf.get()->format, sr, sg, sb, A));
+					         SDL_MapRGBA(bmpSurf.get()->format, sr, sg, sb, (A * sa) / 255));
 			}
 		}
 	}
@@ -204,6 +216,131 @@ void CFont::PreCalculate(const SmartPointer<SDL_Surface> & bmpSurf, Color colour
 }
 
 
+///////////////////
+// Forget all cached atlases, layouts and runs
+void CFont::ClearCaches() {
+	Layouts.clear();
+	Atlases.clear();
+	Runs.clear();
+	RunPixels = 0;
+}
+
+///////////////////
+// Get the font precalculated in the given colour, NULL if it cannot be created
+SmartPointer<SDL_Surface> CFont::GetAtlas(Color col) {
+	if (col == tLX->clBlack)
+		return bmpFont;
+
+	const std::string key = ColourKey(col);
+	SmartPointer<SDL_Surface>* cached = Atlases.find(key);
+	if (cached)
+		return *cached;
+
+	SmartPointer<SDL_Surface> atlas = gfxCreateSurfaceAlpha(bmpFont.get()->w, bmpFont.get()->h);
+	if (!atlas.get())
+		return NULL;
+	PreCalculate(atlas, col);
+
+	if (Atlases.size() >= MAX_ATLASES)
+		Atlases.removeLast();
+	Atlases.insert(key) = atlas;
+	return atlas;
+}
+
+///////////////////
+// Get the glyph positions and the width of the text
+const CFont::Layout& CFont::GetLayout(const std::string& txt) {
+	Layout* cached = Layouts.find(txt);
+	if (cached)
+		return *cached;
+
+	if (Layouts.size() >= MAX_LAYOUTS)
+		Layouts.removeLast();
+	Layout& layout = Layouts.insert(txt);
+	layout.width = 0;
+	layout.lines = 1;
+
+	int x = 0;
+	for (std::string::const_iterator p = txt.begin(); p != txt.end();) {
+		if (*p == '\n') {
+			x = 0;
+			layout.lines++;
+			p++;
+			continue;
+		}
+
+		int l = TranslateCharacter(p, txt.end()); // HINT: increases the iterator
+		if (l == -1)
+			continue;
+
+		Glyph g = { l, x, layout.lines - 1 };
+		layout.glyphs.push_back(g);
+		x += FontWidth[l] + Spacing;
+		layout.width = MAX(layout.width, x);
+	}
+
+	return layout;
+}
+
+///////////////////
+// Get the text rendered from the given atlas, NULL if it should be drawn glyph by glyph
+SmartPointer<SDL_Surface> CFont::GetRun(const std::string& txt, Color col, const SmartPointer<SDL_Surface>& atlas) {
+	const std::string key = ColourKey(col) + txt;
+	Run* run = Runs.find(key);
+
+	// Text that changes all the time (timers, pings) is not worth a surface, so only render it when it repeats
+	if (!run) {
+		while (Runs.size() >= MAX_RUNS || (RunPixels > MAX_RUN_PIXELS && Runs.size())) {
+			RunPixels -= Runs.last().pixels;
+			Runs.removeLast();
+		}
+		Run& r = Runs.insert(key);
+		r.surf = NULL;
+		r.pixels = 0;
+		return NULL;
+	}
+	if (run->surf.get())
+		return run->surf;
+
+	const Layout& layout = GetLayout(txt);
+	const int h = bmpFont.get()->h;
+	const int w = layout.width;
+	const int total_h = layout.lines * (h + VSpacing) - VSpacing;
+	if (w <= 0 || total_h <= 0 || (size_t)(w * total_h) > MAX_RUN_PIXELS / 4)
+		return NULL;
+
+	SmartPointer<SDL_Surface> surf = gfxCreateSurfaceAlpha(w, total_h);
+	if (!surf.get())
+		return NULL;
+	FillSurface(surf.get(), SDL_MapRGBA(surf.get()->format, 255, 0, 255, 0));
+
+	// Glyphs never overlap, so they are copied as they are (blitting would leave the alpha of the target)
+	if (!LockSurface(surf))
+		return NULL;
+	if (!LockSurface(atlas)) {
+		UnlockSurface(surf);
+		return NULL;
+	}
+	const short bpp = surf.get()->format->BytesPerPixel;
+	for (std::vector<Glyph>::const_iterator g = layout.glyphs.begin(); g != layout.glyphs.end(); ++g) {
+		const Uint8 *src = (Uint8 *)atlas.get()->pixels + CharacterOffset[g->index] * bpp;
+		Uint8 *dst = (Uint8 *)surf.get()->pixels + g->line * (h + VSpacing) * surf.get()->pitch + g->x * bpp;
+		for (int j = 0; j < h; ++j) {
+			memcpy(dst, src, FontWidth[g->index] * bpp);
+			src += atlas.get()->pitch;
+			dst += surf.get()->pitch;
+		}
+	}
+	UnlockSurface(atlas);
+	UnlockSurface(surf);
+
+	run->surf = surf;
+	run->pixels = w * total_h;
+	RunPixels += run->pixels;
+	return surf;
+}
+
+
 ////////////////////
 // Get height of multiline text
 int CFont::GetHeight(const std::string& buf) {
@@ -257,26 +394,18 @@ void CFont::DrawAdv(SDL_Surface * dst, int x, int y, int max_w, Color col, const
 
 	ScopedSurfaceClip clip(dst, newrect);
 
-	// Look in the precached fonts if there's some for this color
-	SmartPointer<SDL_Surface> bmpCached = NULL;
-	if (Colorize) {
-		// HINT: if we leave this disabled, the drawing will always be done manually
-		// this is a bit (not not much) slower but prevents from the usual errors with CFont (wrong color, invisible, so on)
-		// TODO: should we completly remove the caches? how much speed improvements do they give?
-		// under MacOSX, it doesn't seem to give any performance improvement at all, at least no change in FPS
-		// I have activated it again now as it seem to work at the moment (perhabps because of my change in gfxCreateSurfaceAlpha)
-		if (col == f_white)
-			bmpCached = bmpWhite;
-		else if (col == tLX->clBlack)
-			bmpCached = bmpFont;
-		else if (col == f_green)
-			bmpCached = bmpGreen;
-	}
-	// Not colourize, bmpFont itself should be blitted without any changes, so it's precached
-	else {
-		bmpCached = bmpFont;
-	}
+	// Glyphs are blitted from the atlas in this colour, not colourized fonts are blitted as they are
+	SmartPointer<SDL_Surface> bmpCached = Colorize ? GetAtlas(col) : bmpFont;
 
+	// Repeated text is drawn with a single blit
+	// Following lines start at newrect.x, so the rendered text only fits if the first one starts there too
+	if (bmpCached.get() && newrect.x == x) {
+		SmartPointer<SDL_Surface> run = GetRun(txt, col, bmpCached);
+		if (run.get()) {
+			DrawImage(dst, run, x, y);
+			return;
+		}
+	}
 
 	// Lock the surfaces
 	// If we use cached font, we do not access the pixels
@@ -285,74 +414,48 @@ void CFont::DrawAdv(SDL_Surface * dst, int x, int y, int max_w, Color col, const
 		LOCK_OR_QUIT(bmpFont);
 	}
 
-	// Get the color values
-	// TODO: this function should accept a device-independent color, change it asap!
-	Color font_cl(col);
-
-	// Position at destination surface
-	int char_y = y;
-	int char_h = bmpFont.get()->h;
-
 	// Get the putpixel & getpixel functors
 	PixelPutAlpha& putter = getPixelAlphaPutFunc(dst);
 	PixelGet& getter = getPixelGetFunc(bmpFont.get());
 
-	// Vertical clipping
-	OneSideClip(char_y, char_h, newrect.y, newrect.h);
-
 	// Get the correct drawing function
 	typedef void(CFont::*GlyphBlitter)(SDL_Surface *dst, const SDL_Rect& r, int sx, int sy, Color col, int glyph_index, PixelPutAlpha& putter, PixelGet& getter);
 	GlyphBlitter func = &CFont::DrawGlyphNormal_Internal;
 	if (OutlineFont)
 		func = &CFont::DrawGlyphOutline_Internal;
 
-	for (std::string::const_iterator p = txt.begin(); p != txt.end();) {
-
-		// Line break
-		if (*p == '\n') {
-			y += bmpFont.get()->h + VSpacing;
-			char_y = y;
-			x = newrect.x;
-			p++;
-
-			// If any further text wouldn't be drawn, just stop
-			if (char_y >= (newrect.y + newrect.h))
-				break;
-			else  {
-				OneSideClip(char_y, char_h, newrect.y, newrect.h);
-				continue;
-			}
-		}
+	const Layout& layout = GetLayout(txt);
+	for (std::vector<Glyph>::const_iterator g = layout.glyphs.begin(); g != layout.glyphs.end(); ++g) {
+		const int l = g->index;
 
-		// Translate and ignore unknown
-		int l = TranslateCharacter(p, txt.end()); // HINT: increases the iterator
-		if (l == -1)
-			continue;
+		// Position at destination surface
+		const int line_x = (g->line == 0) ? x : newrect.x;
+		const int line_y = y + g->line * (bmpFont.get()->h + VSpacing);
 
+		// If any further text wouldn't be drawn, just stop
+		if (line_y >= (newrect.y + newrect.h))
+			break;
 
-		// Check if the current line will be drawn, if not, just proceed
-		if (char_h == 0)
+		// Vertical clipping
+		int char_y = line_y;
+		int char_h = bmpFont.get()->h;
+		if (!OneSideClip(char_y, char_h, newrect.y, newrect.h))
 			continue;
 
 		// Horizontal clipping
-		int char_x = x;
+		int char_x = line_x + g->x;
 		int char_w = FontWidth[l];
-		if (!OneSideClip(char_x, char_w, newrect.x, newrect.w))  {
-			x += FontWidth[l] + Spacing;
+		if (!OneSideClip(char_x, char_w, newrect.x, newrect.w))
 			continue;
-		}
 
 		// Precached fonts
 		if (bmpCached.get()) {
-			DrawImageAdv(dst, bmpCached, CharacterOffset[l], 0, x, y, FontWidth[l], bmpFont.get()->h);
-			x += FontWidth[l] + Spacing;
+			DrawImageAdv(dst, bmpCached, CharacterOffset[l], 0, line_x + g->x, line_y, FontWidth[l], bmpFont.get()->h);
 			continue;
 		}
 
 		// Draw the glyph
-		(this->*(func))(dst, MakeRect(char_x, char_y, char_w, char_h), char_x - x, char_y - y, font_cl, l, putter, getter);
-
-		x += FontWidth[l] + Spacing;
+		(this->*(func))(dst, MakeRect(char_x, char_y, char_w, char_h), char_x - (line_x + g->x), char_y - line_y, col, l, putter, getter);
 	}
 
 
@@ -454,24 +557,7 @@ void CFont::DrawGlyph(SDL_Surface *dst, int x, int y, Color col, UnicodeChar c)
 ///////////////////
 // Calculate the width of a string of text
 int CFont::GetWidth(const std::string& buf) {
-	int length = 0, maxlength = 0;
-	short l;
-
-	// Calculate the length of the text
-	for (std::string::const_iterator p = buf.begin(); p != buf.end();) {
-		if( *p == '\n' ) {
-			length = 0;
-			p++;
-			continue;
-		}
-		l = TranslateCharacter(p, buf.end());
-		if (l != -1)
-			length += FontWidth[l] + Spacing;
-		if( length > maxlength )
-			maxlength = length;
-	}
-
-	return maxlength;
+	return GetLayout(buf).width;
 }
 
 /////////////////
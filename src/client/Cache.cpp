@@ -80,38 +80,36 @@ static AbsTime getCurrentTime()
 
 //////////////
 // Save an image to the cache
-void CCache::SaveImage__unsafe(const std::string& file1, const SmartPointer<SDL_Surface> & img)
+SmartPointer<SDL_Surface> CCache::SaveImage__unsafe(const std::string& file1, const SmartPointer<SDL_Surface> & img)
 {
 	if (img.get() == NULL)
-		return;
+		return NULL;
 
 	std::string file = file1;
 	stringlwr(file);
-	if( ImageCache.find(file) != ImageCache.end() )	// Error - already in cache
-	{
-		errors << "Error: image already in cache - memleak: " << file << endl;
-		return;
-	}
+	ImageCache_t::iterator item = ImageCache.find(file);
+	if( item != ImageCache.end() )	// loaded by another thread meanwhile, use that one
+		return item->second.bmpSurf;
 	//notes << "CCache::SaveImage(): " << img << " " << file << endl;
 	ImageCache[file] = ImageItem_t(img, getCurrentTime(), 0);
+	return img;
 }
 
 //////////////
 // Save a sound sample to the cache
-void CCache::SaveSound(const std::string& file1, const SmartPointer<SoundSample> & smp)
+SmartPointer<SoundSample> CCache::SaveSound(const std::string& file1, const SmartPointer<SoundSample> & smp)
 {
 	ScopedLock lock(mutex);
 	if (smp.get() == NULL)
-		return;
+		return NULL;
 
 	std::string file = file1;
 	stringlwr(file);
-	if( SoundCache.find(file) != SoundCache.end() )
-	{
-		errors << "Error: sound already in cache - memleak: " << file << endl;
-		return;
-	};
+	SoundCache_t::iterator item = SoundCache.find(file);
+	if( item != SoundCache.end() )	// loaded by another thread meanwhile, use that one
+		return item->second.sndSample;
 	SoundCache[file] = SoundItem_t( smp, getCurrentTime(), 0 );
+	return smp;
 }
 
 //////////////
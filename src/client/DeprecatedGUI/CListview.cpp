@@ -23,6 +23,10 @@
 #include "Cursor.h"
 #include "Timer.h"
 
+#include <algorithm>
+#include <vector>
+#include <set>
+
 
 namespace DeprecatedGUI {
 
@@ -93,8 +97,8 @@ void CListview::Draw(SDL_Surface * bmpDest)
 	}
 
 	x = iX+4;
-	lv_item_t *item = tItems;
-	int count=0;
+	// Only the visible items are drawn, start at the first one
+	lv_item_t *item = getTopItem(cScrollbar.getValue());
 
 	// Right bound
 	int right_bound = iX+iWidth-2;
@@ -109,9 +113,6 @@ void CListview::Draw(SDL_Surface * bmpDest)
 		
 		// Draw the items
 		for(;item;item = item->tNext) {
-			if(count++ < cScrollbar.getValue())
-				continue;
-
 			x = iX+4;
 
 			col = tColumns;
@@ -366,16 +367,12 @@ lv_item_t* CListview::AddItem(const std::string& sIndex, int iIndex, Color iColo
 	item->iBgColour.a = SDL_ALPHA_TRANSPARENT;
     item->_iID = iItemID++;
 
+	// Count the final height of the previous last item
+	CountLastItemHeight();
+
 	// Add it to the list
-	if(tItems) {
-		lv_item_t *i = tItems;
-		for(;i;i = i->tNext) {
-			if(i->tNext == NULL) {
-				i->tNext = item;
-				break;
-			}
-		}
-	}
+	if(tLastItem)
+		tLastItem->tNext = item;
 	else {
 		tItems = item;
 		tSelected = item;
@@ -384,6 +381,7 @@ lv_item_t* CListview::AddItem(const std::string& sIndex, int iIndex, Color iColo
 	}
 
 	tLastItem = item;
+	iLastItemHeight = 0;
 
 	// Adjust the scrollbar
 	iItemCount++;
@@ -392,8 +390,9 @@ lv_item_t* CListview::AddItem(const std::string& sIndex, int iIndex, Color iColo
 	//if(cScrollbar.getMax()*20 >= iHeight)
 	//	bGotScrollbar = true;
 
-	// Readjust the scrollbar
-	ReadjustScrollbar();
+	// Readjust the scrollbar, only the new item has to be counted
+	CountLastItemHeight();
+	SetScrollbarSize(iItemCount, iContentHeight);
 
 	// We need a repaint
 	bNeedsRepaint = true;
@@ -482,8 +481,9 @@ void CListview::AddSubitem(int iType, const std::string& sText, const SmartPoint
 		}
 	}
 
-	// Readjust the scrollbar
-	ReadjustScrollbar();
+	// Readjust the scrollbar, only the height of the last item can have changed
+	CountLastItemHeight();
+	SetScrollbarSize(iItemCount, iContentHeight);
 
 	bNeedsRepaint = true; // Repaint required
 }
@@ -516,6 +516,28 @@ void CListview::ReadjustScrollbar()
 		count++;
 	}
 
+	iContentHeight = size;
+	iLastItemHeight = tLastItem ? tLastItem->iHeight : 0;
+
+	SetScrollbarSize(count, size);
+}
+
+///////////////////
+// Adds the changes of the last item's height to the content height
+// Items are mostly changed right after they were added, so this keeps iContentHeight without going through all items
+void CListview::CountLastItemHeight()
+{
+	if (!tLastItem)
+		return;
+
+	iContentHeight += tLastItem->iHeight - iLastItemHeight;
+	iLastItemHeight = tLastItem->iHeight;
+}
+
+///////////////////
+// Setup the scrollbar for count items with the total height size
+void CListview::SetScrollbarSize(int count, int size)
+{
 	// Buffer size on top & bottom
 	int display_height = iHeight;  // Size of box with items
 	if (tColumns)
@@ -624,6 +646,60 @@ void CListview::RemoveItem(int iIndex)
 	else
 		bGotScrollbar = false;*/
 
+	tTopItem = NULL;
+	UpdateItemIDs();
+
+	// Readjust the scrollbar
+	ReadjustScrollbar();
+
+	bNeedsRepaint = true; // Repaint required
+}
+
+///////////////////
+// Remove the given item from the list
+void CListview::RemoveItem(lv_item_t *item)
+{
+	// Find the previous item
+	lv_item_t *prev = NULL;
+	lv_item_t *i = tItems;
+	for(;i && i != item;i=i->tNext)
+		prev = i;
+	if (!i)
+		return;
+
+	// Unlink it
+	if (prev)
+		prev->tNext = item->tNext;
+	else
+		tItems = item->tNext;
+	if (tLastItem == item)
+		tLastItem = prev;
+
+	// Free the sub items
+	lv_subitem_t *s,*sub;
+	for(s=item->tSubitems;s;s=sub) {
+		sub = s->tNext;
+		if (s->tWidget == tFocusedSubWidget)
+			tFocusedSubWidget = NULL;
+		if (s->tWidget == tMouseOverSubWidget)
+			tMouseOverSubWidget = NULL;
+		if (s->tWidget == holdedWidget)
+			holdedWidget = NULL;
+		delete s;
+	}
+
+	if (tMouseOver == item)
+		tMouseOver = NULL;
+	if (tSelected == item)  {
+		tSelected = tItems;
+		if (tSelected)
+			tSelected->bSelected = true;
+	}
+
+	delete item;
+	iItemCount--;
+	tTopItem = NULL;
+
 	UpdateItemIDs();
 
 	// Readjust the scrollbar
@@ -632,6 +708,22 @@ void CListview::RemoveItem(int iIndex)
 	bNeedsRepaint = true; // Repaint required
 }
 
+///////////////////
+// Get the item at the given position, used to find the first visible item
+// It's remembered, so scrolling only goes through the items scrolled over
+lv_item_t *CListview::getTopItem(int pos)
+{
+	if (!tTopItem || pos < iTopItemPos)  {
+		tTopItem = tItems;
+		iTopItemPos = 0;
+	}
+
+	for (; tTopItem && iTopItemPos < pos; ++iTopItemPos)
+		tTopItem = tTopItem->tNext;
+
+	return tTopItem;
+}
+
 
 ///////////////////
 // Get the first sub item from the currently selected item
@@ -683,6 +775,48 @@ void CListview::ReSort()
 	SortBy(i,col->iSorted==1);
 }
 
+///////////////
+// Sort key of an item, the text of the sorted column is only parsed once
+struct lv_sortkey_t {
+	lv_item_t *item;
+	int kind; // 0 = no subitem, 1 = number, 2 = text
+	int number;
+	const std::string *text;
+
+	lv_sortkey_t(lv_item_t *it, int column) : item(it), kind(0), number(0), text(NULL) {
+		lv_subitem_t *sub = it->tSubitems;
+		for(int i=0;i != column && sub;sub=sub->tNext,i++) {	}
+		if (!sub)
+			return;
+
+		bool failed;
+		number = from_string<int>(sub->sText, failed);
+		kind = failed ? 2 : 1;
+		text = &sub->sText;
+	}
+};
+
+// Ascending order: items without the column first, then numbers, then the texts
+// Numbers always come before texts, so this is a strict order also for mixed columns
+static bool lv_sortkey_less(const lv_sortkey_t& a, const lv_sortkey_t& b)
+{
+	if (a.kind != b.kind)
+		return a.kind < b.kind;
+	if (a.kind == 1)
+		return a.number < b.number;
+	if (a.kind == 2)
+		return stringcasecmp(*a.text, *b.text) < 0;
+	return false;
+}
+
+struct lv_sortkey_order {
+	bool ascending;
+	lv_sortkey_order(bool asc) : ascending(asc) {}
+	bool operator()(const lv_sortkey_t& a, const lv_sortkey_t& b) const {
+		return ascending ? lv_sortkey_less(a, b) : lv_sortkey_less(b, a);
+	}
+};
+
 ///////////////
 // Sorts the listview by specified column, ascending or descending
 void CListview::SortBy(int column, bool ascending)
@@ -696,76 +830,24 @@ void CListview::SortBy(int column, bool ascending)
 	if (!item)
 		return;
 
-	lv_item_t *prev_item = NULL;
-	lv_subitem_t *subitem1 = NULL;
-	lv_subitem_t *subitem2 = NULL;
-
-	bool bSwapped = true;
-
-	// Bubble sort the list
-	while (bSwapped)  {
-		bSwapped = false;
-		prev_item = NULL;
-		for(item=tItems;item->tNext;item=item->tNext) {
-			subitem1=item->tSubitems;
-			subitem2=item->tNext->tSubitems;
-
-			// Get subitem 1
-			int i;
-			for(i=0;i != column && subitem1;subitem1=subitem1->tNext,i++) {	}
-
-			// Get subitem 2
-			for(i=0;i != column && subitem2;subitem2=subitem2->tNext,i++) { }
-
-			bool swap = false;
-			if (subitem2 && subitem1)  {
-				// Swap the two items?
-				bool failed1,failed2;
-				int nat_cmp1 = from_string<int>(subitem1->sText,failed1);
-				int nat_cmp2 = from_string<int>(subitem2->sText,failed2);
-				// First try, if we compare numbers
-				if (!failed1 && !failed2)  {
-					if (ascending)
-						swap = nat_cmp1 > nat_cmp2;
-					else
-						swap = nat_cmp2 > nat_cmp1;
-				// String comparison
-				} else {
-					int tmp = stringcasecmp(subitem1->sText,subitem2->sText);
-					if (ascending)
-						swap = tmp > 0;
-					else
-						swap = tmp < 0;
-				}
-			} else  {
-				if (ascending)
-					swap = subitem1 != NULL;
-				else
-					swap = subitem2 != NULL;
-			}
-
-			// Swap if they're not in the right order
-			if (swap)  {
-				lv_item_t *it3 = item->tNext;
-				lv_item_t *it4 = item->tNext->tNext;
-				if (prev_item)
-					prev_item->tNext = it3;
-				else
-					tItems = it3;
-				it3->tNext = item;
-				item->tNext = it4;
-				if (!it4)  {
-					tLastItem = it3;
-					break;
-				}
-				bSwapped = true;
-				prev_item = item;
-				continue;
-			}
-
-			prev_item = item;
-		}
-	}
+	// The last item changes, so count its height now
+	CountLastItemHeight();
+
+	// Stable sort, equal items keep their order
+	std::vector<lv_sortkey_t> keys;
+	keys.reserve(iItemCount);
+	for(;item;item=item->tNext)
+		keys.push_back(lv_sortkey_t(item, column));
+	std::stable_sort(keys.begin(), keys.end(), lv_sortkey_order(ascending));
+
+	// Relink the items
+	tItems = keys.front().item;
+	for (size_t k = 0; k + 1 < keys.size(); ++k)
+		keys[k].item->tNext = keys[k + 1].item;
+	tLastItem = keys.back().item;
+	tLastItem->tNext = NULL;
+	iLastItemHeight = tLastItem->iHeight;
+	tTopItem = NULL;
 
 	// Update the ID of the selected item
 	int i=0;
@@ -781,6 +863,85 @@ void CListview::SortBy(int column, bool ascending)
 
 }
 
+///////////////
+// Moves the items to their positions in the current sorting
+// The other items have to be sorted. Cheaper than ReSort() if only some items were added or changed.
+void CListview::SortItems(const std::vector<lv_item_t *>& items)
+{
+	// Find the sorted column
+	int column = 0;
+	lv_column_t *col = tColumns;
+	for (;col;col=col->tNext,column++)
+		if (col->iSorted != -1)
+			break;
+	if (!col || items.empty())
+		return;
+
+	// The last item can change, so count its height now
+	CountLastItemHeight();
+
+	// Unlink the items first, so only sorted items remain in the list
+	const std::set<lv_item_t *> moved(items.begin(), items.end());
+	std::vector<lv_sortkey_t> keys;
+	keys.reserve(moved.size());
+	lv_item_t *prev = NULL;
+	lv_item_t *i = tItems;
+	while (i)  {
+		lv_item_t *next = i->tNext;
+		if (moved.count(i))  {
+			keys.push_back(lv_sortkey_t(i, column));
+			if (prev)
+				prev->tNext = next;
+			else
+				tItems = next;
+		} else
+			prev = i;
+		i = next;
+	}
+	if (keys.empty())
+		return;
+
+	// Equal items keep their order, the moved ones come behind the others
+	const lv_sortkey_order before(col->iSorted == 1);
+	std::stable_sort(keys.begin(), keys.end(), before);
+
+	// Merge them into the remaining items
+	lv_item_t *rest = tItems;
+	size_t k = 0;
+	prev = NULL;
+	while (rest || k < keys.size())  {
+		lv_item_t *next;
+		if (k < keys.size() && (!rest || before(keys[k], lv_sortkey_t(rest, column))))
+			next = keys[k++].item;
+		else  {
+			next = rest;
+			rest = rest->tNext;
+		}
+		if (prev)
+			prev->tNext = next;
+		else
+			tItems = next;
+		prev = next;
+	}
+	prev->tNext = NULL;
+	tLastItem = prev;
+
+	iLastItemHeight = tLastItem->iHeight;
+	tTopItem = NULL;
+
+	// Update the ID of the selected item
+	int id=0;
+	for (i=tItems;i;i=i->tNext,id++)
+		if (i == tSelected)  {
+			iItemID = id;
+			break;
+		}
+
+	UpdateItemIDs();
+
+	bNeedsRepaint = true; // Repaint required
+}
+
 ///////////////
 // Sorts the listview by specified column, ascending or descending, the sorting is stored in column
 void CListview::SetSortColumn(int column, bool ascending)
@@ -837,6 +998,9 @@ void CListview::Clear()
 	tMouseOverSubWidget = NULL;
 	holdedWidget = NULL;
 	tMouseOver = NULL;
+	tTopItem = NULL;
+	iContentHeight = 0;
+	iLastItemHeight = 0;
 
 	cScrollbar.setMin(0);
 	cScrollbar.setMax(1);
@@ -903,6 +1067,12 @@ void CListview::Destroy()
 	tFocusedSubWidget = NULL;
 	tMouseOverSubWidget = NULL;
 	tItems = NULL;
+	tLastItem = NULL;
+	tSelected = NULL;
+	tMouseOver = NULL;
+	tTopItem = NULL;
+	iContentHeight = 0;
+	iLastItemHeight = 0;
 }
 
 
@@ -981,14 +1151,15 @@ int	CListview::MouseOver(mouse_t *tMouse)
 
 	// Go through items and subitems, processing the widgets
 	tMouseOverSubWidget = NULL; // Reset it here
-	lv_item_t *item = tItems;
 	lv_subitem_t *subitem = NULL;
 	int result = LV_NONE;
 	int scroll = (bGotScrollbar ? cScrollbar.getValue() : 0);
 	int y = iY + 2 + (tColumns ? tLX->cFont.GetHeight() + 2 : 0);
-	for(int i = 0;item;item = item->tNext, i++) {
-		if (i < scroll)
-			continue;
+	lv_item_t *item = getTopItem(scroll);
+	for(;item;item = item->tNext) {
+		// Only the visible items
+		if (y >= iY + iHeight)
+			break;
 		subitem = item->tSubitems;
 		int x = iX + 2;
 		lv_column_t *col = tColumns;
@@ -1042,14 +1213,10 @@ int	CListview::MouseOver(mouse_t *tMouse)
 	y = iY+tLX->cFont.GetHeight()+2;
 	if (!tColumns)
 		y = iY+2;
-	item = tItems;
-	int count=0;
+	item = getTopItem(cScrollbar.getValue());
 
 	for(;item;item = item->tNext) 
 	{
-		if(count++ < cScrollbar.getValue())
-			continue;
-
 		// Find the max height
 		int h = item->iHeight;
 
@@ -19,6 +19,7 @@
 #include "GfxPrimitives.h"
 #include "DeprecatedGUI/Graphics.h"
 #include "Entity.h"
+#include "RenderQueue.h"
 #include "MathLib.h"
 #include "FastVector.h"
 #include "CViewport.h"
@@ -206,20 +207,47 @@ void SpawnEntity(int type, int type2, CVec pos, CVec vel, Color colour, SmartPoi
 
 
 ///////////////////
-// Draw the entities
-void DrawEntities(SDL_Surface * bmpDest, CViewport *v)
+// Draw a beam or a laser sight entity
+static void DrawBeamEntity(void* obj, SDL_Surface * bmpDest, CViewport *v)
 {
-	CVec end;
+	entity_t *ent = (entity_t*)obj;
 
 	int wx = v->GetWorldX();
 	int wy = v->GetWorldY();
 	int l = v->GetLeft();
 	int t = v->GetTop();
 
+	int x = int((ent->vPos.x - (float)wx)*2.0) + l;
+	int y = int((ent->vPos.y - (float)wy)*2.0) + t;
+	CVec end = ent->vPos + ent->vVel*(float)ent->iType2;
+	int x2 = ((int)end.x-wx)*2+l;
+	int y2 = ((int)end.y-wy)*2+t;
+
+	if(ent->iType == ENT_BEAM)
+		DrawBeam(bmpDest, x,y, x2,y2, ent->iColour);
+	else
+		DrawLaserSight(bmpDest, x,y, x2,y2, ent->iColour);
+}
+
+static void DrawBeamInfos(void*, SDL_Surface * bmpDest, CViewport *v)
+{
+	drawBeams(bmpDest, v);
+}
+
+
+///////////////////
+// Queue the entities for drawing
+void DrawEntities(RenderQueue& queue, CViewport *v)
+{
+	int wx = v->GetWorldX();
+	int wy = v->GetWorldY();
+	int l = v->GetLeft();
+	int t = v->GetTop();
 
 	int x,y;
-	int x2,y2;
-		
+	const RenderQueue::Layer layer = RenderQueue::L_Entity;
+
+	// Clipping is done by the render queue
 	for (Entities::Iterator::Ref e = tEntities.begin(); e->isValid(); e->next()) {
 
 		entity_t *ent = e->get();
@@ -227,61 +255,53 @@ void DrawEntities(SDL_Surface * bmpDest, CViewport *v)
 		x= int((ent->vPos.x - (float)wx)*2.0) + l;
 		y= int((ent->vPos.y - (float)wy)*2.0) + t;
 
-		// Clipping
-		if(ent->iType != ENT_BEAM && ent->iType != ENT_LASERSIGHT) {
-			if((x<l || x>l+v->GetVirtW()))
-				continue;
-			if((y<t || y>t+v->GetVirtH()))
-				continue;
-		}
-
 		switch(ent->iType) {
 
 			// Particle & Blood
 			case ENT_PARTICLE:
 			case ENT_BLOOD:				// Fallthrough
 			case ENT_BLOODDROPPER:		// Fallthrough
-				DrawRectFill2x2(bmpDest, x - 1, y - 1, ent->iColour);
+				queue.addPixel2x2(layer, x - 1, y - 1, ent->iColour);
 				break;
 
 			// Explosion
 			case ENT_EXPLOSION:
-				DrawImageAdv(bmpDest, DeprecatedGUI::gfxGame.bmpExplosion,int(ent->fFrame)*32,0,x-16,y-16,32,32);
+				queue.addImage(layer, DeprecatedGUI::gfxGame.bmpExplosion.get(),int(ent->fFrame)*32,0,x-16,y-16,32,32);
 				break;
 
 			// Smoke
 			case ENT_SMOKE:
-				DrawImageAdv(bmpDest, DeprecatedGUI::gfxGame.bmpSmoke, int(ent->fFrame)*14,0,x-7,y-7,14,14);
+				queue.addImage(layer, DeprecatedGUI::gfxGame.bmpSmoke.get(), int(ent->fFrame)*14,0,x-7,y-7,14,14);
 				break;
 
 			// Chemical smoke
 			case ENT_CHEMSMOKE:
-				DrawImageAdv(bmpDest, DeprecatedGUI::gfxGame.bmpChemSmoke, int(ent->fFrame)*10,0,x-5,y-5,10,10);
+				queue.addImage(layer, DeprecatedGUI::gfxGame.bmpChemSmoke.get(), int(ent->fFrame)*10,0,x-5,y-5,10,10);
 				break;
 
 			// Spawn
 			case ENT_SPAWN:
-				DrawImageAdv(bmpDest, DeprecatedGUI::gfxGame.bmpSpawn, int(ent->fFrame)*32,0,x-16,y-16,32,32);
+				queue.addImage(layer, DeprecatedGUI::gfxGame.bmpSpawn.get(), int(ent->fFrame)*32,0,x-16,y-16,32,32);
 				break;
 
 			// Giblet
 			case ENT_GIB:
-				DrawImageAdv(bmpDest,ent->bmpSurf,int(ent->iRotation)*8,0,x-2,y-2,8,8);
+				queue.addImage(layer, ent->bmpSurf.get(),int(ent->iRotation)*8,0,x-2,y-2,8,8);
 				break;
 
 			// Sparkle
 			case ENT_SPARKLE:
 				if(ent->iColour != Color()) {
 					// Well, I admit, not very creative but it's ok for now
-					DrawRectFill2x2(bmpDest, x, y - 1, ent->iColour);
-					DrawRectFill2x2(bmpDest, x - 1, y, ent->iColour);
+					queue.addPixel2x2(layer, x, y - 1, ent->iColour);
+					queue.addPixel2x2(layer, x - 1, y, ent->iColour);
 				} else
-					DrawImageAdv(bmpDest, DeprecatedGUI::gfxGame.bmpSparkle, int(ent->fFrame)*10,0, x-5,y-5,10,10);
+					queue.addImage(layer, DeprecatedGUI::gfxGame.bmpSparkle.get(), int(ent->fFrame)*10,0, x-5,y-5,10,10);
 				break;
 
 			// Doomsday
 			case ENT_DOOMSDAY:
-				DrawRectFill2x2(bmpDest, x - 1, y - 1, doomsday[(int)ent->fFrame]);
+				queue.addPixel2x2(layer, x - 1, y - 1, doomsday[(int)ent->fFrame]);
 				break;
 
 			// Jetpack spray
@@ -290,28 +310,18 @@ void DrawEntities(SDL_Surface * bmpDest, CViewport *v)
 				r = (Uint8)((float)MIN(0.314f * (255-ent->fFrame),255.0f));
 				g = (Uint8)((float)MIN(0.588f * (255-ent->fFrame),255.0f));
 				b = (Uint8)((float)MIN(0.784f * (255-ent->fFrame),255.0f));
-				DrawRectFill2x2(bmpDest, x - 1, y - 1, Color(r, g, b));
+				queue.addPixel2x2(layer, x - 1, y - 1, Color(r, g, b));
 				break;
 
-			// Beam
+			// Beam & Laser Sight
 			case ENT_BEAM:
-				end = ent->vPos + ent->vVel*(float)ent->iType2;
-				x2=((int)end.x-wx)*2+l;
-				y2=((int)end.y-wy)*2+t;
-				DrawBeam(bmpDest, x,y, x2,y2, ent->iColour);
-				break;
-
-			// Laser Sight
 			case ENT_LASERSIGHT:
-				end = ent->vPos + ent->vVel*(float)ent->iType2;
-				x2=((int)end.x-wx)*2+l;
-				y2=((int)end.y-wy)*2+t;
-				DrawLaserSight(bmpDest, x,y, x2,y2, ent->iColour);
+				queue.addCustom(layer, &DrawBeamEntity, ent);
 				break;
 		}
 	}
 	
-	drawBeams(bmpDest, v);
+	queue.addCustom(layer, &DrawBeamInfos, NULL);
 }
 
 
@@ -45,6 +45,7 @@
 #include "CVec.h"
 #include "Cache.h"
 #include "CodeAttributes.h"
+#include "SimdBlit.h"
 
 int iSurfaceFormat = SDL_SWSURFACE;
 
@@ -577,6 +578,45 @@ SmartPointer<SDL_Surface> GetCopiedStretched2Image(SDL_Surface* bmpSrc) {
 	return result;
 }
 
+/////////////////////
+// The common 32bit cases of _OperateOnSurfaces, done row-wise by the SimdBlit kernels.
+// Returns false if the formats don't fit for it; the caller then does it pixel by pixel.
+static bool OperateOnRows_32(bool colorkeycheck, bool alphablend, bool src_hasalpha, bool dst_hasalpha, bool sameformat,
+							 SDL_Surface * bmpDest, SDL_Surface * bmpSrc, const SDL_Rect& rDest, const SDL_Rect& rSrc)
+{
+	const SDL_PixelFormat* srcformat = bmpSrc->format;
+	const SDL_PixelFormat* dstformat = bmpDest->format;
+	if(srcformat->Rmask != dstformat->Rmask || srcformat->Gmask != dstformat->Gmask || srcformat->Bmask != dstformat->Bmask)
+		return false;
+	if(srcformat->Rloss || srcformat->Gloss || srcformat->Bloss)
+		return false;
+	const Uint32 rgbMask = srcformat->Rmask | srcformat->Gmask | srcformat->Bmask;
+
+	enum { Copy, CopyKey, Blend } op;
+	if(alphablend) {
+		// Only RGBA -> RGB. With an alpha channel in the destination, _PutPixel also composes the alpha values.
+		if(!src_hasalpha || dst_hasalpha || colorkeycheck || srcformat->Amask != 0xFF000000)
+			return false;
+		op = Blend;
+	}
+	else if(sameformat)
+		op = colorkeycheck ? CopyKey : Copy;
+	else
+		return false;
+
+	const Uint8 *src = (const Uint8 *)bmpSrc->pixels + rSrc.y * bmpSrc->pitch + rSrc.x * 4;
+	Uint8 *dst = (Uint8 *)bmpDest->pixels + rDest.y * bmpDest->pitch + rDest.x * 4;
+	for (int y = rDest.h; y; --y, dst += bmpDest->pitch, src += bmpSrc->pitch) {
+		switch(op) {
+		case Copy: memmove(dst, src, rDest.w * 4); break;
+		case CopyKey: SimdBlit::copyRowKey((Uint32 *)dst, (const Uint32 *)src, rDest.w, srcformat->colorkey & rgbMask, rgbMask); break;
+		case Blend: SimdBlit::blendRowAlpha((Uint32 *)dst, (const Uint32 *)src, rDest.w, rgbMask); break;
+		}
+	}
+
+	return true;
+}
+
 template <
 	bool colorkeycheck,
 	bool alphablend,
@@ -610,6 +650,13 @@ void _OperateOnSurfaces(SDL_PixelFormat* dstformat, SDL_PixelFormat* srcformat,
 	
 	LOCK_OR_QUIT(bmpDest);
 	LOCK_OR_QUIT(bmpSrc);
+
+	if(sbpp == 4 && dbpp == 4 && !src_persurfacealpha &&
+	OperateOnRows_32(colorkeycheck, alphablend, src_hasalpha, dst_hasalpha, sameformat, bmpDest, bmpSrc, rDest, rSrc)) {
+		UnlockSurface(bmpDest);
+		UnlockSurface(bmpSrc);
+		return;
+	}
 	
 	Uint8 *src = ((Uint8 *)bmpSrc->pixels + rSrc.y * bmpSrc->pitch + rSrc.x * sbpp);
 	Uint8 *dst = ((Uint8 *)bmpDest->pixels + rDest.y * bmpDest->pitch + rDest.x * dbpp);
@@ -860,6 +907,27 @@ void DrawImageAdv_Mirror(SDL_Surface * bmpDest, SDL_Surface * bmpSrc, int sx, in
 }
 
 
+///////////////////
+// Checks if the stretch functions can copy the rows with the SimdBlit kernels,
+// that is for surfaces of the same 32bit format without alpha blending.
+// keyMask is 0 if there is no colorkey.
+static bool CanStretchRows_32(SDL_Surface * bmpDest, SDL_Surface * bmpSrc, Uint32& key, Uint32& keyMask)
+{
+	const SDL_PixelFormat* format = bmpSrc->format;
+	if(format->BytesPerPixel != 4 || !PixelFormatEqual(format, bmpDest->format))
+		return false;
+	if((bmpSrc->flags & SDL_SRCALPHA) || format->Rloss || format->Gloss || format->Bloss)
+		return false;
+
+	key = keyMask = 0;
+	if(bmpSrc->flags & SDL_SRCCOLORKEY) {
+		if(format->Amask) return false;
+		keyMask = format->Rmask | format->Gmask | format->Bmask;
+		key = format->colorkey & keyMask;
+	}
+	return true;
+}
+
 ///////////////////
 // Draws a sprite doubly stretched
 void DrawImageStretch2(SDL_Surface * bmpDest, SDL_Surface * bmpSrc, int sx, int sy, int dx, int dy, int w, int h)
@@ -894,6 +962,20 @@ void DrawImageStretch2(SDL_Surface * bmpDest, SDL_Surface * bmpSrc, int sx, int
 	int doublepitch = bmpDest->pitch*2;
 	int sbpp = bmpSrc->format->BytesPerPixel;
 	int dbpp = bmpDest->format->BytesPerPixel;
+
+	Uint32 key, keyMask;
+	if(CanStretchRows_32(bmpDest, bmpSrc, key, keyMask)) {
+		for(int y = h; y; --y, TrgPix += doublepitch, SrcPix += bmpSrc->pitch) {
+			if(keyMask)
+				SimdBlit::stretch2RowKey((Uint32 *)TrgPix, (Uint32 *)(TrgPix + bmpDest->pitch), (const Uint32 *)SrcPix, w, key, keyMask);
+			else
+				SimdBlit::stretch2Row((Uint32 *)TrgPix, (Uint32 *)(TrgPix + bmpDest->pitch), (const Uint32 *)SrcPix, w);
+		}
+		UnlockSurface(bmpDest);
+		UnlockSurface(bmpSrc);
+		return;
+	}
+
 	PixelCopy& copier = getPixelCopyFunc(bmpSrc, bmpDest);
 
     for(int y = h; y; --y) {
@@ -954,6 +1036,20 @@ void DrawImageStretch2Key(SDL_Surface * bmpDest, SDL_Surface * bmpSrc, int sx, i
 	int doublepitch = bmpDest->pitch*2;
 	int sbpp = bmpSrc->format->BytesPerPixel;
 	int dbpp = bmpDest->format->BytesPerPixel;
+
+	Uint32 key, keyMask;
+	if(CanStretchRows_32(bmpDest, bmpSrc, key, keyMask)) {
+		for(int y = h; y; --y, TrgPix += doublepitch, SrcPix += bmpSrc->pitch) {
+			if(keyMask)
+				SimdBlit::stretch2RowKey((Uint32 *)TrgPix, (Uint32 *)(TrgPix + bmpDest->pitch), (const Uint32 *)SrcPix, w, key, keyMask);
+			else
+				SimdBlit::stretch2Row((Uint32 *)TrgPix, (Uint32 *)(TrgPix + bmpDest->pitch), (const Uint32 *)SrcPix, w);
+		}
+		UnlockSurface(bmpDest);
+		UnlockSurface(bmpSrc);
+		return;
+	}
+
 	PixelCopy& copier = getPixelCopyFunc(bmpSrc, bmpDest);
 	PixelGet& getter = getPixelGetFunc(bmpSrc);
 
@@ -1518,6 +1614,21 @@ void DrawImageScale2x(SDL_Surface* bmpDest, SDL_Surface* bmpSrc, int sx, int sy,
 		return;
 	}
 
+	// Whole rows at once for 32bit surfaces
+	if(sbpp == 4 && bmpDest->format->BytesPerPixel == 4) {
+		for(int y = 0; y < h; ++y) {
+			const Uint32 *row = (const Uint32 *)GetPixelAddr(bmpSrc, sx, sy + y);
+			const Uint32 *above = (y > 0) ? (const Uint32 *)GetPixelAddr(bmpSrc, sx, sy + y - 1) : row;
+			const Uint32 *below = (y < h - 1) ? (const Uint32 *)GetPixelAddr(bmpSrc, sx, sy + y + 1) : row;
+			SimdBlit::scale2xRow((Uint32 *)GetPixelAddr(bmpDest, dx, dy + y * 2), (Uint32 *)GetPixelAddr(bmpDest, dx, dy + y * 2 + 1),
+				above, row, below, w);
+		}
+
+		UnlockSurface(bmpDest);
+		UnlockSurface(bmpSrc);
+		return;
+	}
+
 	// Variables
 	int sx2 = sx + w - 1;
 	int sy2 = sy + h - 1;
@@ -2849,15 +2960,16 @@ SmartPointer<SDL_Surface> LoadGameImage_unaltered(const std::string& _filename,
 // Loads an image, and converts it to the same colour depth as the screen (speed)
 SmartPointer<SDL_Surface> LoadGameImage(const std::string& _filename, bool withalpha)
 {
-	ScopedLock lock(cCache.mutex);
-	
 	{
 		// Try cache first
+		ScopedLock lock(cCache.mutex);
 		SmartPointer<SDL_Surface> ImageCache = cCache.GetImage__unsafe(_filename);
 		if( ImageCache.get() )
 			return ImageCache;
 	}
 	
+	// Decode without holding the cache lock, so that several images can be loaded in parallel.
+	
 #if USE_GD_FOR_IMAGE_LOADING
 	SmartPointer<SDL_Surface> img = LoadGameImage_viaGd(_filename, withalpha, false);	
 #else
@@ -2905,8 +3017,8 @@ SmartPointer<SDL_Surface> LoadGameImage(const std::string& _filename, bool witha
 	#ifdef DEBUG
 	//printf("LoadImage() %p %s\n", Image.get(), _filename.c_str() );
 	#endif
-	cCache.SaveImage__unsafe(_filename, img);
-	return img;
+	ScopedLock lock(cCache.mutex);
+	return cCache.SaveImage__unsafe(_filename, img);
 }
 
 void test_Clipper() {
@@ -138,6 +138,7 @@ bool GameOptions::Init() {
 	CScriptableVars::RegisterVars("GameOptions")
 		( tLXOptions->bFullscreen, "Video.Fullscreen", true )
 		( tLXOptions->bShowFPS, "Video.ShowFPS", false )
+		( tLXOptions->bRenderInterpolation, "Video.RenderInterpolation", true )
 		( tLXOptions->bOpenGL, "Video.OpenGL",
 #ifdef __APPLE__
 			true )
@@ -155,6 +156,13 @@ bool GameOptions::Init() {
 		( tLXOptions->bCheckBandwidthSanity, "Network.CheckBandwidthSanity", true )
 		( tLXOptions->sHttpProxy, "Network.HttpProxy", "" )
 		( tLXOptions->bAutoSetupHttpProxy, "Network.AutoSetupHttpProxy", true )
+		( tLXOptions->iNetSimLatency, "Network.SimLatency", 0, "Simulated latency", "simulated one-way latency in ms (testing only)", GIG_Other, ALT_OnlyViaConfig, true, 0, 5000 )
+		( tLXOptions->iNetSimJitter, "Network.SimJitter", 0, "Simulated jitter", "simulated additional random delay in ms (testing only)", GIG_Other, ALT_OnlyViaConfig, true, 0, 5000 )
+		( tLXOptions->fNetSimLoss, "Network.SimLoss", 0.0f, "Simulated packet loss", "probability that a packet gets lost (testing only)", GIG_Other, ALT_OnlyViaConfig, true, 0.0f, 1.0f )
+		( tLXOptions->fNetSimDuplicate, "Network.SimDuplicate", 0.0f, "Simulated packet duplication", "probability that a packet is sent twice (testing only)", GIG_Other, ALT_OnlyViaConfig, true, 0.0f, 1.0f )
+		( tLXOptions->fNetSimReorder, "Network.SimReorder", 0.0f, "Simulated packet reordering", "probability that a packet arrives after the following ones (testing only)", GIG_Other, ALT_OnlyViaConfig, true, 0.0f, 1.0f )
+		( tLXOptions->iNetSimBandwidth, "Network.SimBandwidth", 0, "Simulated bandwidth", "simulated link capacity in bytes/sec, 0 is unlimited (testing only)", GIG_Other, ALT_OnlyViaConfig, true, 0, 10000000 )
+		( tLXOptions->iNetSimSeed, "Network.SimSeed", 0, "Simulation seed", "random seed for the network simulation (testing only)", GIG_Other, ALT_OnlyViaConfig )
 
 		( tLXOptions->bEnableChat, "Network.EnableChat", true )
 		( tLXOptions->bEnableMiniChat, "Network.EnableMiniChat", true )
@@ -207,7 +215,15 @@ bool GameOptions::Init() {
 		( tLXOptions->nMaxFPS, "Advanced.MaxFPS", 95 )
 		( tLXOptions->iJpegQuality, "Advanced.JpegQuality", 80 )
 		( tLXOptions->iMaxCachedEntries, "Advanced.MaxCachedEntries", 300 ) // Should be enough for every mod (we have 2777 .png and .wav files total now) and does not matter anyway with SmartPointer
+		( tLXOptions->bBakedMapCache, "Advanced.BakedMapCache", true )
+		( tLXOptions->bGusanosScriptCache, "Advanced.GusanosScriptCache", true )
 		( tLXOptions->bMatchLogging, "Advanced.MatchLogging", true )
+		( tLXOptions->iCommandTimeBudget, "Advanced.CommandTimeBudget", 20, "Command time budget", "Milliseconds per frame for executing queued console/dedicated commands, 0 is unlimited", GIG_Invalid, ALT_VeryAdvanced, true, 0, 1000 )
+		( tLXOptions->iLuaGCBudget, "Advanced.LuaGCBudget", 2, "Lua GC time budget", "Milliseconds per frame for the Lua garbage collector, run at the end of the frame. 0 lets Lua collect whenever it allocates", GIG_Invalid, ALT_VeryAdvanced, true, 0, 50 )
+		( tLXOptions->bLocalLoopback, "Advanced.LocalLoopback", true, "Local loopback", "The local client and the server hand their packets directly over in memory, without the OS network stack and the reliable channel. Applies on the next connect", GIG_Invalid, ALT_VeryAdvanced )
+		( tLXOptions->bDedicatedEventLoop, "Advanced.DedicatedEventLoop", true, "Dedicated event loop", "Dedicated server waits until a socket is readable, a command is queued or the next frame is due, instead of sleeping every frame (Linux only)", GIG_Invalid, ALT_VeryAdvanced )
+		( tLXOptions->iDedicatedIdleWait, "Advanced.DedicatedIdleWait", 100, "Dedicated idle wait", "Milliseconds the dedicated server may wait for network data or commands when no game is running", GIG_Invalid, ALT_VeryAdvanced, true, 0, 1000 )
+		( tLXOptions->iMetricsPort, "Advanced.MetricsPort", 0, "Metrics port", "Serve the server metrics (frame time, bandwidth, packet loss, ...) in the Prometheus text format on http://127.0.0.1:<port>/metrics. 0 is off", GIG_Invalid, ALT_VeryAdvanced, true, 0, 65535 )
 		( tLXOptions->bRecoverAfterCrash, "Advanced.RecoverAfterCrash", true )
 		( tLXOptions->bCheckForUpdates, "Advanced.CheckForUpdates", true )
 
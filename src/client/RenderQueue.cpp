@@ -0,0 +1,153 @@
+/*
+ *  RenderQueue.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <algorithm>
+#include "RenderQueue.h"
+#include "GfxPrimitives.h"
+#include "PixelFunctors.h"
+
+
+RenderQueue::Command& RenderQueue::add(Layer l, Kind k)
+{
+	commands.push_back(Command());
+	Command& c = commands.back();
+	c.layer = l;
+	c.kind = k;
+	c.cullable = true;
+	c.image = NULL;
+	c.func = NULL;
+	c.obj = NULL;
+	return c;
+}
+
+void RenderQueue::addPixel2x2(Layer l, int x, int y, Color col)
+{
+	if(col.a == SDL_ALPHA_TRANSPARENT) return;
+	Command& c = add(l, K_Pixel2x2);
+	c.x = x; c.y = y;
+	c.w = c.h = 2;
+	c.color = col;
+}
+
+void RenderQueue::addImage(Layer l, SDL_Surface* img, int sx, int sy, int dx, int dy, int w, int h)
+{
+	if(img == NULL || w <= 0 || h <= 0) return;
+	Command& c = add(l, K_Image);
+	c.image = img;
+	c.sx = sx; c.sy = sy;
+	c.x = dx; c.y = dy;
+	c.w = w; c.h = h;
+}
+
+void RenderQueue::addRectFill(Layer l, int x, int y, int x2, int y2, Color col)
+{
+	if(col.a == SDL_ALPHA_TRANSPARENT || x2 <= x || y2 <= y) return;
+	Command& c = add(l, K_RectFill);
+	c.x = x; c.y = y;
+	c.w = x2 - x; c.h = y2 - y;
+	c.color = col;
+}
+
+void RenderQueue::addCustom(Layer l, DrawFunc func, void* obj)
+{
+	Command& c = add(l, K_Custom);
+	c.cullable = false;
+	c.func = func;
+	c.obj = obj;
+}
+
+void RenderQueue::addCustom(Layer l, DrawFunc func, void* obj, int x, int y, int w, int h)
+{
+	Command& c = add(l, K_Custom);
+	c.func = func;
+	c.obj = obj;
+	c.x = x; c.y = y;
+	c.w = w; c.h = h;
+}
+
+///////////////////
+// Drops all commands which are completely outside of the clipping rect of bmpDest
+void RenderQueue::cull(const SDL_Surface* bmpDest)
+{
+	const SDL_Rect& clip = bmpDest->clip_rect;
+	const int clipX2 = clip.x + clip.w;
+	const int clipY2 = clip.y + clip.h;
+
+	std::vector<Command>::iterator out = commands.begin();
+	for(std::vector<Command>::iterator c = commands.begin(); c != commands.end(); ++c) {
+		bool visible = true;
+		if(c->kind == K_Pixel2x2)
+			// same as in DrawRectFill2x2
+			visible = c->x >= 0 && c->x + 2 < clipX2 && c->y >= 0 && c->y + 2 < clipY2;
+		else if(c->cullable)
+			visible =
+				c->x < clipX2 && c->x + c->w > clip.x &&
+				c->y < clipY2 && c->y + c->h > clip.y;
+
+		if(!visible) continue;
+		if(out != c) *out = *c;
+		++out;
+	}
+
+	stats.culled = commands.end() - out;
+	commands.erase(out, commands.end());
+}
+
+///////////////////
+// Draws a run of (already clipped) pixel commands with one lock
+void RenderQueue::drawPixels(SDL_Surface* bmpDest, std::vector<Command>::const_iterator begin, std::vector<Command>::const_iterator end)
+{
+	LOCK_OR_QUIT(bmpDest);
+	++stats.locks;
+
+	const int bpp = bmpDest->format->BytesPerPixel;
+	PixelPutAlpha& putter = getPixelAlphaPutFunc(bmpDest);
+	for(std::vector<Command>::const_iterator c = begin; c != end; ++c) {
+		Uint8 *row1 = (Uint8 *)bmpDest->pixels + c->y * bmpDest->pitch + c->x * bpp;
+		Uint8 *row2 = row1 + bmpDest->pitch;
+		putter.put(row1, bmpDest->format, c->color);
+		putter.put(row1 + bpp, bmpDest->format, c->color);
+		putter.put(row2, bmpDest->format, c->color);
+		putter.put(row2 + bpp, bmpDest->format, c->color);
+	}
+
+	UnlockSurface(bmpDest);
+}
+
+void RenderQueue::flush(SDL_Surface* bmpDest, CViewport* v)
+{
+	stats = Stats();
+	stats.queued = commands.size();
+
+	cull(bmpDest);
+	std::stable_sort(commands.begin(), commands.end(), Order());
+
+	for(std::vector<Command>::const_iterator c = commands.begin(); c != commands.end(); ) {
+		switch(c->kind) {
+		case K_Pixel2x2: {
+			std::vector<Command>::const_iterator end = c;
+			while(end != commands.end() && end->kind == K_Pixel2x2) ++end;
+			drawPixels(bmpDest, c, end);
+			c = end;
+			continue;
+		}
+		case K_Image:
+			DrawImageAdv(bmpDest, c->image, c->sx, c->sy, c->x, c->y, c->w, c->h);
+			break;
+		case K_RectFill:
+			DrawRectFill(bmpDest, c->x, c->y, c->x + c->w, c->y + c->h, c->color);
+			break;
+		case K_Custom:
+			(*c->func)(c->obj, bmpDest, v);
+			break;
+		}
+		++c;
+	}
+
+	commands.clear();
+}
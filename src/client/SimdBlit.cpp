@@ -0,0 +1,458 @@
+/*
+ *  SimdBlit.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <cstring>
+#include <vector>
+
+#include "SimdBlit.h"
+#include "CodeAttributes.h"
+#include "Debug.h"
+#include "Timer.h"
+#include "StringUtils.h"
+#include "MathLib.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define SIMDBLIT_SSE2
+#	if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#		define SIMDBLIT_AVX2 // needs target attributes which work together with the intrinsics
+#	endif
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	define SIMDBLIT_SSE2
+#endif
+
+#ifdef SIMDBLIT_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef SIMDBLIT_AVX2
+#include <immintrin.h>
+#endif
+
+// SSE2 is part of x86-64 anyway. On x86-32, we compile just these functions for it.
+#if defined(__GNUC__) && defined(__i386__) && !defined(__SSE2__)
+#define SSE2_FUNC __attribute__((target("sse2")))
+#else
+#define SSE2_FUNC
+#endif
+
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+
+namespace SimdBlit {
+
+struct Kernels {
+	void (*copyRowKey)(Uint32* dst, const Uint32* src, int n, Uint32 key, Uint32 keyMask);
+	void (*blendRowAlpha)(Uint32* dst, const Uint32* src, int n, Uint32 dstMask);
+	void (*blendRowFact)(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key);
+	void (*blendRowAlphaFact)(Uint32* dst, const Uint32* src, int n, int fact);
+	void (*addRowFact)(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key);
+	void (*addRowColor)(Uint32* dst, int n, Uint32 color);
+	void (*multRow8)(Uint32* dst, const Uint8* src, int n);
+	void (*stretch2Row)(Uint32* dst1, Uint32* dst2, const Uint32* src, int n);
+	void (*stretch2RowKey)(Uint32* dst1, Uint32* dst2, const Uint32* src, int n, Uint32 key, Uint32 keyMask);
+	void (*scale2xRow)(Uint32* dst1, Uint32* dst2, const Uint32* above, const Uint32* src, const Uint32* below, int n);
+};
+
+// The reference versions. They also do the remaining pixels of the vector versions.
+namespace ScalarImpl {
+
+static INLINE bool isHalfFact(int fact) { return fact >= 127 && fact <= 128; }
+
+static INLINE Uint32 blendAlpha1(Uint32 d, Uint32 s, Uint32 dstMask) {
+	const Uint32 a = s >> 24;
+	Uint32 r = 0;
+	for(int sh = 0; sh < 32; sh += 8)
+		r |= (((255 - a) * ((d >> sh) & 0xFF) + a * ((s >> sh) & 0xFF)) >> 8) << sh;
+	return r & dstMask;
+}
+
+// Like pmullw + psrlw + paddb
+static INLINE Uint32 blendFact1(Uint32 d, Uint32 s, int fact) {
+	Uint32 r = 0;
+	for(int sh = 0; sh < 32; sh += 8) {
+		const int dc = (d >> sh) & 0xFF, sc = (s >> sh) & 0xFF;
+		r |= (Uint32)((dc + ((((sc - dc) * fact) & 0xFFFF) >> 8)) & 0xFF) << sh;
+	}
+	return r;
+}
+
+static INLINE Uint32 blendHalf1(Uint32 d, Uint32 s) {
+	Uint32 r = 0;
+	for(int sh = 0; sh < 32; sh += 8)
+		r |= ((((d >> sh) & 0xFF) + ((s >> sh) & 0xFF) + 1) >> 1) << sh;
+	return r;
+}
+
+static INLINE Uint32 addSat1(Uint32 d, Uint32 s) {
+	Uint32 r = 0;
+	for(int sh = 0; sh < 32; sh += 8)
+		r |= MIN((Uint32)255, ((d >> sh) & 0xFF) + ((s >> sh) & 0xFF)) << sh;
+	return r;
+}
+
+static INLINE Uint32 scale1(Uint32 c, int fact) {
+	Uint32 r = 0;
+	for(int sh = 0; sh < 32; sh += 8)
+		r |= ((((c >> sh) & 0xFF) * fact) >> 8) << sh;
+	return r;
+}
+
+static void copyRowKey(Uint32* dst, const Uint32* src, int n, Uint32 key, Uint32 keyMask) {
+	for(; n > 0; --n, ++dst, ++src)
+		if((*src & keyMask) != key) *dst = *src;
+}
+
+static void blendRowAlpha(Uint32* dst, const Uint32* src, int n, Uint32 dstMask) {
+	for(; n > 0; --n, ++dst, ++src)
+		*dst = blendAlpha1(*dst, *src, dstMask);
+}
+
+static void blendRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key) {
+	for(; n > 0; --n, ++dst, ++src) {
+		if(*src == key) continue;
+		*dst = isHalfFact(fact) ? blendHalf1(*dst, *src) : blendFact1(*dst, *src, fact);
+	}
+}
+
+static void blendRowAlphaFact(Uint32* dst, const Uint32* src, int n, int fact) {
+	for(; n > 0; --n, ++dst, ++src)
+		*dst = blendFact1(*dst, *src, (int)((*src >> 24) * fact) >> 8);
+}
+
+static void addRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key) {
+	for(; n > 0; --n, ++dst, ++src) {
+		if(*src == key) continue;
+		*dst = addSat1(*dst, (fact >= 255) ? *src : scale1(*src, fact));
+	}
+}
+
+static void addRowColor(Uint32* dst, int n, Uint32 color) {
+	for(; n > 0; --n, ++dst)
+		*dst = addSat1(*dst, color);
+}
+
+static void multRow8(Uint32* dst, const Uint8* src, int n) {
+	for(; n > 0; --n, ++dst, ++src)
+		*dst = scale1(*dst, *src);
+}
+
+static void stretch2Row(Uint32* dst1, Uint32* dst2, const Uint32* src, int n) {
+	for(; n > 0; --n, dst1 += 2, dst2 += 2, ++src)
+		dst1[0] = dst1[1] = dst2[0] = dst2[1] = *src;
+}
+
+static void stretch2RowKey(Uint32* dst1, Uint32* dst2, const Uint32* src, int n, Uint32 key, Uint32 keyMask) {
+	for(; n > 0; --n, dst1 += 2, dst2 += 2, ++src)
+		if((*src & keyMask) != key)
+			dst1[0] = dst1[1] = dst2[0] = dst2[1] = *src;
+}
+
+/*
+	[A] [B] [C]
+	[D] [E] [F]
+	[G] [H] [I]
+*/
+static void scale2xRange(Uint32* dst1, Uint32* dst2, const Uint32* above, const Uint32* src, const Uint32* below, int n, int begin, int end) {
+	for(int i = begin; i < end; ++i) {
+		const Uint32 B = above[i], H = below[i], E = src[i];
+		const Uint32 D = src[(i > 0) ? (i - 1) : 0];
+		const Uint32 F = src[(i < n - 1) ? (i + 1) : (n - 1)];
+		Uint32* d1 = dst1 + i*2;
+		Uint32* d2 = dst2 + i*2;
+		if(B != H && D != F) {
+			d1[0] = (D == B) ? D : E;
+			d1[1] = (B == F) ? F : E;
+			d2[0] = (D == H) ? D : E;
+			d2[1] = (H == F) ? F : E;
+		}
+		else
+			d1[0] = d1[1] = d2[0] = d2[1] = E;
+	}
+}
+
+static void scale2xRow(Uint32* dst1, Uint32* dst2, const Uint32* above, const Uint32* src, const Uint32* below, int n) {
+	scale2xRange(dst1, dst2, above, src, below, n, 0, n);
+}
+
+static const Kernels kernels = {
+	copyRowKey,
+	blendRowAlpha,
+	blendRowFact,
+	blendRowAlphaFact,
+	addRowFact,
+	addRowColor,
+	multRow8,
+	stretch2Row,
+	stretch2RowKey,
+	scale2xRow
+};
+
+}
+
+#ifdef SIMDBLIT_SSE2
+namespace SSE2Impl {
+
+SSE2_FUNC static INLINE __m128i expandBytes(const Uint8* p) {
+	int v; memcpy(&v, p, sizeof(v));
+	__m128i x = _mm_cvtsi32_si128(v);
+	x = _mm_unpacklo_epi8(x, x);
+	return _mm_unpacklo_epi16(x, x);
+}
+
+#define V __m128i
+#define VW 4
+#define VOP(op) _mm_##op
+#define VSI(op) _mm_##op##_si128
+#define VFUNC SSE2_FUNC
+#define VFIX_LO(lo, hi) (lo)
+#define VFIX_HI(lo, hi) (hi)
+#include "SimdBlitKernels.h"
+#undef V
+#undef VW
+#undef VOP
+#undef VSI
+#undef VFUNC
+#undef VFIX_LO
+#undef VFIX_HI
+
+}
+#endif
+
+#ifdef SIMDBLIT_AVX2
+namespace AVX2Impl {
+
+AVX2_FUNC static INLINE __m256i expandBytes(const Uint8* p) {
+	const __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+	return _mm256_mullo_epi32(x, _mm256_set1_epi32(0x01010101));
+}
+
+// The 256bit unpack instructions work on each 128bit half separately
+#define V __m256i
+#define VW 8
+#define VOP(op) _mm256_##op
+#define VSI(op) _mm256_##op##_si256
+#define VFUNC AVX2_FUNC
+#define VFIX_LO(lo, hi) _mm256_permute2x128_si256(lo, hi, 0x20)
+#define VFIX_HI(lo, hi) _mm256_permute2x128_si256(lo, hi, 0x31)
+#include "SimdBlitKernels.h"
+#undef V
+#undef VW
+#undef VOP
+#undef VSI
+#undef VFUNC
+#undef VFIX_LO
+#undef VFIX_HI
+
+}
+#endif
+
+
+std::string levelName(Level l) {
+	switch(l) {
+		case Scalar: return "C";
+		case SSE2: return "SSE2";
+		case AVX2: return "AVX2";
+	}
+	return "unknown";
+}
+
+static const Kernels* kernelsFor(Level l) {
+#ifdef SIMDBLIT_AVX2
+	if(l >= AVX2) return &AVX2Impl::kernels;
+#endif
+#ifdef SIMDBLIT_SSE2
+	if(l >= SSE2) return &SSE2Impl::kernels;
+#endif
+	return &ScalarImpl::kernels;
+}
+
+Level detectedLevel() {
+#if defined(SIMDBLIT_SSE2) && defined(__GNUC__)
+	__builtin_cpu_init();
+#ifdef SIMDBLIT_AVX2
+	if(__builtin_cpu_supports("avx2")) return AVX2;
+#endif
+	if(__builtin_cpu_supports("sse2")) return SSE2;
+	return Scalar;
+#elif defined(SIMDBLIT_SSE2)
+	return SSE2; // guaranteed by the compiler settings
+#else
+	return Scalar;
+#endif
+}
+
+static Level maxLevel = AVX2;
+static Level activeLevel = Scalar;
+static const Kernels* activeKernels = NULL;
+
+static void selectKernels() {
+	activeLevel = MIN(detectedLevel(), maxLevel);
+	activeKernels = kernelsFor(activeLevel);
+	notes << "SimdBlit: using " << levelName(activeLevel) << " blitters" << endl;
+}
+
+static INLINE const Kernels& active() {
+	if(!activeKernels) selectKernels();
+	return *activeKernels;
+}
+
+Level level() {
+	active();
+	return activeLevel;
+}
+
+void setMaxLevel(Level l) {
+	maxLevel = l;
+	activeKernels = NULL;
+	active();
+}
+
+void copyRowKey(Uint32* dst, const Uint32* src, int n, Uint32 key, Uint32 keyMask) {
+	if(n > 0) active().copyRowKey(dst, src, n, key, keyMask);
+}
+
+void blendRowAlpha(Uint32* dst, const Uint32* src, int n, Uint32 dstMask) {
+	if(n > 0) active().blendRowAlpha(dst, src, n, dstMask);
+}
+
+void blendRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key) {
+	if(n > 0) active().blendRowFact(dst, src, n, fact, key);
+}
+
+void blendRowAlphaFact(Uint32* dst, const Uint32* src, int n, int fact) {
+	if(n > 0) active().blendRowAlphaFact(dst, src, n, CLAMP(fact, 0, 256));
+}
+
+void addRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key) {
+	if(n > 0 && fact > 0) active().addRowFact(dst, src, n, fact, key);
+}
+
+void addRowColor(Uint32* dst, int n, Uint32 color) {
+	if(n > 0) active().addRowColor(dst, n, color);
+}
+
+void multRow8(Uint32* dst, const Uint8* src, int n) {
+	if(n > 0) active().multRow8(dst, src, n);
+}
+
+void stretch2Row(Uint32* dst1, Uint32* dst2, const Uint32* src, int n) {
+	if(n > 0) active().stretch2Row(dst1, dst2, src, n);
+}
+
+void stretch2RowKey(Uint32* dst1, Uint32* dst2, const Uint32* src, int n, Uint32 key, Uint32 keyMask) {
+	if(n > 0) active().stretch2RowKey(dst1, dst2, src, n, key, keyMask);
+}
+
+void scale2xRow(Uint32* dst1, Uint32* dst2, const Uint32* above, const Uint32* src, const Uint32* below, int n) {
+	if(n > 0) active().scale2xRow(dst1, dst2, above, src, below, n);
+}
+
+
+
+//
+// Benchmark
+//
+
+namespace {
+
+struct BenchSurfaces {
+	int w, h;
+	std::vector<Uint32> src, dst, dst2x;
+	std::vector<Uint8> src8;
+
+	BenchSurfaces(int w_, int h_) : w(w_), h(h_), src(w_ * h_), dst(w_ * h_), dst2x(w_ * h_ * 4), src8(w_ * h_) {
+		// some pseudo random content with all kind of alpha values and some colorkey pixels
+		Uint32 rnd = 0x12345678;
+		for(size_t i = 0; i < src.size(); ++i) {
+			rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+			src[i] = (rnd % 7 == 0) ? 0xFF00FF : rnd;
+			dst[i] = rnd * 2654435761u;
+			src8[i] = (Uint8)(rnd >> 8);
+		}
+	}
+
+	Uint32* srcRow(int y) { return &src[y * w]; }
+	Uint32* dstRow(int y) { return &dst[y * w]; }
+};
+
+enum Kernel {
+	K_CopyKey = 0, K_BlendAlpha, K_BlendFact, K_BlendAlphaFact, K_AddFact, K_AddColor, K_Mult8, K_Stretch2, K_Stretch2Key, K_Scale2x,
+	K_Count
+};
+
+static const char* kernelNames[K_Count] = {
+	"copyKey", "blendAlpha", "blendFact", "blendAlphaFact", "addFact", "addColor", "mult8", "stretch2", "stretch2Key", "scale2x"
+};
+
+}
+
+static void runKernel(const Kernels& k, Kernel kernel, BenchSurfaces& s) {
+	for(int y = 0; y < s.h; ++y) {
+		Uint32* src = s.srcRow(y);
+		Uint32* dst = s.dstRow(y);
+		Uint32* dst1 = &s.dst2x[y * 2 * s.w * 2];
+		Uint32* dst2 = dst1 + s.w * 2;
+		switch(kernel) {
+			case K_CopyKey: k.copyRowKey(dst, src, s.w, 0xFF00FF, 0xFFFFFF); break;
+			case K_BlendAlpha: k.blendRowAlpha(dst, src, s.w, 0xFFFFFF); break;
+			case K_BlendFact: k.blendRowFact(dst, src, s.w, 100, 0xFF00FF); break;
+			case K_BlendAlphaFact: k.blendRowAlphaFact(dst, src, s.w, 200); break;
+			case K_AddFact: k.addRowFact(dst, src, s.w, 100, 0xFF00FF); break;
+			case K_AddColor: k.addRowColor(dst, s.w, 0x203040); break;
+			case K_Mult8: k.multRow8(dst, &s.src8[y * s.w], s.w); break;
+			case K_Stretch2: k.stretch2Row(dst1, dst2, src, s.w); break;
+			case K_Stretch2Key: k.stretch2RowKey(dst1, dst2, src, s.w, 0xFF00FF, 0xFFFFFF); break;
+			case K_Scale2x: k.scale2xRow(dst1, dst2, s.srcRow(MAX(y - 1, 0)), src, s.srcRow(MIN(y + 1, s.h - 1)), s.w); break;
+			case K_Count: break;
+		}
+	}
+}
+
+// Returns the throughput in source megapixels per second
+static float measureKernel(const Kernels& k, Kernel kernel, BenchSurfaces& s) {
+	const TimeDiff minTime = TimeDiff(50);
+	runKernel(k, kernel, s); // warm up the caches
+
+	size_t frames = 0;
+	const AbsTime start = GetTime();
+	TimeDiff elapsed;
+	do {
+		runKernel(k, kernel, s);
+		++frames;
+		elapsed = GetTime() - start;
+	} while(elapsed < minTime);
+
+	return (float)frames * s.w * s.h / MAX(elapsed.seconds(), 0.001f) / 1000000.0f;
+}
+
+std::vector<std::string> benchmark(const std::string& kernelFilter) {
+	static const int sizes[][2] = { {320, 240}, {640, 480}, {1280, 720}, {1920, 1080} };
+	std::vector<std::string> result;
+	const Level best = detectedLevel();
+
+	for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+		BenchSurfaces surfaces(sizes[i][0], sizes[i][1]);
+
+		for(int kernel = 0; kernel < K_Count; ++kernel) {
+			if(!kernelFilter.empty() && !stringcaseequal(kernelFilter, kernelNames[kernel])) continue;
+
+			std::string line = std::string(kernelNames[kernel]) + " " + itoa(surfaces.w) + "x" + itoa(surfaces.h) + ":";
+			float scalarRate = 0;
+			for(int l = Scalar; l <= best; ++l) {
+				const float rate = measureKernel(*kernelsFor((Level)l), (Kernel)kernel, surfaces);
+				if(l == Scalar) scalarRate = rate;
+				line += " " + levelName((Level)l) + " " + itoa((int)rate) + " Mpix/s";
+				if(l != Scalar && scalarRate > 0) line += " (" + ftoa(rate / scalarRate, 2) + "x)";
+			}
+			result.push_back(line);
+		}
+	}
+
+	return result;
+}
+
+}
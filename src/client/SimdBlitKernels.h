@@ -0,0 +1,204 @@
+/*
+ *  SimdBlitKernels.h
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+// HINT: no include guard. This is included by SimdBlit.cpp once per
+// instruction set, inside of the namespace of that instruction set.
+// The includer defines:
+//   V          the vector type
+//   VW         pixels per vector
+//   VOP(op)    prefixes an intrinsic (_mm_op / _mm256_op)
+//   VSI(op)    an intrinsic on the whole register (_mm_op_si128 / _mm256_op_si256)
+//   VFUNC      the target attribute for the functions
+//   VFIX_LO/VFIX_HI  reorder the result of a 32bit unpacklo/unpackhi pair to linear order
+//   expandBytes(p)   loads VW bytes and repeats each of them 4 times (one pixel per byte)
+
+VFUNC static INLINE V load(const void* p) { return VSI(loadu)((const V*)p); }
+VFUNC static INLINE void store(void* p, V v) { VSI(storeu)((V*)p, v); }
+VFUNC static INLINE V select(V m, V a, V b) { return VSI(or)(VSI(and)(m, a), VSI(andnot)(m, b)); }
+
+// Broadcasts the upper 16bit lane (the alpha) of each pixel to all 4 lanes of the pixel
+VFUNC static INLINE V alphaLanes(V px16) {
+	return VOP(shufflehi_epi16)(VOP(shufflelo_epi16)(px16, 0xFF), 0xFF);
+}
+
+// d + ((s - d) * f >> 8) for each byte, where the multiplication is done in 16bit.
+// fLo/fHi are the factors for the unpacklo/unpackhi halves.
+VFUNC static INLINE V blendBytes(V d, V s, V fLo, V fHi) {
+	const V zero = VSI(setzero)();
+	const V lo = VOP(mullo_epi16)(VOP(sub_epi16)(VOP(unpacklo_epi8)(s, zero), VOP(unpacklo_epi8)(d, zero)), fLo);
+	const V hi = VOP(mullo_epi16)(VOP(sub_epi16)(VOP(unpackhi_epi8)(s, zero), VOP(unpackhi_epi8)(d, zero)), fHi);
+	return VOP(add_epi8)(VOP(packus_epi16)(VOP(srli_epi16)(lo, 8), VOP(srli_epi16)(hi, 8)), d);
+}
+
+VFUNC static void copyRowKey(Uint32* dst, const Uint32* src, int n, Uint32 key, Uint32 keyMask) {
+	const V vkey = VOP(set1_epi32)((int)key);
+	const V vmask = VOP(set1_epi32)((int)keyMask);
+	for(; n >= VW; n -= VW, dst += VW, src += VW) {
+		const V s = load(src);
+		const V skip = VOP(cmpeq_epi32)(VSI(and)(s, vmask), vkey);
+		store(dst, select(skip, load(dst), s));
+	}
+	ScalarImpl::copyRowKey(dst, src, n, key, keyMask);
+}
+
+VFUNC static void blendRowAlpha(Uint32* dst, const Uint32* src, int n, Uint32 dstMask) {
+	const V zero = VSI(setzero)();
+	const V c255 = VOP(set1_epi16)(255);
+	const V vmask = VOP(set1_epi32)((int)dstMask);
+	for(; n >= VW; n -= VW, dst += VW, src += VW) {
+		const V s = load(src), d = load(dst);
+		const V sLo = VOP(unpacklo_epi8)(s, zero), sHi = VOP(unpackhi_epi8)(s, zero);
+		const V aLo = alphaLanes(sLo), aHi = alphaLanes(sHi);
+		// (255 - a) * d + a * s is at most 255 * 255, so it fits into unsigned 16bit
+		const V rLo = VOP(add_epi16)(
+			VOP(mullo_epi16)(VOP(sub_epi16)(c255, aLo), VOP(unpacklo_epi8)(d, zero)),
+			VOP(mullo_epi16)(aLo, sLo));
+		const V rHi = VOP(add_epi16)(
+			VOP(mullo_epi16)(VOP(sub_epi16)(c255, aHi), VOP(unpackhi_epi8)(d, zero)),
+			VOP(mullo_epi16)(aHi, sHi));
+		store(dst, VSI(and)(VOP(packus_epi16)(VOP(srli_epi16)(rLo, 8), VOP(srli_epi16)(rHi, 8)), vmask));
+	}
+	ScalarImpl::blendRowAlpha(dst, src, n, dstMask);
+}
+
+VFUNC static void blendRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key) {
+	const V vkey = VOP(set1_epi32)((int)key);
+	if(ScalarImpl::isHalfFact(fact)) {
+		for(; n >= VW; n -= VW, dst += VW, src += VW) {
+			const V d = load(dst);
+			const V s = load(src);
+			store(dst, VOP(avg_epu8)(select(VOP(cmpeq_epi32)(s, vkey), d, s), d));
+		}
+	}
+	else {
+		const V f = VOP(set1_epi16)((short)fact);
+		for(; n >= VW; n -= VW, dst += VW, src += VW) {
+			const V d = load(dst);
+			const V s = load(src);
+			store(dst, blendBytes(d, select(VOP(cmpeq_epi32)(s, vkey), d, s), f, f));
+		}
+	}
+	ScalarImpl::blendRowFact(dst, src, n, fact, key);
+}
+
+VFUNC static void blendRowAlphaFact(Uint32* dst, const Uint32* src, int n, int fact) {
+	const V zero = VSI(setzero)();
+	const V f = VOP(set1_epi16)((short)fact);
+	for(; n >= VW; n -= VW, dst += VW, src += VW) {
+		const V s = load(src);
+		// alpha * fact is at most 255 * 256, that fits into unsigned 16bit
+		const V aLo = VOP(srli_epi16)(VOP(mullo_epi16)(alphaLanes(VOP(unpacklo_epi8)(s, zero)), f), 8);
+		const V aHi = VOP(srli_epi16)(VOP(mullo_epi16)(alphaLanes(VOP(unpackhi_epi8)(s, zero)), f), 8);
+		store(dst, blendBytes(load(dst), s, aLo, aHi));
+	}
+	ScalarImpl::blendRowAlphaFact(dst, src, n, fact);
+}
+
+VFUNC static void addRowFact(Uint32* dst, const Uint32* src, int n, int fact, Uint32 key) {
+	const V vkey = VOP(set1_epi32)((int)key);
+	if(fact >= 255) {
+		for(; n >= VW; n -= VW, dst += VW, src += VW) {
+			const V s = load(src);
+			store(dst, VOP(adds_epu8)(load(dst), VSI(andnot)(VOP(cmpeq_epi32)(s, vkey), s)));
+		}
+	}
+	else {
+		const V zero = VSI(setzero)();
+		const V f = VOP(set1_epi16)((short)fact);
+		for(; n >= VW; n -= VW, dst += VW, src += VW) {
+			V s = load(src);
+			s = VSI(andnot)(VOP(cmpeq_epi32)(s, vkey), s);
+			const V lo = VOP(srli_epi16)(VOP(mullo_epi16)(VOP(unpacklo_epi8)(s, zero), f), 8);
+			const V hi = VOP(srli_epi16)(VOP(mullo_epi16)(VOP(unpackhi_epi8)(s, zero), f), 8);
+			store(dst, VOP(adds_epu8)(load(dst), VOP(packus_epi16)(lo, hi)));
+		}
+	}
+	ScalarImpl::addRowFact(dst, src, n, fact, key);
+}
+
+VFUNC static void addRowColor(Uint32* dst, int n, Uint32 color) {
+	const V c = VOP(set1_epi32)((int)color);
+	for(; n >= VW; n -= VW, dst += VW)
+		store(dst, VOP(adds_epu8)(load(dst), c));
+	ScalarImpl::addRowColor(dst, n, color);
+}
+
+VFUNC static void multRow8(Uint32* dst, const Uint8* src, int n) {
+	const V zero = VSI(setzero)();
+	for(; n >= VW; n -= VW, dst += VW, src += VW) {
+		const V m = expandBytes(src);
+		const V d = load(dst);
+		const V lo = VOP(srli_epi16)(VOP(mullo_epi16)(VOP(unpacklo_epi8)(d, zero), VOP(unpacklo_epi8)(m, zero)), 8);
+		const V hi = VOP(srli_epi16)(VOP(mullo_epi16)(VOP(unpackhi_epi8)(d, zero), VOP(unpackhi_epi8)(m, zero)), 8);
+		store(dst, VOP(packus_epi16)(lo, hi));
+	}
+	ScalarImpl::multRow8(dst, src, n);
+}
+
+VFUNC static void stretch2Row(Uint32* dst1, Uint32* dst2, const Uint32* src, int n) {
+	for(; n >= VW; n -= VW, dst1 += 2*VW, dst2 += 2*VW, src += VW) {
+		const V s = load(src);
+		const V lo = VOP(unpacklo_epi32)(s, s), hi = VOP(unpackhi_epi32)(s, s);
+		const V a = VFIX_LO(lo, hi), b = VFIX_HI(lo, hi);
+		store(dst1, a); store(dst1 + VW, b);
+		store(dst2, a); store(dst2 + VW, b);
+	}
+	ScalarImpl::stretch2Row(dst1, dst2, src, n);
+}
+
+VFUNC static void stretch2RowKey(Uint32* dst1, Uint32* dst2, const Uint32* src, int n, Uint32 key, Uint32 keyMask) {
+	const V vkey = VOP(set1_epi32)((int)key);
+	const V vmask = VOP(set1_epi32)((int)keyMask);
+	for(; n >= VW; n -= VW, dst1 += 2*VW, dst2 += 2*VW, src += VW) {
+		const V s = load(src);
+		const V skip = VOP(cmpeq_epi32)(VSI(and)(s, vmask), vkey);
+		const V lo = VOP(unpacklo_epi32)(s, s), hi = VOP(unpackhi_epi32)(s, s);
+		const V skipLo = VOP(unpacklo_epi32)(skip, skip), skipHi = VOP(unpackhi_epi32)(skip, skip);
+		const V a = VFIX_LO(lo, hi), b = VFIX_HI(lo, hi);
+		const V skipA = VFIX_LO(skipLo, skipHi), skipB = VFIX_HI(skipLo, skipHi);
+		store(dst1, select(skipA, load(dst1), a)); store(dst1 + VW, select(skipB, load(dst1 + VW), b));
+		store(dst2, select(skipA, load(dst2), a)); store(dst2 + VW, select(skipB, load(dst2 + VW), b));
+	}
+	ScalarImpl::stretch2RowKey(dst1, dst2, src, n, key, keyMask);
+}
+
+VFUNC static void scale2xRow(Uint32* dst1, Uint32* dst2, const Uint32* above, const Uint32* src, const Uint32* below, int n) {
+	// The vector loop reads src[i-1] and src[i+1], so the borders are done by the scalar code
+	int i = 1;
+	ScalarImpl::scale2xRange(dst1, dst2, above, src, below, n, 0, 1);
+	const V zero = VSI(setzero)();
+	const V ones = VOP(cmpeq_epi32)(zero, zero);
+	for(; i + VW < n; i += VW) {
+		const V B = load(above + i), H = load(below + i);
+		const V D = load(src + i - 1), E = load(src + i), F = load(src + i + 1);
+		// B != H && D != F
+		const V cond = VSI(andnot)(VSI(or)(VOP(cmpeq_epi32)(B, H), VOP(cmpeq_epi32)(D, F)), ones);
+		const V e0 = select(VSI(and)(cond, VOP(cmpeq_epi32)(D, B)), D, E);
+		const V e1 = select(VSI(and)(cond, VOP(cmpeq_epi32)(B, F)), F, E);
+		const V e2 = select(VSI(and)(cond, VOP(cmpeq_epi32)(D, H)), D, E);
+		const V e3 = select(VSI(and)(cond, VOP(cmpeq_epi32)(H, F)), F, E);
+		const V lo1 = VOP(unpacklo_epi32)(e0, e1), hi1 = VOP(unpackhi_epi32)(e0, e1);
+		const V lo2 = VOP(unpacklo_epi32)(e2, e3), hi2 = VOP(unpackhi_epi32)(e2, e3);
+		store(dst1 + i*2, VFIX_LO(lo1, hi1)); store(dst1 + i*2 + VW, VFIX_HI(lo1, hi1));
+		store(dst2 + i*2, VFIX_LO(lo2, hi2)); store(dst2 + i*2 + VW, VFIX_HI(lo2, hi2));
+	}
+	ScalarImpl::scale2xRange(dst1, dst2, above, src, below, n, i, n);
+}
+
+static const Kernels kernels = {
+	copyRowKey,
+	blendRowAlpha,
+	blendRowFact,
+	blendRowAlphaFact,
+	addRowFact,
+	addRowColor,
+	multRow8,
+	stretch2Row,
+	stretch2RowKey,
+	scale2xRow
+};
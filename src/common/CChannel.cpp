@@ -25,6 +25,8 @@
 #include "MathLib.h"
 #include "CServer.h"
 #include "CodeAttributes.h"
+#include "Mutex.h"
+#include "DedicatedLoop.h"
 
 
 
@@ -44,6 +46,7 @@ void CChannel::Clear()
 	cOutgoingRate.clear();
 	iOutgoingBytes = 0;
 	iIncomingBytes = 0;
+	iReliableRetransmits = 0;
 	iPing = 0;
 	fLastSent = fLastPckRecvd = fLastPingSent = AbsTime();
 	iCurrentIncomingBytes = 0;
@@ -927,6 +930,7 @@ void CChannel3::Clear()
 	PongSequence = -1;
 	LastReliablePacketSent = SEQUENCE_WRAPAROUND - 1;
 	NextReliablePacketToSend = 0;
+	HighestReliablePacketSent = SEQUENCE_WRAPAROUND - 1;
 	LastReliableIn_SentWithLastPacket = SEQUENCE_WRAPAROUND - 1;
 	
 	KeepAlivePacketTimeout = KEEP_ALIVE_PACKET_TIMEOUT;
@@ -1183,6 +1187,7 @@ void CChannel3::Transmit(CBytestream *unreliableData)
 								// This should not occur when packets are fragmented
 	int packetIndex = LastReliableOut;
 	int packetSize = 0;
+	size_t retransmits = 0;
 	
 	for( PacketList_t::iterator it = ReliableOut.begin(); it != ReliableOut.end(); it++ )
 	{
@@ -1191,6 +1196,9 @@ void CChannel3::Transmit(CBytestream *unreliableData)
 			if( bs.GetLength() + 4 + packetData.GetLength() + it->data.GetLength() > MAX_PACKET_SIZE-2 && !firstPacket )  // Substract CRC16 size
 				break;
 
+			if( SequenceDiff( it->idx, HighestReliablePacketSent ) <= 0 )
+				retransmits++;
+
 			if( !firstPacket )
 			{
 				bs.writeInt( packetIndex | SEQUENCE_HIGHEST_BIT, 2 );
@@ -1254,6 +1262,9 @@ void CChannel3::Transmit(CBytestream *unreliableData)
 
 	LastReliableIn_SentWithLastPacket = LastReliableIn;
 	LastReliablePacketSent = NextReliablePacketToSend;
+	if( !unreliableOnly && SequenceDiff( NextReliablePacketToSend, HighestReliablePacketSent ) > 0 )
+		HighestReliablePacketSent = NextReliablePacketToSend;
+	iReliableRetransmits += retransmits;
 
 	UpdateTransmitStatistics( bs1.GetLength() );
 }
@@ -1269,6 +1280,127 @@ void CChannel3::AddReliablePacketToSend(CBytestream& bs) // The same as in CChan
 
 
 
+///////////////////
+// CChannel_Local - direct handover to the local client in the same process
+
+struct CChannel_Local::Link {
+	Mutex mutex;
+	bool closed; // the server side is gone
+	bool clientGone; // the client side is gone, it has not been created yet otherwise
+	std::list<CBytestream> toClient, toServer;
+	Link() : closed(false), clientGone(false) {}
+};
+
+// Only used from the main thread
+static std::map< NetworkSocket::Port, SmartPointer<CChannel_Local::Link> > localLinks; // by port of the client
+
+CChannel_Local::CChannel_Local(const SmartPointer<Link>& _link, bool _serverSide, NetworkSocket::Port _clientPort) :
+	link(_link), serverSide(_serverSide), clientPort(_clientPort) {}
+
+CChannel_Local::~CChannel_Local()
+{
+	{
+		Mutex::ScopedLock lock(link->mutex);
+		if( serverSide ) {
+			link->closed = true;
+			link->toServer.clear();
+		} else
+			link->clientGone = true;
+		link->toClient.clear();
+	}
+	if( serverSide ) {
+		std::map< NetworkSocket::Port, SmartPointer<Link> >::iterator i = localLinks.find(clientPort);
+		if( i != localLinks.end() && i->second.get() == link.get() )
+			localLinks.erase(i);
+	}
+}
+
+CChannel_Local* CChannel_Local::createForServer(NetworkSocket::Port clientPort)
+{
+	SmartPointer<Link> l = new Link();
+	localLinks[clientPort] = l;
+	return new CChannel_Local(l, true, clientPort);
+}
+
+CChannel_Local* CChannel_Local::createForClient(NetworkSocket::Port clientPort)
+{
+	std::map< NetworkSocket::Port, SmartPointer<Link> >::iterator i = localLinks.find(clientPort);
+	if( clientPort == 0 || i == localLinks.end() )
+		return NULL;
+	{
+		Mutex::ScopedLock lock(i->second->mutex);
+		i->second->clientGone = false;
+	}
+	return new CChannel_Local(i->second, false, clientPort);
+}
+
+bool CChannel_Local::hasLink(NetworkSocket::Port clientPort)
+{
+	return clientPort != 0 && localLinks.count(clientPort) > 0;
+}
+
+bool CChannel_Local::isCurrent()
+{
+	std::map< NetworkSocket::Port, SmartPointer<Link> >::iterator i = localLinks.find(clientPort);
+	return i != localLinks.end() && i->second.get() == link.get();
+}
+
+void CChannel_Local::Transmit(CBytestream *unreliableData)
+{
+	if( unreliableData && unreliableData->GetLength() > 0 )
+		Messages.push_back(*unreliableData);
+	if( Messages.empty() )
+		return;
+
+	size_t len = 0;
+	for( std::list<CBytestream>::iterator i = Messages.begin(); i != Messages.end(); ++i )
+		len += i->GetLength();
+
+	{
+		Mutex::ScopedLock lock(link->mutex);
+		if( !link->closed && !(serverSide && link->clientGone) ) {
+			std::list<CBytestream>& out = serverSide ? link->toClient : link->toServer;
+			out.splice(out.end(), Messages);
+		}
+	}
+	Messages.clear(); // if the other side is gone
+
+	UpdateTransmitStatistics( (int)len );
+	// the other side reads it in the next frame, the dedicated server should not sleep before that
+	DedicatedLoopWakeup();
+}
+
+bool CChannel_Local::ReceiveDirect(std::list<CBytestream>& packets)
+{
+	std::list<CBytestream> in;
+	{
+		Mutex::ScopedLock lock(link->mutex);
+		in.swap(serverSide ? link->toServer : link->toClient);
+	}
+	if( in.empty() )
+		return false;
+
+	size_t len = 0;
+	for( std::list<CBytestream>::iterator i = in.begin(); i != in.end(); ++i ) {
+		i->ResetPosToBegin();
+		len += i->GetLength();
+	}
+	packets.splice(packets.end(), in);
+
+	UpdateReceiveStatistics( (int)len );
+	return true;
+}
+
+void CChannel_Local::AddReliablePacketToSend(CBytestream& bs) // The same as in CChannel but without size limit
+{
+	if(bs.GetLength() == 0)
+		return;
+
+	Messages.push_back(bs);
+}
+
+
+
 
 // CRC16 stolen from Linux kernel sources
 /** CRC table for the CRC-16. The poly is 0x8005 (x^16 + x^15 + x^2 + 1) */
@@ -47,6 +47,7 @@ void CGameObject::gusInit( CWormInputHandler* owner, Vec pos_, Vec spd_ )
 {
 	nextS_=(0); nextD_=(0); prevD_=(0); cellIndex_=(-1);
 	deleteMe=(false);
+	snapshotFrame = 0; snapshotCount = 0;
 
 	m_owner=(owner);
 	vPos = CVec(pos_);
@@ -60,7 +61,34 @@ void CGameObject::gusShutdown()
 
 Vec CGameObject::getRenderPos()
 {
-	return pos();
+	return interpolatedPos();
+}
+
+void CGameObject::snapshotRenderPos(uint64_t frame)
+{
+	if(snapshotCount > 0 && snapshotFrame + 1 == frame) {
+		vSnapshotPos[0] = vSnapshotPos[1];
+		snapshotCount = 2;
+	}
+	else {
+		vSnapshotPos[0] = vPos.get();
+		snapshotCount = 1;
+	}
+	vSnapshotPos[1] = vPos.get();
+	snapshotFrame = frame;
+}
+
+CVec CGameObject::interpolatedPos() const
+{
+	if(snapshotCount < 2 || snapshotFrame != game.renderSnapshotFrame())
+		return vPos;
+
+	// Moved outside of the simulation (e.g. by a network update) or teleported (spawn, wrap around)
+	const CVec dist = vSnapshotPos[1] - vSnapshotPos[0];
+	if(vSnapshotPos[1] != vPos.get() || dist.GetLength2() > 20.0f * 20.0f)
+		return vPos;
+
+	return vSnapshotPos[0] + dist * game.renderInterpolation();
 }
 
 Angle CGameObject::getPointingAngle()
@@ -34,6 +34,9 @@
 #include "game/Mod.h"
 #include "gusanos/gusanos.h"
 #include "sound/SoundsBase.h"
+#include "ThreadPool.h"
+#include "MathLib.h"
+#include <boost/bind.hpp>
 
 
 
@@ -665,6 +668,9 @@ int CGameScript::Load(const std::string& dir, bool loadImagesAndSounds)
 		return GSE_MEM;
 	}
 
+	// Parse phase: images and sounds are only requested, they are decoded after we have read the script
+	bQueueAssets = true;
+
 	// Weapons
 	weapon_t *wpn;
 	for(n=0;n<NumWeapons;n++) {
@@ -749,10 +755,7 @@ int CGameScript::Load(const std::string& dir, bool loadImagesAndSounds)
 
 			if(!bDedicated && wpn->UseSound && loadImagesAndSounds) {
 				// Load the sample
-				wpn->smpSample = LoadGSSample(dir,wpn->SndFilename);
-
-				if(wpn->smpSample == NULL)
-					wpn->UseSound = false;
+				RequestGSSample(dir, wpn->SndFilename, &wpn->smpSample, &wpn->UseSound, "");
 			}
 		}
 
@@ -801,6 +804,10 @@ int CGameScript::Load(const std::string& dir, bool loadImagesAndSounds)
 
 	fclose(fp);
 
+	// Asset phase
+	bQueueAssets = false;
+	LoadQueuedAssets();
+
 	// Already cached externally
 	// Save to cache
 	//cCache.SaveMod(dir, this);
@@ -910,13 +917,8 @@ proj_t *CGameScript::LoadProjectile(FILE *fp, bool loadImagesAndSounds)
 		case PRJ_IMAGE:
 			proj->ImgFilename = readString(fp);
 		
-			if(!bDedicated && loadImagesAndSounds) {
-				proj->bmpImage = LoadGSImage(sDirectory, proj->ImgFilename);
-				if(!proj->bmpImage)
-					modLog("Could not open image '" + proj->ImgFilename + "'");
-				else
-					proj->bmpShadow = GenerateShadowSurface(proj->bmpImage);
-			}
+			if(!bDedicated && loadImagesAndSounds)
+				RequestGSImage(sDirectory, proj->ImgFilename, &proj->bmpImage, &proj->bmpShadow, "Could not open image '" + proj->ImgFilename + "'");
 			
 			fread_endian<int>(fp, proj->Rotating);
 			fread_compat(proj->RotIncrement, sizeof(int), 1, fp);
@@ -980,12 +982,7 @@ proj_t *CGameScript::LoadProjectile(FILE *fp, bool loadImagesAndSounds)
 
 		if(!bDedicated && proj->Hit.UseSound && loadImagesAndSounds) {
 			// Load the sample
-			proj->Hit.Sound = LoadGSSample(sDirectory,proj->Hit.SndFilename);
-			
-			if(proj->Hit.Sound == NULL) {
-				proj->Hit.UseSound = false;
-				modLog("Could not open sound '" + proj->Hit.SndFilename + "'");
-			}
+			RequestGSSample(sDirectory, proj->Hit.SndFilename, &proj->Hit.Sound, &proj->Hit.UseSound, "Could not open sound '" + proj->Hit.SndFilename + "'");
 		}		
 	}
 	else { // newer GS version
@@ -1129,29 +1126,42 @@ proj_t *CGameScript::LoadProjectile(FILE *fp, bool loadImagesAndSounds)
 	return proj;
 }
 
+// Image and sample lookup of the game script: first the mod dir, then the data dir.
+// Thread-safe, the loaders share the results through CCache.
+static SmartPointer<SDL_Surface> loadGSImageFile(const std::string& dir, const std::string& filename)
+{
+	// First, check the gfx directory in the mod dir
+	SmartPointer<SDL_Surface> img = LoadGameImage(dir + "/gfx/" + filename, true);
+
+	// Check the gfx directory in the data dir
+	if(!img.get())
+		img = LoadGameImage("data/gfx/" + filename, true);
+
+	if(img.get())
+		SetColorKey(img.get());
+	return img;
+}
+
+static SmartPointer<SoundSample> loadGSSampleFile(const std::string& dir, const std::string& filename)
+{
+	// First, check the sfx directory in the mod dir
+	SmartPointer<SoundSample> smp = LoadSample(dir + "/sfx/" + filename, 10);
+
+	// Check the sounds directory in the data dir
+	if(!smp.get())
+		smp = LoadSample("data/sounds/" + filename, 10);
+	return smp;
+}
+
 ///////////////////
 // Load an image
 SDL_Surface * CGameScript::LoadGSImage(const std::string& dir, const std::string& filename)
 {
 	if(bDedicated) return NULL;
 
-	SmartPointer<SDL_Surface> img = NULL;
-
-	// First, check the gfx directory in the mod dir
-	img = LoadGameImage(dir + "/gfx/" + filename, true);
-	if(img.get())  {
-		SetColorKey(img.get());
-		CachedImages.push_back(img);
-		return img.get();
-	}
-
-	// Check the gfx directory in the data dir
-	img = LoadGameImage("data/gfx/" + filename, true);
+	SmartPointer<SDL_Surface> img = loadGSImageFile(dir, filename);
 	if(img.get())
-	{ 
-		SetColorKey(img.get());
 		CachedImages.push_back(img);
-	}
 	return img.get();
 }
 
@@ -1161,22 +1171,137 @@ SoundSample * CGameScript::LoadGSSample(const std::string& dir, const std::strin
 {
 	if(bDedicated) return NULL;
 	
-	SmartPointer<SoundSample> smp = NULL;
-
-	// First, check the sfx directory in the mod dir
-	smp = LoadSample(dir + "/sfx/" + filename, 10);
-
+	SmartPointer<SoundSample> smp = loadGSSampleFile(dir, filename);
 	if(smp.get())
-	{
 		CachedSamples.push_back(smp);
-		return smp.get();
+	return smp.get();
+}
+
+void CGameScript::RequestGSImage(const std::string& dir, const std::string& filename, SDL_Surface** image, SmartPointer<SDL_Surface>* shadow, const std::string& errorMsg)
+{
+	if(bQueueAssets) {
+		AssetRequest r;
+		r.dir = dir; r.filename = filename;
+		r.image = image; r.shadow = shadow;
+		r.errorMsg = errorMsg;
+		queuedAssets.push_back(r);
+		return;
 	}
 
-	// Check the sounds directory in the data dir
-	smp = LoadSample("data/sounds/" + filename, 10);
-	if(smp.get())
-		CachedSamples.push_back(smp);
-	return smp.get();
+	*image = LoadGSImage(dir, filename);
+	if(!*image) {
+		if(errorMsg != "") modLog(errorMsg);
+	}
+	else if(shadow)
+		*shadow = GenerateShadowSurface(*image);
+}
+
+void CGameScript::RequestGSSample(const std::string& dir, const std::string& filename, SoundSample** sample, bool* useSound, const std::string& errorMsg)
+{
+	if(bQueueAssets) {
+		AssetRequest r;
+		r.dir = dir; r.filename = filename;
+		r.sample = sample; r.useSound = useSound;
+		r.errorMsg = errorMsg;
+		queuedAssets.push_back(r);
+		return;
+	}
+
+	*sample = LoadGSSample(dir, filename);
+	if(!*sample) {
+		if(useSound) *useSound = false;
+		if(errorMsg != "") modLog(errorMsg);
+	}
+}
+
+// One distinct file of the queued assets
+struct GSAssetJob {
+	std::string dir, filename;
+	bool isImage;
+	bool needShadow;
+	SmartPointer<SDL_Surface> image, shadow;
+	SmartPointer<SoundSample> sample;
+	GSAssetJob() : isImage(false), needShadow(false) {}
+};
+
+static Result loadGSAssetJobs(std::vector<GSAssetJob>* jobs, size_t first, size_t step)
+{
+	for(size_t i = first; i < jobs->size(); i += step) {
+		GSAssetJob& job = (*jobs)[i];
+		if(job.isImage) {
+			job.image = loadGSImageFile(job.dir, job.filename);
+			if(job.image.get() && job.needShadow)
+				job.shadow = GenerateShadowSurface(job.image.get());
+		}
+		else
+			job.sample = loadGSSampleFile(job.dir, job.filename);
+	}
+	return true;
+}
+
+///////////////////
+// Decode all queued images and sounds in parallel and hand them out to the requesters
+void CGameScript::LoadQueuedAssets()
+{
+	std::vector<AssetRequest> requests;
+	requests.swap(queuedAssets);
+	if(requests.empty()) return;
+
+	// Deduplicate, many projectiles share the same image or sound
+	std::vector<GSAssetJob> jobs;
+	std::vector<size_t> jobOfRequest(requests.size());
+	std::map<std::string, size_t> jobIndex;
+	for(size_t i = 0; i < requests.size(); ++i) {
+		const AssetRequest& r = requests[i];
+		std::string key = std::string(r.image ? "i:" : "s:") + r.dir + "/" + r.filename;
+		stringlwr(key);
+		std::map<std::string, size_t>::iterator f = jobIndex.find(key);
+		if(f == jobIndex.end()) {
+			GSAssetJob job;
+			job.dir = r.dir; job.filename = r.filename;
+			job.isImage = r.image != NULL;
+			f = jobIndex.insert(std::make_pair(key, jobs.size())).first;
+			jobs.push_back(job);
+		}
+		jobOfRequest[i] = f->second;
+		if(r.shadow) jobs[f->second].needShadow = true;
+	}
+
+	// The calling thread is one of the workers
+	static const size_t MAX_WORKERS = 4;
+	const size_t numWorkers = threadPool ? MIN(jobs.size(), MAX_WORKERS) : 1;
+	std::vector<ThreadPoolItem*> workers;
+	for(size_t w = 1; w < numWorkers; ++w)
+		workers.push_back(threadPool->start(boost::bind(&loadGSAssetJobs, &jobs, w, numWorkers), "GS asset loader"));
+	loadGSAssetJobs(&jobs, 0, numWorkers);
+	for(size_t w = 0; w < workers.size(); ++w)
+		threadPool->wait(workers[w], NULL);
+
+	// Apply the results in request order, so the mod log looks the same as before
+	for(size_t i = 0; i < requests.size(); ++i) {
+		const AssetRequest& r = requests[i];
+		const GSAssetJob& job = jobs[jobOfRequest[i]];
+		bool ok;
+		if(r.image) {
+			*r.image = job.image.get();
+			ok = job.image.get() != NULL;
+			if(ok && r.shadow) *r.shadow = job.shadow;
+		}
+		else {
+			*r.sample = job.sample.get();
+			ok = job.sample.get() != NULL;
+			if(!ok && r.useSound) *r.useSound = false;
+		}
+		if(!ok && r.errorMsg != "")
+			modLog(r.errorMsg);
+	}
+
+	for(size_t i = 0; i < jobs.size(); ++i) {
+		if(jobs[i].image.get()) CachedImages.push_back(jobs[i].image);
+		if(jobs[i].sample.get()) CachedSamples.push_back(jobs[i].sample);
+	}
+
+	notes << "GameScript " << sDirectory << ": loaded " << jobs.size() << " distinct images/sounds for " << requests.size() << " requests" << endl;
 }
 
 
@@ -1276,6 +1401,8 @@ void CGameScript::Shutdown()
 	projectiles.clear();
 	savedProjs.clear();
 	projFileIndexes.clear();
+	bQueueAssets = false;
+	queuedAssets.clear();
 	
 	if(Weapons)
 		delete[] Weapons;
@@ -2183,10 +2310,7 @@ bool Proj_Action::read(CGameScript* gs, FILE* fp) {
 
 		if(!bDedicated) {
 			// Load the sample
-			Sound = gs->LoadGSSample(gs->sDirectory, SndFilename);
-			
-			if(Sound == NULL)
-				gs->modLog("Could not open sound '" + SndFilename + "'");
+			gs->RequestGSSample(gs->sDirectory, SndFilename, &Sound, NULL, "Could not open sound '" + SndFilename + "'");
 		}
 	}
 	fread_endian<float>(fp, BounceCoeff);
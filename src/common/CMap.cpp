@@ -100,7 +100,10 @@ bool CMap::NewFrom(CMap* map)
 	m_config = map->m_config ? new LevelConfig(*map->m_config) : NULL;
 	m_firstFrame = true;
 	
-	m_water = map->m_water;	
+	m_waterChunks = map->m_waterChunks;
+	m_activeWaterChunks = map->m_activeWaterChunks;
+	m_waterChunksX = map->m_waterChunksX;
+	m_waterChunksY = map->m_waterChunksY;
 	
 	// Copy the data
 	bmpDrawImage = map->bmpDrawImage.get() ? GetCopiedImage(map->bmpDrawImage) : NULL;
@@ -240,6 +243,8 @@ bool CMap::MiniCreate(uint _width, uint _height, uint _minimap_w, uint _minimap_
 	fBlinkTime = 0;
 	
 	Objects = NULL;
+	m_terrainField.reset();
+	resetImageChanges();
 			
 	bmpMiniMap = gfxCreateSurface(MinimapWidth, MinimapHeight);
 	if(bmpMiniMap.get() == NULL) {
@@ -494,6 +499,9 @@ bool CMap::CreateSurface()
 // Updates an area according to pixel flags, recalculates minimap, draw image, pixel flags and shadow
 void CMap::UpdateArea(int x, int y, int w, int h, bool update_image)
 {
+	// also needed on dedicated, Gusanos particles collide with it
+	m_terrainField.invalidate(x, y, w, h);
+
 	if(bDedicated) return;
 
 	// When drawing shadows, we have to update a bigger area
@@ -504,6 +512,8 @@ void CMap::UpdateArea(int x, int y, int w, int h, bool update_image)
 	w += 2 * shadow_update;
 	h += 2 * shadow_update;
 
+	markImageDirty(x, y, w, h);
+
 
 	// Clipping
 	if (!ClipRefRectWith(x, y, w, h, (SDLRect&)material->surf->clip_rect))
@@ -1530,10 +1540,71 @@ void CMap::PlaceMisc(int id, CVec pos)
 	UnlockSurface(bmpDrawImage);
 	UnlockSurface(misc);
 
+	m_terrainField.invalidate(sx, sy, w, h);
+	markImageDirty(sx, sy, w, h);
 	bMiniMapDirty = true;
 }
 
 
+// Shared by all maps, so that a new map never looks like an old, unchanged one
+static uint64_t lastImageSerial = 0;
+static const size_t MaxImageChanges = 1024;
+static const int MaxMergedChangeSize = 32;
+
+///////////////////
+// Remember a changed area of the level image (map coordinates)
+void CMap::markImageDirty(int x, int y, int w, int h)
+{
+	if(w <= 0 || h <= 0) return;
+
+	// Blood and gibs come pixel by pixel, grow the last change for nearby ones.
+	// It gets a new serial, so viewports which have seen it get the union again.
+	if(!imageChanges.empty()) {
+		ImageChange& last = imageChanges.back();
+		const int x1 = MIN(x, last.x), y1 = MIN(y, last.y);
+		const int x2 = MAX(x + w, last.x + last.w), y2 = MAX(y + h, last.y + last.h);
+		if(x2 - x1 <= MaxMergedChangeSize && y2 - y1 <= MaxMergedChangeSize) {
+			last.serial = ++lastImageSerial;
+			last.x = x1; last.y = y1; last.w = x2 - x1; last.h = y2 - y1;
+			return;
+		}
+	}
+
+	if(imageChanges.size() >= MaxImageChanges) {
+		// the viewports which missed these will redraw everything
+		imageResetSerial = MAX(imageResetSerial, imageChanges[MaxImageChanges / 2 - 1].serial);
+		imageChanges.erase(imageChanges.begin(), imageChanges.begin() + MaxImageChanges / 2);
+	}
+
+	ImageChange c;
+	c.serial = ++lastImageSerial;
+	c.x = x; c.y = y; c.w = w; c.h = h;
+	imageChanges.push_back(c);
+}
+
+void CMap::resetImageChanges()
+{
+	imageChanges.clear();
+	imageResetSerial = ++lastImageSerial;
+}
+
+uint64_t CMap::imageSerial() const
+{
+	if(imageChanges.empty()) return imageResetSerial;
+	return MAX(imageResetSerial, imageChanges.back().serial);
+}
+
+bool CMap::imageChangesSince(uint64_t serial, std::vector<ImageChange>& changes) const
+{
+	if(serial < imageResetSerial) return false;
+
+	for(std::vector<ImageChange>::const_iterator c = imageChanges.begin(); c != imageChanges.end(); ++c)
+		if(c->serial > serial)
+			changes.push_back(*c);
+	return true;
+}
+
+
 ///////////////////
 // Put a pixel onto the front image buffer
 // TODO: atm, this isnt used at all; some outcommented usage is in debug parts of AI; so shouldn't we put the pixel on the debug image then?
@@ -1543,9 +1614,8 @@ void CMap::PutImagePixel(uint x, uint y, Color colour)
 	if(x >= Width || y >= Height)
 		return;
 
-	x *= 2;
-	y *= 2;
-	DrawRectFill2x2_NoClip(bmpDrawImage.get(), x, y, colour);
+	DrawRectFill2x2_NoClip(bmpDrawImage.get(), x * 2, y * 2, colour);
+	markImageDirty(x, y, 1, 1);
 }
 
 
@@ -1718,6 +1788,20 @@ Result CMap::Load(const std::string& filename)
 		return true;
 	}
 	
+	// try loading a previously baked map from disk
+	BakedMapCache::Key bakedKey;
+	{
+		Result res = BakedMapCache::load(this, filename, bakedKey);
+		if(res) {
+			notes << "loaded baked map for " << filename << endl;
+			bMiniMapDirty = true;
+			Created = true;
+			CalculateDirtCount();
+			SaveToCache();
+			return true;
+		}
+	}
+	
 	MapLoad* loader = MapLoad::open(filename);
 	if(!loader) {
 		warnings << "level " << filename << " couldn't be opened" << endl;
@@ -1746,6 +1830,7 @@ Result CMap::Load(const std::string& filename)
 
 	// Save the map to cache
 	SaveToCache();
+	BakedMapCache::save(this, filename, bakedKey);
 
 	return true;
 }
@@ -1994,6 +2079,8 @@ void CMap::NewNet_RestoreFromMemory()
 
 		for( int y=startY; y<startY+sizeY; y++ )
 			memcpy( (char*)material->surf->pixels + y*material->surf->pitch + startX, savedPixelFlags + y*material->surf->pitch + startX, sizeX*sizeof(uchar) );
+		m_terrainField.invalidate(startX, startY, sizeX, sizeY);
+		markImageDirty(startX, startY, sizeX, sizeY);
 	
 		unlockFlags();
 		UnlockSurface(bmpSavedImage);
@@ -2328,13 +2415,17 @@ Color CMap::getColorAt(long x, long y) {
 }
 
 void CMap::putColorTo(long x, long y, Color c) {
-	if(bmpDrawImage.get())
+	if(bmpDrawImage.get()) {
 		DrawRectFill2x2(bmpDrawImage.get(), x*2, y*2, c);
+		markImageDirty(x, y, 1, 1);
+	}
 }
 
 void CMap::putSurfaceTo(long x, long y, SDL_Surface* surf, int sx, int sy, int sw, int sh) {
-	if(bmpDrawImage.get())
+	if(bmpDrawImage.get()) {
 		DrawImageStretch2(bmpDrawImage.get(), surf, sx, sy, x*2, y*2, sw, sh);
+		markImageDirty(x, y, sw, sh);
+	}
 }
 
 
@@ -17,6 +17,7 @@
 #include "LieroX.h"
 #include "CGameScript.h" // for all PRJ_* and PJ_* constants only
 #include "GfxPrimitives.h"
+#include "RenderQueue.h"
 #include "CProjectile.h"
 #include "Protocol.h"
 #include "game/CWorm.h"
@@ -223,16 +224,37 @@ int CProjectile::CheckCollision(proj_t* tProjInfo, float dt, CVec pos, CVec vel)
 }
 
 ///////////////////
-// Draw the projectile
-void CProjectile::Draw(SDL_Surface * bmpDest, CViewport *view)
+// The projectile types which aren't simple commands in the render queue
+static void DrawProjectileCircle(void* obj, SDL_Surface * bmpDest, CViewport *view)
 {
+	CProjectile* prj = (CProjectile*)obj;
 	CMap* map = game.gameMap();
-	VectorD2<int> p = view->physicToReal(vPos.get(), cClient->getGameLobby()[FT_InfiniteMap], map->GetWidth(), map->GetHeight());
+	VectorD2<int> p = view->physicToReal(prj->interpolatedPos(), cClient->getGameLobby()[FT_InfiniteMap], map->GetWidth(), map->GetHeight());
+	DrawCircleFilled(bmpDest, p.x, p.y, prj->size().x*2, prj->size().y*2, prj->renderColorAt(0, 0));
+}
+
+static void DrawProjectilePolygon(void* obj, SDL_Surface * bmpDest, CViewport *view)
+{
+	CProjectile* prj = (CProjectile*)obj;
+	prj->getProjInfo()->polygon.drawFilled(bmpDest, (int)prj->pos().get().x, (int)prj->pos().get().y, view, prj->renderColorAt(0, 0));
+}
+
+static void DrawProjectileShadow(void* obj, SDL_Surface * bmpDest, CViewport *view)
+{
+	((CProjectile*)obj)->DrawShadow(bmpDest, view);
+}
+
+///////////////////
+// Queue the drawing of the projectile
+void CProjectile::Draw(RenderQueue& queue, CViewport *view)
+{
+	CMap* map = game.gameMap();
+	VectorD2<int> p = view->physicToReal(interpolatedPos(), cClient->getGameLobby()[FT_InfiniteMap], map->GetWidth(), map->GetHeight());
 	
     switch (tProjInfo->Type) {
 		case PRJ_PIXEL:
 			if(view->posInside(p))
-				DrawRectFill2x2(bmpDest, p.x - 1, p.y - 1,iColour);
+				queue.addPixel2x2(RenderQueue::L_Projectile, p.x - 1, p.y - 1, iColour);
 			return;
 	
 		case PRJ_IMAGE:  {
@@ -298,21 +320,22 @@ void CProjectile::Draw(SDL_Surface * bmpDest, CViewport *view)
 			iFrameX = (int)framestep*size;
 			MOD(iFrameX, tProjInfo->bmpImage->w);
 	
-			DrawImageAdv(bmpDest, tProjInfo->bmpImage, iFrameX, 0, p.x-half, p.y-half, size,size);
+			queue.addImage(RenderQueue::L_Projectile, tProjInfo->bmpImage, iFrameX, 0, p.x-half, p.y-half, size,size);
 		
 			return;
 		}
 		
 		case PRJ_CIRCLE:
-			DrawCircleFilled(bmpDest, p.x, p.y, radius.x*2, radius.y*2, iColour);
+			queue.addCustom(RenderQueue::L_Projectile, &DrawProjectileCircle, this,
+				p.x - radius.x*2, p.y - radius.y*2, radius.x*4 + 1, radius.y*4 + 1);
 			return;
 			
 		case PRJ_RECT:
-			DrawRectFill(bmpDest, p.x - radius.x*2, p.y - radius.y*2, p.x + radius.x*2, p.y + radius.x*2, iColour);
+			queue.addRectFill(RenderQueue::L_Projectile, p.x - radius.x*2, p.y - radius.y*2, p.x + radius.x*2, p.y + radius.x*2, iColour);
 			return;
 			
 		case PRJ_POLYGON:
-			getProjInfo()->polygon.drawFilled(bmpDest, (int)vPos.get().x, (int)vPos.get().y, view, iColour);
+			queue.addCustom(RenderQueue::L_Projectile, &DrawProjectilePolygon, this);
 			return;
 		
 		case __PRJ_LBOUND: case __PRJ_UBOUND: errors << "CProjectile::Draw: hit __PRJ_BOUND" << endl;
@@ -320,13 +343,17 @@ void CProjectile::Draw(SDL_Surface * bmpDest, CViewport *view)
 }
 
 
+///////////////////
+// Queue the drawing of the projectiles shadow
+void CProjectile::QueueShadow(RenderQueue& queue)
+{
+	queue.addCustom(RenderQueue::L_Shadow, &DrawProjectileShadow, this);
+}
+
 ///////////////////
 // Draw the projectiles shadow
 void CProjectile::DrawShadow(SDL_Surface * bmpDest, CViewport *view)
 {
-	if (tLX->fDeltaTime >= 0.1f) // Don't draw projectile shadows with FPS <= 10 to get a little better performance
-		return;
-
 	CMap* map = game.gameMap();
 
 	// TODO: DrawObjectShadow is a bit complicated to fix for shadows&tiling, so I just leave all shadows away for now...
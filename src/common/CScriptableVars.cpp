@@ -311,9 +311,32 @@ std::string CScriptableVars::StripClassName( const std::string & c )
 RegisteredVar* CScriptableVars::GetVar( const std::string & name )
 {
 	Init();
-	VarMap::iterator it = m_instance->m_vars.find(name);
-	if(it != m_instance->m_vars.end()) return &it->second;
-	return NULL;
+	return m_instance->m_index.get(name);
+}
+
+CScriptableVars::VarHandle CScriptableVars::GetVarHandle( const std::string & name )
+{
+	Init();
+	return m_instance->m_index.intern(name);
+}
+
+RegisteredVar* CScriptableVars::GetVar( VarHandle h )
+{
+	Init();
+	return m_instance->m_index.get(h);
+}
+
+void CScriptableVars::CompleteVarName( const std::string & prefix, std::vector<std::string>& out )
+{
+	Init();
+	m_instance->m_index.complete(prefix, out, '.');
+}
+
+void CScriptableVars::Register( const std::string & name, const RegisteredVar & var )
+{
+	// Map nodes don't move, so the index can point into m_vars
+	RegisteredVar& v = m_vars[name] = var;
+	m_index.add(name, &v, v.var.type != SVT_CALLBACK);
 }
 
 
@@ -337,6 +360,7 @@ void CScriptableVars::DeRegisterVars( const std::string & base )
 	for( VarMap::iterator it = m_instance->m_vars.lower_bound(base + "."); it != upper;  )
 	{
 		VarMap::iterator cp = it; ++it;
+		m_instance->m_index.set(m_instance->m_index.find(cp->first), NULL);
 		m_instance->m_vars.erase( cp );
 	}
 }
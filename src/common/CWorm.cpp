@@ -924,7 +924,7 @@ void CWorm::UpdateDrawPos() {
 
 	} else {
 		// no antilag movement prediction
-		vDrawPos = vPos;
+		vDrawPos = interpolatedPos();
 	}
 }
 
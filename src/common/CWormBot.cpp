@@ -50,6 +50,7 @@
 #include "game/Mod.h"
 #include "level/FastTraceLine.h"
 #include "CClientNetEngine.h"
+#include "FrameProfiler.h"
 
 
 // used by searchpath algo
@@ -1020,6 +1021,7 @@ void CWormBotInputHandler::startGame() {
 ///////////////////
 // Simulate the AI
 void CWormBotInputHandler::getInput() {
+	PROFILE_ZONE("AI");
 	if(!m_worm->getAlive()) {
 		if(m_worm->bCanRespawnNow)
 			m_worm->bRespawnRequested = true;
@@ -18,6 +18,8 @@
 
 
 #include <limits.h>
+#include <deque>
+#include <sstream>
 #include "LieroX.h"
 #include "Debug.h"
 #include "CServer.h"
@@ -53,8 +55,14 @@
 #include "game/Level.h"
 #include "game/ServerList.h"
 #include "EventQueue.h"
+#include "SimdBlit.h"
 #include "client/ClientConnectionRequestInfo.h"
 #include "gusanos/luaapi/context.h"
+#include "gusanos/luaapi/profiler.h"
+#include "MPSCQueue.h"
+#include "DedicatedLoop.h"
+#include "FrameProfiler.h"
+#include "Metrics.h"
 
 
 CmdLineIntf& stdoutCLI() {
@@ -368,6 +376,7 @@ struct Command : CommandDesc {
 
 typedef std::map<std::string, Command*, stringcaseless> CommandMap;
 static CommandMap commands;
+static NameIndex<Command> commandIndex; // hashed lookup for Cmd_GetCommand
 
 
 
@@ -433,27 +442,8 @@ static bool autoCompleteCommand(Command*, AutocompleteRequest& request) {
 }
 
 static bool autoCompleteVar(Command*, AutocompleteRequest& request) {
-	std::list<std::string> possibilities;
-	
-	for(CScriptableVars::const_iterator it = CScriptableVars::lower_bound(request.token); it != CScriptableVars::Vars().end(); ++it) {
-		// ignore callbacks
-		if(it->second.var.type == SVT_CALLBACK) continue;
-		
-		if( subStrCaseEqual(request.token, it->first, request.token.size()) ) {
-			std::string nextComplete = it->first.substr(0, request.token.size());
-			for(size_t f = request.token.size();; ++f) {
-				if(f >= it->first.size()) break;
-				nextComplete += it->first[f];
-				if(it->first[f] == '.') break;
-			}
-			
-			if(possibilities.size() == 0 || *possibilities.rbegin() != nextComplete) {
-				possibilities.push_back(nextComplete);
-			}
-		}
-		else
-			break;
-	}
+	std::vector<std::string> possibilities;
+	CScriptableVars::CompleteVarName(request.token, possibilities);
 	
 	if(possibilities.size() == 0) {
 		request.cli.writeMsg("unknown variable", CNC_WARNING);
@@ -481,7 +471,7 @@ static bool autoCompleteVar(Command*, AutocompleteRequest& request) {
 		if(request.token[p] == '.') {
 			startSugPos = p + 1;
 		}
-	for(std::list<std::string>::iterator j = possibilities.begin(); j != possibilities.end(); ++j) {
+	for(std::vector<std::string>::iterator j = possibilities.begin(); j != possibilities.end(); ++j) {
 		if(possStr.size() > 0) possStr += " ";
 		possStr += j->substr(startSugPos);
 	}
@@ -508,9 +498,7 @@ bool autoCompleteForFileListCache(Command*, AutocompleteRequest& request) {
 // Find a command with the same name
 static Command *Cmd_GetCommand(const std::string& strName)
 {
-	CommandMap::iterator it = commands.find(strName);
-	if(it != commands.end()) return it->second;
-	return NULL;
+	return commandIndex.get(strName);
 }
 
 CommandDesc* GetCommandDesc(const std::string& cmdname) {
@@ -524,7 +512,8 @@ static void registerCommand(const std::string& name, Command* cmd) {
 		errors << "Command '" << cmd->fullDesc() << "' as " << name << " will overwrite command " << old->name << endl;
 	}
 #endif
-	commands.insert( CommandMap::value_type(name, cmd) );
+	if(commands.insert( CommandMap::value_type(name, cmd) ).second)
+		commandIndex.add(name, cmd);
 }
 
 static void registerCommand(Command* cmd) {
@@ -2315,6 +2304,165 @@ void Cmd_printMemStats::exec(CmdLineIntf* caller, const std::vector<std::string>
 }
 #endif
 
+COMMAND(benchBlit, "measure the throughput of the blitters", "[kernel]", 0, 1);
+void Cmd_benchBlit::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
+	caller->writeMsg("blitters: " + SimdBlit::levelName(SimdBlit::level()) + " (CPU supports " + SimdBlit::levelName(SimdBlit::detectedLevel()) + ")");
+	std::vector<std::string> lines = SimdBlit::benchmark(params.empty() ? "" : params[0]);
+	if(lines.empty()) {
+		caller->writeMsg("unknown kernel " + params[0], CNC_ERROR);
+		return;
+	}
+	for(std::vector<std::string>::iterator i = lines.begin(); i != lines.end(); ++i)
+		caller->writeMsg(*i);
+}
+
+COMMAND(commandQueueStats, "show depth and latency of the command queue", "", 0, 0);
+void Cmd_commandQueueStats::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
+	const CommandQueueStats& s = getCommandQueueStats();
+	caller->writeMsg("pending: " + to_string(s.depth) + ", max: " + to_string(s.maxDepth));
+	caller->writeMsg("executed: " + to_string(s.executed) + ", frames over budget: " + to_string(s.budgetHits));
+	caller->writeMsg("latency (ms) last: " + to_string(s.lastLatency) +
+					 ", avg: " + to_string(s.executed ? s.latencySum / s.executed : 0) +
+					 ", max: " + to_string(s.maxLatency));
+}
+
+static void printLuaMemStats(CmdLineIntf* caller, const std::string& name, LuaContext& context) {
+	if(!context) {
+		caller->writeMsg(name + ": not loaded");
+		return;
+	}
+	const LuaAllocator::Stats& a = context.allocStats();
+	const LuaContext::GCStats& gc = context.gcStats();
+	caller->writeMsg(name + ": " + to_string(lua_gc(context, LUA_GCCOUNT, 0)) + " KB, peak " + to_string(a.peakBytes / 1024) +
+					 " KB, pools " + to_string(a.poolBytes / 1024) + " KB");
+	caller->writeMsg("  allocs: " + to_string(a.allocs) + ", reallocs: " + to_string(a.reallocs) + ", frees: " + to_string(a.frees) +
+					 ", from pools: " + to_string(a.pooledAllocs));
+	caller->writeMsg("  gc frames: " + to_string(gc.frames) + ", steps: " + to_string(gc.steps) + ", cycles: " + to_string(gc.cycles) +
+					 ", overruns: " + to_string(gc.overruns));
+	caller->writeMsg("  gc pause (ms) last: " + to_string(gc.lastPause) + ", max: " + to_string(gc.maxPause));
+}
+
+COMMAND(luaMemStats, "show memory and garbage collector stats of Lua", "", 0, 0);
+void Cmd_luaMemStats::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
+	printLuaMemStats(caller, "ingame", luaIngame);
+	printLuaMemStats(caller, "global", luaGlobal);
+}
+
+COMMAND(luaProfile, "profile the calls into Lua", "start [sampleInterval] | stop | reset | print [count] | table <file> | flamegraph <file> | samples <file>", 1, 2);
+void Cmd_luaProfile::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
+	const std::string& cmd = params[0];
+	if(cmd == "start") {
+		int interval = 0;
+		if(params.size() > 1) {
+			bool fail = false;
+			interval = from_string<int>(params[1], fail);
+			if(fail || interval < 0) { printUsage(caller); return; }
+		}
+		luaProfiler.start(interval);
+		caller->writeMsg("Lua profiler started" + (interval > 0 ? ", sampling every " + to_string(interval) + " instructions" : std::string()));
+	}
+	else if(cmd == "stop") {
+		luaProfiler.stop();
+		caller->writeMsg("Lua profiler stopped");
+	}
+	else if(cmd == "reset")
+		luaProfiler.reset();
+	else if(cmd == "print") {
+		size_t count = 20;
+		if(params.size() > 1) {
+			bool fail = false;
+			count = from_string<int>(params[1], fail);
+			if(fail) { printUsage(caller); return; }
+		}
+		std::vector<LuaProfiler::Entry const*> entries;
+		luaProfiler.sortedEntries(entries);
+		caller->writeMsg("calls, total/self/max (ms), allocs (KB): name");
+		for(size_t i = 0; i < entries.size() && i < count; ++i) {
+			const LuaProfiler::Entry& e = *entries[i];
+			caller->writeMsg(to_string(e.calls) + ", " + to_string(e.totalUs / 1000.0f) + "/" + to_string(e.selfUs / 1000.0f) + "/" +
+							 to_string(e.maxUs / 1000.0f) + ", " + to_string(e.allocs) + " (" + to_string(e.allocBytes / 1024) + "): " + e.name);
+		}
+		if(luaProfiler.sampleCount() > 0)
+			caller->writeMsg("samples: " + to_string(luaProfiler.sampleCount()));
+	}
+	else if(cmd == "table" || cmd == "flamegraph" || cmd == "samples") {
+		if(params.size() < 2) { printUsage(caller); return; }
+		std::ofstream f;
+		if(!OpenGameFileW(f, params[1])) {
+			caller->writeMsg("cannot write " + params[1], CNC_ERROR);
+			return;
+		}
+		if(cmd == "table") luaProfiler.writeTable(f);
+		else if(cmd == "flamegraph") luaProfiler.writeFolded(f);
+		else luaProfiler.writeSamples(f);
+		caller->writeMsg("written to " + GetFullFileName(params[1]));
+	}
+	else
+		printUsage(caller);
+}
+
+COMMAND(profile, "profile the game frames", "start [eventsPerThread] | stop | reset | print [count] | trace <file>", 1, 2);
+void Cmd_profile::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
+	const std::string& cmd = params[0];
+	if(cmd == "start") {
+		int events = 65536;
+		if(params.size() > 1) {
+			bool fail = false;
+			events = from_string<int>(params[1], fail);
+			if(fail || events <= 0) { printUsage(caller); return; }
+		}
+		FrameProfiler::start(events);
+		caller->writeMsg("frame profiler started, keeping the last " + to_string(events) + " events of each thread");
+	}
+	else if(cmd == "stop") {
+		FrameProfiler::stop();
+		caller->writeMsg("frame profiler stopped");
+	}
+	else if(cmd == "reset")
+		FrameProfiler::reset();
+	else if(cmd == "print") {
+		size_t count = 20;
+		if(params.size() > 1) {
+			bool fail = false;
+			count = from_string<int>(params[1], fail);
+			if(fail) { printUsage(caller); return; }
+		}
+		std::vector<FrameProfiler::ZoneStats> zones;
+		FrameProfiler::zoneStats(zones);
+		caller->writeMsg("calls, total/avg/max (ms): zone");
+		for(size_t i = 0; i < zones.size() && i < count; ++i) {
+			const FrameProfiler::ZoneStats& z = zones[i];
+			caller->writeMsg(to_string(z.calls) + ", " + to_string(z.totalUs / 1000.0f) + "/" + to_string(z.totalUs / 1000.0f / z.calls) + "/" +
+							 to_string(z.maxUs / 1000.0f) + ": " + z.name);
+		}
+		caller->writeMsg("events: " + to_string(FrameProfiler::eventCount()));
+	}
+	else if(cmd == "trace") {
+		if(params.size() < 2) { printUsage(caller); return; }
+		std::ofstream f;
+		if(!OpenGameFileW(f, params[1])) {
+			caller->writeMsg("cannot write " + params[1], CNC_ERROR);
+			return;
+		}
+		FrameProfiler::writeTrace(f);
+		caller->writeMsg("written to " + GetFullFileName(params[1]));
+	}
+	else
+		printUsage(caller);
+}
+
+COMMAND(metrics, "print the server metrics in the Prometheus text format", "[filter]", 0, 1);
+void Cmd_metrics::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
+	std::ostringstream s;
+	Metrics::writePrometheus(s);
+	std::istringstream lines(s.str());
+	std::string line;
+	while(std::getline(lines, line)) {
+		if(!params.empty() && line.find(params[0]) == std::string::npos) continue;
+		caller->writeMsg(line);
+	}
+}
+
 COMMAND(updateServerList, "update server list", "", 0, 0);
 void Cmd_updateServerList::exec(CmdLineIntf* caller, const std::vector<std::string>& params) {
 	ServerList::get()->updateList();
@@ -2532,10 +2680,10 @@ static void HandleCommand(const CmdLineIntf::Command& command) {
 	}
 	if(cmdstr == "") return;
 	
-	CommandMap::iterator cmd = commands.find(cmdstr);
+	Command* cmd = Cmd_GetCommand(cmdstr);
 	
-	if(cmd != commands.end()) {
-		cmd->second->exec(command.sender, params);
+	if(cmd) {
+		cmd->exec(command.sender, params);
 	}
 	// we must handle this command seperate
 	else if( stringcaseequal(cmdstr, "nextsignal") ) {
@@ -2555,17 +2703,23 @@ static void HandleCommand(const CmdLineIntf::Command& command) {
 
 struct CmdQueue {
 	
-	SDL_mutex* pendingCommandsMutex;
-	std::list<CmdLineIntf::Command> pendingCommands;
+	struct Pending {
+		CmdLineIntf::Command command;
+		Uint32 enqueueTicks;
+	};
+	
+	MPSCQueue<Pending> incoming; // filled from any thread
+	std::deque<Pending> batch; // only used by the gameloop thread
+	CommandQueueStats stats; // gameloop thread too
 	
-	CmdQueue() {
-		pendingCommandsMutex = SDL_CreateMutex();
+	// Takes all commands which are in the queue right now
+	void drain() {
+		Pending p;
+		while(incoming.pop(p))
+			batch.push_back(p);
 	}
 	
-	~CmdQueue() {
-		SDL_DestroyMutex(pendingCommandsMutex);
-		pendingCommandsMutex = NULL;
-	}
+	size_t depth() const { return incoming.size() + batch.size(); }
 
 };
 
@@ -2573,27 +2727,46 @@ static CmdQueue cmdQueue;
 
 
 void Execute(const CmdLineIntf::Command& command) {
-	ScopedLock lock(cmdQueue.pendingCommandsMutex);
-	cmdQueue.pendingCommands.push_back(command);
+	CmdQueue::Pending p;
+	p.command = command;
+	p.enqueueTicks = SDL_GetTicks();
+	cmdQueue.incoming.push(p);
+	DedicatedLoopWakeup();
 }
 
 bool havePendingCommands() {
-	ScopedLock lock(cmdQueue.pendingCommandsMutex);
-	return !cmdQueue.pendingCommands.empty();
+	return cmdQueue.depth() > 0;
+}
+
+const CommandQueueStats& getCommandQueueStats() {
+	return cmdQueue.stats;
 }
 
 void HandlePendingCommands() {
+	CommandQueueStats& stats = cmdQueue.stats;
+	const Uint32 startTicks = SDL_GetTicks();
+	const Uint32 budget = (tLXOptions && tLXOptions->iCommandTimeBudget > 0) ? (Uint32)tLXOptions->iCommandTimeBudget : 0;
+	const uint64_t stateVersion = game.state.ext.version;
+	
+	stats.depth = cmdQueue.depth();
+	stats.maxDepth = MAX(stats.maxDepth, stats.depth);
+	
 	while(true) {
-		CmdLineIntf::Command command;
-		{
-			ScopedLock lock(cmdQueue.pendingCommandsMutex);
-			if(cmdQueue.pendingCommands.size() > 0) {
-				command = cmdQueue.pendingCommands.front();
-				cmdQueue.pendingCommands.pop_front();
-			}
-			else
-				break;
+		if(cmdQueue.batch.empty()) {
+			// Also takes the commands which were pushed by the commands we just executed
+			cmdQueue.drain();
+			if(cmdQueue.batch.empty()) break;
 		}
+		
+		CmdQueue::Pending p = cmdQueue.batch.front();
+		cmdQueue.batch.pop_front();
+		CmdLineIntf::Command& command = p.command;
+		
+		const Uint32 latency = SDL_GetTicks() - p.enqueueTicks;
+		stats.executed++;
+		stats.latencySum += latency;
+		stats.lastLatency = latency;
+		stats.maxLatency = MAX(stats.maxLatency, latency);
 
 		if(command.execScope.get())
 			command.execScope->execNow(command);
@@ -2601,10 +2774,16 @@ void HandlePendingCommands() {
 		command.sender->finishedCommand(command.cmd);
 		command.execScope = NULL;
 
-		if(game.state.ext.updated)
-			// Next frame, we will continue with other pending commands.
-			// For now, skip the rest because we might have some other work to do.
+		if(game.state.ext.version != stateVersion)
+			// The command changed the game state. Next frame, we will continue with
+			// the other pending commands. The gameloop must handle the change first.
+			break;
+		
+		if(budget > 0 && SDL_GetTicks() - startTicks >= budget) {
+			// Next frame, we will continue.
+			if(havePendingCommands()) stats.budgetHits++;
 			break;
+		}
 	}
 }
 
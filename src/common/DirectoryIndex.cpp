@@ -0,0 +1,550 @@
+/*
+ *  DirectoryIndex.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+/*
+	In-memory index of all files in the searchpaths.
+
+	GetExactFileName has to resolve the case of every path component on case
+	sensitive filesystems, which meant one readdir scan per component and per
+	searchpath for everything not yet in exactfilenamecache. Loading a mod or a
+	skin does thousands of such lookups.
+
+	The index is built in the background, one worker per searchpath, and it is
+	kept up to date with inotify. Pending inotify events are applied before
+	every lookup, so changes done by this process itself are always visible.
+	A searchpath is only used once it is fully indexed; everything else (and
+	everything on systems without inotify) goes through the old code path.
+*/
+
+#include "FindFile.h"
+
+#ifndef __linux__
+
+void InitDirectoryIndex() {}
+void UnInitDirectoryIndex() {}
+bool DirectoryIndexLookup(const std::string&, std::string&, bool&) { return false; }
+bool DirectoryIndexListDir(const std::string&, std::vector<DirectoryIndexEntry>&) { return false; }
+
+#else // __linux__
+
+#include <map>
+#include <list>
+#include <set>
+#include <tr1/unordered_map>
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstring>
+#include <boost/bind.hpp>
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "StringUtils.h"
+#include "Debug.h"
+#include "ReadWriteLock.h"
+
+bool IsPathStatable(const std::string& f); // FindFile.cpp
+
+// Limits to keep us from indexing the whole harddisk if "." happens to be $HOME or /
+static const size_t INDEX_MAX_ENTRIES_PER_ROOT = 200000;
+static const int INDEX_MAX_DEPTH = 16;
+
+static std::string lowerCase(const std::string& s) {
+	std::string r = s;
+	stringlwr(r);
+	return r;
+}
+
+// Unifies the slashes and removes double and trailing slashes.
+// Returns false if the path contains "." or ".." components (besides a leading "."), we don't resolve them.
+static bool normalizePath(const std::string& path, std::string& out) {
+	out = "";
+	out.reserve(path.size());
+	size_t compStart = 0;
+	for(size_t i = 0; i <= path.size(); ++i) {
+		char c = (i < path.size()) ? path[i] : '/';
+		if(c == '\\') c = '/';
+		if(c == '/') {
+			const std::string comp = out.substr(compStart);
+			if(compStart > 0 && (comp == "." || comp == "..")) return false;
+			if(compStart == 0 && comp == "..") return false;
+			if(i == path.size()) break;
+			if(out.size() > 0 && out[out.size()-1] == '/') continue;
+			out += '/';
+			compStart = out.size();
+			continue;
+		}
+		out += c;
+	}
+	while(out.size() > 1 && out[out.size()-1] == '/')
+		out.erase(out.size()-1);
+	return out.size() > 0;
+}
+
+struct IndexRoot {
+	std::string path;
+	bool ready;
+	bool failed;
+	size_t numDirs, numEntries;
+	ThreadPoolItem* worker;
+	IndexRoot(const std::string& p) : path(p), ready(false), failed(false), numDirs(0), numEntries(0), worker(NULL) {}
+};
+
+struct IndexDir {
+	typedef std::tr1::unordered_map<std::string, DirectoryIndexEntry> Entries; // key is the lowercase name
+	std::string exactPath;
+	IndexRoot* root;
+	int wd;
+	Entries entries;
+	IndexDir() : root(NULL), wd(-1) {}
+};
+
+class DirectoryIndex {
+	typedef std::tr1::unordered_map<std::string, IndexDir*> Dirs; // key is the lowercase exact path
+	typedef std::multimap<int, std::string> Watches; // inotify wd -> dirs key; multiple searchpaths can share a dir
+	typedef std::map<int, int> WatchRefs; // inotify_add_watch returns the same wd for the same inode, even from different searchpaths
+
+	Mutex mutex;
+	int inotifyFd;
+	bool authoritative; // false if we possibly missed some changes; then only found entries are trusted (after a stat)
+	bool quit;
+	std::list<IndexRoot*> roots;
+	Dirs dirs;
+	Watches watches;
+	WatchRefs watchRefs;
+	WatchRefs scanningWds; // wds of dirs which are being read right now, not yet in watches
+	std::list< std::pair<int, std::string> > deferredEvents; // for scanningWds, the raw inotify_event
+	size_t lookups, indexHits, indexMisses;
+
+public:
+	DirectoryIndex() : inotifyFd(-1), authoritative(true), quit(false), lookups(0), indexHits(0), indexMisses(0) {}
+
+	~DirectoryIndex() {
+		{
+			Mutex::ScopedLock lock(mutex);
+			quit = true;
+		}
+		for(std::list<IndexRoot*>::iterator r = roots.begin(); r != roots.end(); ++r)
+			if((*r)->worker) threadPool->wait((*r)->worker, NULL);
+
+		notes << "DirectoryIndex: " << lookups << " lookups, " << indexHits << " answered by the index, " << indexMisses << " of them negative" << endl;
+
+		for(Dirs::iterator d = dirs.begin(); d != dirs.end(); ++d)
+			delete d->second;
+		for(std::list<IndexRoot*>::iterator r = roots.begin(); r != roots.end(); ++r)
+			delete *r;
+		if(inotifyFd >= 0) close(inotifyFd);
+	}
+
+	bool init() {
+		inotifyFd = inotify_init();
+		if(inotifyFd < 0) {
+			warnings << "DirectoryIndex: inotify not available: " << strerror(errno) << endl;
+			return false;
+		}
+		fcntl(inotifyFd, F_SETFL, fcntl(inotifyFd, F_GETFL) | O_NONBLOCK);
+		fcntl(inotifyFd, F_SETFD, FD_CLOEXEC);
+		return true;
+	}
+
+	void addRoot(const std::string& path) {
+		Mutex::ScopedLock lock(mutex);
+		for(std::list<IndexRoot*>::iterator r = roots.begin(); r != roots.end(); ++r)
+			if(stringcaseequal((*r)->path, path)) return;
+		IndexRoot* root = new IndexRoot(path);
+		roots.push_back(root);
+		root->worker = threadPool->start(boost::bind(&DirectoryIndex::buildRoot, this, root), "DirectoryIndex " + path);
+	}
+
+	Result buildRoot(IndexRoot* root) {
+		AbsTime start = GetTime();
+		std::set< std::pair<dev_t, ino_t> > visited;
+		scanDir(root, root->path, 0, visited, false);
+
+		Mutex::ScopedLock lock(mutex);
+		if(quit) return "quit";
+		if(root->failed) {
+			notes << "DirectoryIndex: not indexing " << root->path << ", too many files" << endl;
+			removeDirs(lowerCase(root->path), root); // keep the dirs of searchpaths inside of this one
+			return "too many files";
+		}
+		root->ready = true;
+		notes << "DirectoryIndex: indexed " << root->path << " (" << root->numDirs << " dirs, " << root->numEntries << " entries) in "
+			<< (GetTime() - start).milliseconds() << " ms" << endl;
+		return true;
+	}
+
+	// Reads the directory and all subdirectories into the index.
+	void scanDir(IndexRoot* root, const std::string& exactPath, int depth, std::set< std::pair<dev_t, ino_t> >& visited, bool haveLock) {
+		struct stat s;
+		if(stat(exactPath.c_str(), &s) != 0 || !S_ISDIR(s.st_mode)) return;
+		if(!visited.insert(std::make_pair(s.st_dev, s.st_ino)).second) return; // symlink loop
+
+		// Add the watch before we read the dir, so that we don't miss any changes in between.
+		const int wd = inotify_add_watch(inotifyFd, exactPath.c_str(),
+							IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+		if(wd >= 0) {
+			// Events which arrive while we read the dir are applied afterwards, see finishScan
+			if(!haveLock) mutex.lock();
+			scanningWds[wd]++;
+			if(!haveLock) mutex.unlock();
+		}
+
+		IndexDir* dir = new IndexDir();
+		dir->exactPath = exactPath;
+		dir->root = root;
+		dir->wd = wd;
+		std::list<std::string> subdirs;
+
+		DIR* handle = opendir(exactPath.c_str());
+		if(handle) {
+			dirent* entry;
+			while((entry = readdir(handle)) != 0) {
+				if(entry->d_name[0] == '.' && (entry->d_name[1] == '\0' || (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+					continue;
+				DirectoryIndexEntry e;
+				e.name = entry->d_name;
+				const std::string full = exactPath + "/" + e.name;
+				if(stat(full.c_str(), &s) != 0) continue;
+				if(S_ISDIR(s.st_mode)) e.mode = FM_DIR;
+				else if(S_ISREG(s.st_mode)) e.mode = FM_REG;
+				else continue;
+				// like CaseInsFindFile, the first one wins if names only differ in case
+				dir->entries.insert(std::make_pair(lowerCase(e.name), e));
+				if(e.mode == FM_DIR) subdirs.push_back(full);
+			}
+			closedir(handle);
+		}
+
+		{
+			if(!haveLock) mutex.lock();
+			if(wd < 0) authoritative = false;
+			else watchRefs[wd]++;
+			root->numDirs++;
+			root->numEntries += dir->entries.size();
+			if(root->numEntries > INDEX_MAX_ENTRIES_PER_ROOT) root->failed = true;
+			const std::string key = lowerCase(exactPath);
+			IndexDir*& slot = dirs[key];
+			if(slot && slot->root != root && !slot->root->failed && slot->root->path.size() >= root->path.size()) {
+				// The innermost searchpath owns a dir, so it stays indexed when an outer one is dropped
+				releaseWatch(wd);
+				delete dir;
+			}
+			else {
+				if(slot) dropDir(key, slot); // we got it already through an inotify event or an outer searchpath
+				slot = dir;
+				if(wd >= 0) watches.insert(std::make_pair(wd, key));
+			}
+			if(wd >= 0) finishScan(wd);
+			const bool stop = quit || root->failed;
+			if(!haveLock) mutex.unlock();
+			if(stop) return;
+		}
+
+		if(depth >= INDEX_MAX_DEPTH) return; // subdirs are not indexed and thus handled by the old code
+		for(std::list<std::string>::iterator i = subdirs.begin(); i != subdirs.end(); ++i)
+			scanDir(root, *i, depth + 1, visited, haveLock);
+	}
+
+	// Applies the events which were deferred while the dir of wd was read, once no other dir
+	// with the same wd is being read anymore. mutex must be locked.
+	void finishScan(int wd) {
+		WatchRefs::iterator s = scanningWds.find(wd);
+		if(s == scanningWds.end() || --s->second > 0) return;
+		scanningWds.erase(s);
+
+		std::list< std::pair<int, std::string> > events;
+		for(std::list< std::pair<int, std::string> >::iterator e = deferredEvents.begin(); e != deferredEvents.end(); ) {
+			if(e->first == wd) events.splice(events.end(), deferredEvents, e++);
+			else ++e;
+		}
+		for(std::list< std::pair<int, std::string> >::iterator e = events.begin(); e != events.end(); ++e)
+			handleEvent((const inotify_event*)e->second.data());
+	}
+
+	// Removes the watch when the last dir which uses it is gone. mutex must be locked.
+	void releaseWatch(int wd) {
+		WatchRefs::iterator r = watchRefs.find(wd);
+		if(r == watchRefs.end()) return; // already removed by the kernel (IN_IGNORED)
+		if(--r->second > 0) return;
+		watchRefs.erase(r);
+		inotify_rm_watch(inotifyFd, wd);
+	}
+
+	// Frees the dir and its watch. The caller removes it from dirs. mutex must be locked.
+	void dropDir(const std::string& key, IndexDir* dir) {
+		if(dir->wd >= 0) {
+			std::pair<Watches::iterator, Watches::iterator> range = watches.equal_range(dir->wd);
+			for(Watches::iterator w = range.first; w != range.second; ++w)
+				if(w->second == key) { watches.erase(w); break; }
+			releaseWatch(dir->wd);
+		}
+		delete dir;
+	}
+
+	// Removes the dir and everything below from the index, only the dirs of onlyRoot if given. mutex must be locked.
+	void removeDirs(const std::string& lowerPath, IndexRoot* onlyRoot = NULL) {
+		const std::string prefix = lowerPath + "/";
+		for(Dirs::iterator d = dirs.begin(); d != dirs.end(); ) {
+			if((d->first == lowerPath || d->first.compare(0, prefix.size(), prefix) == 0) && (!onlyRoot || d->second->root == onlyRoot)) {
+				dropDir(d->first, d->second);
+				dirs.erase(d++);
+			}
+			else ++d;
+		}
+	}
+
+	// Applies all pending inotify events. mutex must be locked.
+	void processEvents() {
+		if(inotifyFd < 0) return;
+		char buf[16 * 1024] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+		while(true) {
+			ssize_t len = read(inotifyFd, buf, sizeof(buf));
+			if(len <= 0) break;
+			for(char* p = buf; p < buf + len; ) {
+				const inotify_event* ev = (const inotify_event*)p;
+				p += sizeof(inotify_event) + ev->len;
+				handleEvent(ev);
+			}
+		}
+	}
+
+	void handleEvent(const inotify_event* ev) {
+		if(ev->mask & IN_Q_OVERFLOW) {
+			warnings << "DirectoryIndex: inotify queue overflow, index is not reliable anymore" << endl;
+			authoritative = false;
+			return;
+		}
+
+		if(scanningWds.count(ev->wd)) {
+			// The dir is not in the index yet, the readdir might have missed this change
+			deferredEvents.push_back(std::make_pair(ev->wd, std::string((const char*)ev, sizeof(inotify_event) + ev->len)));
+			return;
+		}
+
+		std::pair<Watches::iterator, Watches::iterator> range = watches.equal_range(ev->wd);
+		if(ev->mask & IN_IGNORED) {
+			watches.erase(range.first, range.second);
+			watchRefs.erase(ev->wd);
+			return;
+		}
+
+		// copy the keys, the handling below can modify watches
+		std::list<std::string> keys;
+		for(Watches::iterator w = range.first; w != range.second; ++w)
+			keys.push_back(w->second);
+
+		for(std::list<std::string>::iterator k = keys.begin(); k != keys.end(); ++k) {
+			Dirs::iterator d = dirs.find(*k);
+			if(d == dirs.end()) continue;
+			IndexDir* dir = d->second;
+
+			if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+				if(dir->root->path == dir->exactPath) {
+					warnings << "DirectoryIndex: searchpath " << dir->root->path << " was removed" << endl;
+					dir->root->failed = true;
+				}
+				continue; // the parent dir gets an IN_DELETE / IN_MOVED_FROM
+			}
+
+			if(ev->len == 0) continue;
+			const std::string name = ev->name;
+			const std::string lowerName = lowerCase(name);
+			const std::string full = dir->exactPath + "/" + name;
+
+			if(ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				IndexDir::Entries::iterator e = dir->entries.find(lowerName);
+				if(e != dir->entries.end() && e->second.name == name) {
+					dir->entries.erase(e);
+					// there might be another entry which only differs in case
+					DirectoryIndexEntry ne;
+					if(findCaseVariant(dir->exactPath, lowerName, ne.name) && statEntry(dir->exactPath + "/" + ne.name, ne.mode))
+						dir->entries.insert(std::make_pair(lowerName, ne));
+				}
+				if(ev->mask & IN_ISDIR) removeDirs(lowerCase(full));
+			}
+
+			if(ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+				DirectoryIndexEntry ne;
+				ne.name = name;
+				if(!statEntry(full, ne.mode)) continue;
+				dir->entries.insert(std::make_pair(lowerName, ne)); // doesn't overwrite an existing case variant
+				if(ne.mode == FM_DIR && dirs.find(lowerCase(full)) == dirs.end()) {
+					std::set< std::pair<dev_t, ino_t> > visited;
+					scanDir(dir->root, full, 0, visited, true);
+				}
+			}
+		}
+	}
+
+	static bool statEntry(const std::string& path, filemodes_t& mode) {
+		struct stat s;
+		if(stat(path.c_str(), &s) != 0) return false;
+		if(S_ISDIR(s.st_mode)) mode = FM_DIR;
+		else if(S_ISREG(s.st_mode)) mode = FM_REG;
+		else return false;
+		return true;
+	}
+
+	static bool findCaseVariant(const std::string& dir, const std::string& lowerName, std::string& name) {
+		DIR* handle = opendir(dir.c_str());
+		if(!handle) return false;
+		dirent* entry;
+		bool found = false;
+		while((entry = readdir(handle)) != 0) {
+			if(lowerCase(entry->d_name) == lowerName) {
+				name = entry->d_name;
+				found = true;
+				break;
+			}
+		}
+		closedir(handle);
+		return found;
+	}
+
+	// Returns the indexed dir if it belongs to a ready searchpath. mutex must be locked.
+	IndexDir* findDir(const std::string& lowerPath) {
+		Dirs::iterator d = dirs.find(lowerPath);
+		if(d == dirs.end()) return NULL;
+		if(!d->second->root->ready || d->second->root->failed) return NULL;
+		return d->second;
+	}
+
+	bool lookup(const std::string& searchname, std::string& exactname, bool& found) {
+		std::string path;
+		if(!normalizePath(searchname, path)) return false;
+		const std::string lowerPath = lowerCase(path);
+
+		Mutex::ScopedLock lock(mutex);
+		processEvents();
+		lookups++;
+
+		// find the deepest indexed dir which is a prefix of the path
+		IndexDir* dir = NULL;
+		size_t pos = lowerPath.size();
+		while(true) {
+			dir = findDir(lowerPath.substr(0, pos));
+			if(dir) break;
+			pos = lowerPath.rfind('/', pos - 1);
+			if(pos == std::string::npos || pos == 0) return false;
+		}
+
+		exactname = dir->exactPath;
+		while(pos < path.size()) {
+			size_t next = path.find('/', pos + 1);
+			if(next == std::string::npos) next = path.size();
+			const std::string lowerComp = lowerPath.substr(pos + 1, next - pos - 1);
+
+			IndexDir::Entries::iterator e = dir->entries.find(lowerComp);
+			if(e == dir->entries.end()) {
+				if(!authoritative) return false;
+				// same result as GetExactFileName: the resolved part plus the rest as it is
+				exactname += path.substr(pos);
+				found = false;
+				indexHits++; indexMisses++;
+				return true;
+			}
+			// like CaseInsFindFile, prefer the exact name if there are multiple case variants
+			const std::string comp = path.substr(pos + 1, next - pos - 1);
+			if(e->second.name != comp && IsPathStatable(exactname + "/" + comp))
+				exactname += "/" + comp;
+			else
+				exactname += "/" + e->second.name;
+			pos = next;
+			if(pos >= path.size()) break;
+
+			if(e->second.mode != FM_DIR) {
+				if(!authoritative) return false;
+				exactname += path.substr(pos);
+				found = false;
+				indexHits++; indexMisses++;
+				return true;
+			}
+			dir = findDir(lowerCase(exactname));
+			if(!dir) return false; // below the depth limit
+		}
+
+		if(!authoritative && !IsPathStatable(exactname)) return false;
+		found = true;
+		indexHits++;
+		return true;
+	}
+
+	bool listDir(const std::string& absDir, std::vector<DirectoryIndexEntry>& entries) {
+		std::string path;
+		if(!normalizePath(absDir, path)) return false;
+
+		Mutex::ScopedLock lock(mutex);
+		processEvents();
+		if(!authoritative) return false;
+		IndexDir* dir = findDir(lowerCase(path));
+		if(!dir) return false;
+		entries.reserve(dir->entries.size());
+		for(IndexDir::Entries::iterator e = dir->entries.begin(); e != dir->entries.end(); ++e)
+			entries.push_back(e->second);
+		return true;
+	}
+};
+
+// Lookups come from any thread; they hold a read access while they use the index
+static ReadWriteLock directoryIndexLock;
+static DirectoryIndex* directoryIndex = NULL;
+
+struct DirectoryIndex_AddSearchpath {
+	DirectoryIndex* index;
+	DirectoryIndex_AddSearchpath(DirectoryIndex* i) : index(i) {}
+	bool operator()(const std::string& path) {
+		std::string abs_path;
+		if(!GetExactFileName(path, abs_path)) return true; // not existing
+		std::string norm;
+		if(!normalizePath(abs_path, norm) || norm == "/") return true;
+		index->addRoot(norm);
+		return true;
+	}
+};
+
+void InitDirectoryIndex() {
+	UnInitDirectoryIndex();
+
+	DirectoryIndex* index = new DirectoryIndex();
+	if(!index->init()) {
+		delete index;
+		return;
+	}
+
+	directoryIndexLock.startWriteAccess();
+	directoryIndex = index;
+	directoryIndexLock.endWriteAccess();
+
+	// not under the lock, GetExactFileName does lookups
+	DirectoryIndex_AddSearchpath adder(index);
+	ForEachSearchpath(adder);
+}
+
+void UnInitDirectoryIndex() {
+	// After this, no lookup uses the index anymore
+	directoryIndexLock.startWriteAccess();
+	DirectoryIndex* index = directoryIndex;
+	directoryIndex = NULL;
+	directoryIndexLock.endWriteAccess();
+
+	if(index) delete index;
+}
+
+bool DirectoryIndexLookup(const std::string& abs_searchname, std::string& exactname, bool& found) {
+	ScopedReadLock lock(directoryIndexLock);
+	if(!directoryIndex) return false;
+	return directoryIndex->lookup(abs_searchname, exactname, found);
+}
+
+bool DirectoryIndexListDir(const std::string& abs_dir, std::vector<DirectoryIndexEntry>& entries) {
+	ScopedReadLock lock(directoryIndexLock);
+	if(!directoryIndex) return false;
+	return directoryIndex->listDir(abs_dir, entries);
+}
+
+#endif // __linux__
@@ -23,6 +23,7 @@
 #include "Debug.h"
 #include "InputEvents.h"
 #include "game/Game.h"
+#include "DedicatedLoop.h"
 
 static void InitQuitSignalHandler();
 
@@ -137,6 +138,9 @@ bool EventQueue::push(const EventItem& event) {
 		SDL_CondSignal(data->cond);
 	}
 
+	if(this == mainQueue)
+		DedicatedLoopWakeup();
+
 #ifdef SINGLETHREADED
 	if(this == mainQueue && !isMainThread()) {
 		// This is somewhat hacky but not that serious.
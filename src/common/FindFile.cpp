@@ -368,6 +368,12 @@ bool GetExactFileName(const std::string& abs_searchname, std::string& filename)
 	std::string sname = abs_searchname;
 	ReplaceFileVariables(sname);
 
+	{
+		bool found = false;
+		if(DirectoryIndexLookup(sname, filename, found))
+			return found;
+	}
+
 	std::string nextname = "";
 	std::string nextexactname = "";
 	size_t pos;
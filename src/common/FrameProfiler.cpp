@@ -0,0 +1,227 @@
+/*
+ *  FrameProfiler.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <map>
+#include <algorithm>
+#include "FrameProfiler.h"
+#include "ThreadPool.h"
+#include "Mutex.h"
+#include "StringUtils.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+#ifdef _MSC_VER
+#define PROFILER_THREADLOCAL __declspec(thread)
+#else
+#define PROFILER_THREADLOCAL __thread
+#endif
+
+namespace FrameProfiler {
+
+bool running = false;
+
+namespace {
+
+	struct Event {
+		const char* name;
+		Uint64 start;
+		Uint64 duration;
+	};
+
+	// Written by its thread only, read when writing the trace
+	struct ThreadBuffer {
+		ThreadId thread;
+		Mutex mutex;
+		std::vector<Event> events;
+		size_t next; // ring position
+		size_t count;
+
+		ThreadBuffer() : thread(0), next(0), count(0) {}
+
+		template<typename F> void each(F& f) const {
+			const size_t first = (count < events.size()) ? 0 : next;
+			for(size_t i = 0; i < count; ++i)
+				f(thread, events[(first + i) % events.size()]);
+		}
+	};
+
+	// Buffers are never freed, threads keep pointers to them
+	Mutex buffersMutex;
+	std::vector<ThreadBuffer*> buffers;
+	size_t capacity = 65536;
+	Uint64 startTime = 0;
+
+	PROFILER_THREADLOCAL ThreadBuffer* curBuffer = NULL;
+
+	ThreadBuffer* threadBuffer() {
+		if(curBuffer) return curBuffer;
+
+		ThreadBuffer* b = new ThreadBuffer();
+		b->thread = getCurrentThreadId();
+		Mutex::ScopedLock lock(buffersMutex);
+		b->events.resize(capacity);
+		buffers.push_back(b);
+		curBuffer = b;
+		return b;
+	}
+
+	std::string threadName(ThreadId t) {
+		if(t == mainThreadId) return "main";
+		std::string name = getThreadName(t);
+		if(name.empty()) name = "thread 0x" + hex(t);
+		return name;
+	}
+
+	std::string jsonString(const std::string& s) {
+		std::string r = "\"";
+		for(std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
+			if(*i == '"' || *i == '\\') { r += '\\'; r += *i; }
+			else if((unsigned char)*i < 0x20) r += ' ';
+			else r += *i;
+		}
+		return r + "\"";
+	}
+
+	struct StatsCollector {
+		std::map<const char*, ZoneStats> zones;
+		void operator()(ThreadId, const Event& e) {
+			ZoneStats& z = zones[e.name];
+			z.name = e.name;
+			z.calls++;
+			z.totalUs += e.duration;
+			z.maxUs = std::max(z.maxUs, e.duration);
+		}
+	};
+
+	struct TraceWriter {
+		std::ostream& s;
+		bool first;
+		TraceWriter(std::ostream& s_) : s(s_), first(true) {}
+		void separate() { if(!first) s << ",\n"; first = false; }
+		void operator()(ThreadId t, const Event& e) {
+			separate();
+			s << "{\"name\":" << jsonString(e.name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << (Uint64)t
+			  << ",\"ts\":" << (e.start > startTime ? e.start - startTime : 0) << ",\"dur\":" << e.duration << "}";
+		}
+	};
+
+	bool byTotalTime(const ZoneStats& a, const ZoneStats& b) {
+		return a.totalUs > b.totalUs;
+	}
+}
+
+Uint64 now() {
+#ifdef WIN32
+	static LARGE_INTEGER freq = {0};
+	if(freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return (Uint64)(t.QuadPart / freq.QuadPart * 1000000 + (t.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart);
+#else
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (Uint64)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+#endif
+}
+
+void record(const char* name, Uint64 start) {
+	if(!running) return;
+	const Uint64 end = now();
+
+	ThreadBuffer* b = threadBuffer();
+	Mutex::ScopedLock lock(b->mutex); // only contended while the trace is written
+	if(b->events.empty()) return;
+	Event& e = b->events[b->next];
+	e.name = name;
+	e.start = start;
+	e.duration = end - start;
+	b->next = (b->next + 1) % b->events.size();
+	if(b->count < b->events.size()) b->count++;
+}
+
+void start(size_t eventsPerThread) {
+	{
+		Mutex::ScopedLock lock(buffersMutex);
+		capacity = std::max(eventsPerThread, (size_t)1);
+		for(std::vector<ThreadBuffer*>::iterator i = buffers.begin(); i != buffers.end(); ++i) {
+			Mutex::ScopedLock bufferLock((*i)->mutex);
+			if((*i)->events.size() == capacity) continue;
+			(*i)->events.clear();
+			(*i)->events.resize(capacity);
+			(*i)->next = (*i)->count = 0;
+		}
+	}
+	if(startTime == 0) startTime = now();
+	running = true;
+}
+
+void stop() {
+	running = false;
+}
+
+void reset() {
+	Mutex::ScopedLock lock(buffersMutex);
+	for(std::vector<ThreadBuffer*>::iterator i = buffers.begin(); i != buffers.end(); ++i) {
+		Mutex::ScopedLock bufferLock((*i)->mutex);
+		(*i)->next = (*i)->count = 0;
+	}
+	startTime = now();
+}
+
+size_t eventCount() {
+	Mutex::ScopedLock lock(buffersMutex);
+	size_t n = 0;
+	for(std::vector<ThreadBuffer*>::iterator i = buffers.begin(); i != buffers.end(); ++i) {
+		Mutex::ScopedLock bufferLock((*i)->mutex);
+		n += (*i)->count;
+	}
+	return n;
+}
+
+void zoneStats(std::vector<ZoneStats>& out) {
+	StatsCollector stats;
+	{
+		Mutex::ScopedLock lock(buffersMutex);
+		for(std::vector<ThreadBuffer*>::iterator i = buffers.begin(); i != buffers.end(); ++i) {
+			Mutex::ScopedLock bufferLock((*i)->mutex);
+			(*i)->each(stats);
+		}
+	}
+
+	out.clear();
+	out.reserve(stats.zones.size());
+	for(std::map<const char*, ZoneStats>::iterator i = stats.zones.begin(); i != stats.zones.end(); ++i)
+		out.push_back(i->second);
+	std::sort(out.begin(), out.end(), byTotalTime);
+}
+
+void writeTrace(std::ostream& s) {
+	TraceWriter writer(s);
+	s << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	Mutex::ScopedLock lock(buffersMutex);
+	for(std::vector<ThreadBuffer*>::iterator i = buffers.begin(); i != buffers.end(); ++i) {
+		writer.separate();
+		s << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (Uint64)(*i)->thread
+		  << ",\"args\":{\"name\":" << jsonString(threadName((*i)->thread)) << "}}";
+
+		// The thread waits while its buffer is written
+		Mutex::ScopedLock bufferLock((*i)->mutex);
+		(*i)->each(writer);
+	}
+
+	s << "\n]}\n";
+}
+
+}
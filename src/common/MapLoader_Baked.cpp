@@ -0,0 +1,395 @@
+/*
+ *  MapLoader_Baked.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#ifdef WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "MapLoader.h"
+#include "FindFile.h"
+#include "game/CMap.h"
+#include "Options.h"
+#include "Color.h"
+#include "GfxPrimitives.h"
+#include "StringUtils.h"
+#include "util/StringConv.h"
+#include "MathLib.h"
+#include "Debug.h"
+
+
+/*
+	File layout (native byte order, checked by byteOrder):
+
+	BakedHeader
+	string name, string theme					(Uint32 length + chars)
+	Uint32 count, count * (string key, string value)	(AdditionalData)
+	numObjects * object_t
+	3 layers: material (8bpp, w*h), draw image and back image (main format, 2w*2h)
+		each as Uint32 w, h, bytesPerPixel followed by the packed rows
+*/
+
+static const char BAKED_MAGIC[8] = { 'O','L','X','B','A','K','E','D' };
+static const Uint32 BAKED_VERSION = 2;
+static const Uint32 BAKED_BYTEORDER = 0x01020304;
+
+// Flags of the baking game; a level baked with other flags is not loaded
+enum {
+	BAKED_DEDICATED = 1, // dedicated servers don't load the hi-res images, the back layer is empty
+};
+
+struct BakedHeader {
+	char	magic[8];
+	Uint32	version;
+	Uint32	byteOrder;
+	Uint64	sourceHash;
+	Uint64	sourceSize;
+	Uint32	bytesPerPixel;
+	Uint32	Rmask, Gmask, Bmask, Amask;
+	Uint32	width, height;
+	Sint32	type;
+	Uint32	numObjects;
+	Uint32	flags;
+};
+
+static Uint32 bakeFlags() {
+	return bDedicated ? BAKED_DEDICATED : 0;
+}
+
+
+// FNV-1a over the whole level file. Returns false for directories (Gusanos levels) and unreadable files.
+static bool hashLevelFile(const std::string& filename, Uint64& hash, Uint64& size) {
+	if(IsDirectory(filename)) return false;
+	FILE* fp = OpenGameFile(filename, "rb");
+	if(!fp) return false;
+
+	hash = 14695981039346656037ULL;
+	size = 0;
+	static const size_t CHUNK = 64 * 1024;
+	std::vector<unsigned char> buf(CHUNK);
+	size_t n;
+	while((n = fread(&buf[0], 1, CHUNK, fp)) > 0) {
+		for(size_t i = 0; i < n; ++i) {
+			hash ^= buf[i];
+			hash *= 1099511628211ULL;
+		}
+		size += n;
+	}
+	fclose(fp);
+	return size > 0;
+}
+
+static std::string bakedFileName(Uint64 hash, Uint32 flags) {
+	return "cache/maps/" + hex(hash) + ((flags & BAKED_DEDICATED) ? ".ded" : "") + ".olxmap";
+}
+
+
+// Read-only view of a whole file; mmap'ed where available.
+class MappedFile {
+	const char* m_data;
+	size_t m_size;
+#ifdef WIN32
+	std::string m_buffer;
+#endif
+
+	MappedFile(const MappedFile&) { assert(false); }
+	MappedFile& operator=(const MappedFile&) { assert(false); return *this; }
+public:
+	MappedFile() : m_data(NULL), m_size(0) {}
+	~MappedFile() { close(); }
+
+	bool open(const std::string& absfilename) {
+		close();
+#ifdef WIN32
+		FILE* fp = OpenAbsFile(absfilename, "rb");
+		if(!fp) return false;
+		fseek(fp, 0, SEEK_END);
+		long len = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		if(len <= 0) { fclose(fp); return false; }
+		m_buffer.resize(len);
+		bool ok = fread(&m_buffer[0], 1, len, fp) == (size_t)len;
+		fclose(fp);
+		if(!ok) { m_buffer = ""; return false; }
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+		return true;
+#else
+		int fd = ::open(absfilename.c_str(), O_RDONLY);
+		if(fd < 0) return false;
+		struct stat st;
+		if(fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return false; }
+		void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd); // the mapping stays valid
+		if(p == MAP_FAILED) return false;
+		m_data = (const char*)p;
+		m_size = (size_t)st.st_size;
+		return true;
+#endif
+	}
+
+	void close() {
+#ifdef WIN32
+		m_buffer = "";
+#else
+		if(m_data) munmap((void*)m_data, m_size);
+#endif
+		m_data = NULL;
+		m_size = 0;
+	}
+
+	const char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+};
+
+// Bounds-checked cursor over the baked data
+struct BakedReader {
+	const char* p;
+	const char* end;
+	BakedReader(const char* data, size_t size) : p(data), end(data + size) {}
+
+	const char* take(size_t n) {
+		if((size_t)(end - p) < n) return NULL;
+		const char* r = p;
+		p += n;
+		return r;
+	}
+	template<typename T> bool get(T& v) {
+		const char* r = take(sizeof(T));
+		if(!r) return false;
+		memcpy(&v, r, sizeof(T));
+		return true;
+	}
+	bool getString(std::string& s) {
+		Uint32 len = 0;
+		if(!get(len)) return false;
+		const char* r = take(len);
+		if(!r) return false;
+		s.assign(r, len);
+		return true;
+	}
+	// Returns the pixel rows of a layer, or NULL if the layer doesn't match the expected size
+	const char* getLayer(Uint32 w, Uint32 h, Uint32 bpp, bool& empty) {
+		Uint32 lw = 0, lh = 0, lbpp = 0;
+		if(!get(lw) || !get(lh) || !get(lbpp)) return NULL;
+		empty = (lw == 0 && lh == 0);
+		if(empty) return p;
+		if(lw != w || lh != h || lbpp != bpp) return NULL;
+		return take((size_t)w * h * bpp);
+	}
+};
+
+struct BakedWriter {
+	FILE* fp;
+	bool ok;
+	BakedWriter(FILE* f) : fp(f), ok(true) {}
+
+	void put(const void* data, size_t n) {
+		if(ok && n > 0 && fwrite(data, 1, n, fp) != n) ok = false;
+	}
+	template<typename T> void put(const T& v) { put(&v, sizeof(T)); }
+	void putString(const std::string& s) {
+		put((Uint32)s.size());
+		put(s.data(), s.size());
+	}
+	void putLayer(SDL_Surface* surf) {
+		if(!surf) {
+			put((Uint32)0); put((Uint32)0); put((Uint32)0);
+			return;
+		}
+		const Uint32 bpp = surf->format->BytesPerPixel;
+		put((Uint32)surf->w); put((Uint32)surf->h); put(bpp);
+		if(!LockSurface(surf)) { ok = false; return; }
+		const Uint8* row = (const Uint8*)surf->pixels;
+		for(int y = 0; y < surf->h; ++y, row += surf->pitch)
+			put(row, (size_t)surf->w * bpp);
+		UnlockSurface(surf);
+	}
+};
+
+static void copyLayer(SDL_Surface* surf, const char* src) {
+	const size_t rowSize = (size_t)surf->w * surf->format->BytesPerPixel;
+	Uint8* row = (Uint8*)surf->pixels;
+	for(int y = 0; y < surf->h; ++y, row += surf->pitch, src += rowSize)
+		memcpy(row, src, rowSize);
+}
+
+
+Result BakedMapCache::load(CMap* m, const std::string& filename, Key& key) {
+	key = Key();
+	if(!tLXOptions || !tLXOptions->bBakedMapCache) return "baked map cache disabled";
+
+	if(!hashLevelFile(filename, key.hash, key.size)) return "cannot hash level " + filename;
+	key.valid = true;
+	const Uint64 hash = key.hash, size = key.size;
+	const Uint32 flags = bakeFlags();
+
+	const std::string bakedFile = GetFullFileName(bakedFileName(hash, flags));
+	if(bakedFile == "" || !IsFileAvailable(bakedFile, true)) return "no baked level";
+
+	MappedFile file;
+	if(!file.open(bakedFile)) return "cannot open " + bakedFile;
+	BakedReader r(file.data(), file.size());
+
+	// Validate everything before we touch the map, so a bad file leaves it as it was
+	BakedHeader head;
+	if(!r.get(head)) return "baked level " + bakedFile + " too short";
+	if(memcmp(head.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC)) != 0 || head.version != BAKED_VERSION || head.byteOrder != BAKED_BYTEORDER)
+		return "baked level " + bakedFile + " has a different version";
+	if(head.sourceHash != hash || head.sourceSize != size)
+		return "baked level " + bakedFile + " does not belong to " + filename;
+	if(head.flags != flags)
+		return "baked level " + bakedFile + " was baked by a " + ((head.flags & BAKED_DEDICATED) ? "dedicated server" : "client");
+
+	SDL_PixelFormat* fmt = getMainPixelFormat();
+	if(!fmt || head.bytesPerPixel != fmt->BytesPerPixel ||
+	   head.Rmask != fmt->Rmask || head.Gmask != fmt->Gmask || head.Bmask != fmt->Bmask || head.Amask != fmt->Amask)
+		return "baked level " + bakedFile + " uses a different pixel format";
+	if(head.width == 0 || head.height == 0 || head.width > 10000 || head.height > 10000 || head.numObjects > MAX_OBJECTS)
+		return "baked level " + bakedFile + " is corrupt";
+
+	std::string name, theme;
+	std::map<std::string, std::string> additionalData;
+	Uint32 numAdditionalData = 0;
+	if(!r.getString(name) || !r.getString(theme) || !r.get(numAdditionalData))
+		return "baked level " + bakedFile + " is corrupt";
+	for(Uint32 i = 0; i < numAdditionalData; ++i) {
+		std::string key, value;
+		if(!r.getString(key) || !r.getString(value))
+			return "baked level " + bakedFile + " is corrupt";
+		additionalData[key] = value;
+	}
+
+	const char* objects = r.take(head.numObjects * sizeof(object_t));
+	bool materialEmpty = false, drawEmpty = false, backEmpty = false;
+	const char* material = objects ? r.getLayer(head.width, head.height, 1, materialEmpty) : NULL;
+	const char* draw = material ? r.getLayer(head.width*2, head.height*2, head.bytesPerPixel, drawEmpty) : NULL;
+	const char* back = draw ? r.getLayer(head.width*2, head.height*2, head.bytesPerPixel, backEmpty) : NULL;
+	if(!back || materialEmpty)
+		return "baked level " + bakedFile + " is corrupt";
+
+	// Now build the map, the same way the LX loader does it
+	m->Name = name;
+	m->Type = head.type;
+	if(!m->Create(head.width, head.height, theme, m->MinimapWidth, m->MinimapHeight)) {
+		m->Shutdown();
+		return "cannot allocate map for baked level " + bakedFile;
+	}
+
+	if(m->material->surf->w != (int)head.width || m->material->surf->h != (int)head.height ||
+	   (!drawEmpty && (!m->bmpDrawImage.get() || m->bmpDrawImage->format->BytesPerPixel != head.bytesPerPixel)) ||
+	   (!backEmpty && (!m->bmpBackImageHiRes.get() || m->bmpBackImageHiRes->format->BytesPerPixel != head.bytesPerPixel))) {
+		m->Shutdown();
+		return "map surfaces don't match baked level " + bakedFile;
+	}
+
+	m->lockFlags();
+	copyLayer(m->material->surf.get(), material);
+	m->unlockFlags();
+
+	if(!drawEmpty) {
+		LOCK_OR_FAIL(m->bmpDrawImage);
+		copyLayer(m->bmpDrawImage.get(), draw);
+		UnlockSurface(m->bmpDrawImage);
+	}
+	if(!backEmpty) {
+		LOCK_OR_FAIL(m->bmpBackImageHiRes);
+		copyLayer(m->bmpBackImageHiRes.get(), back);
+		UnlockSurface(m->bmpBackImageHiRes);
+	}
+
+	m->NumObjects = head.numObjects;
+	if(m->Objects && head.numObjects > 0)
+		memcpy(m->Objects, objects, head.numObjects * sizeof(object_t));
+	m->AdditionalData = additionalData;
+
+	m->lxflagsToGusflags();
+	if(m->GetMiniMap().get() && m->image)
+		m->UpdateMiniMap(true);
+
+	return true;
+}
+
+
+void BakedMapCache::save(CMap* m, const std::string& filename, const Key& key) {
+	if(!tLXOptions || !tLXOptions->bBakedMapCache) return;
+	if(!key.valid) return; // not a level file
+	// Gusanos levels depend on the mod, same as for the in-memory cache
+	if(m->gusIsLoaded() || !m->material) return;
+	if(m->material->surf->format->BytesPerPixel != 1) return;
+
+	SDL_PixelFormat* fmt = getMainPixelFormat();
+	if(!fmt) return;
+	if(m->bmpDrawImage.get() && m->bmpDrawImage->format->BytesPerPixel != fmt->BytesPerPixel) return;
+	if(m->bmpBackImageHiRes.get() && m->bmpBackImageHiRes->format->BytesPerPixel != fmt->BytesPerPixel) return;
+
+	const Uint32 flags = bakeFlags();
+	const std::string bakedFile = bakedFileName(key.hash, flags);
+	if(IsFileAvailable(bakedFile)) return; // already baked (maybe under another file name)
+
+	// write to a temp file first, so that a parallel running server never sees a half-written file
+	const std::string fullFile = GetWriteFullFileName(bakedFile, true);
+	const std::string tmpFile = fullFile + ".tmp" + itoa((int)getpid());
+	FILE* fp = OpenAbsFile(tmpFile, "wb");
+	if(!fp) {
+		warnings << "BakedMapCache: cannot write " << tmpFile << endl;
+		return;
+	}
+
+	BakedHeader head;
+	memset(&head, 0, sizeof(head));
+	memcpy(head.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC));
+	head.version = BAKED_VERSION;
+	head.byteOrder = BAKED_BYTEORDER;
+	head.sourceHash = key.hash;
+	head.sourceSize = key.size;
+	head.bytesPerPixel = fmt->BytesPerPixel;
+	head.Rmask = fmt->Rmask; head.Gmask = fmt->Gmask; head.Bmask = fmt->Bmask; head.Amask = fmt->Amask;
+	head.width = m->Width;
+	head.height = m->Height;
+	head.type = m->Type;
+	head.numObjects = m->Objects ? CLAMP(m->NumObjects, 0, MAX_OBJECTS) : 0;
+	head.flags = flags;
+
+	BakedWriter w(fp);
+	w.put(head);
+	w.putString(m->Name);
+	w.putString(m->Theme.name);
+	w.put((Uint32)m->AdditionalData.size());
+	for(std::map<std::string, std::string>::const_iterator i = m->AdditionalData.begin(); i != m->AdditionalData.end(); ++i) {
+		w.putString(i->first);
+		w.putString(i->second);
+	}
+	if(head.numObjects > 0)
+		w.put(m->Objects, head.numObjects * sizeof(object_t));
+
+	m->lockFlags(false);
+	w.putLayer(m->material->surf.get());
+	m->unlockFlags(false);
+	w.putLayer(m->bmpDrawImage.get());
+	w.putLayer(m->bmpBackImageHiRes.get());
+
+	fclose(fp);
+
+	if(!w.ok || rename(tmpFile.c_str(), fullFile.c_str()) != 0) {
+		warnings << "BakedMapCache: writing " << fullFile << " failed" << endl;
+		remove(tmpFile.c_str());
+		return;
+	}
+	notes << "baked level " << filename << " to " << bakedFile << endl;
+}
@@ -19,11 +19,221 @@
 #include "Color.h"
 #include "PixelFunctors.h"
 #include "Cache.h"
+#include "MathLib.h"
+#include "ThreadPool.h"
+#include "Mutex.h"
+#include "Condition.h"
+#include <vector>
+#include <boost/bind.hpp>
 #include <zlib.h>
 #ifndef DEDICATED_ONLY
 #include <gd.h>
 #endif
 
+/*
+	Decoder for the LX image format data.
+
+	The data is zlib compressed and consists of the back image (RGB), the front image (RGB)
+	and the LX pixel flags, each Width*Height. We inflate it chunk-wise directly from the file.
+	Each of the three layers is converted on its own worker thread, row by row, as soon as
+	the rows are decompressed, so the conversion overlaps with the inflating.
+	The flags worker also copies the back image into the front image for empty pixels,
+	thus it waits until both image workers are done with the row.
+*/
+class LxImageDecoder {
+	CMap* map;
+	const int width, height;
+	std::vector<uint8_t> data;
+	
+	Mutex mutex;
+	Condition progress;
+	size_t decompressed;	// bytes in data which are ready
+	bool finished;			// inflating is done (or failed)
+	int backRowsDone, frontRowsDone;
+	uint dirtCount;
+	
+	size_t layerSize() const { return (size_t)width * height * 3; }
+	
+	// Waits until at least 'bytes' are decompressed. Returns how many bytes are available
+	// or 0 if the data ends before.
+	size_t waitForData(size_t bytes) {
+		Mutex::ScopedLock lock(mutex);
+		while(decompressed < bytes && !finished)
+			progress.wait(mutex);
+		return (decompressed >= bytes) ? decompressed : 0;
+	}
+	
+	void setRowDone(int& rowsDone, int y) {
+		Mutex::ScopedLock lock(mutex);
+		rowsDone = y + 1;
+		progress.broadcast();
+	}
+	
+	static INLINE Uint32 packRGB(const SDL_PixelFormat* fmt, Uint8 r, Uint8 g, Uint8 b) {
+		if(fmt->BytesPerPixel == 1) return SDL_MapRGB((SDL_PixelFormat*)fmt, r, g, b);
+		return Pack(Color(r, g, b), fmt);
+	}
+	
+	// Converts the RGB rows into the 2x stretched surface as they arrive.
+	Result convertImage(SDL_Surface* surf, size_t offset, int* rowsDone) {
+		const SDL_PixelFormat* fmt = surf->format;
+		const short bpp = fmt->BytesPerPixel;
+		const size_t rowSize = (size_t)width * 3;
+		size_t available = 0;
+		for(int y = 0; y < height; y++) {
+			const size_t rowEnd = offset + (y + 1) * rowSize;
+			if(available < rowEnd) {
+				available = waitForData(rowEnd);
+				if(available == 0) return "LX image data too short";
+			}
+			const uint8_t* src = &data[offset + y * rowSize];
+			Uint8* dst0 = (Uint8*)surf->pixels + (y * 2) * surf->pitch;
+			Uint8* dst1 = dst0 + surf->pitch;
+			for(int x = 0; x < width; x++, src += 3, dst0 += bpp * 2, dst1 += bpp * 2) {
+				const Uint32 c = packRGB(fmt, src[0], src[1], src[2]);
+				PutPixelToAddr(dst0, c, bpp);
+				PutPixelToAddr(dst0 + bpp, c, bpp);
+				PutPixelToAddr(dst1, c, bpp);
+				PutPixelToAddr(dst1 + bpp, c, bpp);
+			}
+			setRowDone(*rowsDone, y);
+		}
+		return true;
+	}
+	
+	Result convertBack() { return convertImage(map->bmpBackImageHiRes.get(), 0, &backRowsDone); }
+	Result convertFront() { return convertImage(map->bmpDrawImage.get(), layerSize(), &frontRowsDone); }
+	
+	Result convertFlags() {
+		SDL_Surface* front = map->bmpDrawImage.get();
+		SDL_Surface* back = map->bmpBackImageHiRes.get();
+		const short bpp = front->format->BytesPerPixel;
+		const size_t offset = layerSize() * 2;
+		size_t available = 0;
+		uint dirt = 0;
+		for(int y = 0; y < height; y++) {
+			const size_t rowEnd = offset + (size_t)(y + 1) * width;
+			if(available < rowEnd) {
+				available = waitForData(rowEnd);
+				if(available == 0) return "LX flags data too short";
+			}
+			{
+				// we must not overwrite the row before the image workers have written it
+				Mutex::ScopedLock lock(mutex);
+				while(backRowsDone <= y || frontRowsDone <= y) {
+					if(finished && decompressed < offset) return "LX image data too short";
+					progress.wait(mutex);
+				}
+			}
+			const uint8_t* src = &data[offset + (size_t)y * width];
+			char* matRow = map->material->line[y];
+			Uint8* dst = (Uint8*)front->pixels + (y * 2) * front->pitch;
+			const Uint8* bk = (const Uint8*)back->pixels + (y * 2) * back->pitch;
+			for(int x = 0; x < width; x++, dst += bpp * 2, bk += bpp * 2) {
+				const uint8_t lxflag = src[x];
+				matRow[x] = Material::indexFromLxFlag(lxflag);
+				if(lxflag & PX_EMPTY) {
+					memcpy(dst, bk, bpp * 2);
+					memcpy(dst + front->pitch, bk + back->pitch, bpp * 2);
+				}
+				if(lxflag & PX_DIRT)
+					dirt++;
+			}
+		}
+		dirtCount = dirt;
+		return true;
+	}
+	
+	void publish(size_t bytes, bool done) {
+		Mutex::ScopedLock lock(mutex);
+		decompressed = bytes;
+		if(done) finished = true;
+		progress.broadcast();
+	}
+	
+	// Inflates the compressed data from the file. Returns false on error.
+	bool inflateFrom(FILE* fp, Uint32 compressedSize) {
+		z_stream strm;
+		memset(&strm, 0, sizeof(strm));
+		if(inflateInit(&strm) != Z_OK) {
+			publish(0, true);
+			return false;
+		}
+		
+		uint8_t inbuf[64 * 1024];
+		Uint32 left = compressedSize;
+		int zret = Z_OK;
+		strm.next_out = &data[0];
+		strm.avail_out = (uInt)data.size();
+		while(zret != Z_STREAM_END) {
+			if(strm.avail_in == 0) {
+				if(left == 0) break;
+				const size_t toRead = MIN((size_t)left, sizeof(inbuf));
+				const size_t r = fread(inbuf, 1, toRead, fp);
+				if(r == 0) break;
+				left -= (Uint32)r;
+				strm.next_in = inbuf;
+				strm.avail_in = (uInt)r;
+			}
+			zret = inflate(&strm, Z_NO_FLUSH);
+			if(zret != Z_OK && zret != Z_STREAM_END) break;
+			publish(strm.total_out, false);
+			if(strm.avail_out == 0) break;
+		}
+		
+		// skip what we didn't use, the file position must be behind the compressed data
+		if(left > 0) fseek(fp, left, SEEK_CUR);
+		
+		const bool ok = (zret == Z_STREAM_END || strm.avail_out == 0);
+		publish(strm.total_out, true);
+		inflateEnd(&strm);
+		return ok;
+	}
+	
+public:
+	LxImageDecoder(CMap* m, int w, int h, size_t destsize) :
+		map(m), width(w), height(h), data(destsize),
+		decompressed(0), finished(false), backRowsDone(0), frontRowsDone(0), dirtCount(0) {}
+	
+	// Surfaces and flags must be locked.
+	bool run(FILE* fp, Uint32 compressedSize) {
+		ThreadPoolItem* workers[3] = { NULL, NULL, NULL };
+		if(threadPool) {
+			workers[0] = threadPool->start(boost::bind(&LxImageDecoder::convertBack, this), "LX back image decoder");
+			workers[1] = threadPool->start(boost::bind(&LxImageDecoder::convertFront, this), "LX front image decoder");
+			workers[2] = threadPool->start(boost::bind(&LxImageDecoder::convertFlags, this), "LX flags decoder");
+		}
+		
+		bool ok = inflateFrom(fp, compressedSize);
+		if(!ok)
+			errors("Failed decompression\n");
+		
+		Result res(true);
+		if(threadPool) {
+			for(int i = 0; i < 3; i++) {
+				int ret = 0;
+				threadPool->wait(workers[i], &ret);
+				if(!ret) ok = false;
+			}
+		}
+		else {
+			// no threads, just do it in order; all data is ready now
+			if(res) res = convertBack();
+			if(res) res = convertFront();
+			if(res) res = convertFlags();
+			if(!res) ok = false;
+		}
+		
+		if(ok && decompressed < layerSize() * 2 + (size_t)width * height) {
+			errors("CMap::LoadImageFormat(): image too small for Width*Height");
+			ok = false;
+		}
+		
+		map->nTotalDirtCount = dirtCount;
+		return ok;
+	}
+};
+
 class ML_LieroX : public MapLoad {
 	
 	std::string id;
@@ -72,90 +282,29 @@ class ML_LieroX : public MapLoad {
 		fread_compat(destsize, sizeof(Uint32), 1, fp);
 		EndianSwap(destsize);
 		
-		// Allocate the memory
-		uint8_t *pSource = new uint8_t[size];
-		uint8_t *pDest = new uint8_t[destsize];
-		
-		if(!pSource || !pDest) {
-			errors << "CMap::LoadImageFormat: not enough memory" << endl;
-			return false;
-		}
-		
-		if(fread(pSource, sizeof(uint8_t), size, fp) < size) {
-			errors << "CMap::LoadImageFormat: cannot read data" << endl;
-			return false;
-		}
-		
-		ulong lng_dsize = destsize;
-		if( uncompress( pDest, &lng_dsize, pSource, size ) != Z_OK ) {
-			errors("Failed decompression\n");
-			delete[] pSource;
-			delete[] pDest;
-			return false;
-		}
-		destsize = lng_dsize;
-		if( destsize < Uint32(head.width * head.height * 3 * 2) )
+		if( destsize < Uint32(head.width * head.height * 7) )
 		{
 			errors("CMap::LoadImageFormat(): image too small for Width*Height");
-			delete[] pSource;
-			delete[] pDest;
 			return false;
 		}
 		
-		delete[] pSource;  // not needed anymore
-		
-		//
-		// Translate the data
-		//
-		
 		// Lock surfaces
 		LOCK_OR_FAIL(m->bmpBackImageHiRes);
 		LOCK_OR_FAIL(m->bmpDrawImage);
-		
-		Uint64 p=0;
-		
-		// Load the back image
-		for (Sint64 y = 0; y < head.height; y++)  {
-			for (Sint64 x = 0; x < head.width; x++)  {
-				Color curcolor = Color(pDest[p], pDest[p+1], pDest[p+2]);
-				p += 3;
-				PutPixel2x2(m->bmpBackImageHiRes.get(), (int)x*2, (int)y*2, curcolor.get(m->bmpBackImageHiRes->format));
-			}
-		}
-		
-		// Load the front image
-		for (Sint64 y = 0; y < head.height; y++)  {
-			for (Sint64 x = 0;x < head.width; x++)  {
-				Color curcolor = Color(pDest[p], pDest[p+1], pDest[p+2]);
-				p += 3;
-				PutPixel2x2(m->bmpDrawImage.get(), (int)x*2, (int)y*2, curcolor.get(m->bmpDrawImage->format));
-			}
-		}
-		
-		
-		// Load the pixel flags and calculate dirt count
-		Uint64 n=0;
-		m->nTotalDirtCount = 0;
-		
 		m->lockFlags();
 		
-		for(Sint64 y=0; y< head.height; y++) {
-			for(Sint64 x=0; x<head.width; x++) {
-				uint8_t lxflag = pDest[p++];
-				m->material->line[y][x] = Material::indexFromLxFlag(lxflag);
-				if(lxflag & PX_EMPTY)
-					CopyPixel2x2_SameFormat(m->bmpDrawImage.get(), m->bmpBackImageHiRes.get(), (int)x*2, (int)y*2);
-				if(lxflag & PX_DIRT)
-					m->nTotalDirtCount++;
-				n++;
-			}
-		}
+		LxImageDecoder decoder(m, (int)head.width, (int)head.height, destsize);
+		bool ret = decoder.run(fp, size);
+		
 		m->unlockFlags();
 		
 		// Unlock the surfaces
 		UnlockSurface(m->bmpBackImageHiRes);
 		UnlockSurface(m->bmpDrawImage);
 		
+		if(!ret)
+			return false;
+		
 		// Load the CTF gametype variables
 		if (ctf)  {
 			warnings << "CMap::LoadImageFormat(): trying to load old-format CTF map, we do not support this anymore" << endl;
@@ -172,9 +321,6 @@ class ML_LieroX : public MapLoad {
 		//SDL_SaveBMP(m->bmpImage.get(), GetWriteFullFileName("debug-front.bmp",true).c_str());
 		//SDL_SaveBMP(m->bmpBackImage.get(), GetWriteFullFileName("debug-back.bmp",true).c_str());
 		
-		// Delete the data
-		delete[] pDest;
-		
 		// Try to load additional data (like hi-res images)
 		LoadAdditionalLevelData(m);
 		
@@ -0,0 +1,380 @@
+/*
+ *  Metrics.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <sstream>
+#include <errno.h>
+#include "Metrics.h"
+#include "FrameProfiler.h"
+#include "LieroX.h"
+#include "Options.h"
+#include "Debug.h"
+#include "StringUtils.h"
+#include "Networking.h"
+#include "CServer.h"
+#include "CClient.h"
+#include "CServerConnection.h"
+#include "CChannel.h"
+#include "game/Game.h"
+
+#ifdef WIN32
+#include "wsock.h"
+#define sockerrno WSAGetLastError()
+#define SOCK_WOULDBLOCK(e) ((e) == WSAEWOULDBLOCK)
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#define closesocket close
+#define INVALID_SOCKET -1
+#define SOCKET int
+#define sockerrno errno
+#define SOCK_WOULDBLOCK(e) ((e) == EAGAIN || (e) == EWOULDBLOCK || (e) == EINTR)
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace Metrics {
+
+namespace {
+
+	// Function-local, as metrics of other files can be constructed first
+	std::vector<Metric*>& registry() {
+		static std::vector<Metric*> metrics;
+		return metrics;
+	}
+
+	const double frameTimeBounds[] = { 0.001, 0.002, 0.005, 0.01, 0.016, 0.025, 0.033, 0.05, 0.1, 0.25, 0.5, 1 };
+
+	Histogram frameTime("olx_frame_time_seconds", "Time of a main loop frame, without the time waited for the next frame",
+						frameTimeBounds, sizeof(frameTimeBounds) / sizeof(frameTimeBounds[0]));
+	Gauge simDelay("olx_simulation_delay_seconds", "How far the game simulation was behind the real time at the last simulation frame");
+	Counter simHighDelay("olx_simulation_high_delay_frames_total", "Simulation frames run with a delay of more than 100 ms");
+	Counter simSkipped("olx_simulation_skipped_seconds_total", "Game time skipped because the simulation was more than 200 ms behind");
+	Counter luaTime("olx_lua_seconds_total", "Time spent in Lua calls");
+	Counter luaCalls("olx_lua_calls_total", "Lua calls from the engine (nested calls are not counted)");
+
+	int luaDepth = 0;
+
+	std::string labelValue(const std::string& s) {
+		std::string r;
+		for(std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
+			if(*i == '"' || *i == '\\') { r += '\\'; r += *i; }
+			else if(*i == '\n') r += "\\n";
+			else r += *i;
+		}
+		return r;
+	}
+
+	void writeGauge(std::ostream& s, const char* name, const char* help, double value) {
+		s << "# HELP " << name << " " << help << "\n";
+		s << "# TYPE " << name << " gauge\n";
+		s << name << " " << value << "\n";
+	}
+
+	// Values of the connections, collected when written
+	struct ClientStat {
+		const char* name;
+		const char* help;
+		const char* type;
+		double (*get)(CChannel* c);
+	};
+
+	double incomingRate(CChannel* c) { return c->getIncomingRate(); }
+	double outgoingRate(CChannel* c) { return c->getOutgoingRate(); }
+	double incomingBytes(CChannel* c) { return (double)c->getIncoming(); }
+	double outgoingBytes(CChannel* c) { return (double)c->getOutgoing(); }
+	double ping(CChannel* c) { return c->getPing() / 1000.0; }
+	double packetsDropped(CChannel* c) { return (double)c->getPacketLoss(); }
+	double packetsGood(CChannel* c) { return (double)c->getPacketsGood(); }
+	double retransmits(CChannel* c) { return (double)c->getRetransmits(); }
+	double packetLoss(CChannel* c) {
+		const double total = (double)c->getPacketLoss() + (double)c->getPacketsGood();
+		return (total > 0) ? c->getPacketLoss() / total : 0;
+	}
+
+	const ClientStat clientStats[] = {
+		{ "olx_client_incoming_bytes_per_second", "Incoming bandwidth of the client over the last 2 seconds", "gauge", incomingRate },
+		{ "olx_client_outgoing_bytes_per_second", "Outgoing bandwidth to the client over the last 2 seconds", "gauge", outgoingRate },
+		{ "olx_client_incoming_bytes_total", "Bytes received from the client", "counter", incomingBytes },
+		{ "olx_client_outgoing_bytes_total", "Bytes sent to the client", "counter", outgoingBytes },
+		{ "olx_client_ping_seconds", "Ping of the client", "gauge", ping },
+		{ "olx_client_packets_dropped_total", "Packets of the client which were lost or came out of order", "counter", packetsDropped },
+		{ "olx_client_packets_good_total", "Packets of the client which arrived in order", "counter", packetsGood },
+		{ "olx_client_packet_loss_ratio", "Ratio of the dropped packets of the client", "gauge", packetLoss },
+		{ "olx_client_reliable_retransmits_total", "Reliable packets sent again to the client", "counter", retransmits },
+	};
+
+	void writeClients(std::ostream& s) {
+		std::vector< std::pair<std::string, CChannel*> > channels;
+		if(cServer && cServer->isServerRunning()) {
+			CServerConnection* cl = cServer->getClients();
+			for(int c = 0; c < MAX_CLIENTS; c++, cl++) {
+				if(cl->getStatus() == NET_DISCONNECTED || !cl->getChannel()) continue;
+				const std::string labels = "client=\"" + itoa(c) + "\",address=\"" +
+					labelValue(NetAddrToString(cl->getChannel()->getAddress())) + "\",local=\"" +
+					(cl->isLocalClient() ? "1" : "0") + "\"";
+				channels.push_back(std::make_pair(labels, cl->getChannel()));
+			}
+		}
+
+		writeGauge(s, "olx_clients", "Connected clients, including the local one", (double)channels.size());
+		if(channels.empty()) return;
+
+		for(size_t i = 0; i < sizeof(clientStats) / sizeof(clientStats[0]); ++i) {
+			const ClientStat& stat = clientStats[i];
+			s << "# HELP " << stat.name << " " << stat.help << "\n";
+			s << "# TYPE " << stat.name << " " << stat.type << "\n";
+			for(size_t c = 0; c < channels.size(); ++c)
+				s << stat.name << "{" << channels[c].first << "} " << stat.get(channels[c].second) << "\n";
+		}
+	}
+
+	void writeObjects(std::ostream& s) {
+		writeGauge(s, "olx_game_state", "State of the game (1 inactive, 2 connecting, 3 lobby, 4 preparing, 5 playing)", (double)(int)game.state);
+		writeGauge(s, "olx_worms", "Worms in the game", (double)game.worms()->size());
+		writeGauge(s, "olx_players", "Worm input handlers (Gusanos players)", (double)game.players.size());
+		writeGauge(s, "olx_objects", "Gusanos objects (particles, weapons, ...)", (double)game.objects.size());
+		writeGauge(s, "olx_projectiles", "LX projectiles", cClient ? (double)cClient->getProjectiles().size() : 0);
+	}
+
+
+	/*
+		HTTP endpoint
+
+		Serves the metrics to any GET request on 127.0.0.1:Advanced.MetricsPort.
+		The sockets are non-blocking and handled from Game::frame, so the metrics
+		are always read in the main thread.
+	*/
+
+	struct Connection {
+		SOCKET sock;
+		std::string request;
+		std::string response;
+		size_t sent;
+		Uint64 started;
+	};
+
+	enum { MaxConnections = 8, MaxRequestSize = 8192 };
+	const Uint64 ConnectionTimeout = 2000000; // µs
+
+	SOCKET listener = INVALID_SOCKET;
+	int listenPort = 0; // the port of listener, or the port which failed
+	std::vector<Connection> connections;
+
+	bool setNonBlocking(SOCKET sock) {
+#ifdef WIN32
+		u_long mode = 1;
+		return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+		const int flags = fcntl(sock, F_GETFL, 0);
+		return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+	}
+
+	void closeServer() {
+		for(std::vector<Connection>::iterator i = connections.begin(); i != connections.end(); ++i)
+			closesocket(i->sock);
+		connections.clear();
+		if(listener != INVALID_SOCKET) {
+			closesocket(listener);
+			listener = INVALID_SOCKET;
+		}
+	}
+
+	void openServer(int port) {
+		listenPort = port;
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		if(listener == INVALID_SOCKET) {
+			errors << "Metrics: cannot create socket" << endl;
+			return;
+		}
+
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // the metrics are not meant to be public
+		addr.sin_port = htons((unsigned short)port);
+
+		if(bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, MaxConnections) != 0 || !setNonBlocking(listener)) {
+			errors << "Metrics: cannot listen on 127.0.0.1:" << port << endl;
+			closesocket(listener);
+			listener = INVALID_SOCKET;
+			return;
+		}
+
+		notes << "Metrics: serving on http://127.0.0.1:" << port << "/metrics" << endl;
+	}
+
+	void acceptConnections() {
+		while(true) {
+			SOCKET sock = accept(listener, NULL, NULL);
+			if(sock == INVALID_SOCKET) return;
+			if(connections.size() >= MaxConnections || !setNonBlocking(sock)) {
+				closesocket(sock);
+				continue;
+			}
+			Connection c;
+			c.sock = sock;
+			c.sent = 0;
+			c.started = FrameProfiler::now();
+			connections.push_back(c);
+		}
+	}
+
+	std::string httpResponse(const std::string& request) {
+		const std::string line = request.substr(0, request.find_first_of("\r\n"));
+		std::string status = "200 OK", body;
+		if(line.compare(0, 4, "GET ") != 0)
+			status = "405 Method Not Allowed";
+		else {
+			const std::string path = line.substr(4, line.find(' ', 4) - 4);
+			if(path == "/metrics" || path == "/") {
+				std::ostringstream s;
+				writePrometheus(s);
+				body = s.str();
+			}
+			else
+				status = "404 Not Found";
+		}
+		return "HTTP/1.0 " + status + "\r\n"
+			"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			"Content-Length: " + itoa((int)body.size()) + "\r\n"
+			"Connection: close\r\n\r\n" + body;
+	}
+
+	// Returns false when the connection is done
+	bool processConnection(Connection& c) {
+		if(FrameProfiler::now() - c.started > ConnectionTimeout) return false;
+
+		if(c.response.empty()) {
+			char buf[1024];
+			const int n = recv(c.sock, buf, sizeof(buf), 0);
+			if(n == 0) return false;
+			if(n < 0) return SOCK_WOULDBLOCK(sockerrno);
+			c.request.append(buf, n);
+			if(c.request.find("\r\n\r\n") == std::string::npos && c.request.find("\n\n") == std::string::npos)
+				return c.request.size() < MaxRequestSize;
+			c.response = httpResponse(c.request);
+		}
+
+		while(c.sent < c.response.size()) {
+			const int n = send(c.sock, c.response.data() + c.sent, (int)(c.response.size() - c.sent), MSG_NOSIGNAL);
+			if(n < 0) return SOCK_WOULDBLOCK(sockerrno);
+			c.sent += n;
+		}
+		return false;
+	}
+}
+
+
+Metric::Metric(const char* name, const char* help, const char* type) : m_name(name), m_help(help), m_type(type) {
+	registry().push_back(this);
+}
+
+void Metric::writeHeader(std::ostream& s) const {
+	s << "# HELP " << m_name << " " << m_help << "\n";
+	s << "# TYPE " << m_name << " " << m_type << "\n";
+}
+
+void Counter::write(std::ostream& s) const {
+	writeHeader(s);
+	s << m_name << " " << m_value << "\n";
+}
+
+void Gauge::write(std::ostream& s) const {
+	writeHeader(s);
+	s << m_name << " " << m_value << "\n";
+}
+
+Histogram::Histogram(const char* name, const char* help, const double* bounds, size_t count)
+: Metric(name, help, "histogram"), m_bounds(bounds, bounds + count), m_counts(count + 1, 0), m_sum(0), m_count(0) {}
+
+void Histogram::observe(double v) {
+	size_t i = 0;
+	while(i < m_bounds.size() && v > m_bounds[i]) ++i;
+	m_counts[i]++;
+	m_sum += v;
+	m_count++;
+}
+
+void Histogram::write(std::ostream& s) const {
+	writeHeader(s);
+	Uint64 cumulative = 0;
+	for(size_t i = 0; i < m_bounds.size(); ++i) {
+		cumulative += m_counts[i];
+		s << m_name << "_bucket{le=\"" << m_bounds[i] << "\"} " << cumulative << "\n";
+	}
+	s << m_name << "_bucket{le=\"+Inf\"} " << m_count << "\n";
+	s << m_name << "_sum " << m_sum << "\n";
+	s << m_name << "_count " << m_count << "\n";
+}
+
+
+void frameDone(Uint64 durationUs) {
+	frameTime.observe(durationUs / 1000000.0);
+}
+
+void simulationDelay(int delayMs, bool high) {
+	simDelay.set(delayMs / 1000.0);
+	if(high) simHighDelay.inc();
+}
+
+void simulationSkipped(int ms) {
+	simSkipped.inc(ms / 1000.0);
+}
+
+LuaCallTimer::LuaCallTimer() : start(0) {
+	if(luaDepth++ == 0) start = FrameProfiler::now();
+}
+
+LuaCallTimer::~LuaCallTimer() {
+	if(--luaDepth > 0) return;
+	luaTime.inc((FrameProfiler::now() - start) / 1000000.0);
+	luaCalls.inc();
+}
+
+void writePrometheus(std::ostream& s) {
+	const std::streamsize oldPrecision = s.precision(15);
+	for(std::vector<Metric*>::const_iterator i = registry().begin(); i != registry().end(); ++i)
+		(*i)->write(s);
+	writeObjects(s);
+	writeClients(s);
+	s.precision(oldPrecision);
+}
+
+void processServer() {
+	const int port = tLXOptions ? tLXOptions->iMetricsPort : 0;
+	if(port != listenPort) {
+		closeServer();
+		listenPort = 0;
+		if(port > 0) openServer(port);
+	}
+	if(listener == INVALID_SOCKET) return;
+
+	acceptConnections();
+	for(size_t i = 0; i < connections.size(); ) {
+		if(processConnection(connections[i])) { ++i; continue; }
+		closesocket(connections[i].sock);
+		connections.erase(connections.begin() + i);
+	}
+}
+
+void shutdownServer() {
+	closeServer();
+	listenPort = 0;
+}
+
+}
@@ -0,0 +1,120 @@
+/*
+ *  NameIndex.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <cctype>
+#include "NameIndex.h"
+#include "StringUtils.h"
+
+
+static inline char lowerChar(char c) {
+	return (char)tolower((unsigned char)c);
+}
+
+size_t stringcasehash::operator()(const std::string& s) const {
+	// FNV-1a
+	size_t h = 2166136261u;
+	for(std::string::const_iterator i = s.begin(); i != s.end(); ++i) {
+		h ^= (unsigned char)lowerChar(*i);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+bool stringcaseequalfct::operator()(const std::string& s1, const std::string& s2) const {
+	return stringcaseequal(s1, s2);
+}
+
+
+void PrefixTree::insert(const std::string& name) {
+	// count only after we know that it is new
+	std::vector<Node*> path;
+	path.reserve(name.size() + 1);
+	Node* n = &root;
+	path.push_back(n);
+	for(std::string::const_iterator i = name.begin(); i != name.end(); ++i) {
+		Node*& child = n->children[lowerChar(*i)];
+		if(!child) child = new Node();
+		n = child;
+		path.push_back(n);
+	}
+	if(n->terminal) return;
+	n->terminal = true;
+	n->name = name;
+	for(std::vector<Node*>::iterator p = path.begin(); p != path.end(); ++p)
+		(*p)->count++;
+}
+
+void PrefixTree::erase(const std::string& name) {
+	std::vector<Node*> path;
+	path.reserve(name.size() + 1);
+	Node* n = &root;
+	path.push_back(n);
+	for(std::string::const_iterator i = name.begin(); i != name.end(); ++i) {
+		Node::Children::iterator c = n->children.find(lowerChar(*i));
+		if(c == n->children.end()) return;
+		n = c->second;
+		path.push_back(n);
+	}
+	if(!n->terminal) return;
+	n->terminal = false;
+	n->name.clear();
+	for(std::vector<Node*>::iterator p = path.begin(); p != path.end(); ++p)
+		(*p)->count--;
+
+	// remove the nodes which are empty now
+	for(size_t i = name.size(); i > 0; --i) {
+		if(path[i]->count > 0) break;
+		deleteChildren(*path[i]);
+		delete path[i];
+		path[i - 1]->children.erase(lowerChar(name[i - 1]));
+	}
+}
+
+void PrefixTree::deleteChildren(Node& n) {
+	for(Node::Children::iterator c = n.children.begin(); c != n.children.end(); ++c) {
+		deleteChildren(*c->second);
+		delete c->second;
+	}
+	n.children.clear();
+}
+
+void PrefixTree::clear() {
+	deleteChildren(root);
+	root = Node();
+}
+
+const std::string& PrefixTree::anyName(const Node* n) {
+	while(!n->terminal) {
+		// there are no empty subtrees, see erase()
+		n = n->children.begin()->second;
+	}
+	return n->name;
+}
+
+void PrefixTree::collect(const Node* n, size_t depth, std::vector<std::string>& out, char stop) {
+	if(n->terminal)
+		out.push_back(n->name);
+	for(Node::Children::const_iterator c = n->children.begin(); c != n->children.end(); ++c) {
+		if(stop && c->first == lowerChar(stop)) {
+			out.push_back(anyName(c->second).substr(0, depth + 1));
+			continue;
+		}
+		collect(c->second, depth + 1, out, stop);
+	}
+}
+
+void PrefixTree::complete(const std::string& prefix, std::vector<std::string>& out, char stop) const {
+	const Node* n = &root;
+	for(std::string::const_iterator i = prefix.begin(); i != prefix.end(); ++i) {
+		Node::Children::const_iterator c = n->children.find(lowerChar(*i));
+		if(c == n->children.end()) return;
+		n = c->second;
+	}
+	if(n->count == 0) return;
+	collect(n, prefix.size(), out, stop);
+}
@@ -0,0 +1,396 @@
+/*
+ *  NetworkImpairment.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include <vector>
+
+#include "NetworkImpairment.h"
+#include "LieroX.h"
+#include "Debug.h"
+#include "Options.h"
+#include "CChannel.h"
+#include "CBytestream.h"
+#include "StringUtils.h"
+#include "MathLib.h"
+
+
+std::string NetworkImpairmentSettings::asString() const {
+	return
+		"latency " + itoa(latency) + "ms" +
+		", jitter " + itoa(jitter) + "ms" +
+		", loss " + ftoa(loss * 100.0f) + "%" +
+		", duplicate " + ftoa(duplicate * 100.0f) + "%" +
+		", reorder " + ftoa(reorder * 100.0f) + "%" +
+		", bandwidth " + (bandwidth > 0 ? (itoa(bandwidth) + "B/s") : std::string("unlimited")) +
+		", seed " + itoa(seed);
+}
+
+NetworkImpairmentSettings NetworkImpairmentSettings::fromOptions() {
+	NetworkImpairmentSettings s;
+	if(tLXOptions == NULL) return s;
+	s.latency = MAX(0, tLXOptions->iNetSimLatency);
+	s.jitter = MAX(0, tLXOptions->iNetSimJitter);
+	s.loss = CLAMP(tLXOptions->fNetSimLoss, 0.0f, 1.0f);
+	s.duplicate = CLAMP(tLXOptions->fNetSimDuplicate, 0.0f, 1.0f);
+	s.reorder = CLAMP(tLXOptions->fNetSimReorder, 0.0f, 1.0f);
+	s.bandwidth = MAX(0, tLXOptions->iNetSimBandwidth);
+	s.seed = (Uint32)tLXOptions->iNetSimSeed;
+	return s;
+}
+
+
+void NetworkImpairment::Stats::reset() {
+	packetsIn = packetsSent = packetsLost = packetsDuplicated = packetsReordered = packetsTailDropped = 0;
+	bytesIn = bytesSent = 0;
+}
+
+std::string NetworkImpairment::Stats::asString() const {
+	return
+		"in " + itoa(packetsIn) + " (" + itoa(bytesIn) + " bytes)" +
+		", sent " + itoa(packetsSent) + " (" + itoa(bytesSent) + " bytes)" +
+		", lost " + itoa(packetsLost) +
+		", duplicated " + itoa(packetsDuplicated) +
+		", reordered " + itoa(packetsReordered) +
+		", taildropped " + itoa(packetsTailDropped);
+}
+
+
+NetworkImpairment::NetworkImpairment(const NetworkImpairmentSettings& settings) :
+	m_settings(settings), m_linkFreeTime(0) {
+	// xorshift must not start with 0
+	m_rndState = settings.seed ^ 0x9E3779B9;
+	if(m_rndState == 0) m_rndState = 1;
+}
+
+Uint32 NetworkImpairment::nextRandom() {
+	// xorshift32; we don't use rand() as that is shared with the game and thus not reproducible
+	m_rndState ^= m_rndState << 13;
+	m_rndState ^= m_rndState >> 17;
+	m_rndState ^= m_rndState << 5;
+	return m_rndState;
+}
+
+float NetworkImpairment::nextRandomPos() {
+	return float(nextRandom() >> 8) / float(1 << 24);
+}
+
+void NetworkImpairment::enqueue(Uint64 deliveryTime, const NetworkAddr& addr, const void* buffer, int nbytes) {
+	Packet p;
+	p.addr = addr;
+	p.data.assign((const char*)buffer, nbytes);
+	m_queue.insert(std::make_pair(deliveryTime, p));
+}
+
+int NetworkImpairment::write(NetworkSocket& sock, const void* buffer, int nbytes) {
+	if(nbytes <= 0) return nbytes;
+
+	m_stats.packetsIn++;
+	m_stats.bytesIn += nbytes;
+
+	// The random numbers are always taken in the same order, independent of the settings,
+	// so changing e.g. the loss doesn't change the jitter sequence.
+	const float lossRnd = nextRandomPos();
+	const float dupRnd = nextRandomPos();
+	const float reorderRnd = nextRandomPos();
+	const Uint32 jitterRnd = nextRandom();
+	const Uint32 dupJitterRnd = nextRandom();
+
+	if(lossRnd < m_settings.loss) {
+		m_stats.packetsLost++;
+		return nbytes;
+	}
+
+	const Uint64 now = tLX->currentTime.milliseconds();
+
+	// Bandwidth: the link sends one packet after the other, each takes nbytes/bandwidth.
+	if(m_linkFreeTime < now) m_linkFreeTime = now;
+	if(m_settings.bandwidth > 0) {
+		if(m_linkFreeTime - now > (Uint64)MAX(0, m_settings.queueLimit)) {
+			m_stats.packetsTailDropped++;
+			return nbytes;
+		}
+		m_linkFreeTime += (Uint64)nbytes * 1000 / m_settings.bandwidth;
+	}
+
+	Uint64 delivery = m_linkFreeTime + m_settings.latency;
+	if(m_settings.jitter > 0)
+		delivery += jitterRnd % (Uint32)(m_settings.jitter + 1);
+	if(reorderRnd < m_settings.reorder) {
+		// hold it back long enough so that the following packets overtake it
+		delivery += m_settings.jitter + MAX(m_settings.latency / 2, 10);
+		m_stats.packetsReordered++;
+	}
+
+	const NetworkAddr addr = sock.remoteAddress();
+	enqueue(delivery, addr, buffer, nbytes);
+
+	if(dupRnd < m_settings.duplicate) {
+		Uint64 dupDelivery = m_linkFreeTime + m_settings.latency;
+		if(m_settings.jitter > 0)
+			dupDelivery += dupJitterRnd % (Uint32)(m_settings.jitter + 1);
+		enqueue(dupDelivery, addr, buffer, nbytes);
+		m_stats.packetsDuplicated++;
+	}
+
+	return nbytes;
+}
+
+void NetworkImpairment::flush(NetworkSocket& sock) {
+	if(m_queue.empty()) return;
+
+	const Uint64 now = tLX->currentTime.milliseconds();
+	if(m_queue.begin()->first > now) return;
+
+	// The socket sends to its current remote address, so we have to set it for each packet
+	// and restore it afterwards, otherwise we would confuse the user of the socket.
+	const NetworkAddr oldAddr = sock.remoteAddress();
+	NetworkAddr curAddr = oldAddr;
+
+	while(!m_queue.empty() && m_queue.begin()->first <= now) {
+		const Packet& p = m_queue.begin()->second;
+		if(!AreNetAddrEqual(p.addr, curAddr)) {
+			sock.setRemoteAddress(p.addr);
+			curAddr = p.addr;
+		}
+		int ret = sock.WriteDirect(p.data.data(), (int)p.data.size());
+		if(ret > 0) {
+			m_stats.packetsSent++;
+			m_stats.bytesSent += ret;
+		}
+		m_queue.erase(m_queue.begin());
+	}
+
+	if(!AreNetAddrEqual(oldAddr, curAddr))
+		sock.setRemoteAddress(oldAddr);
+}
+
+void NetworkImpairment::clear() {
+	m_queue.clear();
+	m_linkFreeTime = 0;
+}
+
+
+void ApplyNetworkImpairmentFromOptions(NetworkSocket& sock, Uint32 streamId) {
+	NetworkImpairmentSettings s = NetworkImpairmentSettings::fromOptions();
+	if(!s.isActive()) {
+		if(sock.impairment().get())
+			sock.setImpairment(NULL);
+		return;
+	}
+	s.seed = s.seed * 31 + streamId;
+	notes << "Network simulation on " << sock.debugString() << ": " << s.asString() << endl;
+	sock.setImpairment(new NetworkImpairment(s));
+}
+
+
+///////////////////
+// Simulated server/clients test over impaired sockets
+
+namespace {
+
+struct SimClient {
+	SmartPointer<NetworkSocket> sock;
+	CChannel3 channel;			// client side
+	CChannel3 serverChannel;	// server side of this client
+	NetworkSocket::Port port;
+
+	int stateSent;				// server -> client reliable state updates
+	int stateReceived;
+	Uint32 serverHash;
+	Uint32 clientHash;
+	int inputSent;				// client -> server reliable input
+	int inputReceived;
+	int outOfOrder;
+	int snapshotsReceived;		// unreliable data
+
+	SimClient() : port(0), stateSent(0), stateReceived(0), serverHash(2166136261u), clientHash(2166136261u),
+		inputSent(0), inputReceived(0), outOfOrder(0), snapshotsReceived(0) {}
+};
+
+enum { SIMMSG_STATE = 1, SIMMSG_INPUT = 2, SIMMSG_SNAPSHOT = 3 };
+
+Uint32 HashStep(Uint32 hash, Uint32 v) {
+	// FNV-1a over the 4 bytes
+	for(int i = 0; i < 4; i++) {
+		hash ^= (v >> (i * 8)) & 0xff;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Reads all messages from bs. Returns false if there was garbage.
+bool ReadSimMessages(CBytestream& bs, SimClient& cl, bool atClient) {
+	while(bs.GetRestLen() > 0) {
+		int type = bs.readByte();
+		switch(type) {
+			case SIMMSG_STATE: {
+				int seq = bs.readInt(4);
+				Uint32 value = (Uint32)bs.readInt(4);
+				if(!atClient) return false;
+				if(seq != cl.stateReceived + 1) cl.outOfOrder++;
+				cl.stateReceived = seq;
+				cl.clientHash = HashStep(cl.clientHash, value);
+				break;
+			}
+			case SIMMSG_INPUT: {
+				int seq = bs.readInt(4);
+				if(atClient) return false;
+				if(seq != cl.inputReceived + 1) cl.outOfOrder++;
+				cl.inputReceived = seq;
+				break;
+			}
+			case SIMMSG_SNAPSHOT: {
+				size_t len = bs.readInt(2);
+				bs.Skip(len);
+				if(atClient) cl.snapshotsReceived++;
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	return true;
+}
+
+void ProcessSimPackets(CChannel& chan, CBytestream& bs, SimClient& cl, bool atClient, int& garbage) {
+	bs.ResetPosToBegin();
+	while(chan.Process(&bs)) {
+		if(!ReadSimMessages(bs, cl, atClient))
+			garbage++;
+		bs.Clear();
+	}
+}
+
+}
+
+void TestNetworkSimulation(int numClients, const NetworkImpairmentSettings& settings) {
+	if(numClients < 1) numClients = 1;
+	notes << "Network simulation test with " << numClients << " clients: " << settings.asString() << endl;
+
+	const int stepMs = 10;
+	const int runMs = 60 * 1000;
+	const int drainMs = 20 * 1000; // no new data, just let the channels deliver everything
+	const int stateIntervalMs = 50;
+	const int inputIntervalMs = 20;
+	const int snapshotSize = 64;
+
+	Uint32 streamId = 0;
+	SmartPointer<NetworkSocket> serverSock = new NetworkSocket();
+	if(NegResult r = serverSock->OpenUnreliable(0)) {
+		errors << "TestNetworkSimulation: cannot open server socket: " << r.res.humanErrorMsg << endl;
+		return;
+	}
+	{
+		NetworkImpairmentSettings s = settings;
+		s.seed = settings.seed * 31 + (streamId++);
+		serverSock->setImpairment(new NetworkImpairment(s));
+	}
+	const NetworkAddr serverAddr = serverSock->localAddress();
+
+	std::vector< SmartPointer<SimClient> > clients;
+	for(int i = 0; i < numClients; i++) {
+		SmartPointer<SimClient> cl = new SimClient();
+		cl->sock = new NetworkSocket();
+		if(NegResult r = cl->sock->OpenUnreliable(0)) {
+			errors << "TestNetworkSimulation: cannot open client socket: " << r.res.humanErrorMsg << endl;
+			return;
+		}
+		NetworkImpairmentSettings s = settings;
+		s.seed = settings.seed * 31 + (streamId++);
+		cl->sock->setImpairment(new NetworkImpairment(s));
+		cl->port = GetNetAddrPort(cl->sock->localAddress());
+		cl->channel.Create(serverAddr, cl->sock);
+		cl->serverChannel.Create(cl->sock->localAddress(), serverSock);
+		clients.push_back(cl);
+	}
+
+	int garbage = 0;
+	int unknownSender = 0;
+	CBytestream bs;
+	for(int t = 0; t < runMs + drainMs; t += stepMs) {
+		tLX->currentTime = AbsTime(t);
+		const bool running = t < runMs;
+
+		for(size_t i = 0; i < clients.size(); i++) {
+			SimClient& cl = *clients[i].get();
+
+			CBytestream snapshot;
+			if(running && t % stateIntervalMs == 0) {
+				CBytestream msg;
+				cl.stateSent++;
+				Uint32 value = HashStep((Uint32)i, (Uint32)cl.stateSent);
+				msg.writeByte(SIMMSG_STATE);
+				msg.writeInt(cl.stateSent, 4);
+				msg.writeInt((int)value, 4);
+				cl.serverHash = HashStep(cl.serverHash, value);
+				cl.serverChannel.AddReliablePacketToSend(msg);
+
+				snapshot.writeByte(SIMMSG_SNAPSHOT);
+				snapshot.writeInt(snapshotSize, 2);
+				for(int f = 0; f < snapshotSize; f++)
+					snapshot.writeByte((uchar)(f + cl.stateSent));
+			}
+			cl.serverChannel.Transmit(&snapshot);
+
+			CBytestream input;
+			if(running && t % inputIntervalMs == 0) {
+				CBytestream msg;
+				cl.inputSent++;
+				msg.writeByte(SIMMSG_INPUT);
+				msg.writeInt(cl.inputSent, 4);
+				cl.channel.AddReliablePacketToSend(msg);
+			}
+			cl.channel.Transmit(&input);
+		}
+
+		// server receive; demultiplex by the sender port as the clients only know their 0.0.0.0 address
+		while(bs.Read(serverSock.get()) > 0) {
+			const NetworkSocket::Port fromPort = GetNetAddrPort(serverSock->remoteAddress());
+			SimClient* from = NULL;
+			for(size_t i = 0; i < clients.size(); i++)
+				if(clients[i]->port == fromPort) { from = clients[i].get(); break; }
+			if(!from) { unknownSender++; continue; }
+			ProcessSimPackets(from->serverChannel, bs, *from, false, garbage);
+		}
+
+		// client receive
+		for(size_t i = 0; i < clients.size(); i++) {
+			SimClient& cl = *clients[i].get();
+			while(bs.Read(cl.sock.get()) > 0)
+				ProcessSimPackets(cl.channel, bs, cl, true, garbage);
+		}
+	}
+
+	// Report
+	size_t totalBytes = 0, totalRetransmits = 0;
+	int diverged = 0;
+	for(size_t i = 0; i < clients.size(); i++) {
+		SimClient& cl = *clients[i].get();
+		const bool ok =
+			cl.stateReceived == cl.stateSent && cl.clientHash == cl.serverHash &&
+			cl.inputReceived == cl.inputSent && cl.outOfOrder == 0;
+		if(!ok) diverged++;
+		totalBytes += cl.channel.getOutgoing() + cl.serverChannel.getOutgoing();
+		totalRetransmits += cl.channel.getRetransmits() + cl.serverChannel.getRetransmits();
+
+		notes << "client " << i << ": " << (ok ? "in sync" : "DIVERGED") << endl;
+		notes << "  state " << cl.stateReceived << "/" << cl.stateSent
+			<< ", hash " << hex(cl.clientHash) << (cl.clientHash == cl.serverHash ? " == " : " != ") << hex(cl.serverHash)
+			<< ", input " << cl.inputReceived << "/" << cl.inputSent
+			<< ", out of order " << cl.outOfOrder
+			<< ", snapshots " << cl.snapshotsReceived << endl;
+		notes << "  server->client: " << cl.serverChannel.getOutgoing() << " bytes, "
+			<< cl.serverChannel.getRetransmits() << " retransmits, ping " << cl.serverChannel.getPing() << "ms" << endl;
+		notes << "  client->server: " << cl.channel.getOutgoing() << " bytes, "
+			<< cl.channel.getRetransmits() << " retransmits, ping " << cl.channel.getPing() << "ms" << endl;
+		notes << "  client link: " << cl.sock->impairment()->stats().asString() << endl;
+	}
+	notes << "server link: " << serverSock->impairment()->stats().asString() << endl;
+	notes << "Network simulation result: " << clients.size() << " clients, " << diverged << " diverged, "
+		<< totalBytes << " bytes sent, " << totalRetransmits << " retransmits, "
+		<< garbage << " garbage packets, " << unknownSender << " from unknown sender" << endl;
+}
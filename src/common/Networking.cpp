@@ -26,6 +26,7 @@
 #include "Options.h"
 #include "Error.h"
 #include "Networking.h"
+#include "NetworkImpairment.h"
 #include "StringUtils.h"
 #include "SmartPointer.h"
 #include "Timer.h"
@@ -35,6 +36,7 @@
 #include "TaskManager.h"
 #include "ReadWriteLock.h"
 #include "Mutex.h"
+#include "DedicatedLoop.h"
 
 
 
@@ -50,6 +52,7 @@ static std::string GetLastErrorAndReset() {
 #endif
 
 #include <map>
+#include <deque>
 
 #include <nl.h>
 // workaraound for bad named makros by nl.h
@@ -681,11 +684,42 @@ struct NetworkSocket::EventHandler {
 	}
 };
 
+// In-process delivery between our own UDP sockets, see NetworkSocket::setLocalLoopback()
+struct LoopbackPacket {
+	NetworkSocket::Port fromPort;
+	std::string data;
+};
+
+static const size_t LoopbackQueueLimit = 1024; // packets; like a full OS buffer, more are dropped
+static Mutex loopbackMutex;
+static std::map<NetworkSocket::Port, NetworkSocket*> loopbackSockets; // by local port
+
+static bool isLoopbackAddr(const NetworkAddr& addr) {
+	const NLaddress* a = getNLaddr(addr);
+	if(!a || !a->valid) return false;
+	const struct sockaddr_in* sin = (const struct sockaddr_in*)a->addr;
+	return sin->sin_family == AF_INET && (ntohl(sin->sin_addr.s_addr) >> 24) == 127;
+}
+
+static NetworkAddr loopbackAddr(NetworkSocket::Port port) {
+	static NetworkAddr localhost = StringToNetAddr("127.0.0.1");
+	NetworkAddr addr = localhost;
+	SetNetAddrPort(addr, port);
+	return addr;
+}
+
 struct NetworkSocket::InternSocket {
 	NLsocket sock;
 	SmartPointer<EventHandler> eventHandler;
+	SmartPointer<NetworkImpairment> impairment;
+	
+	// Local loopback; the queue is protected by loopbackMutex
+	bool loopback;
+	Port loopbackPort; // our port in loopbackSockets, 0 if not registered
+	Port remoteLoopbackPort; // if not 0, the remote address is 127.0.0.1 with this port
+	std::deque<LoopbackPacket> loopbackQueue;
 	
-	InternSocket() : sock(NL_INVALID) {}
+	InternSocket() : sock(NL_INVALID), loopback(false), loopbackPort(0), remoteLoopbackPort(0) {}
 	~InternSocket() {
 		// just a double check - there really shouldn't be a case where this could be true
 		if(eventHandler.get()) {
@@ -802,6 +836,12 @@ void NetworkSocket::checkEventHandling() {
 	}
 }
 
+int NetworkSocket::systemSocket() const {
+	if(!isOpen() || m_socket->sock == NL_INVALID) return -1;
+	if(nlIsValidSocket(m_socket->sock) != NL_TRUE) return -1;
+	return (int)nlSockets[m_socket->sock]->realsocket;
+}
+
 std::string NetworkSocket::debugString() const {
 	if(!isOpen()) return "Closed";
 	std::string ret = TypeStr(m_type) + "/" + StateStr(m_state);
@@ -840,6 +880,7 @@ Result NetworkSocket::OpenReliable(Port port) {
 	m_type = NST_TCP;
 	m_state = NSS_NONE;
 	checkEventHandling();
+	updateLoopback();
 	return true;
 }
 
@@ -856,6 +897,7 @@ Result NetworkSocket::OpenUnreliable(Port port) {
 	m_type = NST_UDP;
 	m_state = NSS_NONE;
 	checkEventHandling();
+	updateLoopback();
 	return true;
 }
 
@@ -872,6 +914,7 @@ Result NetworkSocket::OpenBroadcast(Port port) {
 	m_type = NST_UDPBROADCAST;
 	m_state = NSS_NONE;
 	checkEventHandling();
+	updateLoopback();
 	return true;	
 }
 
@@ -904,12 +947,21 @@ Result NetworkSocket::Listen() {
 	return true;
 }
 
+static volatile unsigned int socketCloseCount = 0;
+
+unsigned int NetworkSocket::closeCount() {
+	return socketCloseCount;
+}
+
 void NetworkSocket::Close() {
 	if(!isOpen()) {
 		warnings << "NetworkSocket::Close: cannot close already closed socket" << endl;
 		return;
 	}
 	
+	if(m_socket->impairment.get())
+		m_socket->impairment->clear();
+
 	if(m_type != NST_TCP) {
 		nlClose(m_socket->sock);
 	}
@@ -924,8 +976,70 @@ void NetworkSocket::Close() {
 	m_socket->sock = NL_INVALID;
 	m_type = NST_INVALID;
 	m_state = NSS_NONE;
+	socketCloseCount++;
 	
 	checkEventHandling();
+	updateLoopback();
+}
+
+void NetworkSocket::setLocalLoopback(bool v) {
+	m_socket->loopback = v;
+	updateLoopback();
+}
+
+bool NetworkSocket::localLoopback() const {
+	return m_socket->loopback;
+}
+
+NetworkSocket::Port NetworkSocket::localLoopbackPort() const {
+	return m_socket->loopbackPort;
+}
+
+void NetworkSocket::updateLoopback() {
+	Mutex::ScopedLock lock(loopbackMutex);
+	const bool want = m_socket->loopback && isOpen() && m_type == NST_UDP;
+	
+	if(!want && m_socket->loopbackPort) {
+		std::map<Port, NetworkSocket*>::iterator i = loopbackSockets.find(m_socket->loopbackPort);
+		if(i != loopbackSockets.end() && i->second == this)
+			loopbackSockets.erase(i);
+		m_socket->loopbackPort = 0;
+		m_socket->remoteLoopbackPort = 0;
+		m_socket->loopbackQueue.clear();
+	}
+	
+	if(want && !m_socket->loopbackPort) {
+		NetworkAddr addr;
+		if(nlGetLocalAddr(m_socket->sock, getNLaddr(addr)) == NL_FALSE) {
+			warnings << "NetworkSocket " << debugString() << ": no local loopback, cannot get the local port: " << GetLastErrorAndReset() << endl;
+			return;
+		}
+		const Port port = GetNetAddrPort(addr);
+		if(port == 0) return;
+		loopbackSockets[port] = this;
+		m_socket->loopbackPort = port;
+	}
+}
+
+bool NetworkSocket::writeLoopback(const void* buffer, int nbytes) {
+	Mutex::ScopedLock lock(loopbackMutex);
+	std::map<Port, NetworkSocket*>::iterator i = loopbackSockets.find(m_socket->remoteLoopbackPort);
+	if(i == loopbackSockets.end())
+		return false;
+	
+	NetworkSocket* target = i->second;
+	std::deque<LoopbackPacket>& queue = target->m_socket->loopbackQueue;
+	if(queue.size() >= LoopbackQueueLimit)
+		return true; // dropped, like UDP would do
+	queue.push_back(LoopbackPacket());
+	queue.back().fromPort = m_socket->loopbackPort;
+	queue.back().data.assign((const char*)buffer, nbytes);
+	
+	if(target->m_withEvents)
+		target->OnNewData.pushToMainQueue(EventData(target));
+	// the socket does not become readable, so the dedicated server would not notice the packet
+	DedicatedLoopWakeup();
+	return true;
 }
 
 int NetworkSocket::Write(const void* buffer, int nbytes) {
@@ -933,7 +1047,23 @@ int NetworkSocket::Write(const void* buffer, int nbytes) {
 		errors << "NetworkSocket::Write: cannot write on closed socket" << endl;
 		return NL_INVALID;
 	}
-	
+
+	if(m_socket->impairment.get() && m_type != NST_TCP) {
+		m_socket->impairment->flush(*this);
+		return m_socket->impairment->write(*this, buffer, nbytes);
+	}
+
+	if(m_socket->remoteLoopbackPort) {
+		if(tLXOptions && tLXOptions->bLocalLoopback && writeLoopback(buffer, nbytes))
+			return nbytes;
+		// The remote address in HawkNL might be outdated if we got the last packet over the loopback
+		nlSetRemoteAddr(m_socket->sock, getNLaddr(loopbackAddr(m_socket->remoteLoopbackPort)));
+	}
+
+	return WriteDirect(buffer, nbytes);
+}
+
+int NetworkSocket::WriteDirect(const void* buffer, int nbytes) {
 	ResetSocketError();
 	NLint ret = nlWrite(m_socket->sock, buffer, nbytes);
 
@@ -961,8 +1091,26 @@ int NetworkSocket::Read(void* buffer, int nbytes) {
 		return NL_INVALID;
 	}
 
+	// deliver the delayed packets, otherwise sockets which only read would never send them
+	if(m_socket->impairment.get() && m_type != NST_TCP)
+		m_socket->impairment->flush(*this);
+
+	if(m_socket->loopbackPort) {
+		Mutex::ScopedLock lock(loopbackMutex);
+		if(!m_socket->loopbackQueue.empty()) {
+			LoopbackPacket& p = m_socket->loopbackQueue.front();
+			const int n = MIN((int)p.data.size(), nbytes); // truncated like a UDP read
+			memcpy(buffer, p.data.data(), n);
+			m_socket->remoteLoopbackPort = p.fromPort;
+			m_socket->loopbackQueue.pop_front();
+			return n;
+		}
+	}
+
 	ResetSocketError();
 	NLint ret = nlRead(m_socket->sock, buffer, nbytes);
+	if(ret > 0)
+		m_socket->remoteLoopbackPort = 0; // HawkNL has the sender now
 	
 	// Error checking
 	if (ret == NL_INVALID)  {
@@ -1088,6 +1236,9 @@ NetworkAddr NetworkSocket::remoteAddress() const {
 		return addr;
 	}
 	
+	if(m_socket->remoteLoopbackPort)
+		return loopbackAddr(m_socket->remoteLoopbackPort);
+	
 	if(nlGetRemoteAddr(m_socket->sock, getNLaddr(addr)) == NL_FALSE) {
 		std::string errMsg = GetLastErrorAndReset();
 		errors << "NetworkSocket::remoteAddress: cannot get remote address" << "(" << debugString() << "): " << errMsg << endl;
@@ -1113,6 +1264,10 @@ Result NetworkSocket::setRemoteAddress(const NetworkAddr& addr) {
 		return "NetworkSocket::setRemoteAddress " + debugString() + ": failed to set destination " + addrStr + ": " + errMsg;
 	}
 	
+	m_socket->remoteLoopbackPort = 0;
+	if(m_socket->loopbackPort && isLoopbackAddr(addr))
+		m_socket->remoteLoopbackPort = GetNetAddrPort(addr);
+	
 	return true;
 }
 
@@ -1412,6 +1567,18 @@ bool NetworkSocket::isDataAvailable() {
 	return ret > 0;
 }
 
+void NetworkSocket::setImpairment(const SmartPointer<NetworkImpairment>& imp) {
+	if(m_type == NST_TCP) {
+		errors << "NetworkSocket::setImpairment: not supported for TCP sockets" << endl;
+		return;
+	}
+	m_socket->impairment = imp;
+}
+
+SmartPointer<NetworkImpairment> NetworkSocket::impairment() const {
+	return m_socket->impairment;
+}
+
 // In some cases, e.g. if the network is not connected, some IPs are
 // not available. Most likely, without any network, you just have
 // 127.* in the routing table.
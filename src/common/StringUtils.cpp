@@ -495,14 +495,15 @@ bool subStrCaseEqual(const std::string& s1, const std::string s2, size_t p) {
 	return true;
 }
 
-static size_t maxStartingEqualStr(const std::list<std::string>& strs, bool caseSensitive) {
+template<typename _List>
+static size_t maxStartingEqualStr(const _List& strs, bool caseSensitive) {
 	if(strs.size() == 0) return 0;
 	
 	size_t l = 0;
 	while(true) {
 		int i = 0;
 		char c = 0;
-		for(std::list<std::string>::const_iterator it = strs.begin(); it != strs.end(); ++it, ++i) {
+		for(typename _List::const_iterator it = strs.begin(); it != strs.end(); ++it, ++i) {
 			if(it->size() <= l) return l;
 			if(i == 0)
 				c = (*it)[l];
@@ -526,6 +527,10 @@ size_t maxStartingCaseEqualStr(const std::list<std::string>& strs) {
 	return maxStartingEqualStr(strs, false);
 }
 
+size_t maxStartingCaseEqualStr(const std::vector<std::string>& strs) {
+	return maxStartingEqualStr(strs, false);
+}
+
 
 std::vector<std::string> explode(const std::string& str, const std::string& delim) {
 	std::vector<std::string> result;
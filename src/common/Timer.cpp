@@ -26,6 +26,7 @@
 #include "Debug.h"
 #include "InputEvents.h"
 #include "game/Game.h"
+#include "MathLib.h"
 
 
 TimeCounter timeCounter;
@@ -145,66 +146,278 @@ struct TimerData {
 	Uint32				interval;
 	bool				once;
 	bool				quitSignal;
-	SDL_cond*			quitCond;
 	SDL_mutex*			mutex;
-	ThreadPoolItem*		thread;
-	
-	TimerData() : timer(NULL), userData(NULL), interval(0), once(false), quitSignal(false), quitCond(NULL), mutex(NULL), thread(NULL) {
+
+	// Protected by the mutex of the TimerWheel
+	TimerData*			prev;
+	TimerData*			next;
+	TimerData**			slot; // the list we are in, NULL if not scheduled
+	Uint64				expires;
+	bool				finished; // the last event was pushed
+
+	TimerData() : timer(NULL), userData(NULL), interval(0), once(false), quitSignal(false), mutex(NULL),
+	prev(NULL), next(NULL), slot(NULL), expires(0), finished(false) {
 		mutex = SDL_CreateMutex();
-		quitCond = SDL_CreateCond();
 		// TODO: not threadsafe
 		//timers.push_back(data); // Add it to the global timer array
 	}
-	~TimerData() {
-		breakThread();
-		if(thread) threadPool->wait(thread, NULL); thread = NULL;
-		SDL_DestroyMutex(mutex); mutex = NULL;
-		SDL_DestroyCond(quitCond); quitCond = NULL;
-		RemoveTimerFromGlobalList(this);
+	~TimerData();
+
+	void schedule();
+	void quit();
+};
+
+
+/*
+	Hierarchical timing wheel (like the one of the Linux kernel)
+
+	All running timers are in here, with a resolution of one ms. The root
+	level has a slot for each of the next 256 ms, the slots of each further
+	level cover 64 times as much. When the root level wraps around, the due
+	slot of the next level is cascaded down. Thus scheduling and cancelling
+	is O(1), and advancing by a tick mostly as well.
+
+	A single ticker thread sleeps until the next occupied root slot and
+	advances the wheel; the main loop advances it too (ProcessTimers()).
+	Expired timers push their event to the main queue, so the timer events
+	are still handled in the main thread.
+*/
+class TimerWheel {
+public:
+	enum { RootBits = 8, RootSize = 1 << RootBits, LevelBits = 6, LevelSize = 1 << LevelBits, Levels = 4 };
+
+	TimerWheel() : current(0), count(0), ticker(NULL), quitTicker(false) {
+		mutex = SDL_CreateMutex();
+		changed = SDL_CreateCond();
+		for(int i = 0; i < RootSize; ++i) root[i] = NULL;
+		for(int l = 0; l < Levels; ++l)
+			for(int i = 0; i < LevelSize; ++i) levels[l][i] = NULL;
+		current = GetTime().milliseconds();
 	}
-	
-	void breakThread() {
+
+	void schedule(TimerData* data) {
 		ScopedLock lock(mutex);
-		quitSignal = true;
-		SDL_CondSignal(quitCond);
+		if(data->finished) return;
+		if(data->slot) unlink(data);
+		advance(GetTime().milliseconds());
+		data->expires = current + MAX(data->interval, (Uint32)1);
+		add(data);
+
+		if(!ticker && !quitTicker)
+			ticker = threadPool->start(new Ticker(this), "timer wheel");
+		SDL_CondSignal(changed);
 	}
 
-	void startThread() {
-		assert(thread == NULL);
-		
-		struct TimerHandler : Action {
-			TimerData* data;
-			
-			// thread function
-			Result handle() {
-	
-				SDL_mutexP(data->mutex);
-				while(true) {
-					SDL_CondWaitTimeout(data->quitCond, data->mutex, data->interval);
-					
-					bool lastEvent = data->once || data->quitSignal || game.state == Game::S_Quit;
-					onInternTimerSignal.pushToMainQueue(InternTimerEventData(data, lastEvent));
-	
-					if(lastEvent) {
-						SDL_mutexV(data->mutex);
-						// we have to return it here to ensure that this callback is never called again
-						// we also have to ensure that there is only *one* event with lastEvent=true
-						// (and this event has to be of course the last event for this timer in the queue)
-						return true;
-					}
-				}
-		
-				return "should not happen";
+	// Unschedules the timer and pushes its last event, if not done yet
+	void cancel(TimerData* data) {
+		ScopedLock lock(mutex);
+		if(data->slot) unlink(data);
+		if(!data->finished) {
+			data->finished = true;
+			onInternTimerSignal.pushToMainQueue(InternTimerEventData(data, true));
+		}
+	}
+
+	// Only for the destructor of TimerData
+	void forget(TimerData* data) {
+		ScopedLock lock(mutex);
+		if(data->slot) unlink(data);
+	}
+
+	void update() {
+		ScopedLock lock(mutex);
+		advance(GetTime().milliseconds());
+	}
+
+	// Stops the ticker. Running timers get no more events.
+	void shutdown() {
+		ThreadPoolItem* thread = NULL;
+		{
+			ScopedLock lock(mutex);
+			quitTicker = true;
+			SDL_CondSignal(changed);
+			thread = ticker;
+
+			for(int i = 0; i < RootSize; ++i) finishAll(root[i]);
+			for(int l = 0; l < Levels; ++l)
+				for(int i = 0; i < LevelSize; ++i) finishAll(levels[l][i]);
+		}
+		if(thread) threadPool->wait(thread, NULL);
+
+		ScopedLock lock(mutex);
+		ticker = NULL;
+		quitTicker = false; // timers can be started again after a restart
+	}
+
+private:
+	SDL_mutex* mutex;
+	SDL_cond* changed;
+	TimerData* root[RootSize];
+	TimerData* levels[Levels][LevelSize];
+	Uint64 current; // the next tick (ms) to process
+	size_t count;
+	ThreadPoolItem* ticker;
+	bool quitTicker;
+
+	static void link(TimerData** slot, TimerData* data) {
+		data->slot = slot;
+		data->prev = NULL;
+		data->next = *slot;
+		if(*slot) (*slot)->prev = data;
+		*slot = data;
+	}
+
+	void unlink(TimerData* data) {
+		if(data->prev) data->prev->next = data->next;
+		else *data->slot = data->next;
+		if(data->next) data->next->prev = data->prev;
+		data->prev = data->next = NULL;
+		data->slot = NULL;
+		count--;
+	}
+
+	void add(TimerData* data) {
+		count++;
+		const Uint64 e = data->expires;
+		if(e < current) { // overdue, next tick
+			link(&root[current & (RootSize - 1)], data);
+			return;
+		}
+		const Uint64 ticks = e - current;
+		if(ticks < RootSize) {
+			link(&root[e & (RootSize - 1)], data);
+			return;
+		}
+		for(int l = 0; l < Levels; ++l) {
+			const int shift = RootBits + (l + 1) * LevelBits;
+			if(ticks < ((Uint64)1 << shift) || l == Levels - 1) {
+				link(&levels[l][(e >> (shift - LevelBits)) & (LevelSize - 1)], data);
+				return;
 			}
-		
-			TimerHandler(TimerData* d) : data(d) {}
-		};
-		
-		thread = threadPool->start(new TimerHandler(this), name + " timer");
+		}
 	}
-	
+
+	// Moves the timers of the due slot of the level one level down. Returns the slot index.
+	int cascade(int level) {
+		const int shift = RootBits + level * LevelBits;
+		const int index = (int)((current >> shift) & (LevelSize - 1));
+		TimerData* list = levels[level][index];
+		levels[level][index] = NULL;
+		while(list) {
+			TimerData* data = list;
+			list = list->next;
+			data->slot = NULL;
+			count--;
+			add(data);
+		}
+		return index;
+	}
+
+	void advance(Uint64 now) {
+		if(count == 0) {
+			if(now >= current) current = now + 1;
+			return;
+		}
+
+		while(current <= now) {
+			const int index = (int)(current & (RootSize - 1));
+			if(index == 0) {
+				for(int l = 0; l < Levels; ++l)
+					if(cascade(l) != 0) break;
+			}
+
+			TimerData* list = root[index];
+			root[index] = NULL;
+			current++;
+			while(list) {
+				TimerData* data = list;
+				list = list->next;
+				data->slot = NULL;
+				count--;
+				fire(data);
+			}
+
+			if(count == 0 && current <= now)
+				current = now + 1;
+		}
+	}
+
+	void fire(TimerData* data) {
+		// quitSignal is not checked here; quit() removes the timer from the wheel first
+		const bool lastEvent = data->once || game.state == Game::S_Quit;
+		if(lastEvent) data->finished = true;
+		onInternTimerSignal.pushToMainQueue(InternTimerEventData(data, lastEvent));
+		if(!lastEvent) {
+			data->expires = current - 1 + MAX(data->interval, (Uint32)1);
+			add(data);
+		}
+	}
+
+	void finishAll(TimerData*& slot) {
+		while(slot) {
+			TimerData* data = slot;
+			unlink(data);
+			data->finished = true;
+		}
+	}
+
+	// The next tick with something to do: the next occupied root slot or the next cascade.
+	// Returns false if there are no timers.
+	bool nextTick(Uint64& tick) {
+		if(count == 0) return false;
+		for(tick = current; ; ++tick) {
+			if(root[tick & (RootSize - 1)]) return true;
+			if(tick != current && (tick & (RootSize - 1)) == 0) return true;
+		}
+	}
+
+	struct Ticker : Action {
+		TimerWheel* wheel;
+		Ticker(TimerWheel* w) : wheel(w) {}
+
+		Result handle() {
+			ScopedLock lock(wheel->mutex);
+			while(!wheel->quitTicker) {
+				const Uint64 now = GetTime().milliseconds();
+				wheel->advance(now);
+
+				Uint64 tick = 0;
+				if(!wheel->nextTick(tick))
+					SDL_CondWait(wheel->changed, wheel->mutex);
+				else if(tick > now)
+					SDL_CondWaitTimeout(wheel->changed, wheel->mutex, (Uint32)MIN(tick - now, (Uint64)1000));
+			}
+			return true;
+		}
+	};
 };
 
+// Never freed, as timers in global objects can be stopped at any time
+static TimerWheel& timerWheel() {
+	static TimerWheel* wheel = new TimerWheel();
+	return *wheel;
+}
+
+TimerData::~TimerData() {
+	timerWheel().forget(this);
+	SDL_DestroyMutex(mutex); mutex = NULL;
+	RemoveTimerFromGlobalList(this);
+}
+
+void TimerData::schedule() {
+	timerWheel().schedule(this);
+}
+
+void TimerData::quit() {
+	ScopedLock lock(mutex);
+	quitSignal = true;
+	timerWheel().cancel(this);
+}
+
+void ProcessTimers() {
+	timerWheel().update();
+}
+
 // Global list that holds info about headless timers
 // Used to make sure there are no memory leaks
 // TODO: not threadsafe
@@ -222,6 +435,8 @@ void InitializeTimers()
 // Shut down and free all running timers
 void ShutdownTimers()
 {
+	timerWheel().shutdown();
+
 // TODO: not threadsafe
 // TODO: why not std::set?
 	//assert(!EventSystemInited()); // Make sure the event system is shut down (to avoid double freed memory)
@@ -233,7 +448,7 @@ void ShutdownTimers()
 		// Call the user function, because it might free some data
 		Event<Timer::EventData>::Handler& handler = (*it)->timer ? (*it)->timer->onTimer.handler().get() : (*it)->onTimerHandler.get();
 		bool cont = true;
-		(*it)->breakThread();
+		(*it)->quit();
 		if (&handler) // Make sure it exists
 			handler(Timer::EventData(NULL, (*it)->userData, cont));
 
@@ -333,7 +548,7 @@ bool Timer::start()
 		data->name = "unnamed";
 	}
 	
-	data->startThread();
+	data->schedule();
 
 	m_running = true;
 	return true;
@@ -364,7 +579,7 @@ bool Timer::startHeadless()
 		data->once = true;
 	}
 	
-	data->startThread();
+	data->schedule();
 	
 	return true;
 }
@@ -377,7 +592,7 @@ void Timer::stop()
 	if(!m_running) return;
 	
 	SDL_mutexP(m_lastData->mutex);
-	m_lastData->breakThread(); // it will be removed in the last event
+	m_lastData->quit(); // it will be removed in the last event
 	m_lastData->timer = NULL;
 	SDL_mutexV(m_lastData->mutex);
 	
@@ -417,7 +632,7 @@ static void Timer_handleEvent(InternTimerEventData data)
 			}
 			
 			// just to be sure; does not hurt
-			timer_data->breakThread();
+			timer_data->quit();
 		}
 	}
 	SDL_mutexV(timer_data->mutex);
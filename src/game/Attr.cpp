@@ -56,6 +56,8 @@ AttrUpdateByServerScope::~AttrUpdateByServerScope() {
 	attrUpdateByServerScope = false;
 }
 
+void realCopyVar(ScriptVar_t& var);
+
 typedef std::map<AttribRef, const AttrDesc*> AttrDescs;
 static StaticVar<AttrDescs> attrDescs;
 
@@ -70,6 +72,87 @@ void AttrDesc::set(BaseObject* base, const ScriptVar_t& v) const {
 	getValueScriptPtr(base).fromScriptVar(v);
 }
 
+bool AttrDesc::valueEquals(const BaseObject* base, const BaseObject* other) const {
+	if(isStatic && typeOps)
+		return (*typeOps->equals)(getValuePtr(base), getValuePtr(other));
+	return get(base) == get(other);
+}
+
+bool AttrDesc::valueEquals(const BaseObject* base, const ScriptVar_t& v) const {
+	if(isStatic && typeOps)
+		return (*typeOps->equalsVar)(getValuePtr(base), v);
+	if(!isStatic)
+		return dynGetValue(base, this) == v;
+	return get(base) == v;
+}
+
+void AttrDesc::copyValueTo(const BaseObject* base, ScriptVar_t& v) const {
+	if(isStatic && typeOps)
+		(*typeOps->copyToVar)(getValuePtr(base), v);
+	else {
+		v = get(base);
+		realCopyVar(v);
+	}
+}
+
+bool AttrDesc::writeValueToBs(CBytestream* bs, const BaseObject* base, const CustomVar* diffToOld) const {
+	if(isStatic && typeOps)
+		return (*typeOps->writeToBs)(bs, getValuePtr(base), diffToOld);
+	if(!isStatic)
+		return bs->writeVar(dynGetValue(base, this), diffToOld);
+	return bs->writeVar(get(base), diffToOld);
+}
+
+// Same encoding as CBytestream::writeVar
+bool writeAttrValueToBs(CBytestream* bs, bool v) {
+	bs->writeByte(SVT_BOOL);
+	return bs->writeBool(v);
+}
+
+bool writeAttrValueToBs(CBytestream* bs, int32_t v) {
+	bs->writeByte(SVT_INT32);
+	return bs->writeInt(v, 4);
+}
+
+bool writeAttrValueToBs(CBytestream* bs, uint64_t v) {
+	bs->writeByte(SVT_UINT64);
+	return bs->writeUInt64(v);
+}
+
+bool writeAttrValueToBs(CBytestream* bs, float v) {
+	bs->writeByte(SVT_FLOAT);
+	return bs->writeFloat(v);
+}
+
+bool writeAttrValueToBs(CBytestream* bs, const std::string& v) {
+	bs->writeByte(SVT_STRING);
+	return bs->writeString(v);
+}
+
+bool writeAttrValueToBs(CBytestream* bs, Color v) {
+	bs->writeByte(SVT_COLOR);
+	bs->writeByte(v.r);
+	bs->writeByte(v.g);
+	bs->writeByte(v.b);
+	bs->writeByte(v.a);
+	return true;
+}
+
+bool writeAttrValueToBs(CBytestream* bs, const CVec& v) {
+	bs->writeByte(SVT_VEC2);
+	bs->writeFloat(v.x);
+	bs->writeFloat(v.y);
+	return true;
+}
+
+bool writeAttrCustomValueToBs(CBytestream* bs, const CustomVar& v, const CustomVar* diffToOld) {
+	assert(v.thisRef.classId != ClassId(-1));
+	if(diffToOld)
+		assert(v.thisRef.classId == diffToOld->thisRef.classId);
+	bs->writeByte(SVT_CustomWeakRefToStatic);
+	return v.ToBytestream(bs, diffToOld);
+}
+
 bool AttrDesc::authorizedToWrite(const BaseObject* base) const {
 	assert(base != NULL);
 	if(this == Game::state_Type::attrDesc()) { // small exception for game.state
@@ -235,12 +318,12 @@ typedef std::vector< WeakRef<BaseObject> > ObjUpdates;
 static StaticVar<ObjUpdates> objUpdates;
 static StaticVar<Mutex> objUpdatesMutex;
 
+static uint64_t attrWriteCounter = 0;
+
 static void pushObjAttrUpdate(BaseObject& obj) {
 	objUpdates->push_back(obj.thisRef.obj);
 }
 
-void realCopyVar(ScriptVar_t& var);
-
 #ifdef DEBUG
 struct CallInfo {
 	std::vector<void*> callstack;
@@ -335,12 +418,12 @@ void pushObjAttrUpdate(BaseObject& obj, const AttrDesc* attrDesc) {
 	if(obj.attrUpdates.empty())
 		pushObjAttrUpdate(obj);
 	AttrExt& ext = attrDesc->getAttrExt(&obj);
+	ext.version = ++attrWriteCounter;
 	if(!ext.updated || obj.attrUpdates.empty()) {
-		AttrUpdateInfo info;
+		obj.attrUpdates.push_back(AttrUpdateInfo());
+		AttrUpdateInfo& info = obj.attrUpdates.back();
 		info.attrDesc = attrDesc;
-		info.oldValue = attrDesc->get(&obj);
-		realCopyVar(info.oldValue);
-		obj.attrUpdates.push_back(info);
+		attrDesc->copyValueTo(&obj, info.oldValue);
 		ext.updated = true;
 	}
 }
@@ -379,7 +462,7 @@ void iterAttrUpdates(boost::function<void(BaseObject*, const AttrDesc* attrDesc,
 			ScriptVar_t& oldValue = u->oldValue;
 
 			attrDesc->getAttrExt(oPt).updated = false;
-			if(oldValue == attrDesc->get(oPt)) continue;
+			if(attrDesc->valueEquals(oPt, oldValue)) continue;
 
 			if(oPt->thisRef) // if registered
 				game.gameStateUpdates->pushObjAttrUpdate(ObjAttrRef(oPt->thisRef, attrDesc));
@@ -22,10 +22,78 @@
 class CBytestream;
 class CServerConnection;
 
+bool writeAttrValueToBs(CBytestream* bs, bool v);
+bool writeAttrValueToBs(CBytestream* bs, int32_t v);
+bool writeAttrValueToBs(CBytestream* bs, uint64_t v);
+bool writeAttrValueToBs(CBytestream* bs, float v);
+bool writeAttrValueToBs(CBytestream* bs, const std::string& v);
+bool writeAttrValueToBs(CBytestream* bs, Color v);
+bool writeAttrValueToBs(CBytestream* bs, const CVec& v);
+bool writeAttrCustomValueToBs(CBytestream* bs, const CustomVar& v, const CustomVar* diffToOld);
+
 struct AttrExt {
 	bool updated;
 	bool S2CupdateNeeded;
-	AttrExt() : updated(false), S2CupdateNeeded(false) {}
+	// Set from a global counter on every write access (see pushObjAttrUpdate).
+	// If it didn't change, the value didn't change either.
+	uint64_t version;
+	AttrExt() : updated(false), S2CupdateNeeded(false), version(0) {}
+};
+
+// Operations on the raw value memory of a static attrib.
+// They are generated by the ATTR macro and work without boxing into ScriptVar_t.
+struct AttrTypeOps {
+	bool (*equals)(const void* value, const void* other);
+	bool (*equalsVar)(const void* value, const ScriptVar_t& var);
+	// Copies into var. var keeps its memory if it is already of the same type.
+	void (*copyToVar)(const void* value, ScriptVar_t& var);
+	// Same encoding as CBytestream::writeVar
+	bool (*writeToBs)(CBytestream* bs, const void* value, const CustomVar* diffToOld);
+};
+
+template<typename T, bool IsCustom = (GetType<T>::value == SVT_CustomWeakRefToStatic)>
+struct AttrTypeOpsFor {
+	static const T& val(const void* value) { return *(const T*)value; }
+	static bool equals(const void* value, const void* other) { return val(value) == val(other); }
+	static bool equalsVar(const void* value, const ScriptVar_t& var) {
+		if(var.type != GetType<T>::value) return ScriptVar_t(val(value)) == var;
+		return val(value) == *var.ptr<T>();
+	}
+	static void copyToVar(const void* value, ScriptVar_t& var) {
+		if(var.type == GetType<T>::value) *var.ptr<T>() = val(value);
+		else var = ScriptVar_t(val(value));
+	}
+	static bool writeToBs(CBytestream* bs, const void* value, const CustomVar*) {
+		return writeAttrValueToBs(bs, val(value));
+	}
+	static const AttrTypeOps* ops() {
+		static const AttrTypeOps o = { &equals, &equalsVar, &copyToVar, &writeToBs };
+		return &o;
+	}
+};
+
+template<typename T>
+struct AttrTypeOpsFor<T, true> {
+	static const CustomVar& val(const void* value) { return *static_cast<const CustomVar*>((const T*)value); }
+	static bool equals(const void* value, const void* other) { return val(value) == val(other); }
+	static bool equalsVar(const void* value, const ScriptVar_t& var) {
+		if(!var.isCustomType() || var.customVar() == NULL) return false;
+		return val(value) == *var.customVar();
+	}
+	static void copyToVar(const void* value, ScriptVar_t& var) {
+		// SVT_CUSTOM owns its object, so we can overwrite it
+		if(var.type == SVT_CUSTOM && var.customVar()->thisRef.classId == val(value).thisRef.classId)
+			var.customVar()->copyFrom(val(value));
+		else
+			var = ScriptVar_t(val(value).getRefCopy());
+	}
+	static bool writeToBs(CBytestream* bs, const void* value, const CustomVar* diffToOld) {
+		return writeAttrCustomValueToBs(bs, val(value), diffToOld);
+	}
+	static const AttrTypeOps* ops() {
+		static const AttrTypeOps o = { &equals, &equalsVar, &copyToVar, &writeToBs };
+		return &o;
+	}
 };
 
 struct AttrDesc {
@@ -36,7 +104,8 @@ struct AttrDesc {
 	bool isStatic; // if true -> use memOffsets; otherwise, dyn funcs
 	intptr_t attrMemOffset;
 	intptr_t attrExtMemOffset;
-	boost::function<ScriptVar_t (const BaseObject* base, const AttrDesc* attrDesc)> dynGetValue;
+	const AttrTypeOps* typeOps; // only for static
+	boost::function<const ScriptVar_t& (const BaseObject* base, const AttrDesc* attrDesc)> dynGetValue;
 	boost::function<AttrExt& (BaseObject* base, const AttrDesc* attrDesc)> dynGetAttrExt;
 	std::string attrName;
 	AttrId attrId;
@@ -47,7 +116,7 @@ struct AttrDesc {
 	boost::function<void(BaseObject* base, const AttrDesc* attrDesc, ScriptVar_t oldValue)> onUpdate;
 	
 	AttrDesc()
-	: objTypeId(0), attrType(SVT_INVALID), isStatic(true), attrMemOffset(0), attrExtMemOffset(0), attrId(0),
+	: objTypeId(0), attrType(SVT_INVALID), isStatic(true), attrMemOffset(0), attrExtMemOffset(0), typeOps(NULL), attrId(0),
 	  serverside(true), serverCanUpdate(true) {}
 	std::string description() const;
 
@@ -55,6 +124,10 @@ struct AttrDesc {
 		assert(isStatic);
 		return (void*)(uintptr_t(base) + attrMemOffset);
 	}
+	template<typename T> const T& getTyped(const BaseObject* base) const {
+		assert(isStatic && attrType == GetType<T>::value);
+		return *(const T*)getValuePtr(base);
+	}
 	ScriptVarPtr_t getValueScriptPtr(BaseObject* base) const {
 		return ScriptVarPtr_t(attrType, (void*)getValuePtr(base), defaultValue);
 	}
@@ -73,6 +146,15 @@ struct AttrDesc {
 	}
 	void set(BaseObject* base, const ScriptVar_t& v) const;
 
+	// The typed ops if we have them, otherwise via ScriptVar_t
+	bool valueEquals(const BaseObject* base, const BaseObject* other) const;
+	bool valueEquals(const BaseObject* base, const ScriptVar_t& v) const;
+	void copyValueTo(const BaseObject* base, ScriptVar_t& v) const;
+	bool writeValueToBs(CBytestream* bs, const BaseObject* base, const CustomVar* diffToOld = NULL) const;
+	// If true, AttrExt::version tells about every change.
+	// Custom vars can also change via their own attribs, so they are not.
+	bool isVersioned() const { return isStatic && typeOps && attrType != SVT_CustomWeakRefToStatic; }
+
 	bool authorizedToWrite(const BaseObject* base) const;
 	bool shouldUpdate(const BaseObject* base) const;
 };
@@ -269,6 +351,7 @@ struct _ ## name ## _AttrDesc ## id : AttrDesc { \
 		attrMemOffset = (intptr_t)__OLX_OFFSETOF(parentType, name); \
 		struct Dummy { type x; AttrExt ext; }; \
 		attrExtMemOffset = (intptr_t)__OLX_OFFSETOF(Dummy, ext); \
+		typeOps = AttrTypeOpsFor<type>::ops(); \
 		attrName = #name ; \
 		attrId = id; \
 		defaultValue = ScriptVar_t(GetType<type>::defaultValue()); \
@@ -64,6 +64,17 @@ public:
 	virtual bool isInside(int x, int y) const;
 	virtual IVec size() const { return IVec(); }
 
+	// Render interpolation: the positions of the last two simulation frames,
+	// captured by Game::snapshotRenderState().
+	void		snapshotRenderPos(uint64_t frame);
+	CVec		interpolatedPos() const;
+
+private:
+	CVec		vSnapshotPos[2];
+	uint64_t	snapshotFrame;
+	int			snapshotCount;
+public:
+
 	virtual Color renderColorAt(/* relative coordinates */ int x, int y) const { return Color(0,0,0,SDL_ALPHA_TRANSPARENT); }
 	
 	
@@ -82,6 +93,10 @@ public:
 	//virtual void draw(ALLEGRO_BITMAP* where, int xOff, int yOff) {}
 	virtual void draw(CViewport* viewport)
 	{}
+	// The rect in destination coordinates which draw() paints into, used to cull the object.
+	// False if it can paint outside of it (lines, distortions, lights).
+	virtual bool getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h)
+	{ return false; }
 #endif
 	// All the object logic here
 	virtual void think()
@@ -28,6 +28,7 @@
 #include "Color.h"
 #include "MathLib.h" // for SIGN
 #include "gusanos/level.h"
+#include "gusanos/terrain_field.h"
 #include "level/LXMapFlags.h"
 #include "CodeAttributes.h"
 
@@ -63,15 +64,18 @@ class ML_CommanderKeen123;
 struct ML_Gusanos;
 struct ML_Teeworlds;
 struct VermesLevelLoader;
+struct BakedMapCache;
 
 class CMap {
 	friend class MapLoad;
 	friend class ML_OrigLiero;
 	friend class ML_LieroX;
+	friend class LxImageDecoder;
 	friend class ML_CommanderKeen123;
 	friend struct ML_Gusanos;
 	friend struct ML_Teeworlds;
 	friend struct VermesLevelLoader;
+	friend struct BakedMapCache;
 	
 private:
 	// just don't do that
@@ -112,6 +116,8 @@ public:
 		savedPixelFlags = NULL;
 		savedMapCoords.clear();
 		
+		imageResetSerial = 0;
+		
 		gusInit();
    	}
 
@@ -246,6 +252,7 @@ private:
 	// not thread-safe, therefore private	
 	INLINE void	unsafeSetPixelFlag(long x, long y, uchar flag) {
 		material->line[y][x] = (char) Material::indexFromLxFlag(flag);
+		m_terrainField.invalidatePixel(x, y);
 	}
 	
 	INLINE void	SetPixelFlag(long x, long y, uchar flag, bool wrapAround = false) {
@@ -267,6 +274,22 @@ public:
 
 	size_t GetMemorySize();
 
+	// Log of changed level image areas (map coordinates), for the viewport layer caches
+	struct ImageChange {
+		uint64_t serial;
+		int x, y, w, h;
+	};
+private:
+	std::vector<ImageChange> imageChanges;
+	uint64_t	imageResetSerial; // everything changed with this serial
+public:
+	void		markImageDirty(int x, int y, int w, int h);
+	void		resetImageChanges();
+	uint64_t	imageSerial() const;
+	uint64_t	imageGeneration() const { return imageResetSerial; }
+	// Collects the areas changed after serial. Returns false if they are not all known anymore.
+	bool		imageChangesSince(uint64_t serial, std::vector<ImageChange>& changes) const;
+
 	int WrapAroundX(int x) const {
 		x %= (int)Width;
 		if(x < 0) x += Width;
@@ -521,8 +544,11 @@ public:
 	
 	void putMaterial( unsigned char index, unsigned int x, unsigned int y )
 	{
-		if(x < static_cast<unsigned int>(material->w) && y < static_cast<unsigned int>(material->h))
+		if(x < static_cast<unsigned int>(material->w) && y < static_cast<unsigned int>(material->h)) {
+			if(m_materialList[(unsigned char)material->line[y][x]].particle_pass != m_materialList[index].particle_pass)
+				m_terrainField.invalidatePixel(x, y);
 			material->line[y][x] = index;
+		}
 	}
 	
 	void putMaterial( Material const& mat, unsigned int x, unsigned int y )
@@ -553,6 +579,12 @@ public:
 	void culledDrawLight(Sprite* sprite, CViewport* viewport, const IVec& pos, int alpha);
 	
 #endif
+	// Collision correction for a particle with the given radius, see TerrainField
+	bool particleCorrection(const Vec& pos, float radius, Vec& correction)
+	{
+		return m_terrainField.correction(*this, pos, radius, correction);
+	}
+	
 	// applies the effect and returns true if it actually changed something on the map
 	bool applyEffect( LevelEffect* effect, int x, int y);
 	
@@ -596,13 +628,25 @@ private:
 	
 	void checkWBorders( int x, int y );
 	
+	void resetWater();
+	void addWater( const WaterParticle& wp );
+	void waterThink();
+	void waterThinkChunk( size_t index );
+	Result waterThinkChunks( const std::vector<size_t>* chunks, size_t first, size_t step );
+	void waterWake( WaterChunk& chunk, int x, int y );
+	void waterPut( WaterChunk& chunk, unsigned char index, int x, int y );
+	void waterFlush( size_t index );
+	
 	array<Material, 256> m_materialList;
+	TerrainField m_terrainField;
 	
 	LevelConfig *m_config;
 	bool m_firstFrame;
 	bool m_gusLoaded;
 	
-	std::list<WaterParticle> m_water;
+	std::vector<WaterChunk> m_waterChunks;
+	std::vector<size_t> m_activeWaterChunks;
+	int m_waterChunksX, m_waterChunksY;
 	
 };
 
@@ -22,6 +22,7 @@
 #include "OLXCommand.h"
 #include "IRC.h"
 #include "CClient.h"
+#include "CProjectile.h"
 #include "CServer.h"
 #include "Physics.h"
 #include "DeprecatedGUI/Menu.h"
@@ -49,6 +50,8 @@
 #include "GameState.h"
 #include "DeprecatedGUI/CBrowser.h"
 #include "gusanos/LuaCallbacks.h"
+#include "FrameProfiler.h"
+#include "Metrics.h"
 
 #include <boost/shared_ptr.hpp>
 #include <boost/lambda/lambda.hpp>
@@ -74,6 +77,8 @@ Game::Game() {
 	thisRef.objId = 1;
 	m_isServer = false;
 	m_isLocalGame = false;
+	m_renderSnapshotFrame = 0;
+	m_renderInterpolation = 1.0f;
 	m_wpnRest = new CWpnRest();
 	gameStateUpdates = new GameStateUpdates;
 }
@@ -668,6 +673,8 @@ struct GusSpeedScope {
 
 void Game::frame() {
 	SetCrashHandlerReturnPoint("main game loop");
+	PROFILE_ZONE("Game::frame");
+	const Uint64 frameStart = FrameProfiler::now();
 
 	// Timing
 	tLX->currentTime = GetTime();
@@ -675,6 +682,7 @@ void Game::frame() {
 	tLX->fRealDeltaTime = tLX->fDeltaTime;
 	oldtime = tLX->currentTime;
 
+	ProcessTimers();
 	ProcessEvents();
 
 	// Main frame
@@ -692,8 +700,22 @@ void Game::frame() {
 
 	if(DbgSimulateSlow) SDL_Delay(700);
 
-	doVideoFrameInMainThread();
-	CapFPS();
+	{
+		PROFILE_ZONE("video");
+		doVideoFrameInMainThread();
+	}
+
+	// Collect the Lua garbage in the time which is left of this frame
+	if(luaIngame)
+		luaIngame.gcFrame(tLXOptions->iLuaGCBudget);
+
+	Metrics::processServer();
+	Metrics::frameDone(FrameProfiler::now() - frameStart);
+
+	{
+		PROFILE_ZONE("idle");
+		CapFPS();
+	}
 }
 
 
@@ -702,6 +724,7 @@ void Game::frame() {
 // Game loop
 void Game::frameInner()
 {
+	PROFILE_ZONE("Game::frameInner");
 	HandlePendingCommands();
 	
 	if(bDedicated)
@@ -874,13 +897,17 @@ void Game::frameInner()
 		tLX->fRealDeltaTime = TimeDiff(Game::FixedFrameTime);
 		while(tLX->currentTime < curTime) {
 
+			Metrics::simulationDelay((int)simulationDelay().milliseconds(), hasHighSimulationDelay());
+
 			if(hasSeriousHighSimulationDelay()) {
 				TimeDiff simDelay = simulationDelay();
 				if(simDelay > 0.5f)
 					warnings << "deltatime " << simDelay.seconds() << " is too high" << endl;
 				// Don't do anything anymore, just skip.
 				// Also don't increment serverFrame so clients know about this.
-				tLX->currentTime += TimeDiff(simDelay.milliseconds() - simDelay.milliseconds() % Game::FixedFrameTime);
+				const Uint64 skipped = simDelay.milliseconds() - simDelay.milliseconds() % Game::FixedFrameTime;
+				Metrics::simulationSkipped((int)skipped);
+				tLX->currentTime += TimeDiff(skipped);
 				continue;
 			}
 
@@ -905,17 +932,26 @@ void Game::frameInner()
 				cServer->Frame();
 
 			tLX->currentTime += TimeDiff(Game::FixedFrameTime);
+			snapshotRenderState();
 		}
 		simulationTime = tLX->currentTime;
 		tLX->currentTime = curTime;
 		tLX->fDeltaTime = curDeltaTime;
+
+		// The simulation is ahead of the real time by less than one frame.
+		// Draw the state between the last two simulation frames at real time.
+		m_renderInterpolation = 1.0f;
+		if(tLXOptions->bRenderInterpolation && simulationTime >= curTime)
+			m_renderInterpolation = CLAMP(1.0f - (float)(simulationTime - curTime).milliseconds() / (float)Game::FixedFrameTime, 0.0f, 1.0f);
 	}
 
 	const bool stateUpdated = state.ext.updated;
 	iterAttrUpdates(NULL);
 
-	if(tLX && !stateUpdated && state >= Game::S_Preparing)
+	if(tLX && !stateUpdated && state >= Game::S_Preparing) {
+		PROFILE_ZONE("render");
 		cClient->Draw(VideoPostProcessor::videoSurface());
+	}
 
 	if(state > Game::S_Inactive) {
 		// Gusanos network
@@ -948,6 +984,21 @@ void Game::frameInner()
 }
 
 
+// Called after every simulation frame. Keeps the positions of the last two
+// frames so that drawing can interpolate in between.
+void Game::snapshotRenderState() {
+	if(bDedicated || !tLXOptions->bRenderInterpolation) return;
+
+	m_renderSnapshotFrame++;
+	for_each_iterator(CWorm*, w, worms())
+		w->get()->snapshotRenderPos(m_renderSnapshotFrame);
+	for(Iterator<CProjectile*>::Ref p = cClient->getProjectiles().begin(); p->isValid(); p->next())
+		p->get()->snapshotRenderPos(m_renderSnapshotFrame);
+	for(Grid::iterator iter = objects.beginAll(); iter; ++iter)
+		iter->snapshotRenderPos(m_renderSnapshotFrame);
+}
+
+
 void Game::cleanupAfterGameloopEnd() {
 	gameWasPrepared = false;
 	CrashHandler::recoverAfterCrash = false;
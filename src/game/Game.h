@@ -173,6 +173,11 @@ public:
 
 	bool allowedToSleepForEvent();
 
+	// Render interpolation between the last two simulation frames, see CGameObject::interpolatedPos()
+	void		snapshotRenderState();
+	uint64_t	renderSnapshotFrame() const { return m_renderSnapshotFrame; }
+	float		renderInterpolation() const { return m_renderInterpolation; }
+
 private:
 	static void onStateUpdate(BaseObject*,const AttrDesc*,ScriptVar_t);
 	static void onGameOverUpdate(BaseObject*,const AttrDesc*,ScriptVar_t);
@@ -189,6 +194,8 @@ private:
 	uint64_t menuFrame;
 	AbsTime oldtime;
 	AbsTime simulationTime;
+	uint64_t m_renderSnapshotFrame;
+	float m_renderInterpolation;
 	SmartPointer<CMap> m_gameMap;
 	SmartPointer<CGameScript> m_gameMod;
 	SmartPointer<CGameMode> m_gameMode;
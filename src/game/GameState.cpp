@@ -24,6 +24,13 @@ ScriptVar_t ObjectState::getValue(AttribRef a) const {
 	return it->second.value;
 }
 
+const AttribState* ObjectState::getAttrib(AttribRef a) const {
+	Attribs::const_iterator it = attribs.find(a);
+	if(it == attribs.end())
+		return NULL;
+	return &it->second;
+}
+
 GameStateUpdates::operator bool() const {
 	if(!objs.empty()) return true;
 	if(!objCreations.empty()) return true;
@@ -45,15 +52,19 @@ void GameStateUpdates::writeToBs(CBytestream* bs, const GameState& oldState) con
 	bs->writeInt((uint32_t)objs.size(), 4);
 	const_foreach(a, objs) {
 		const ObjAttrRef& attr = *a;
-		ScriptVar_t curValue = a->get();
+		const BaseObject* obj = attr.obj.obj.get();
+		assert(obj != NULL);
+		const AttrDesc* attrDesc = attr.attr.getAttrDesc();
+		assert(attrDesc != NULL);
 		attr.writeToBs(bs);
-		if((attr.attr.getAttrDesc()->attrType == SVT_CustomWeakRefToStatic || attr.attr.getAttrDesc()->attrType == SVT_CUSTOM) && oldState.haveObject(attr.obj)) {
-			ScriptVar_t oldValue = oldState.getValue(attr);
+		if((attrDesc->attrType == SVT_CustomWeakRefToStatic || attrDesc->attrType == SVT_CUSTOM) && oldState.haveObject(attr.obj)) {
+			const AttribState* oldAttr = oldState.getAttrib(attr);
+			const ScriptVar_t& oldValue = oldAttr ? oldAttr->value : attrDesc->defaultValue;
 			assert(oldValue.isCustomType());
-			bs->writeVar(curValue, oldValue.customVar());
+			attrDesc->writeValueToBs(bs, obj, oldValue.customVar());
 		}
 		else
-			bs->writeVar(curValue);
+			attrDesc->writeValueToBs(bs, obj);
 	}
 }
 
@@ -268,7 +279,7 @@ void GameStateUpdates::handleFromBs(CBytestream* bs, CServerConnection* source)
 			}
 			BaseObject* o = getObjFromRef(r.obj, true);
 			assert(o);
-			source->gameState->setObjAttr(r, r.attr.getAttrDesc()->get(o));
+			source->gameState->setObjAttr(r, o);
 		}
 	}
 }
@@ -312,13 +323,12 @@ void GameStateUpdates::diffFromStateToCurrent(const GameState& s) {
 		assert(attrDesc != NULL);
 		if(!attrDesc->shouldUpdate(obj)) continue;
 
-		attrDesc->getAttrExt(obj).S2CupdateNeeded = false;
+		AttrExt& ext = attrDesc->getAttrExt(obj);
+		ext.S2CupdateNeeded = false;
 
-		ScriptVar_t curValue = u->get();
-		ScriptVar_t stateValue = attrDesc->defaultValue;
-		if(s.haveObject(u->obj))
-			stateValue = s.getValue(*u);
-		if(curValue == stateValue) continue;
+		const AttribState* state = s.getAttrib(*u);
+		if(state && attrDesc->isVersioned() && state->version == ext.version) continue;
+		if(attrDesc->valueEquals(obj, state ? state->value : attrDesc->defaultValue)) continue;
 
 		/*if(attrDesc->attrName != "serverFrame")
 			notes << "send update " << u->description() << ": " << stateValue.toString() << " -> " << curValue.toString() << endl;*/
@@ -354,16 +364,38 @@ void GameState::reset() {
 	*this = GameState();
 }
 
-void realCopyVar(ScriptVar_t& var);
-
 void GameState::updateToCurrent() {
-	reset();
+	// Keep the attrib states which we have already, so that we can
+	// skip the unchanged ones and reuse the memory of the others.
+	for(Objs::iterator it = objs.begin(); it != objs.end(); ) {
+		const ObjRef& o = it->first;
+		bool singleton = o == game.thisRef || o == gameSettings.thisRef;
+		if(!singleton && game.gameStateUpdates->objCreations.find(o) == game.gameStateUpdates->objCreations.end())
+			objs.erase(it++);
+		else
+			++it;
+	}
 	foreach(o, game.gameStateUpdates->objCreations) {
-		addObject(*o);
+		if(!haveObject(*o))
+			addObject(*o);
+	}
+	foreach(o, objs) {
+		// an object might have been deleted and recreated in the meantime
+		ObjectState::Attribs& attribs = o->second.attribs;
+		for(ObjectState::Attribs::iterator a = attribs.begin(); a != attribs.end(); ) {
+			ObjAttrRef r;
+			r.obj = o->first;
+			r.attr = a->first;
+			if(game.gameStateUpdates->objs.find(r) == game.gameStateUpdates->objs.end())
+				attribs.erase(a++);
+			else
+				++a;
+		}
 	}
 	foreach(u, game.gameStateUpdates->objs) {
-		ObjAttrRef r = *u;
-		setObjAttr(r, r.get());
+		const BaseObject* obj = u->obj.obj.get();
+		assert(obj != NULL);
+		setObjAttr(*u, obj);
 	}
 }
 
@@ -377,13 +409,20 @@ void GameState::removeObject(ObjRef o) {
 	objs.erase(o);
 }
 
-void GameState::setObjAttr(ObjAttrRef r, ScriptVar_t value) {
+void GameState::setObjAttr(ObjAttrRef r, const BaseObject* current) {
 	Objs::iterator it = objs.find(r.obj);
 	assert(it != objs.end());
 	ObjectState& s = it->second;
 	assert(s.obj == it->first);
-	s.attribs[r.attr].value = value;
-	realCopyVar(s.attribs[r.attr].value);
+	const AttrDesc* attrDesc = r.attr.getAttrDesc();
+	assert(attrDesc != NULL);
+	AttribState& a = s.attribs[r.attr];
+	if(attrDesc->isVersioned()) {
+		const uint64_t version = attrDesc->getAttrExt((BaseObject*)current).version;
+		if(a.version == version && version != 0) return;
+		a.version = version;
+	}
+	attrDesc->copyValueTo(current, a.value);
 }
 
 bool GameState::haveObject(ObjRef o) const {
@@ -398,3 +437,10 @@ ScriptVar_t GameState::getValue(ObjAttrRef a) const {
 	return it->second.getValue(a.attr);
 }
 
+const AttribState* GameState::getAttrib(ObjAttrRef a) const {
+	Objs::const_iterator it = objs.find(a.obj);
+	if(it == objs.end()) return NULL;
+	assert(it->second.obj == a.obj);
+	return it->second.getAttrib(a.attr);
+}
+
@@ -24,6 +24,8 @@ class CServerConnection;
 
 struct AttribState {
 	ScriptVar_t value;
+	uint64_t version; // AttrExt::version of the value, if AttrDesc::isVersioned()
+	AttribState() : version(0) {}
 };
 
 struct ObjectState {
@@ -36,6 +38,7 @@ struct ObjectState {
 	ObjectState(ObjRef obj_) : obj(obj_) {}
 	ObjectState(BaseObject* obj_) : obj(obj_->thisRef) {}
 	ScriptVar_t getValue(AttribRef) const;
+	const AttribState* getAttrib(AttribRef) const;
 };
 
 struct GameStateUpdates {
@@ -66,10 +69,12 @@ struct GameState {
 	void updateToCurrent();
 	void addObject(ObjRef);
 	void removeObject(ObjRef);
-	void setObjAttr(ObjAttrRef, ScriptVar_t);
+	void setObjAttr(ObjAttrRef, const BaseObject* current);
 
 	bool haveObject(ObjRef) const;
 	ScriptVar_t getValue(ObjAttrRef) const;
+	// NULL if we don't have the object or the attrib is not set
+	const AttribState* getAttrib(ObjAttrRef) const;
 };
 
 
@@ -663,8 +663,81 @@ server_t::Ptr ServerList::findServerStr(const std::string& szAddress, const std:
 }
 
 
+// One row of the server listview
+struct SvrListRow {
+	struct Cell {
+		int type;
+		std::string text;
+		SmartPointer<SDL_Surface> image;
+		std::string tooltip;
+	};
+	Color colour;
+	std::vector<Cell> cells;
+
+	void add(int type, const std::string& text, const SmartPointer<SDL_Surface>& image = NULL, const std::string& tooltip = "") {
+		// The listview ignores images without surface
+		if (type == DeprecatedGUI::LVS_IMAGE && !image.get())
+			return;
+		Cell c;
+		c.type = type;
+		c.text = text;
+		c.image = image;
+		c.tooltip = tooltip;
+		cells.push_back(c);
+	}
+};
+
+static void addRow(DeprecatedGUI::CListview *lv, const std::string& index, const SvrListRow& row)
+{
+	lv->AddItem(index, 0, row.colour);
+	for (std::vector<SvrListRow::Cell>::const_iterator c = row.cells.begin(); c != row.cells.end(); ++c) {
+		if (c->type == DeprecatedGUI::LVS_IMAGE)
+			lv->AddSubitem(DeprecatedGUI::LVS_IMAGE, c->text, c->image, NULL, DeprecatedGUI::VALIGN_MIDDLE, c->tooltip);
+		else
+			lv->AddSubitem(c->type, c->text, (DynDrawIntf*)NULL, NULL, DeprecatedGUI::VALIGN_MIDDLE, c->tooltip);
+	}
+}
+
+// Updates the item in place. Returns false if it has other cells and has to be recreated.
+// changed is set if anything visible changed
+static bool updateRow(DeprecatedGUI::lv_item_t *item, const SvrListRow& row, bool& changed)
+{
+	changed = false;
+
+	// Check the layout
+	DeprecatedGUI::lv_subitem_t *sub = item->tSubitems;
+	std::vector<SvrListRow::Cell>::const_iterator c = row.cells.begin();
+	for (; sub && c != row.cells.end(); sub = sub->tNext, ++c)
+		if (sub->iType != c->type)
+			return false;
+	if (sub || c != row.cells.end())
+		return false;
+
+	if (item->iColour != row.colour) {
+		item->iColour = row.colour;
+		changed = true;
+	}
+
+	for (sub = item->tSubitems, c = row.cells.begin(); sub; sub = sub->tNext, ++c) {
+		if (sub->sText == c->text && sub->sTooltip == c->tooltip && sub->iColour == row.colour)
+			continue;
+
+		// Images are identified by their text (ping) or tooltip (country flag)
+		if (c->type == DeprecatedGUI::LVS_IMAGE && (sub->sText != c->text || sub->sTooltip != c->tooltip))
+			sub->bmpImage = DynDrawFromSurface(c->image);
+		sub->sText = c->text;
+		sub->sTooltip = c->tooltip;
+		sub->iColour = row.colour;
+		changed = true;
+	}
+
+	return true;
+}
+
 ///////////////////
 // Fill a listview box with the server list
+// The listview is only updated where it differs from the server list, so the selection stays and
+// a refresh doesn't rebuild (and re-sort) the whole list
 void ServerList::fillList(DeprecatedGUI::CListview *lv, SvrListFilterType filterType, SvrListSettingsFilter::Ptr settingsFilter)
 {
 	if (!lv)
@@ -673,11 +746,18 @@ void ServerList::fillList(DeprecatedGUI::CListview *lv, SvrListFilterType filter
 	std::string		addr;
 	static const std::string states[] = {"Open", "Loading", "Playing", "Open/Loading", "Open/Playing"};
 	
-    // Store the ID of the currently selected item
-    int curID = lv->getSelectedID();
-	
 	lv->SaveScrollbarPos();
-	lv->Clear();
+	
+	// The current rows by address, duplicates are removed
+	typedef std::map<std::string, DeprecatedGUI::lv_item_t*> Rows;
+	Rows rows;
+	std::vector<DeprecatedGUI::lv_item_t*> unused;
+	for (DeprecatedGUI::lv_item_t *item = lv->getItems(); item; item = item->tNext)
+		if (!rows.insert(Rows::value_type(item->sIndex, item)).second)
+			unused.push_back(item);
+	
+	// Rows which have to be moved to their place in the sorting
+	std::vector<DeprecatedGUI::lv_item_t*> changedRows;
 	
 	SvrList::type serverList;
 	{
@@ -724,37 +804,36 @@ void ServerList::fillList(DeprecatedGUI::CListview *lv, SvrListFilterType filter
 			state += 2;
 		
 		// Colour
-		Color colour = tLX->clListView;
+		SvrListRow row;
+		row.colour = tLX->clListView;
 		if(processing)
-			colour = tLX->clDisabled;
+			row.colour = tLX->clDisabled;
 		
 		
-		// Add the server to the list
-		lv->AddItem(s->szAddress, 0, colour);
-		lv->AddSubitem(DeprecatedGUI::LVS_IMAGE, itoa(num,10), DeprecatedGUI::tMenu->bmpConnectionSpeeds[num], NULL);
-		lv->AddSubitem(DeprecatedGUI::LVS_TEXT, s->szName, (DynDrawIntf*)NULL, NULL);
+		// The cells of the server
+		row.add(DeprecatedGUI::LVS_IMAGE, itoa(num,10), DeprecatedGUI::tMenu->bmpConnectionSpeeds[num]);
+		row.add(DeprecatedGUI::LVS_TEXT, s->szName);
         if(processing) {
 			if(IsNetAddrValid(s->sAddress))
-				lv->AddSubitem(DeprecatedGUI::LVS_TEXT, "Querying...", (DynDrawIntf*)NULL, NULL);
+				row.add(DeprecatedGUI::LVS_TEXT, "Querying...");
 			else
-				lv->AddSubitem(DeprecatedGUI::LVS_TEXT, "Lookup...", (DynDrawIntf*)NULL, NULL);
+				row.add(DeprecatedGUI::LVS_TEXT, "Lookup...");
         } else if( num == 3 )
-            lv->AddSubitem(DeprecatedGUI::LVS_TEXT, "Down", (DynDrawIntf*)NULL, NULL);
+            row.add(DeprecatedGUI::LVS_TEXT, "Down");
         else
-		    lv->AddSubitem(DeprecatedGUI::LVS_TEXT, states[state], (DynDrawIntf*)NULL, NULL);
+		    row.add(DeprecatedGUI::LVS_TEXT, states[state]);
 		
 		bool unknownData = ( s->bProcessing || num == 3 ) && 
 			!getUdpMasterserverForServer( s->szAddress );
 		
 		// Players
-		lv->AddSubitem(DeprecatedGUI::LVS_TEXT,
-					   unknownData ? "?" : (itoa(s->nNumPlayers,10)+"/"+itoa(s->nMaxPlayers,10)),
-					   (DynDrawIntf*)NULL, NULL);
+		row.add(DeprecatedGUI::LVS_TEXT,
+					   unknownData ? "?" : (itoa(s->nNumPlayers,10)+"/"+itoa(s->nMaxPlayers,10)));
 		
 		if (s->nPing <= -2) // Server behind a NAT or not queried, it will add spaces if s->nPing == -3 so not queried servers will be below NAT ones
-			lv->AddSubitem(DeprecatedGUI::LVS_TEXT, "N/A" + std::string(' ', -2 - s->nPing), (DynDrawIntf*)NULL, NULL);
+			row.add(DeprecatedGUI::LVS_TEXT, "N/A" + std::string(' ', -2 - s->nPing));
 		else
-			lv->AddSubitem(DeprecatedGUI::LVS_TEXT, unknownData ? "∞" : itoa(s->nPing,10), (DynDrawIntf*)NULL, NULL); // TODO: the infinity symbol isn't shown correctly
+			row.add(DeprecatedGUI::LVS_TEXT, unknownData ? "∞" : itoa(s->nPing,10)); // TODO: the infinity symbol isn't shown correctly
 		
 		// Country
 		if (tLXOptions->bUseIpToCountry) {
@@ -763,23 +842,49 @@ void ServerList::fillList(DeprecatedGUI::CListview *lv, SvrListFilterType filter
 			{
 				SmartPointer<SDL_Surface> flag = tIpToCountryDB->GetCountryFlag(inf.countryCode);
 				if (flag.get())
-					lv->AddSubitem(DeprecatedGUI::LVS_IMAGE, "", flag, NULL, DeprecatedGUI::VALIGN_MIDDLE, inf.countryName);
+					row.add(DeprecatedGUI::LVS_IMAGE, "", flag, inf.countryName);
 				else
-					lv->AddSubitem(DeprecatedGUI::LVS_TEXT, inf.countryCode, (DynDrawIntf*)NULL, NULL);
+					row.add(DeprecatedGUI::LVS_TEXT, inf.countryCode);
 			}
 			else
 			{
-				lv->AddSubitem(DeprecatedGUI::LVS_TEXT, inf.countryName, (DynDrawIntf*)NULL, NULL);
+				row.add(DeprecatedGUI::LVS_TEXT, inf.countryName);
 			}
 		}
 		
 		// Address
-		lv->AddSubitem(DeprecatedGUI::LVS_TEXT, addr, (DynDrawIntf*)NULL, NULL);
+		row.add(DeprecatedGUI::LVS_TEXT, addr);
+		
+		// Update the existing row or add a new one
+		Rows::iterator existing = rows.find(s->szAddress);
+		if (existing != rows.end()) {
+			DeprecatedGUI::lv_item_t *item = existing->second;
+			rows.erase(existing);
+			
+			bool changed = false;
+			if (updateRow(item, row, changed)) {
+				if (changed)
+					changedRows.push_back(item);
+				continue;
+			}
+			unused.push_back(item);
+		}
+		
+		addRow(lv, s->szAddress, row);
+		changedRows.push_back(lv->getLastItem());
 	}
 	
-	lv->ReSort();
-    lv->setSelectedID(curID);
+	// Remove the servers which are not in the list anymore
+	for (Rows::iterator r = rows.begin(); r != rows.end(); ++r)
+		unused.push_back(r->second);
+	for (std::vector<DeprecatedGUI::lv_item_t*>::iterator u = unused.begin(); u != unused.end(); ++u)
+		lv->RemoveItem(*u);
+	
+	// Only the changed rows have to be sorted in
+	lv->SortItems(changedRows);
+	
 	lv->RestoreScrollbarPos();
+	lv->SetRepaint(true);
 }
 
 static bool bUpdateFromUdpThread = false;
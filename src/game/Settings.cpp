@@ -122,7 +122,7 @@ void Settings::dumpAllLayers() const {
 }
 
 
-static ScriptVar_t Settings_attrGetValue(const BaseObject* obj, const AttrDesc* attrDesc) {
+static const ScriptVar_t& Settings_attrGetValue(const BaseObject* obj, const AttrDesc* attrDesc) {
 	const Settings* s = dynamic_cast<const Settings*>(obj);
 	assert(s != NULL);
 	assert(s == &gameSettings); // it's a singleton
@@ -178,7 +178,7 @@ void Settings::pushUpdateHintAll() {
 		pushUpdateHint((FeatureIndex)i);
 }
 
-ScriptVar_t Settings::attrGetValue(const AttrDesc* attrDesc) const {
+const ScriptVar_t& Settings::attrGetValue(const AttrDesc* attrDesc) const {
 	FeatureIndex i = getAttrDescs().getIndex(attrDesc);
 	if(game.isServer() || game.state <= Game::S_Inactive)
 		return (*this)[i];
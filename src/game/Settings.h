@@ -131,7 +131,7 @@ struct Settings : BaseObject {
 
 	void pushUpdateHintAll();
 	void pushUpdateHint(FeatureIndex i);
-	ScriptVar_t attrGetValue(const AttrDesc* attrDesc) const;
+	const ScriptVar_t& attrGetValue(const AttrDesc* attrDesc) const;
 	AttrExt& attrGetAttrExt(const AttrDesc* attrDesc);
 };
 
@@ -17,7 +17,7 @@ int LuaCallbackProxy::_exec(LuaCallbackRef& c, int nparams) {
 		return 0;
 	}
 
-	int r = c.context.call(nparams, nreturns, -nparams-2);
+	int r = c.context.call(nparams, nreturns, -nparams-2, name);
 
 	if(r < 0)
 	{
@@ -32,6 +32,57 @@ int LuaCallbackProxy::_exec(LuaCallbackRef& c, int nparams) {
 
 LuaCallbacks luaCallbacks;
 
+char const* LuaCallbacks::name(int type)
+{
+	if(type >= localplayerEvent && type < localplayerEvent + C_LocalPlayer_ActionCount)
+	{
+		switch(type - localplayerEvent)
+		{
+			case CWormHumanInputHandler::LEFT: return "localplayerLeft";
+			case CWormHumanInputHandler::RIGHT: return "localplayerRight";
+			case CWormHumanInputHandler::UP: return "localplayerUp";
+			case CWormHumanInputHandler::DOWN: return "localplayerDown";
+			case CWormHumanInputHandler::FIRE: return "localplayerFire";
+			case CWormHumanInputHandler::JUMP: return "localplayerJump";
+			case CWormHumanInputHandler::CHANGE: return "localplayerChange";
+			case CWormHumanInputHandler::NINJAROPE: return "localplayerNinjaRope";
+		}
+	}
+
+	#define NAME(x_) case x_: return #x_
+	switch(type)
+	{
+		NAME(exit);
+		NAME(serverStart);
+		NAME(serverStop);
+		NAME(serverJoined);
+		NAME(serverLeft);
+		NAME(gamePrepare);
+		NAME(gameBegin);
+		NAME(gameOver);
+		NAME(gotoLobby);
+		NAME(afterRender);
+		NAME(afterUpdate);
+		NAME(wormRender);
+		NAME(viewportRender);
+		NAME(wormPrepare);
+		NAME(wormDeath);
+		NAME(wormRemoved);
+		NAME(playerUpdate);
+		NAME(playerInit);
+		NAME(playerRemoved);
+		NAME(playerNetworkInit);
+		NAME(gameNetworkInit);
+		NAME(gameEnded);
+		case localplayerEventAny: return "localplayerEvent";
+		NAME(localplayerInit);
+		NAME(networkStateChange);
+		NAME(gameError);
+	}
+	#undef NAME
+	return "unknown";
+}
+
 void LuaCallbacks::bind(const LuaContext& ctx, std::string callback, LuaReference ref)
 {
 	int idx = -1;
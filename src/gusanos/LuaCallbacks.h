@@ -27,8 +27,9 @@ struct LuaCallbackProxy {
 	int nreturns;
 	typedef boost::function<void(LuaContext&,int)> PostHandler;
 	PostHandler postHandler;
-	LuaCallbackProxy(LuaCallbackList& callbacks_, int nreturns_, PostHandler postHandler_)
-		: callbacks(callbacks_), nreturns(nreturns_), postHandler(postHandler_) {}
+	char const* name; // for the profiler
+	LuaCallbackProxy(LuaCallbackList& callbacks_, int nreturns_, PostHandler postHandler_, char const* name_ = NULL)
+		: callbacks(callbacks_), nreturns(nreturns_), postHandler(postHandler_), name(name_) {}
 
 	LuaCallbackProxy& root() { return *this; }
 
@@ -111,6 +112,7 @@ struct LuaCallbacks
 		gameError,
 		max
 	};
+	static char const* name(int type);
 	void bind(const LuaContext& ctx, std::string callback, LuaReference ref);
 	LuaCallbackList callbacks[max];
 	void cleanup();
@@ -122,7 +124,7 @@ struct LuaCallbackProxyEnv {
 	LuaCallbacks::Type t;
 	LuaCallbackProxyEnv(LuaCallbacks::Type t_) : t(t_) {}
 	LuaCallbackProxy call(int nreturns = 0, LuaCallbackProxy::PostHandler postHandler = NULL) {
-		return LuaCallbackProxy(luaCallbacks.callbacks[t], nreturns, postHandler);
+		return LuaCallbackProxy(luaCallbacks.callbacks[t], nreturns, postHandler, LuaCallbacks::name(t));
 	}
 };
 
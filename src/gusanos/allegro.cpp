@@ -15,6 +15,7 @@
 #include "FindFile.h"
 #include "Debug.h"
 #include "GfxPrimitives.h"
+#include "SimdBlit.h"
 #include "StringUtils.h"
 #include "InputEvents.h"
 #include "EventQueue.h"
@@ -205,6 +206,9 @@ bool allegro_init() {
 	if(cpu_capabilities & CPU_MMX) notes << "MMX, "; else notes << "no MMX, ";
 	if(cpu_capabilities & CPU_MMXPLUS) notes << "MMXExt"; else notes << "no MMXExt";
 	notes << endl;
+
+	// the 32bit blitters don't need MMX; they use SSE2/AVX2 if available
+	SimdBlit::setMaxLevel(cfgUseSSE ? SimdBlit::AVX2 : SimdBlit::Scalar);
 	
 	screen = create_bitmap_ex(32, SCREEN_W, SCREEN_H);
 	
@@ -4,251 +4,51 @@
 #include "colors.h"
 #include "mmx.h"
 #include "macros.h"
-
-#ifdef BUILTIN_MMXSSE
+#include "SimdBlit.h"
 
 namespace Blitters
 {
 
-void rectfill_add_32_mmx(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact)
+void rectfill_add_32_simd(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact)
 {
-	typedef Pixel32 pixel_t_1;
-	typedef Pixel32 pixel_t_2; // Doesn't really matter what type this is
-	
 	if(fact <= 0)
 		return;
 
 	CLIP_RECT();
-	
+
 	Pixel col = scaleColor_32(colour, fact);
-	
-	movd_rm(mm7, col);       //  -  col
-	punpckldq_rr(mm7, mm7);  // col col
-	
-	// w00t, 14 pixels at a time
 
 	RECT_Y_LOOP(
-		//RECT_X_LOOP_ALIGN(14, 8,
-		RECT_X_LOOP_NOALIGN(14,
-			*p = addColorsCrude_32(*p, col)
-		,
-			movq_rm(mm0, p[0]);
-			movq_rm(mm1, p[2]);
-			movq_rm(mm2, p[4]);
-			movq_rm(mm3, p[6]);
-			movq_rm(mm4, p[8]);
-			movq_rm(mm5, p[10]);
-			movq_rm(mm6, p[12]);
-			paddusb_rr(mm0, mm7);
-			paddusb_rr(mm1, mm7);
-			paddusb_rr(mm2, mm7);
-			paddusb_rr(mm3, mm7);
-			paddusb_rr(mm4, mm7);
-			paddusb_rr(mm5, mm7);
-			paddusb_rr(mm6, mm7);
-			movq_mr(p[0], mm0);
-			movq_mr(p[2], mm1);
-			movq_mr(p[4], mm2);
-			movq_mr(p[6], mm3);
-			movq_mr(p[8], mm4);
-			movq_mr(p[10], mm5);
-			movq_mr(p[12], mm6);
-		)
+		SimdBlit::addRowColor((Pixel32 *)where->line[y1] + x1, x2 - x1 + 1, col);
 	)
-	
-	
-	emms();
 }
 
-void hline_add_32_mmx(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact)
+void hline_add_32_simd(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact)
 {
-	typedef Pixel32 pixel_t_1;
-	typedef Pixel32 pixel_t_2; // Doesn't really matter what type this is
-	
 	if(fact <= 0)
 		return;
-	Pixel col = scaleColor_32(colour, fact);
-	
-	movd_rm(mm7, col);       //  -  col
-	punpckldq_rr(mm7, mm7);  // col col
-	
-	RECT_X_LOOP_NOALIGN(14,
-		*p = addColorsCrude_32(*p, col)
-	,
-		movq_rm(mm0, p[0]);
-		movq_rm(mm1, p[2]);
-		movq_rm(mm2, p[4]);
-		movq_rm(mm3, p[6]);
-		movq_rm(mm4, p[8]);
-		movq_rm(mm5, p[10]);
-		movq_rm(mm6, p[12]);
-		paddusb_rr(mm0, mm7);
-		paddusb_rr(mm1, mm7);
-		paddusb_rr(mm2, mm7);
-		paddusb_rr(mm3, mm7);
-		paddusb_rr(mm4, mm7);
-		paddusb_rr(mm5, mm7);
-		paddusb_rr(mm6, mm7);
-		movq_mr(p[0], mm0);
-		movq_mr(p[2], mm1);
-		movq_mr(p[4], mm2);
-		movq_mr(p[6], mm3);
-		movq_mr(p[8], mm4);
-		movq_mr(p[10], mm5);
-		movq_mr(p[12], mm6);
-	)
 
-	emms();
+	SimdBlit::addRowColor((Pixel32 *)where->line[y1] + x1, x2 - x1 + 1, scaleColor_32(colour, fact));
 }
 
-void drawSprite_add_32_mmx_sse(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact)
+void drawSprite_add_32_simd(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact)
 {
-	typedef Pixel32 pixel_t_1;
-	typedef Pixel32 pixel_t_2; // Doesn't really matter what type this is
-	
 	if(fact <= 0)
 		return;
-	
-	CLIP_SPRITE_REGION();
-
-#ifdef NDEBUG
-#define MEM_PREFETCH  \
-		prefetchnta(src[8]);  \
-		prefetcht0(dest[8])
-#else
-#define MEM_PREFETCH // GCC 4 has problems with these instructions with -O0 somewhy
-#endif
-
-	static unsigned long long rb_mask32 = 0x00FF00FF00FF00FFull;
-	//static unsigned long long g_mask32  = 0x0000FF000000FF00ull;
-	
-	movq_rm(mm3, rb_mask32);
 
-	if(fact >= 255)
-	{
-		SPRITE_Y_LOOP(
-			SPRITE_X_LOOP_NOALIGN(8,
-				Pixel s = *src;
-				if(s != maskcolor_32)
-					*dest = addColorsCrude_32(*dest, s)
-			,
-				//prefetchnta 32(%esi);
-				//prefetcht0  %es:32(%edi);
-
-				MEM_PREFETCH;
-				
-				movq_rm(mm4, src[0]);    // mm0 = src1 | src2
-				movq_rm(mm5, src[2]);    // mm4 = src3 | src4
-				movq_rm(mm6, src[4]);    // mm4 = src3 | src4
-				movq_rm(mm7, src[6]);    // mm4 = src3 | src4
-				
-				movq_rr(mm0, mm4);
-				movq_rr(mm1, mm5);
-				movq_rr(mm2, mm6);
-
-				pcmpeqd_rr(mm4, mm3);
-				pcmpeqd_rr(mm5, mm3);
-				pcmpeqd_rr(mm6, mm3);
-				
-				pandn_rr(mm4, mm0);
-				pandn_rr(mm5, mm1);
-				pandn_rr(mm6, mm2);
-				
-				// mask last
-				movq_rr(mm0, mm7);
-				pcmpeqd_rr(mm7, mm3);
-				pandn_rr(mm7, mm0);
-				
-				movq_rm(mm0, dest[0]);
-				movq_rm(mm1, dest[2]);
-				movq_rm(mm2, dest[4]);
-				movq_rm(mm3, dest[6]);
-				
-				paddusb_rr(mm4, mm0);
-				paddusb_rr(mm5, mm1);
-				paddusb_rr(mm6, mm2);
-				paddusb_rr(mm7, mm3);
-				
-				movq_mr(dest[0], mm4);
-				movq_mr(dest[2], mm5);
-				movq_mr(dest[4], mm6);
-				movq_mr(dest[6], mm7);
-			)
-		)
-
-#undef MEM_PREFETCH
-	}
-	else
-	{
-		int fact2 = fact * 256;
-		movd_rm(mm7, fact2);
-		punpcklwd_rr(mm7, mm7); // 00000000ff00ff00
-		punpcklwd_rr(mm7, mm7); // ff00ff00ff00ff00
-		pxor_rr(mm6, mm6);
+	CLIP_SPRITE_REGION();
 
-#ifdef NDEBUG
-#define MEM_PREFETCH \
-				prefetchnta(src[8]);  \
-				prefetcht0(dest[8])
-#else
-#define MEM_PREFETCH // GCC 4 has problems with these instructions with -O0 somewhy
-#endif
-		
-		SPRITE_Y_LOOP(
-			SPRITE_X_LOOP_NOALIGN(4,
-				Pixel s = *src;
-				if(s != maskcolor_32)
-					*dest = addColorsCrude_32(*dest, scaleColor_32(s, fact))
-			,
-				// Optimized from 39 to 26 instructions ;o
-				
-				movq_rm(mm0, src[0]);    // mm0 = src1 | src2
-				movq_rm(mm4, src[2]);    // mm4 = src3 | src4
-				
-				MEM_PREFETCH;
-				
-				movq_rr(mm1, mm0);
-				movq_rr(mm5, mm4);
+	SPRITE_Y_LOOP(
+		SimdBlit::addRowFact((Pixel32 *)where->line[y] + x, (Pixel32 *)from->line[y1] + x1, x2 - x1, fact, maskcolor_32);
+	)
+}
 
-				pcmpeqd_rr(mm0, mm3);
-				pcmpeqd_rr(mm4, mm3);
-				pandn_rr(mm0, mm1);
-				pandn_rr(mm4, mm5);
-				
-				// mm0 and mm4 are masked
-				
-				// mm6 is 0
-				movq_rr(mm1, mm0);
-				movq_rr(mm5, mm4);
-				punpckhbw_rr(mm0, mm6); // mm0 = src1 = 00rr00gg00bb
-				punpckhbw_rr(mm4, mm6); // mm4 = src3 = 00rr00gg00bb
-				punpcklbw_rr(mm1, mm6); // mm1 = src2 = 00rr00gg00bb
-				punpcklbw_rr(mm5, mm6); // mm5 = src4 = 00rr00gg00bb
-				
-				pmulhuw_rr(mm0, mm7); // mm0 = src1 = 00rs00gs00bs
-				pmulhuw_rr(mm4, mm7); // mm4 = src3 = 00rs00gs00bs
-				pmulhuw_rr(mm1, mm7); // mm1 = src2 = 00rs00gs00bs
-				pmulhuw_rr(mm5, mm7); // mm5 = src4 = 00rs00gs00bs
-				
-				packuswb_rr(mm1, mm0); // mm5 = src1 | src2
-				packuswb_rr(mm5, mm4); // mm6 = src3 | src4
+}
 
-				movq_rm(mm0, dest[0]);
-				movq_rm(mm4, dest[2]);
-				
-				paddusb_rr(mm1, mm0);
-				paddusb_rr(mm5, mm4);
-				
-				movq_mr(dest[0], mm1);
-				movq_mr(dest[2], mm5);
-			)
-		)
+#ifdef BUILTIN_MMXSSE
 
-#undef MEM_PREFETCH
-	}
-	
-	emms();
-}
+namespace Blitters
+{
 
 void drawSprite_add_16_mmx_sse(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact)
 {
@@ -10,6 +10,7 @@
 #include "gusanos/blitters/types.h"
 #include "mmx.h"
 #include "CodeAttributes.h"
+#include "SimdBlit.h"
 
 // TODO: correct check if we should include MMX/SSE code
 #if !defined(WIN32) && (SDL_BYTEORDER == SDL_LIL_ENDIAN)
@@ -31,6 +32,9 @@
 
 #define FOR_MMX(x_) if(HAS_MMX) { x_ }
 
+// The 32bit blitters use the SimdBlit row kernels (SSE2/AVX2, selected at runtime)
+#define HAS_SIMD_BLIT (SimdBlit::level() != SimdBlit::Scalar)
+
 namespace Blitters
 {
 
@@ -42,6 +46,7 @@ namespace Blitters
 	
 	e.g.:
 	rectfill_blend_32_mmx
+	drawSprite_add_32_simd
 	
 	defaults:
 		parallelism = 1
@@ -86,12 +91,12 @@ void rectfill_add_16(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixe
 void rectfill_blend_16(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact);
 
 void rectfill_add_32(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact);
-void rectfill_add_32_mmx(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact);
+void rectfill_add_32_simd(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact);
 void rectfill_blend_32(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact);
 
 void hline_add_16(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact);
 void hline_add_32(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact);
-void hline_add_32_mmx(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact);
+void hline_add_32_simd(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact);
 void hline_blend_16(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact);
 void hline_blend_32(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact);
 
@@ -111,14 +116,14 @@ void drawSprite_multsec_32_with_8(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, A
 void drawSprite_mult_8_to_16(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb);
 
 void drawSprite_add_32(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
-void drawSprite_add_32_mmx_sse(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
+void drawSprite_add_32_simd(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
 void drawSprite_blend_32(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
-void drawSprite_blend_32_mmx_sse(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
+void drawSprite_blend_32_simd(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
 void drawSprite_blendalpha_32_to_32(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
-void drawSprite_blendalpha_32_to_32_mmx_sse(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
+void drawSprite_blendalpha_32_to_32_simd(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact);
 void drawSprite_blendtint_8_to_32(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact, int color);
 void drawSprite_mult_8_to_32(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb);
-void drawSprite_mult_8_to_32_mmx_sse(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb);
+void drawSprite_mult_8_to_32_simd(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb);
 
 void drawSpriteLine_add_32(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int x1, int y1, int x2, int fact);
 void drawSpriteLine_add_16(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int x1, int y1, int x2, int fact);
@@ -163,11 +168,11 @@ using Blitters::line_add;
 			else Blitters::f_##_8 x_ ; \
 		break; }
 		
-#define SELECT_MMX32(f_, x_) \
+#define SELECT_SIMD32(f_, x_) \
 	switch(bitmap_color_depth(where)) { \
 		case 16: Blitters::f_##_16 x_ ; break; \
 		case 32: \
-			if(HAS_MMX) Blitters::f_##_32_mmx x_ ; \
+			if(HAS_SIMD_BLIT) Blitters::f_##_32_simd x_ ; \
 			else Blitters::f_##_32 x_ ; \
 		break; }
 			
@@ -179,21 +184,13 @@ using Blitters::line_add;
 			else Blitters::f_##_32 x_ ; \
 		break; }
 		
-#define SELECT_MMX_SSE_32(f_, x_) \
-	switch(bitmap_color_depth(where)) { \
-		case 16: Blitters::f_##_16 x_ ; break; \
-		case 32: \
-			if(HAS_MMXSSE || HAS_SSE) Blitters::f_##_32_mmx_sse x_ ; \
-			else Blitters::f_##_32 x_ ; \
-		break; }
-		
-#define SELECT_MMX_SSE(f_, x_) \
+#define SELECT_MMX_SSE16_SIMD32(f_, x_) \
 	switch(bitmap_color_depth(where)) { \
 		case 16: \
 			if(HAS_MMXSSE || HAS_SSE) Blitters::f_##_16_mmx_sse x_ ; \
 			else Blitters::f_##_16 x_ ; break; \
 		case 32: \
-			if(HAS_MMXSSE || HAS_SSE) Blitters::f_##_32_mmx_sse x_ ; \
+			if(HAS_SIMD_BLIT) Blitters::f_##_32_simd x_ ; \
 			else Blitters::f_##_32 x_ ; \
 		break; }
 		
@@ -287,7 +284,7 @@ INLINE void putpixelwu_solid(ALLEGRO_BITMAP* where, float x, float y, Pixel colo
 
 INLINE void rectfill_add(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact)
 {
-	SELECT_MMX32(rectfill_add, (where, x1, y1, x2, y2, colour, fact));
+	SELECT_SIMD32(rectfill_add, (where, x1, y1, x2, y2, colour, fact));
 }
 
 INLINE void rectfill_blend(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2, Pixel colour, int fact)
@@ -307,7 +304,7 @@ INLINE void rectfill_solid(ALLEGRO_BITMAP* where, int x1, int y1, int x2, int y2
 
 INLINE void hline_add(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact)
 {
-	SELECT_MMX32(hline_add, (where, x1, y1, x2, colour, fact));
+	SELECT_SIMD32(hline_add, (where, x1, y1, x2, colour, fact));
 }
 
 INLINE void hline_blend(ALLEGRO_BITMAP* where, int x1, int y1, int x2, Pixel colour, int fact)
@@ -347,17 +344,17 @@ INLINE void line_blendalpha(ALLEGRO_BITMAP* where, int x, int y, int destx, int
 
 INLINE void drawSprite_add(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int fact)
 {
-	SELECT_MMX_SSE(drawSprite_add, (where, from, x, y, 0, 0, 0, 0, fact));
+	SELECT_MMX_SSE16_SIMD32(drawSprite_add, (where, from, x, y, 0, 0, 0, 0, fact));
 }
 
 INLINE void drawSprite_blend(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int fact)
 {
-	SELECT_MMX_SSE(drawSprite_blend, (where, from, x, y, 0, 0, 0, 0, fact));
+	SELECT_MMX_SSE16_SIMD32(drawSprite_blend, (where, from, x, y, 0, 0, 0, 0, fact));
 }
 
 INLINE void drawSprite_blendalpha(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int fact)
 {
-	SELECT_MMX_SSE_32(drawSprite_blendalpha_32_to, (where, from, x, y, 0, 0, 0, 0, fact));
+	SELECT_SIMD32(drawSprite_blendalpha_32_to, (where, from, x, y, 0, 0, 0, 0, fact));
 }
 
 INLINE void drawSprite_blendtint(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int fact, int color)
@@ -372,22 +369,22 @@ INLINE void drawSprite_solid(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x,
 
 INLINE void drawSprite_mult_8(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y)
 {
-	SELECT_MMX_SSE_32(drawSprite_mult_8_to, (where, from, x, y, 0, 0, 0, 0));
+	SELECT_SIMD32(drawSprite_mult_8_to, (where, from, x, y, 0, 0, 0, 0));
 }
 
 INLINE void drawSpriteCut_add(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact)
 {
-	SELECT_MMX_SSE(drawSprite_add, (where, from, x, y, cutl, cutt, cutr, cutb, fact));
+	SELECT_MMX_SSE16_SIMD32(drawSprite_add, (where, from, x, y, cutl, cutt, cutr, cutb, fact));
 }
 
 INLINE void drawSpriteCut_blend(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact)
 {
-	SELECT_MMX_SSE(drawSprite_blend, (where, from, x, y, cutl, cutt, cutr, cutb, fact));
+	SELECT_MMX_SSE16_SIMD32(drawSprite_blend, (where, from, x, y, cutl, cutt, cutr, cutb, fact));
 }
 
 INLINE void drawSpriteCut_blendalpha(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb, int fact)
 {
-	SELECT_MMX_SSE_32(drawSprite_blendalpha_32_to, (where, from, x, y, cutl, cutt, cutr, cutb, fact));
+	SELECT_SIMD32(drawSprite_blendalpha_32_to, (where, from, x, y, cutl, cutt, cutr, cutb, fact));
 }
 
 INLINE void drawSpriteCut_solid(ALLEGRO_BITMAP* where, ALLEGRO_BITMAP* from, int x, int y, int cutl, int cutt, int cutr, int cutb)
@@ -0,0 +1,209 @@
+#ifndef DEDICATED_ONLY
+
+#include "compositor.h"
+
+#include "gusanos/allegro.h"
+#include "game/CMap.h"
+#include "gusgame.h"
+#include "GfxPrimitives.h"
+#include "MathLib.h"
+
+#include <cstring>
+#include <cstdlib>
+
+LayerCompositor::LayerCompositor()
+: m_level(NULL), m_levelMap(NULL), m_levelSerial(0), m_tilesX(0), m_tilesY(0),
+m_fgSurface(NULL), m_fgSerial(0), m_fgTilesX(0), m_fgTilesY(0)
+{
+}
+
+LayerCompositor::~LayerCompositor()
+{
+	reset();
+}
+
+void LayerCompositor::reset()
+{
+	destroy_bitmap(m_level); m_level = NULL;
+	m_levelMap = NULL;
+	m_dirty.clear();
+	m_tilesX = m_tilesY = 0;
+	m_fgSurface = NULL;
+	m_fgUsed.clear();
+}
+
+// x/y/w/h in viewport pixels
+void LayerCompositor::markDirty(int x, int y, int w, int h)
+{
+	if(w <= 0 || h <= 0) return;
+	int tx1 = MAX(x, 0) >> TileShift;
+	int ty1 = MAX(y, 0) >> TileShift;
+	int tx2 = MIN(x + w - 1, m_level->w - 1);
+	int ty2 = MIN(y + h - 1, m_level->h - 1);
+	if(tx2 < 0 || ty2 < 0) return;
+	tx2 >>= TileShift; ty2 >>= TileShift;
+
+	for(int ty = ty1; ty <= ty2; ++ty)
+		for(int tx = tx1; tx <= tx2; ++tx)
+			m_dirty[ty * m_tilesX + tx] = true;
+}
+
+// Moves the cached content by dx/dy viewport pixels and marks the uncovered strips dirty
+void LayerCompositor::scroll(int dx, int dy)
+{
+	const int bpp = m_level->surf->format->BytesPerPixel;
+	const int w = m_level->w - abs(dx);
+	const int h = m_level->h - abs(dy);
+	const int srcX = MAX(-dx, 0), dstX = MAX(dx, 0);
+
+	if(w > 0 && h > 0) {
+		LOCK_OR_QUIT(m_level->surf);
+		if(dy > 0) {
+			for(int y = h - 1; y >= 0; --y)
+				memmove(m_level->line[y + dy] + dstX * bpp, m_level->line[y] + srcX * bpp, w * bpp);
+		} else {
+			for(int y = 0; y < h; ++y)
+				memmove(m_level->line[y] + dstX * bpp, m_level->line[y - dy] + srcX * bpp, w * bpp);
+		}
+		UnlockSurface(m_level->surf);
+	}
+
+	if(dx > 0) markDirty(0, 0, dx, m_level->h);
+	else if(dx < 0) markDirty(m_level->w + dx, 0, -dx, m_level->h);
+	if(dy > 0) markDirty(0, 0, m_level->w, dy);
+	else if(dy < 0) markDirty(0, m_level->h + dy, m_level->w, -dy);
+}
+
+void LayerCompositor::drawLevel(CMap* map, ALLEGRO_BITMAP* where, int offX, int offY)
+{
+	// Without a paralax, the level is one straight copy. Nothing to save by caching it.
+	if(!map->image || !map->paralax || gusGame.options.showMapDebug) {
+		map->gusDraw(where, offX, offY);
+		return;
+	}
+
+	// same as in CMap::gusDraw()
+	const IVec paralaxPos(
+		int(offX * (map->paralax->w - where->w) / float( map->image->w - where->w )),
+		int(offY * (map->paralax->h - where->h) / float( map->image->h - where->h )));
+	const IVec levelPos(offX, offY);
+
+	bool full = false;
+	if(!m_level || m_level->w != where->w || m_level->h != where->h) {
+		destroy_bitmap(m_level);
+		m_level = create_bitmap(where->w, where->h);
+		m_tilesX = (m_level->w + TileSize - 1) >> TileShift;
+		m_tilesY = (m_level->h + TileSize - 1) >> TileShift;
+		m_dirty.assign(m_tilesX * m_tilesY, true);
+		full = true;
+	}
+
+	std::vector<CMap::ImageChange> changes;
+	if(m_levelMap != map || !map->imageChangesSince(m_levelSerial, changes))
+		full = true;
+
+	if(!full && (levelPos != m_levelPos || paralaxPos != m_paralaxPos)) {
+		const IVec d = (levelPos - m_levelPos) * 2;
+		// Both layers have to move the same way, otherwise the composite is different everywhere
+		if(levelPos - m_levelPos == paralaxPos - m_paralaxPos && abs(d.x) < m_level->w && abs(d.y) < m_level->h)
+			scroll(-d.x, -d.y);
+		else
+			full = true;
+	}
+
+	if(full)
+		m_dirty.assign(m_tilesX * m_tilesY, true);
+	else {
+		for(std::vector<CMap::ImageChange>::iterator c = changes.begin(); c != changes.end(); ++c)
+			markDirty((c->x - offX) * 2, (c->y - offY) * 2, c->w * 2, c->h * 2);
+	}
+
+	// Composite the dirty tiles, joined to horizontal runs
+	for(int ty = 0; ty < m_tilesY; ++ty) {
+		for(int tx = 0; tx < m_tilesX; ) {
+			if(!m_dirty[ty * m_tilesX + tx]) { ++tx; continue; }
+			int tx2 = tx;
+			while(tx2 < m_tilesX && m_dirty[ty * m_tilesX + tx2]) {
+				m_dirty[ty * m_tilesX + tx2] = false;
+				++tx2;
+			}
+
+			const int x = tx << TileShift, y = ty << TileShift;
+			const int w = MIN(tx2 << TileShift, m_level->w) - x;
+			const int h = MIN(TileSize, m_level->h - y);
+			blit(map->paralax, m_level, paralaxPos.x*2 + x, paralaxPos.y*2 + y, x, y, w, h);
+			masked_blit(map->image, m_level, offX*2 + x, offY*2 + y, x, y, w, h);
+			tx = tx2;
+		}
+	}
+
+	m_levelMap = map;
+	m_levelSerial = map->imageSerial();
+	m_levelPos = levelPos;
+	m_paralaxPos = paralaxPos;
+
+	blit(m_level, where, 0, 0, 0, 0, where->w, where->h);
+}
+
+void LayerCompositor::classifyForeground(SDL_Surface* fg)
+{
+	m_fgTilesX = (fg->w + FgTileSize - 1) >> FgTileShift;
+	m_fgTilesY = (fg->h + FgTileSize - 1) >> FgTileShift;
+	m_fgUsed.assign(m_fgTilesX * m_fgTilesY, true);
+
+	const Uint32 amask = fg->format->Amask;
+	if(!amask || fg->format->BytesPerPixel != 4)
+		return; // no alpha, we have to draw it all
+
+	LOCK_OR_QUIT(fg);
+	for(int ty = 0; ty < m_fgTilesY; ++ty)
+		for(int tx = 0; tx < m_fgTilesX; ++tx) {
+			bool used = false;
+			const int x2 = MIN((tx + 1) << FgTileShift, fg->w);
+			const int y2 = MIN((ty + 1) << FgTileShift, fg->h);
+			for(int y = ty << FgTileShift; y < y2 && !used; ++y) {
+				const Uint32* p = (const Uint32*)((Uint8*)fg->pixels + y * fg->pitch) + (tx << FgTileShift);
+				for(int x = tx << FgTileShift; x < x2; ++x, ++p)
+					if(*p & amask) { used = true; break; }
+			}
+			m_fgUsed[ty * m_fgTilesX + tx] = used;
+		}
+	UnlockSurface(fg);
+}
+
+void LayerCompositor::drawForeground(CMap* map, ALLEGRO_BITMAP* where, int offX, int offY)
+{
+	SDL_Surface* fg = map->bmpForeground.get();
+	if(!fg) return;
+
+	// The foreground never changes while the map is loaded
+	if(fg != m_fgSurface || m_fgSerial != map->imageGeneration()) {
+		classifyForeground(fg);
+		m_fgSurface = fg;
+		m_fgSerial = map->imageGeneration();
+	}
+
+	const int srcX = offX * 2, srcY = offY * 2;
+	const int tx1 = MAX(srcX, 0) >> FgTileShift;
+	const int ty1 = MAX(srcY, 0) >> FgTileShift;
+	const int tx2 = MIN((srcX + where->w - 1) >> FgTileShift, m_fgTilesX - 1);
+	const int ty2 = MIN((srcY + where->h - 1) >> FgTileShift, m_fgTilesY - 1);
+
+	for(int ty = ty1; ty <= ty2; ++ty) {
+		for(int tx = tx1; tx <= tx2; ) {
+			if(!m_fgUsed[ty * m_fgTilesX + tx]) { ++tx; continue; }
+			int txEnd = tx;
+			while(txEnd <= tx2 && m_fgUsed[ty * m_fgTilesX + txEnd]) ++txEnd;
+
+			// clip the run to the viewport
+			const int x1 = MAX(tx << FgTileShift, srcX);
+			const int x2 = MIN(txEnd << FgTileShift, srcX + where->w);
+			const int y1 = MAX(ty << FgTileShift, srcY);
+			const int y2 = MIN((ty + 1) << FgTileShift, srcY + where->h);
+			DrawImageAdv(where->surf.get(), fg, x1, y1, x1 - srcX, y1 - srcY, x2 - x1, y2 - y1);
+			tx = txEnd;
+		}
+	}
+}
+
+#endif
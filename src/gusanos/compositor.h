@@ -0,0 +1,56 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+/* Caches the static layers which CViewport::gusRender() draws every frame.
+
+  The level layer (paralax + masked level image) is kept per viewport and
+  only the tiles which got dirty by terrain changes (see
+  CMap::markImageDirty()) or by scrolling are composited again.
+  The foreground overlay is drawn only where it is not fully transparent.
+  */
+
+#include <vector>
+#include <SDL.h>
+#include "CVec.h"
+
+struct ALLEGRO_BITMAP;
+class CMap;
+
+class LayerCompositor
+{
+public:
+	LayerCompositor();
+	~LayerCompositor();
+
+	void reset();
+
+	// offX/offY is the camera position in map coordinates, like CMap::gusDraw()
+	void drawLevel(CMap* map, ALLEGRO_BITMAP* where, int offX, int offY);
+	void drawForeground(CMap* map, ALLEGRO_BITMAP* where, int offX, int offY);
+
+private:
+	enum { TileShift = 6, TileSize = 1 << TileShift }; // viewport pixels
+	enum { FgTileShift = 5, FgTileSize = 1 << FgTileShift }; // foreground pixels
+
+	LayerCompositor(const LayerCompositor&);
+	LayerCompositor& operator=(const LayerCompositor&);
+
+	void markDirty(int x, int y, int w, int h);
+	void scroll(int dx, int dy);
+	void classifyForeground(SDL_Surface* fg);
+
+	ALLEGRO_BITMAP* m_level;
+	CMap* m_levelMap;
+	uint64_t m_levelSerial;
+	IVec m_levelPos;
+	IVec m_paralaxPos;
+	int m_tilesX, m_tilesY;
+	std::vector<bool> m_dirty;
+
+	SDL_Surface* m_fgSurface;
+	uint64_t m_fgSerial;
+	int m_fgTilesX, m_fgTilesY;
+	std::vector<bool> m_fgUsed;
+};
+
+#endif // COMPOSITOR_H
@@ -65,6 +65,7 @@ void Console::registerItem(std::string const& name, ConsoleItem* item)
 {
 	item->m_owner = this;
 	items[name] = item;
+	itemIndex.add(name, item);
 }
 
 void Console::registerVariable(Variable* var)
@@ -72,11 +73,10 @@ void Console::registerVariable(Variable* var)
 	string const& name = var->getName();
 	if (!name.empty())
 	{
-		std::map<std::string, ConsoleItem*, IStrCompare>::iterator i = items.find(name);
-		if(i != items.end())
+		if(ConsoleItem* old = itemIndex.get(name))
 		{
 			// Replace old variable
-			delete i->second;
+			delete old;
 		}
 		
 		registerItem(name, var);
@@ -94,7 +94,7 @@ void Console::registerVariable(Variable* var)
 
 void Console::registerCommand(std::string const& name, GusCommand* command)
 {
-	if (!name.empty() && items.find(name) == items.end())
+	if (!name.empty() && !itemIndex.get(name))
 	{
 		registerItem(name, command);
 	}
@@ -106,8 +106,7 @@ void Console::registerSpecialCommand(const std::string &name, int index, std::st
 {
 	if (!name.empty())
 	{
-		ItemMap::iterator tempItem = items.find(name);
-		if (tempItem == items.end())
+		if (!itemIndex.get(name))
 		{
 			//items[name] = new SpecialCommand(index,func);
 			registerItem(name, new SpecialCommand(index, func));
@@ -119,12 +118,11 @@ void Console::registerAlias(const std::string &name, const std::string &action)
 {
 	if (!name.empty())
 	{
-		ItemMap::iterator tempItem = items.find(name);
-		if (tempItem == items.end()
-		|| !tempItem->second->isLocked())
+		ConsoleItem* old = itemIndex.get(name);
+		if (!old || !old->isLocked())
 		{
-			if(tempItem != items.end())
-				delete tempItem->second;
+			if(old)
+				delete old;
 			registerItem(name, new Alias(name, action));
 		}
 	}
@@ -146,6 +144,7 @@ void Console::clearTemporaries()
 	{	
 		if(i->second->temp)
 		{
+			itemIndex.set(itemIndex.find(i->first), NULL);
 			delete i->second;
 			items.erase(i);
 		}
@@ -219,10 +218,9 @@ std::string Console::invoke(string const& name, list<string> const& args, bool p
 		if(parseRelease)
 			nameCopy[0] = '-';
 
-		ItemMap::iterator tempItem = items.find(nameCopy);
-		if (tempItem != items.end())
+		if (ConsoleItem* item = itemIndex.get(nameCopy))
 		{
-			return tempItem->second->invoke(args);
+			return item->invoke(args);
 		} else
 			return "UNKNOWN COMMAND: " + name;
 	}
@@ -413,19 +411,22 @@ struct CompletionHandler : public ConsoleGrammarBase
 	std::stack<State> states;
 };
 
-struct ItemGetText
+struct NameGetText
 {
 	template<class IteratorT>
 	std::string const& operator()(IteratorT i) const
 	{
-		return i->first;
+		return *i;
 	}
 };
 
 std::string Console::completeCommand(std::string const& b)
 {
-	return shellComplete(items, b.begin(), b.end()
-		, ItemGetText(), ConsoleAddLines(*this));
+	// Only the matching items, from the prefix tree
+	std::vector<std::string> matches;
+	itemIndex.complete(b, matches);
+	return shellComplete(matches, b.begin(), b.end()
+		, NameGetText(), ConsoleAddLines(*this));
 }
 
 string Console::autoComplete(string const& text)
@@ -444,11 +445,9 @@ string Console::autoComplete(string const& text)
 		{
 			if(result.commandComplete)
 			{
-				ItemMap::const_iterator item = items.find(result.command);
-				
-				if(item != items.end())
+				if(ConsoleItem* item = itemIndex.get(result.command))
 				{
-					return handler.prefix() + item->second->completeArgument(result.argumentIdx, result.argument);
+					return handler.prefix() + item->completeArgument(result.argumentIdx, result.argument);
 				}
 				
 				return text;
@@ -7,6 +7,7 @@
 // PROJECT INCLUDES
 //
 #include "util/text.h"
+#include "NameIndex.h"
 #include "variables.h"
 #include "command.h"
 
@@ -128,6 +129,7 @@ public:
 protected:
 	
 	ItemMap items;
+	NameIndex<ConsoleItem> itemIndex; // hashed lookup and completion for items
 	std::list<std::string> log;
 	
 	int m_variableCount;
@@ -98,6 +98,21 @@ void Explosion::think()
 	}
 }
 
+bool Explosion::getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h)
+{
+	IVec rPos = viewport->convertCoords( IVec( Vec(pos()) ) );
+	if (!m_sprite) {
+		x = rPos.x - 1; y = rPos.y - 1;
+		w = h = 4;
+	} else {
+		// also for rockHidden
+		Sprite* sprite = m_sprite->getSprite(m_animator->getFrame(), Angle(0));
+		x = rPos.x - sprite->m_xPivot; y = rPos.y - sprite->m_yPivot;
+		w = sprite->getWidth(); h = sprite->getHeight();
+	}
+	return true;
+}
+
 void Explosion::draw(CViewport* viewport)
 {
 
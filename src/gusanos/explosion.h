@@ -24,6 +24,7 @@ public:
 
 #ifndef DEDICATED_ONLY
 	void draw(CViewport* viewport);
+	bool getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h);
 	void think();
 #endif
 	ExpType* getType()
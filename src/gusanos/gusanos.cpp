@@ -30,6 +30,7 @@
 #include "lua/bindings.h"
 #include "util/log.h"
 #include "game/Game.h"
+#include "FrameProfiler.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -61,6 +62,7 @@ bool gusInit(const std::string& mod) {
 }
 
 void gusLogicFrame() {
+	PROFILE_ZONE("gusLogicFrame");
 	for ( Grid::iterator iter = game.objects.beginAll(); iter;)
 	{
 		if(iter->deleteMe)
@@ -71,6 +73,7 @@ void gusLogicFrame() {
 
 	if ( game.isMapReady() && game.shouldDoPhysicsFrame() && gusGame.isLoaded() )
 	{
+		PROFILE_ZONE("gusanos think");
 		for ( Grid::iterator iter = game.objects.beginAll(); iter; ++iter)
 		{
 			iter->think();
@@ -164,6 +164,7 @@ void Options::registerInConsole()
 		("SV_MAX_WEAPONS", &maxWeaponsVar, 5)
 			
 		("CL_SHOW_MAP_DEBUG", &showMapDebug, 0 )
+		("CL_WATER_THREADS", &waterThreads, 4 )
 		("CL_SHOW_DEATH_MESSAGES", &showDeathMessages, true )
 		("CL_LOG_DEATH_MESSAGES", &logDeathMessages, false )
 	;
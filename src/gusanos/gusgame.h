@@ -70,6 +70,7 @@ struct Options
 	bool logDeathMessages;
 	
 	int showMapDebug;
+	int waterThreads;
 };
 
 struct LevelEffectEvent
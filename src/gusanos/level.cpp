@@ -20,6 +20,9 @@
 #include "game/Game.h"
 
 #include "gusanos/allegro.h"
+#include "ThreadPool.h"
+#include <boost/bind.hpp>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -82,6 +85,7 @@ void CMap::gusInit()
 	m_gusLoaded = false;
 	m_firstFrame = true;
 	m_config = 0;
+	m_waterChunksX = m_waterChunksY = 0;
 
 #ifndef DEDICATED_ONLY
 
@@ -159,6 +163,8 @@ void CMap::gusShutdown()
 {
 	m_gusLoaded = false;
 	m_firstFrame = true;
+	m_terrainField.reset();
+	resetImageChanges();
 
 	if(m_config) {
 		delete m_config;
@@ -181,6 +187,7 @@ void CMap::gusShutdown()
 
 	destroy_bitmap(material);
 	material = NULL;
+	resetWater();
 
 	vectorEncoding = Encoding::VectorEncoding();
 }
@@ -191,24 +198,226 @@ void CMap::checkWBorders( int x, int y )
 {
 	if ( getMaterial( x, y-1 ).is_stagnated_water ) {
 		unsigned char mat = getMaterialIndex(x, y-1) - 1;
-		m_water.push_back( WaterParticle( x, y-1, mat ) );
+		addWater( WaterParticle( x, y-1, mat ) );
 		putMaterial( mat, x, y-1 );
 	}
 	if ( getMaterial( x+1, y ).is_stagnated_water ) {
 		unsigned char mat = getMaterialIndex(x+1, y) - 1;
-		m_water.push_back( WaterParticle( x+1, y, mat ) );
+		addWater( WaterParticle( x+1, y, mat ) );
 		putMaterial( mat, x+1, y );
 	}
 	if ( getMaterial( x-1, y ).is_stagnated_water ) {
 		unsigned char mat = getMaterialIndex(x-1, y) - 1;
-		m_water.push_back( WaterParticle( x-1, y, mat ) );
+		addWater( WaterParticle( x-1, y, mat ) );
 		putMaterial( mat, x-1, y );
 	}
 
 }
 
+void CMap::resetWater()
+{
+	m_waterChunks.clear();
+	m_activeWaterChunks.clear();
+	m_waterChunksX = m_waterChunksY = 0;
+	if ( !material )
+		return;
+	
+	m_waterChunksX = (material->w + WaterChunk::Size - 1) >> WaterChunk::Shift;
+	m_waterChunksY = (material->h + WaterChunk::Size - 1) >> WaterChunk::Shift;
+	m_waterChunks.resize( m_waterChunksX * m_waterChunksY );
+}
+
+void CMap::addWater( const WaterParticle& wp )
+{
+	if ( m_waterChunks.empty() )
+		resetWater();
+	if ( !isInside( wp.x, wp.y ) )
+		return;
+	
+	size_t index = (wp.y >> WaterChunk::Shift) * m_waterChunksX + (wp.x >> WaterChunk::Shift);
+	WaterChunk& chunk = m_waterChunks[index];
+	chunk.particles.push_back( wp );
+	if ( !chunk.active ) {
+		chunk.active = true;
+		m_activeWaterChunks.push_back( index );
+	}
+}
+
 static const float WaterSkipFactor = 0.05f;
 
+// xorshift, each chunk has its own state so that chunks can run in parallel
+static INLINE float waterRnd( unsigned int& state )
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+// Like checkWBorders(), but the woken water is handed over after the step
+void CMap::waterWake( WaterChunk& chunk, int x, int y )
+{
+	static const int dx[3] = { 0, 1, -1 };
+	static const int dy[3] = { -1, 0, 0 };
+	for ( int i = 0; i < 3; ++i ) {
+		if ( getMaterial( x+dx[i], y+dy[i] ).is_stagnated_water ) {
+			unsigned char mat = getMaterialIndex( x+dx[i], y+dy[i] ) - 1;
+			chunk.outgoing.push_back( WaterParticle( x+dx[i], y+dy[i], mat, waterRnd( chunk.rndState ) < 0.5f ) );
+			waterPut( chunk, mat, x+dx[i], y+dy[i] );
+		}
+	}
+}
+
+// putMaterial() without touching shared state, safe within a chunk step
+void CMap::waterPut( WaterChunk& chunk, unsigned char index, int x, int y )
+{
+	unsigned char old = getMaterialIndex( x, y );
+	if ( m_materialList[old].particle_pass != m_materialList[index].particle_pass )
+		chunk.passChanged = true;
+	material->line[y][x] = index;
+	chunk.touched.push_back( IVec( x, y ) );
+}
+
+void CMap::waterThinkChunk( size_t index )
+{
+	WaterChunk& chunk = m_waterChunks[index];
+	size_t keep = 0;
+	
+	for ( size_t i = 0; i < chunk.particles.size(); ++i ) {
+		WaterParticle wp = chunk.particles[i];
+		bool alive = true;
+		
+		if ( getMaterialIndex( wp.x, wp.y ) != wp.mat ) {
+			chunk.touched.push_back( IVec( wp.x, wp.y ) );
+			alive = false;
+		} else if ( waterRnd( chunk.rndState ) > WaterSkipFactor ) {
+			unsigned char mat = getMaterialIndex( wp.x, wp.y+1 );
+			if ( m_materialList[mat].particle_pass && !m_materialList[mat].flows) {
+				waterWake( chunk, wp.x, wp.y );
+				waterPut( chunk, 1, wp.x, wp.y );
+				++wp.y;
+				waterPut( chunk, wp.mat, wp.x, wp.y );
+				wp.count = 0; // Reset stagnation counter because it moved
+			} else {
+				char dir;
+				if ( wp.dir )
+					dir = 1;
+				else
+					dir = -1;
+				
+				mat = getMaterialIndex( wp.x+dir, wp.y );
+				if ( m_materialList[mat].particle_pass && !m_materialList[mat].flows ) {
+					waterWake( chunk, wp.x, wp.y );
+					waterPut( chunk, 1, wp.x, wp.y );
+					wp.x += dir;
+					waterPut( chunk, wp.mat, wp.x, wp.y );
+					wp.count = 0; // Reset stagnation counter because it moved
+				} else {
+					wp.dir = !wp.dir;
+					++wp.count; // It didnt move so the stagnation counter gets incremented.
+					if ( wp.count > 1 ) {
+						mat = getMaterialIndex( wp.x-dir, wp.y );
+						if ( !m_materialList[mat].particle_pass || m_materialList[mat].flows ) {
+							waterPut( chunk, wp.mat+1, wp.x, wp.y );
+							alive = false;
+						}
+					}
+				}
+			}
+		}
+		
+		if ( !alive )
+			continue;
+		if ( (size_t)((wp.y >> WaterChunk::Shift) * m_waterChunksX + (wp.x >> WaterChunk::Shift)) == index )
+			chunk.particles[keep++] = wp;
+		else
+			chunk.outgoing.push_back( wp );
+	}
+	chunk.particles.erase( chunk.particles.begin() + keep, chunk.particles.end() );
+}
+
+Result CMap::waterThinkChunks( const std::vector<size_t>* chunks, size_t first, size_t step )
+{
+	for ( size_t i = first; i < chunks->size(); i += step )
+		waterThinkChunk( (*chunks)[i] );
+	return true;
+}
+
+// Writes back the image pixels and hands over the particles which left the chunk
+void CMap::waterFlush( size_t index )
+{
+	WaterChunk& chunk = m_waterChunks[index];
+	const int cx = int(index % m_waterChunksX), cy = int(index / m_waterChunksX);
+#ifndef DEDICATED_ONLY
+	if ( !chunk.touched.empty() && image && background && watermap ) {
+		markImageDirty( (cx << WaterChunk::Shift) - 1, (cy << WaterChunk::Shift) - 1, WaterChunk::Size + 2, WaterChunk::Size + 2 );
+		const int bpp = image->surf->format->BytesPerPixel;
+		foreach( p, chunk.touched ) {
+			Material const& m = getMaterial( p->x, p->y );
+			ALLEGRO_BITMAP* src = ( m.flows || m.is_stagnated_water ) ? watermap : background;
+			const int x = p->x * 2, y = p->y * 2;
+			if ( x + 1 >= image->w || y + 1 >= image->h || x + 1 >= src->w || y + 1 >= src->h )
+				continue;
+			memcpy( image->line[y] + x * bpp, src->line[y] + x * bpp, 2 * bpp );
+			memcpy( image->line[y+1] + x * bpp, src->line[y+1] + x * bpp, 2 * bpp );
+		}
+	}
+#endif
+	chunk.touched.clear();
+	
+	if ( chunk.passChanged ) {
+		chunk.passChanged = false;
+		m_terrainField.invalidate( (cx << WaterChunk::Shift) - 1, (cy << WaterChunk::Shift) - 1, WaterChunk::Size + 2, WaterChunk::Size + 2 );
+	}
+}
+
+void CMap::waterThink()
+{
+	if ( m_activeWaterChunks.empty() )
+		return;
+	
+	// Chunks of the same phase are at least one chunk apart. Water only
+	// touches its direct neighbour pixels, so they can run in parallel.
+	std::vector<size_t> phases[4];
+	foreach( i, m_activeWaterChunks ) {
+		int cx = int(*i % m_waterChunksX), cy = int(*i / m_waterChunksX);
+		phases[(cx & 1) | ((cy & 1) << 1)].push_back( *i );
+		m_waterChunks[*i].rndState = (unsigned int)rndgen() | 1;
+	}
+	
+	static const size_t MinChunksPerWorker = 16;
+	for ( int phase = 0; phase < 4; ++phase ) {
+		const std::vector<size_t>& chunks = phases[phase];
+		size_t numWorkers = threadPool ? CLAMP( chunks.size() / MinChunksPerWorker, (size_t)1, (size_t)MAX( gusGame.options.waterThreads, 1 ) ) : 1;
+		std::vector<ThreadPoolItem*> workers;
+		for ( size_t w = 1; w < numWorkers; ++w )
+			workers.push_back( threadPool->start( boost::bind( &CMap::waterThinkChunks, this, &chunks, w, numWorkers ), "Gusanos water" ) );
+		waterThinkChunks( &chunks, 0, numWorkers );
+		for ( size_t w = 0; w < workers.size(); ++w )
+			threadPool->wait( workers[w], NULL );
+	}
+	
+	std::vector<size_t> active;
+	active.swap( m_activeWaterChunks );
+	std::vector<WaterParticle> moved;
+	foreach( i, active ) {
+		WaterChunk& chunk = m_waterChunks[*i];
+		waterFlush( *i );
+		moved.insert( moved.end(), chunk.outgoing.begin(), chunk.outgoing.end() );
+		chunk.outgoing.clear();
+		chunk.active = false;
+	}
+	foreach( i, active ) {
+		WaterChunk& chunk = m_waterChunks[*i];
+		if ( !chunk.particles.empty() && !chunk.active ) {
+			chunk.active = true;
+			m_activeWaterChunks.push_back( *i );
+		}
+	}
+	foreach( wp, moved )
+		addWater( *wp );
+}
+
 void CMap::gusThink()
 {
 	if(!gusIsLoaded())
@@ -220,53 +429,7 @@ void CMap::gusThink()
 			m_config->gameStart->run(0,0,0,0);
 	}
 #ifndef DEDICATED_ONLY
-	foreach_delete( wp, m_water ) {
-		if ( getMaterialIndex( wp->x, wp->y ) != wp->mat ) {
-			copypixel_solid2x2(image, background, wp->x*2, wp->y*2);
-			m_water.erase(wp);
-		} else
-			if ( rnd() > WaterSkipFactor ) {
-				unsigned char mat = getMaterialIndex( wp->x, wp->y+1 );
-				if ( m_materialList[mat].particle_pass && !m_materialList[mat].flows) {
-					checkWBorders( wp->x, wp->y  );
-					copypixel_solid2x2(image, background, wp->x*2, wp->y*2);
-					putMaterial( 1, wp->x, wp->y );
-					++wp->y;
-					copypixel_solid2x2(image, watermap, wp->x*2, wp->y*2);
-					putMaterial( wp->mat, wp->x, wp->y );
-					wp->count = 0; // Reset stagnation counter because it moved
-				} else {
-					char dir;
-					if ( wp->dir )
-						dir = 1;
-					else
-						dir = -1;
-
-					mat = getMaterialIndex( wp->x+dir, wp->y );
-					if ( m_materialList[mat].particle_pass && !m_materialList[mat].flows ) {
-						checkWBorders( wp->x, wp->y );
-						copypixel_solid2x2(image, background, wp->x*2, wp->y*2);
-						putMaterial( 1, wp->x, wp->y );
-						wp->x += dir;
-						copypixel_solid2x2(image, watermap, wp->x*2, wp->y*2);
-						putMaterial( wp->mat, wp->x, wp->y );
-						wp->count = 0;
-						// Reset stagnation counter because it moved
-					} else {
-						wp->dir = !wp->dir;
-						++wp->count; // It didnt move so the stagnation counter gets incremented.
-						if ( wp->count > 1 ) {
-							mat = getMaterialIndex( wp->x-dir, wp->y );
-							if ( !m_materialList[mat].particle_pass || m_materialList[mat].flows ) {
-								putMaterial( wp->mat+1, wp->x, wp->y );
-								putpixel_solid(image, wp->x, wp->y, getpixel(watermap, wp->x, wp->y) );
-								m_water.erase(wp);
-							}
-						}
-					}
-				}
-			}
-	}
+	waterThink();
 #endif
 }
 
@@ -441,11 +604,12 @@ bool CMap::getPredefinedSpawnLocation(CWorm* worm, CVec* v) {
 
 void CMap::loaderSucceeded()
 {
-	m_water.clear();
+	resetImageChanges();
+	resetWater();
 	for ( int y = 0; y < material->h; ++y )
 		for ( int x = 0; x < material->w; ++x ) {
 			if ( unsafeGetMaterial(x,y).flows && !unsafeGetMaterial(x,y).is_stagnated_water ) {
-				m_water.push_back( WaterParticle( x, y, getMaterialIndex(x,y) ) );
+				addWater( WaterParticle( x, y, getMaterialIndex(x,y) ) );
 			}
 
 			if ( unsafeGetMaterial(x,y).is_stagnated_water ) {
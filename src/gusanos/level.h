@@ -35,6 +35,10 @@ struct WaterParticle
 		dir = rndInt(2) != 0;
 	}
 	
+	WaterParticle( int x_, int y_, unsigned char material_, bool dir_ ) : x(x_), y(y_), dir(dir_), mat(material_), count(0)
+	{
+	}
+	
 	int x;
 	int y;
 	bool dir; // true is right false is left
@@ -42,6 +46,22 @@ struct WaterParticle
 	int count;
 };
 
+// The water simulation only runs over the chunks which contain moving water.
+// See CMap::waterThink().
+struct WaterChunk
+{
+	enum { Shift = 5, Size = 1 << Shift };
+	
+	WaterChunk() : rndState(1), passChanged(false), active(false) {}
+	
+	std::vector<WaterParticle> particles;
+	std::vector<WaterParticle> outgoing; // moved to another chunk, handed over after the step
+	std::vector<IVec> touched; // pixels which need an image update
+	unsigned int rndState;
+	bool passChanged; // particle_pass of some pixel changed, see TerrainField
+	bool active;
+};
+
 struct SpawnPoint
 {
 	SpawnPoint( const Vec& pos_, int team_ )
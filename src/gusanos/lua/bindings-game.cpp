@@ -618,6 +618,30 @@ static void initGameWrapper(LuaContext& context) {
 
 static void initSettingsWrapper(LuaContext& context, const std::string& snamespace);
 
+// Each settings wrapper keeps the var handles of the names which were accessed in a
+// table (upvalue 2), so a script which reads a setting every frame doesn't look it up by name.
+// Key is at index 2.
+static RegisteredVar* cachedSettingsVar(LuaContext& context) {
+	lua_pushvalue(context, 2);
+	lua_rawget(context, lua_upvalueindex(2));
+	RegisteredVar* var = NULL;
+	if(lua_isnumber(context, -1))
+		var = CScriptableVars::GetVar( (CScriptableVars::VarHandle)lua_tointeger(context, -1) );
+	lua_pop(context, 1);
+	return var;
+}
+
+static RegisteredVar* cacheSettingsVar(LuaContext& context, const std::string& fullVarName) {
+	// Check first, GetVarHandle() would also intern names which don't exist
+	RegisteredVar* var = CScriptableVars::GetVar(fullVarName);
+	if(var) {
+		lua_pushvalue(context, 2);
+		lua_pushinteger(context, (lua_Integer)CScriptableVars::GetVarHandle(fullVarName));
+		lua_rawset(context, lua_upvalueindex(2));
+	}
+	return var;
+}
+
 static int l_settings_get(lua_State* L) {
 	LuaContext context(L);
 
@@ -630,17 +654,20 @@ static int l_settings_get(lua_State* L) {
 		return 0;
 	}
 
-	std::string fullVarName = std::string(snamespace) + varname;
+	RegisteredVar* var = cachedSettingsVar(context);
+	if(!var) {
+		std::string fullVarName = std::string(snamespace) + varname;
 
-	if(CScriptableVars::haveSomethingWith(fullVarName + ".")) {
-		initSettingsWrapper(context, fullVarName + ".");
-		return 1;
-	}
+		if(CScriptableVars::haveSomethingWith(fullVarName + ".")) {
+			initSettingsWrapper(context, fullVarName + ".");
+			return 1;
+		}
 
-	RegisteredVar* var = CScriptableVars::GetVar(fullVarName);
-	if(!var) {
-		context.pushError("no var named " + fullVarName);
-		return 0;
+		var = cacheSettingsVar(context, fullVarName);
+		if(!var) {
+			context.pushError("no var named " + fullVarName);
+			return 0;
+		}
 	}
 
 	ClientRights rights; rights.Everything();
@@ -670,12 +697,14 @@ static int l_settings_set(lua_State* L) {
 		return 0;
 	}
 
-	std::string fullVarName = std::string(snamespace) + varname;
-
-	RegisteredVar* var = CScriptableVars::GetVar(fullVarName);
+	RegisteredVar* var = cachedSettingsVar(context);
 	if(!var) {
-		context.pushError("no var named " + fullVarName);
-		return 0;
+		std::string fullVarName = std::string(snamespace) + varname;
+		var = cacheSettingsVar(context, fullVarName);
+		if(!var) {
+			context.pushError("no var named " + fullVarName);
+			return 0;
+		}
 	}
 
 	ClientRights rights; rights.Everything();
@@ -706,15 +735,21 @@ static void initSettingsWrapper(LuaContext& context, const std::string& snamespa
 	{
 		context.newtable(); // meta
 		{
+			context.newtable(); // var handles, see cachedSettingsVar
+
 			context.push("__index");
 			context.push(snamespace);
-			lua_pushcclosure(context, l_settings_get, 1);
-			lua_rawset(context, -3);
+			lua_pushvalue(context, -3);
+			lua_pushcclosure(context, l_settings_get, 2);
+			lua_rawset(context, -4);
 
 			context.push("__newindex");
 			context.push(snamespace);
-			lua_pushcclosure(context, l_settings_set, 1);
-			lua_rawset(context, -3);
+			lua_pushvalue(context, -3);
+			lua_pushcclosure(context, l_settings_set, 2);
+			lua_rawset(context, -4);
+
+			lua_pop(context, 1); // var handles
 		}
 		lua_setmetatable(context, -2);
 	}
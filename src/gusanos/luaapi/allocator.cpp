@@ -0,0 +1,142 @@
+#include "allocator.h"
+#include <cstdlib>
+#include <cstring>
+
+LuaAllocator::LuaAllocator()
+: m_chunkPos(0), m_chunkEnd(0)
+{
+	for(size_t i = 0; i < ClassCount; ++i)
+		m_freeLists[i] = 0;
+}
+
+LuaAllocator::~LuaAllocator()
+{
+	for(std::vector<char*>::iterator i = m_chunks.begin(); i != m_chunks.end(); ++i)
+		free(*i);
+}
+
+void* LuaAllocator::alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	LuaAllocator& a = *static_cast<LuaAllocator*>(ud);
+
+	if(nsize == 0)
+	{
+		if(ptr)
+		{
+			a.deallocate(ptr, osize);
+			++a.m_stats.frees;
+			a.m_stats.bytesInUse -= osize;
+		}
+		return 0;
+	}
+
+	void* p = 0;
+	if(ptr)
+	{
+		p = a.reallocate(ptr, osize, nsize);
+		++a.m_stats.reallocs;
+	}
+	else
+	{
+		p = a.allocate(nsize);
+		++a.m_stats.allocs;
+	}
+	if(!p)
+		return 0; // Lua raises a memory error, the old block is still valid
+
+	a.m_stats.bytesAllocated += nsize;
+	a.m_stats.bytesInUse += nsize;
+	a.m_stats.bytesInUse -= ptr ? osize : 0;
+	if(a.m_stats.bytesInUse > a.m_stats.peakBytes)
+		a.m_stats.peakBytes = a.m_stats.bytesInUse;
+	return p;
+}
+
+void* LuaAllocator::allocate(size_t size)
+{
+	if(!pooled(size))
+		return malloc(size);
+	return allocatePooled(sizeClass(size));
+}
+
+void LuaAllocator::deallocate(void* ptr, size_t size)
+{
+	if(!pooled(size))
+	{
+		free(ptr);
+		return;
+	}
+
+	FreeBlock* b = static_cast<FreeBlock*>(ptr);
+	size_t cls = sizeClass(size);
+	b->next = m_freeLists[cls];
+	m_freeLists[cls] = b;
+}
+
+void* LuaAllocator::reallocate(void* ptr, size_t osize, size_t nsize)
+{
+	if(!pooled(osize) && !pooled(nsize))
+		return realloc(ptr, nsize);
+
+	// Growing a string buffer or table part often stays in the same class
+	if(pooled(osize) && pooled(nsize) && sizeClass(osize) == sizeClass(nsize))
+	{
+		++m_stats.pooledAllocs;
+		return ptr;
+	}
+
+	void* p = pooled(nsize) ? allocatePooled(sizeClass(nsize)) : malloc(nsize);
+	if(!p)
+		return 0;
+	memcpy(p, ptr, (osize < nsize) ? osize : nsize);
+	deallocate(ptr, osize);
+	return p;
+}
+
+void* LuaAllocator::allocatePooled(size_t cls)
+{
+	++m_stats.pooledAllocs;
+
+	FreeBlock* b = m_freeLists[cls];
+	if(b)
+	{
+		m_freeLists[cls] = b->next;
+		return b;
+	}
+
+	const size_t size = (cls + 1) * Granularity;
+	if(size_t(m_chunkEnd - m_chunkPos) < size)
+	{
+		newChunk();
+		if(!m_chunkPos)
+			return 0;
+	}
+
+	void* p = m_chunkPos;
+	m_chunkPos += size;
+	return p;
+}
+
+void LuaAllocator::newChunk()
+{
+	// The rest of the old chunk is smaller than MaxPooledSize and a multiple
+	// of Granularity, so it fits exactly into one class
+	size_t rest = m_chunkEnd - m_chunkPos;
+	if(rest > 0)
+	{
+		FreeBlock* b = reinterpret_cast<FreeBlock*>(m_chunkPos);
+		size_t cls = sizeClass(rest);
+		b->next = m_freeLists[cls];
+		m_freeLists[cls] = b;
+	}
+
+	m_chunkPos = m_chunkEnd = 0;
+	char* chunk = static_cast<char*>(malloc(ChunkSize));
+	if(!chunk)
+		return;
+
+	m_chunks.push_back(chunk);
+	m_chunkPos = chunk;
+	m_chunkEnd = chunk + ChunkSize;
+	m_stats.poolBytes += ChunkSize;
+}
@@ -0,0 +1,70 @@
+#ifndef LUA_ALLOCATOR_H
+#define LUA_ALLOCATOR_H
+
+#include <cstddef>
+#include <vector>
+
+/* Size-class pool allocator for a Lua state (a lua_Alloc, the allocator is the ud).
+
+  Most of what Lua allocates are small tables, strings, closures and upvalues.
+  Blocks up to MaxPooledSize bytes come from free lists, one per multiple of
+  Granularity bytes, which are refilled from ChunkSize chunks. Lua always
+  passes the old size of a block, so the blocks don't need a header.
+  Bigger blocks go to malloc/realloc.
+
+  Pooled memory is reused for the same size class but only given back to the
+  system when the allocator is destroyed, i.e. after lua_close.
+  */
+
+class LuaAllocator
+{
+public:
+	static const size_t Granularity = 8; // also the alignment, Lua wants doubles and pointers aligned
+	static const size_t MaxPooledSize = 256;
+	static const size_t ChunkSize = 16 * 1024;
+	static const size_t ClassCount = MaxPooledSize / Granularity;
+
+	struct Stats
+	{
+		size_t allocs, reallocs, frees;
+		size_t pooledAllocs; // of allocs and reallocs, served by the free lists
+		size_t bytesInUse, peakBytes; // as requested by Lua
+		size_t bytesAllocated; // sum of all allocs and reallocs
+		size_t poolBytes; // reserved in chunks
+		Stats() : allocs(0), reallocs(0), frees(0), pooledAllocs(0), bytesInUse(0), peakBytes(0), bytesAllocated(0), poolBytes(0) {}
+	};
+
+	LuaAllocator();
+	~LuaAllocator();
+
+	static void* alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+	Stats const& stats() const { return m_stats; }
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	static bool pooled(size_t size) { return size > 0 && size <= MaxPooledSize; }
+	static size_t sizeClass(size_t size) { return (size - 1) / Granularity; }
+
+	void* allocate(size_t size);
+	void deallocate(void* ptr, size_t size);
+	void* reallocate(void* ptr, size_t osize, size_t nsize);
+	void* allocatePooled(size_t cls);
+	void newChunk();
+
+	FreeBlock* m_freeLists[ClassCount];
+	std::vector<char*> m_chunks;
+	char* m_chunkPos; // the unused rest of the newest chunk
+	char* m_chunkEnd;
+	Stats m_stats;
+
+	// not copyable
+	LuaAllocator(LuaAllocator const&);
+	LuaAllocator& operator=(LuaAllocator const&);
+};
+
+#endif //LUA_ALLOCATOR_H
@@ -1,5 +1,7 @@
 #include <cstdlib>
+#include <SDL.h>
 #include "context.h"
+#include "profiler.h"
 #include "Debug.h"
 
 extern "C"
@@ -17,6 +19,9 @@ extern "C"
 #include "gusanos/lua/bindings.h"
 #include "gusanos/LuaCallbacks.h"
 #include "FindFile.h"
+#include "gusanos/script_cache.h"
+#include "FrameProfiler.h"
+#include "Metrics.h"
 #include <cmath>
 #include <map>
 #include <set>
@@ -105,21 +110,34 @@ LuaContext::LuaContext(lua_State* L) {
 
 namespace
 {
-	void* l_alloc (void*, void* ptr, size_t, size_t nsize)
+	// What we keep per lua_State, the ud of its allocator
+	struct StateData
 	{
-		if (nsize == 0)
-		{
-			free(ptr);
-			return 0;
-		}
-		else
-			return realloc(ptr, nsize);
+		LuaAllocator allocator;
+		LuaContext::GCStats gc;
+		bool frameGC; // the collector only runs in gcFrame()
+		bool inCycle;
+		int nextCycleKB; // heap size at which gcFrame() starts the next cycle
+		
+		StateData() : frameGC(false), inCycle(false), nextCycleKB(0) {}
+	};
+	
+	StateData& stateData(lua_State* L)
+	{
+		void* ud = 0;
+		lua_getallocf(L, &ud);
+		return *static_cast<StateData*>(ud);
+	}
+	
+	void* l_alloc (void* ud, void* ptr, size_t osize, size_t nsize)
+	{
+		return LuaAllocator::alloc(&static_cast<StateData*>(ud)->allocator, ptr, osize, nsize);
 	}
 }
 
 void LuaContext::init()
 {
-	weakRef.set(lua_newstate(l_alloc, 0));
+	weakRef.set(lua_newstate(l_alloc, new StateData()));
 
 	lua_pushinteger(*this, 3);
 	lua_rawseti(*this, LUA_REGISTRYINDEX, ARRAY_SIZE);
@@ -152,10 +170,50 @@ const char * LuaContext::istreamChunkReader(lua_State *L, void *data, size_t *si
 		return 0;
 }
 
+namespace
+{
+	int stringWriter(lua_State*, const void* p, size_t size, void* ud)
+	{
+		static_cast<std::string*>(ud)->append(static_cast<char const*>(p), size);
+		return 0;
+	}
+}
+
+// Like lua_load, but takes the bytecode from the ScriptCache if it is there
+static int loadCached(lua_State* L, std::string const& chunk, std::istream& stream) // [0,1]
+{
+	if(!ScriptCache::enabled())
+		return lua_load(L, LuaContext::istreamChunkReader, &stream, chunk.c_str());
+	
+	std::string source;
+	ScriptCache::readAll(stream, source);
+	
+	// The bytecode has the chunk name in it and depends on the Lua build
+	const std::string salt = chunk + "\n" LUA_RELEASE "\n" + to_string(sizeof(void*)) + to_string(sizeof(lua_Number));
+	const Uint64 key = ScriptCache::hash(source, ScriptCache::hash(salt));
+	
+	std::string bytecode;
+	if(ScriptCache::read("luac", key, bytecode))
+	{
+		if(luaL_loadbuffer(L, bytecode.data(), bytecode.size(), chunk.c_str()) == 0)
+			return 0;
+		lua_pop(L, 1); // Pop error message, compile it again
+	}
+	
+	int result = luaL_loadbuffer(L, source.data(), source.size(), chunk.c_str());
+	if(result == 0)
+	{
+		bytecode.clear();
+		if(lua_dump(L, stringWriter, &bytecode) == 0)
+			ScriptCache::write("luac", key, bytecode);
+	}
+	return result;
+}
+
 void LuaContext::load(std::string const& chunk, std::istream& stream)
 {
 	lua_pushcfunction(*this, errorReport);
-	int result = lua_load(*this, istreamChunkReader, &stream, chunk.c_str());
+	int result = loadCached(*this, chunk, stream);
 	
 	if(result)
 	{
@@ -377,9 +435,18 @@ void LuaContext::load(std::string const& chunk, istream& stream, string const& t
 	}
 }*/
 
-int LuaContext::call(int params, int returns, int errfunc)
+int LuaContext::call(int params, int returns, int errfunc, char const* label)
 {
+	PROFILE_ZONE(label ? label : "Lua");
+	Metrics::LuaCallTimer metricsTimer;
+	const bool profile = luaProfiler.enabled();
+	if(profile)
+		luaProfiler.enter(*this, params, label);
+	
 	int result = lua_pcall (*this, params, returns, errfunc);
+	
+	if(profile)
+		luaProfiler.leave(*this);
 		
 	switch(result)
 	{
@@ -944,11 +1011,85 @@ Result LuaContext::toScriptVar(int idx, ScriptVar_t& var) {
 void LuaContext::close()
 {
 	if(weakRef) {
+		StateData* data = &stateData(*this);
 		lua_close(*this);
+		delete data;
 		weakRef.overwriteShared(NULL);
 	}
 }
 
+void LuaContext::gcFrame(int budgetMs)
+{
+	lua_State* L = *this;
+	StateData& d = stateData(L);
+	
+	if(budgetMs <= 0)
+	{
+		if(d.frameGC)
+		{
+			lua_gc(L, LUA_GCRESTART, 0);
+			d.frameGC = false;
+		}
+		return;
+	}
+	
+	if(!d.frameGC)
+	{
+		// We don't know how far Lua is in its cycle, just continue it
+		d.frameGC = true;
+		d.inCycle = true;
+		d.nextCycleKB = lua_gc(L, LUA_GCCOUNT, 0) * 2;
+	}
+	
+	if(!d.inCycle && lua_gc(L, LUA_GCCOUNT, 0) < d.nextCycleKB)
+	{
+		lua_gc(L, LUA_GCSTOP, 0);
+		return;
+	}
+	d.inCycle = true;
+	
+	const Uint32 start = SDL_GetTicks();
+	Uint32 elapsed = 0;
+	while(elapsed < (Uint32)budgetMs)
+	{
+		d.gc.steps++;
+		if(lua_gc(L, LUA_GCSTEP, 0))
+		{
+			// Like Lua (LUAI_GCPAUSE), wait until the heap has doubled
+			d.gc.cycles++;
+			d.inCycle = false;
+			d.nextCycleKB = lua_gc(L, LUA_GCCOUNT, 0) * 2;
+			break;
+		}
+		elapsed = SDL_GetTicks() - start;
+	}
+	elapsed = SDL_GetTicks() - start;
+	
+	d.gc.frames++;
+	d.gc.lastPause = elapsed;
+	if(elapsed > d.gc.maxPause) d.gc.maxPause = elapsed;
+	
+	// If the frame steps can't keep up with the garbage, Lua keeps collecting
+	// in the next frame as before, the last LUA_GCSTEP has set it up for that
+	if(d.inCycle && lua_gc(L, LUA_GCCOUNT, 0) > d.nextCycleKB * 2)
+	{
+		d.gc.overruns++;
+		return;
+	}
+	
+	lua_gc(L, LUA_GCSTOP, 0);
+}
+
+LuaAllocator::Stats const& LuaContext::allocStats() const
+{
+	return stateData(*this).allocator.stats();
+}
+
+LuaContext::GCStats const& LuaContext::gcStats() const
+{
+	return stateData(*this).gc;
+}
+
 LuaContext::~LuaContext()
 {
 	// We might not always use the global instance but have a local one,
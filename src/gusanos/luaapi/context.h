@@ -7,6 +7,7 @@ extern "C"
 }
 
 #include "gusanos/luaapi/types.h"
+#include "gusanos/luaapi/allocator.h"
 #include "CodeAttributes.h"
 #include "util/WeakRef.h"
 #include "util/Result.h"
@@ -156,7 +157,8 @@ public:
 	/*
 	void load(std::string const& chunk, istream& stream, string const& table);
 	*/
-	int call(int params = 0, int returns = 0, int errfunc = 0);
+	// label groups the call in the profiler (LuaProfiler), e.g. the callback name
+	int call(int params = 0, int returns = 0, int errfunc = 0, char const* label = NULL);
 	
 	LuaContext& push(lua_CFunction v)
 	{
@@ -441,6 +443,25 @@ public:
 
 	void close();
 	
+	// Of the frame steps of the collector, see gcFrame()
+	struct GCStats
+	{
+		size_t frames; // in which the collector did some work
+		size_t steps;
+		size_t cycles; // finished within the frame steps
+		size_t overruns; // frames after which the collector had to keep running on its own
+		unsigned int lastPause, maxPause; // ms
+		GCStats() : frames(0), steps(0), cycles(0), overruns(0), lastPause(0), maxPause(0) {}
+	};
+	
+	// Runs the incremental collector for up to budgetMs, meant for the end of a
+	// frame. As long as this is used, Lua doesn't collect while allocating, so
+	// it can't interrupt the physics anymore. 0 gives the collection back to Lua.
+	void gcFrame(int budgetMs);
+	
+	LuaAllocator::Stats const& allocStats() const;
+	GCStats const& gcStats() const;
+	
 	~LuaContext();
 	
 	WeakRef<lua_State> weakRef;
@@ -0,0 +1,308 @@
+#include "profiler.h"
+#include "context.h"
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <sstream>
+
+LuaProfiler luaProfiler;
+
+namespace
+{
+	// Registry key of the table function -> entry index, with weak keys
+	char functionsKey;
+
+	std::string frameName(lua_Debug const& ar)
+	{
+		std::ostringstream s;
+		s << ar.short_src;
+		if(ar.linedefined > 0)
+			s << ":" << ar.linedefined;
+		std::string name = s.str();
+		// ';' separates the frames in folded stacks
+		std::replace(name.begin(), name.end(), ';', ':');
+		return name;
+	}
+
+	bool byTotalTime(LuaProfiler::Entry const* a, LuaProfiler::Entry const* b)
+	{
+		return a->totalUs > b->totalUs;
+	}
+
+	void forgetFunctions(LuaContext& context)
+	{
+		if(!context) return;
+		lua_pushlightuserdata(context, &functionsKey);
+		lua_pushnil(context);
+		lua_rawset(context, LUA_REGISTRYINDEX);
+	}
+}
+
+LuaProfiler::LuaProfiler()
+: m_enabled(false), m_sampleInterval(0), m_generation(0), m_sampleCount(0)
+{
+	m_paths.push_back(Path(size_t(-1), size_t(-1)));
+}
+
+void LuaProfiler::setHook(lua_State* L)
+{
+	if(m_sampleInterval > 0)
+		lua_sethook(L, sampleHook, LUA_MASKCOUNT, m_sampleInterval);
+	else if(lua_gethook(L) == sampleHook)
+		lua_sethook(L, NULL, 0, 0);
+}
+
+void LuaProfiler::start(int sampleInterval)
+{
+	m_enabled = true;
+	m_sampleInterval = std::max(sampleInterval, 0);
+	if(luaIngame) setHook(luaIngame);
+	if(luaGlobal) setHook(luaGlobal);
+}
+
+void LuaProfiler::stop()
+{
+	m_enabled = false;
+	m_sampleInterval = 0;
+	if(luaIngame) setHook(luaIngame);
+	if(luaGlobal) setHook(luaGlobal);
+}
+
+void LuaProfiler::reset()
+{
+	m_generation++;
+	m_entries.clear();
+	m_labels.clear();
+	m_paths.clear();
+	m_paths.push_back(Path(size_t(-1), size_t(-1)));
+	m_children.clear();
+	m_samples.clear();
+	m_sampleCount = 0;
+
+	// They have the indices of the old entries
+	forgetFunctions(luaIngame);
+	forgetFunctions(luaGlobal);
+}
+
+size_t LuaProfiler::functionEntry(lua_State* L, int func)
+{
+	lua_pushlightuserdata(L, &functionsKey);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if(!lua_istable(L, -1))
+	{
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_newtable(L);
+		lua_pushstring(L, "k");
+		lua_setfield(L, -2, "__mode");
+		lua_setmetatable(L, -2);
+		lua_pushlightuserdata(L, &functionsKey);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, LUA_REGISTRYINDEX);
+	}
+
+	lua_pushvalue(L, func);
+	lua_rawget(L, -2);
+	if(lua_isnumber(L, -1))
+	{
+		size_t e = (size_t)lua_tointeger(L, -1);
+		lua_pop(L, 2);
+		return e;
+	}
+	lua_pop(L, 1);
+
+	std::string name;
+	if(lua_isfunction(L, func))
+	{
+		lua_Debug ar;
+		lua_pushvalue(L, func);
+		lua_getinfo(L, ">S", &ar);
+		name = frameName(ar);
+	}
+	else
+		name = lua_typename(L, lua_type(L, func));
+
+	size_t e = m_entries.size();
+	m_entries.push_back(Entry(name));
+
+	// Weak keys, so a collected function can't leave its entry to a new one at the same address
+	lua_pushvalue(L, func);
+	lua_pushinteger(L, (lua_Integer)e);
+	lua_rawset(L, -3);
+	lua_pop(L, 1);
+	return e;
+}
+
+size_t LuaProfiler::labelEntry(char const* label)
+{
+	std::map<char const*, size_t>::iterator i = m_labels.find(label);
+	if(i != m_labels.end())
+		return i->second;
+
+	size_t e = m_entries.size();
+	m_entries.push_back(Entry(label, true));
+	m_labels[label] = e;
+	return e;
+}
+
+void LuaProfiler::enter(LuaContext& context, int params, char const* label)
+{
+	lua_State* L = context;
+	// The state might have been recreated since start()
+	if(m_sampleInterval > 0 && lua_gethook(L) != sampleHook)
+		setHook(L);
+
+	size_t func = functionEntry(L, lua_gettop(L) - params);
+	if(label)
+		push(context, labelEntry(label), false);
+	push(context, func, label != NULL);
+}
+
+void LuaProfiler::leave(LuaContext& context)
+{
+	if(m_stack.empty()) return;
+	bool labelled = m_stack.back().labelled;
+	pop(context);
+	if(labelled && !m_stack.empty())
+		pop(context);
+}
+
+void LuaProfiler::push(LuaContext& context, size_t entry, bool labelled)
+{
+	size_t parent = 0;
+	if(!m_stack.empty() && m_stack.back().generation == m_generation)
+		parent = m_stack.back().path;
+
+	std::pair<size_t, size_t> key(parent, entry);
+	std::map<std::pair<size_t, size_t>, size_t>::iterator i = m_children.find(key);
+	size_t path;
+	if(i != m_children.end())
+		path = i->second;
+	else
+	{
+		path = m_paths.size();
+		m_paths.push_back(Path(parent, entry));
+		m_children[key] = path;
+	}
+
+	LuaAllocator::Stats const& a = context.allocStats();
+	Frame f;
+	f.entry = entry;
+	f.path = path;
+	f.childUs = 0;
+	f.allocs = a.allocs;
+	f.allocBytes = a.bytesAllocated;
+	f.labelled = labelled;
+	f.generation = m_generation;
+	f.start = FrameProfiler::now();
+	m_stack.push_back(f);
+}
+
+void LuaProfiler::pop(LuaContext& context)
+{
+	const Uint64 end = FrameProfiler::now();
+	Frame f = m_stack.back();
+	m_stack.pop_back();
+	if(f.generation != m_generation)
+		return;
+
+	const Uint64 us = end - f.start;
+	const Uint64 selfUs = us - std::min(f.childUs, us);
+	LuaAllocator::Stats const& a = context.allocStats();
+
+	Entry& e = m_entries[f.entry];
+	e.calls++;
+	e.totalUs += us;
+	e.selfUs += selfUs;
+	e.maxUs = std::max(e.maxUs, us);
+	e.allocs += a.allocs - f.allocs;
+	e.allocBytes += a.bytesAllocated - f.allocBytes;
+	m_paths[f.path].selfUs += selfUs;
+
+	if(!m_stack.empty() && m_stack.back().generation == m_generation)
+		m_stack.back().childUs += us;
+}
+
+void LuaProfiler::sampleHook(lua_State* L, lua_Debug*)
+{
+	luaProfiler.sample(L);
+}
+
+void LuaProfiler::sample(lua_State* L)
+{
+	if(!m_enabled) return;
+
+	// The Lua stack already has the called functions, so only the labels are taken from our stack
+	std::string stack;
+	if(!m_stack.empty() && m_stack.back().generation == m_generation)
+		stack = pathName(m_stack.back().path, true);
+
+	std::vector<std::string> frames;
+	lua_Debug ar;
+	for(int level = 0; lua_getstack(L, level, &ar); ++level)
+	{
+		lua_getinfo(L, "S", &ar);
+		frames.push_back(frameName(ar));
+	}
+	for(std::vector<std::string>::reverse_iterator i = frames.rbegin(); i != frames.rend(); ++i)
+	{
+		if(!stack.empty()) stack += ";";
+		stack += *i;
+	}
+
+	m_samples[stack]++;
+	m_sampleCount++;
+}
+
+std::string LuaProfiler::pathName(size_t path, bool labelsOnly) const
+{
+	std::vector<size_t> entries;
+	for(size_t p = path; p != 0; p = m_paths[p].parent)
+	{
+		size_t e = m_paths[p].entry;
+		if(!labelsOnly || m_entries[e].label)
+			entries.push_back(e);
+	}
+
+	std::string name;
+	for(std::vector<size_t>::reverse_iterator i = entries.rbegin(); i != entries.rend(); ++i)
+	{
+		if(!name.empty()) name += ";";
+		name += m_entries[*i].name;
+	}
+	return name;
+}
+
+void LuaProfiler::sortedEntries(std::vector<Entry const*>& out) const
+{
+	out.clear();
+	out.reserve(m_entries.size());
+	for(std::vector<Entry>::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i)
+		out.push_back(&*i);
+	std::sort(out.begin(), out.end(), byTotalTime);
+}
+
+void LuaProfiler::writeTable(std::ostream& s) const
+{
+	std::vector<Entry const*> entries;
+	sortedEntries(entries);
+	s << "calls\ttotal_us\tself_us\tmax_us\tallocs\talloc_bytes\tname\n";
+	for(std::vector<Entry const*>::iterator i = entries.begin(); i != entries.end(); ++i)
+	{
+		Entry const& e = **i;
+		s << e.calls << "\t" << e.totalUs << "\t" << e.selfUs << "\t" << e.maxUs << "\t"
+		  << e.allocs << "\t" << e.allocBytes << "\t" << e.name << "\n";
+	}
+}
+
+void LuaProfiler::writeFolded(std::ostream& s) const
+{
+	for(size_t p = 1; p < m_paths.size(); ++p)
+		if(m_paths[p].selfUs > 0)
+			s << pathName(p) << " " << m_paths[p].selfUs << "\n";
+}
+
+void LuaProfiler::writeSamples(std::ostream& s) const
+{
+	for(std::map<std::string, size_t>::const_iterator i = m_samples.begin(); i != m_samples.end(); ++i)
+		s << i->first << " " << i->second << "\n";
+}
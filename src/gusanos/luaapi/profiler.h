@@ -0,0 +1,114 @@
+#ifndef LUA_PROFILER_H
+#define LUA_PROFILER_H
+
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+extern "C"
+{
+#include "lua.h"
+}
+
+class LuaContext;
+
+/* Profiler for the calls from the game into Lua.
+
+  LuaContext::call() reports every call. An entry is a Lua function (by its
+  source and line) or, if the caller gives one, a label such as the name of
+  a LuaCallbacks callback, which then is the parent of the function. Each
+  entry counts calls, total (with nested calls), self and max time in µs
+  and the allocations within.
+
+  With a sample interval, a count hook also records the Lua stack every
+  that many VM instructions, for a flamegraph of the Lua code itself.
+
+  When stopped, the only cost is a check of enabled() in LuaContext::call().
+  */
+
+class LuaProfiler
+{
+public:
+	struct Entry
+	{
+		std::string name;
+		size_t calls;
+		Uint64 totalUs, selfUs, maxUs;
+		size_t allocs, allocBytes;
+		bool label;
+		Entry(std::string const& name_, bool label_ = false)
+		: name(name_), calls(0), totalUs(0), selfUs(0), maxUs(0), allocs(0), allocBytes(0), label(label_)
+		{
+		}
+	};
+
+	LuaProfiler();
+
+	// sampleInterval is in VM instructions, 0 is no sampling
+	void start(int sampleInterval = 0);
+	void stop();
+	void reset();
+	bool enabled() const { return m_enabled; }
+	int sampleInterval() const { return m_sampleInterval; }
+
+	// Around lua_pcall. The function is below the params on the stack.
+	void enter(LuaContext& context, int params, char const* label);
+	void leave(LuaContext& context);
+
+	// Sorted by total time
+	void sortedEntries(std::vector<Entry const*>& out) const;
+	size_t sampleCount() const { return m_sampleCount; }
+
+	// Tab separated, one entry per line
+	void writeTable(std::ostream& s) const;
+	// Folded stacks ("a;b;c value") as flamegraph.pl reads them.
+	// The value is the self time in µs or the number of samples.
+	void writeFolded(std::ostream& s) const;
+	void writeSamples(std::ostream& s) const;
+
+private:
+	struct Path
+	{
+		size_t parent, entry;
+		Uint64 selfUs;
+		Path(size_t parent_, size_t entry_) : parent(parent_), entry(entry_), selfUs(0) {}
+	};
+
+	struct Frame
+	{
+		size_t entry, path;
+		Uint64 start, childUs;
+		size_t allocs, allocBytes;
+		bool labelled; // the label frame below belongs to the same call
+		unsigned int generation;
+	};
+
+	static void sampleHook(lua_State* L, lua_Debug* ar);
+	void sample(lua_State* L);
+	void setHook(lua_State* L);
+
+	size_t functionEntry(lua_State* L, int func);
+	size_t labelEntry(char const* label);
+	void push(LuaContext& context, size_t entry, bool labelled);
+	void pop(LuaContext& context);
+	std::string pathName(size_t path, bool labelsOnly = false) const;
+
+	bool m_enabled;
+	int m_sampleInterval;
+	unsigned int m_generation; // frames which were open during reset() don't count
+
+	std::vector<Entry> m_entries;
+	std::map<char const*, size_t> m_labels;
+	std::vector<Path> m_paths;
+	std::map<std::pair<size_t, size_t>, size_t> m_children; // (parent path, entry) -> path
+	std::vector<Frame> m_stack;
+
+	std::map<std::string, size_t> m_samples; // folded stack -> count
+	size_t m_sampleCount;
+};
+
+extern LuaProfiler luaProfiler;
+
+#endif //LUA_PROFILER_H
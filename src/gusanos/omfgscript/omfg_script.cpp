@@ -9,7 +9,12 @@
 #include "util/stringbuild.h"
 #include "util/text.h"
 #include "gusanos/allegro.h"
+#include "gusanos/script_cache.h"
 #include <boost/crc.hpp>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
 using std::auto_ptr;
 using std::cout;
 using std::endl;
@@ -555,9 +560,9 @@ struct ParserImpl : public TGrammar<ParserImpl>
 	};
 	
 	ParserImpl(std::istream& str_, ActionFactory& actionFactory_, std::string const& fileName_)
-	: str(str_), fileName(fileName_), actionFactory(actionFactory_)
+	: str(str_), fileName(fileName_), sourcePos(0), buffered(false), recording(false)
+	, eventCount(0), actionCount(0), actionFactory(actionFactory_)
 	{
-		this->next();
 	}
 	
 	~ParserImpl()
@@ -581,10 +586,44 @@ struct ParserImpl : public TGrammar<ParserImpl>
 	
 	size_t read(char* p, size_t s)
 	{
+		if(buffered)
+		{
+			size_t n = std::min(s, source.size() - sourcePos);
+			memcpy(p, source.data() + sourcePos, n);
+			sourcePos += n;
+			return n;
+		}
 		str.read(p, s);
 		return (size_t)str.gcount();
 	}
 	
+	bool run()
+	{
+		Uint64 key = 0;
+		if(ScriptCache::enabled())
+		{
+			ScriptCache::readAll(str, source);
+			buffered = true;
+			key = ScriptCache::hash(source, ScriptCache::hash(definitions()));
+			
+			std::string data;
+			const int firstLine = line;
+			if(ScriptCache::read("omfg", key, data) && loadCached(data))
+				return true;
+			line = firstLine; // loadCached() sets it
+			recording = true;
+		}
+		
+		this->next();
+		rule_lines();
+		if(!full())
+			return false;
+		
+		if(recording)
+			ScriptCache::write("omfg", key, serialize());
+		return true;
+	}
+	
 	void reportError(std::string const& error, Location loc)
 	{
 		loc.print(error);
@@ -645,6 +684,7 @@ struct ParserImpl : public TGrammar<ParserImpl>
 	
 	ActionDef* getAction(std::string const& name)
 	{
+		lastActionName = name;
 		crc.process_bytes(name.data(), name.size());
 		let_(i, actionFactory[name]);
 		if(i)
@@ -676,21 +716,352 @@ struct ParserImpl : public TGrammar<ParserImpl>
 	BaseAction* createAction(ActionDef* action, std::auto_ptr<Parameters> params)
 	{
 		params->calcCRC(crc);
+		if(recording)
+		{
+			actionsRecord.putString(lastActionName);
+			putParams(actionsRecord, *params);
+			++actionCount;
+		}
 		return action->create(params->params);
 	}
 	
 	void addEvent(GameEventDef* event, std::auto_ptr<Parameters> params, std::vector< boost::shared_ptr<BaseAction> >& actions)
 	{
 		params->calcCRC(crc);
+		if(recording)
+		{
+			eventsRecord.putString(event->name);
+			putParams(eventsRecord, *params);
+			eventsRecord.put(actionCount);
+			eventsRecord.data += actionsRecord.data;
+			actionsRecord.data.clear();
+			actionCount = 0;
+			++eventCount;
+		}
 		events.push_back(new GameEvent(event, params.release(), actions));
 	}
 	
+	// The cache entry depends on the events and actions that the game defines
+	std::string definitions()
+	{
+		std::ostringstream s;
+		s << "omfg1\n";
+		foreach(i, eventDef)
+		{
+			s << "event " << i->first << " " << i->second->type << " " << i->second->provideMask;
+			foreach(p, i->second->paramDef->params)
+				s << " " << p->name << (p->optional ? "?" : "");
+			s << "\n";
+		}
+		foreach(i, actionFactory.pimpl->actionDefs)
+		{
+			s << "action " << i->first << " " << i->second->requireMask;
+			foreach(p, i->second->paramDef->params)
+				s << " " << p->name << (p->optional ? "?" : "");
+			s << "\n";
+		}
+		return s.str();
+	}
+	
+	// Cached token kinds
+	enum
+	{
+		TDefault, TInt, TDouble, TString, TList, TFunc, TAdd, TSub, TMul, TDiv
+	};
+	
+	void putToken(ScriptCache::Writer& w, TokenBase* t)
+	{
+		if(BinOp* op = dynamic_cast<BinOp*>(t))
+		{
+			Uint8 kind = dynamic_cast<Add*>(t) ? TAdd : dynamic_cast<Sub*>(t) ? TSub : dynamic_cast<Mul*>(t) ? TMul : TDiv;
+			w.put(kind);
+			w.put((Sint32)t->loc.getLine());
+			putToken(w, op->a);
+			putToken(w, op->b);
+			return;
+		}
+		
+		switch(t->type())
+		{
+			case TokenBase::Type::Int:
+				w.put((Uint8)TInt);
+				w.put((Sint32)t->loc.getLine());
+				w.put((Sint32)t->toInt());
+				break;
+			case TokenBase::Type::Double:
+				w.put((Uint8)TDouble);
+				w.put((Sint32)t->loc.getLine());
+				w.put(t->toDouble());
+				break;
+			case TokenBase::Type::String:
+				w.put((Uint8)TString);
+				w.put((Sint32)t->loc.getLine());
+				w.putString(t->toString());
+				break;
+			case TokenBase::Type::List:
+			{
+				std::list<TokenBase*> const& l = t->toList();
+				w.put((Uint8)TList);
+				w.put((Sint32)t->loc.getLine());
+				w.put((Uint32)l.size());
+				foreach(i, l)
+					putToken(w, *i);
+				break;
+			}
+			case TokenBase::Type::Func:
+			{
+				Function const* f = t->toFunction();
+				w.put((Uint8)TFunc);
+				w.put((Sint32)t->loc.getLine());
+				w.putString(f->name);
+				w.put((Uint32)f->params.size());
+				foreach(i, f->params)
+					putToken(w, *i);
+				break;
+			}
+			default:
+				w.put((Uint8)TDefault);
+				w.put((Sint32)t->loc.getLine());
+		}
+	}
+	
+	// Returns 0 if the data is broken
+	TokenBase* getToken(ScriptCache::Reader& r, int depth = 0)
+	{
+		Uint8 kind = 0;
+		Sint32 l = 0;
+		if(depth > 64 || !r.get(kind) || !r.get(l))
+			return 0;
+		line = l; // for getLoc(), also used by the tokens of the grammar
+		Location loc = getLoc();
+		
+		switch(kind)
+		{
+			case TDefault:
+				return new TokenBase(loc);
+			case TInt:
+			{
+				Sint32 v = 0;
+				if(!r.get(v)) return 0;
+				return new INTEGER(*this, (int)v);
+			}
+			case TDouble:
+			{
+				double v = 0;
+				if(!r.get(v)) return 0;
+				char buf[64];
+				int n = snprintf(buf, sizeof(buf), "%.17g", v);
+				if(n <= 0 || n >= (int)sizeof(buf)) return 0;
+				return new NUMBER(*this, buf, buf + n);
+			}
+			case TString:
+			{
+				std::string v;
+				if(!r.getString(v)) return 0;
+				return new STRING(*this, v.data(), v.data() + v.size());
+			}
+			case TList:
+			{
+				Uint32 n = 0;
+				if(!r.get(n)) return 0;
+				std::auto_ptr<List> list(new List(loc));
+				for(Uint32 i = 0; i < n; ++i)
+				{
+					TokenBase::ptr el(getToken(r, depth + 1));
+					if(!el.get()) return 0;
+					list->add(el);
+				}
+				return list.release();
+			}
+			case TFunc:
+			{
+				std::string name;
+				Uint32 n = 0;
+				if(!r.getString(name) || !r.get(n)) return 0;
+				std::auto_ptr<Func> f(new Func(loc, name));
+				for(Uint32 i = 0; i < n; ++i)
+				{
+					TokenBase::ptr el(getToken(r, depth + 1));
+					if(!el.get()) return 0;
+					f->add(el);
+				}
+				return f.release();
+			}
+			case TAdd: case TSub: case TMul: case TDiv:
+			{
+				TokenBase::ptr a(getToken(r, depth + 1));
+				if(!a.get()) return 0;
+				TokenBase::ptr b(getToken(r, depth + 1));
+				if(!b.get()) return 0;
+				switch(kind)
+				{
+					case TAdd: return new Add(loc, a.release(), b.release());
+					case TSub: return new Sub(loc, a.release(), b.release());
+					case TMul: return new Mul(loc, a.release(), b.release());
+					default: return new Div(loc, a.release(), b.release());
+				}
+			}
+		}
+		return 0;
+	}
+	
+	void putParams(ScriptCache::Writer& w, Parameters& p)
+	{
+		w.put((Sint32)p.loc.getLine());
+		w.put((Uint32)p.params.size());
+		foreach(i, p.params)
+			putToken(w, *i);
+	}
+	
+	Parameters* getParams(ScriptCache::Reader& r, ParamDef* def)
+	{
+		Sint32 l = 0;
+		Uint32 n = 0;
+		if(!r.get(l) || !r.get(n) || n != def->params.size())
+			return 0;
+		std::auto_ptr<Parameters> p(new Parameters(def, Location(fileName, l)));
+		for(Uint32 i = 0; i < n; ++i)
+		{
+			if(!(p->params[i] = getToken(r)))
+				return 0;
+		}
+		return p.release();
+	}
+	
+	std::string serialize()
+	{
+		ScriptCache::Writer w;
+		w.put((Uint32)crc.get_interim_remainder());
+		w.put((Uint32)properties.size());
+		foreach(i, properties)
+		{
+			w.putString(i->first);
+			w.put((Sint32)i->second->loc.getLine());
+			putToken(w, i->second->value);
+		}
+		w.put(eventCount);
+		w.data += eventsRecord.data;
+		return w.data;
+	}
+	
+	// What loadCached() reads before it creates anything
+	struct CachedEvent
+	{
+		GameEventDef* def;
+		Parameters* params;
+		std::vector< std::pair<ActionDef*, Parameters*> > actions;
+		
+		CachedEvent() : def(0), params(0) {}
+	};
+	
+	struct CachedData
+	{
+		std::map<std::string, Property*> properties;
+		std::vector<CachedEvent> events;
+		
+		~CachedData()
+		{
+			foreach(i, properties)
+				delete i->second;
+			foreach(e, events)
+			{
+				delete e->params;
+				foreach(a, e->actions)
+					delete a->second;
+			}
+		}
+	};
+	
+	// Sets everything up as if the source was parsed
+	bool loadCached(std::string const& data)
+	{
+		ScriptCache::Reader r(data);
+		CachedData c;
+		
+		Uint32 crcRem = 0, count = 0;
+		if(!r.get(crcRem) || !r.get(count))
+			return false;
+		for(Uint32 i = 0; i < count; ++i)
+		{
+			std::string name;
+			Sint32 l = 0;
+			if(!r.getString(name) || !r.get(l))
+				return false;
+			TokenBase* t = getToken(r);
+			if(!t)
+				return false;
+			delete c.properties[name];
+			c.properties[name] = new Property(Location(fileName, l), t);
+		}
+		
+		if(!r.get(count))
+			return false;
+		for(Uint32 i = 0; i < count; ++i)
+		{
+			c.events.push_back(CachedEvent());
+			CachedEvent& e = c.events.back();
+			
+			std::string name;
+			Uint32 actions = 0;
+			if(!r.getString(name))
+				return false;
+			let_(d, eventDef.find(name));
+			if(d == eventDef.end())
+				return false;
+			e.def = d->second;
+			if(!(e.params = getParams(r, e.def->paramDef)) || !r.get(actions))
+				return false;
+			
+			for(Uint32 j = 0; j < actions; ++j)
+			{
+				if(!r.getString(name))
+					return false;
+				ActionDef* action = actionFactory[name];
+				if(!action || (action->requireMask & e.def->provideMask) != action->requireMask)
+					return false;
+				e.actions.push_back(std::make_pair(action, (Parameters*)0));
+				if(!(e.actions.back().second = getParams(r, action->paramDef)))
+					return false;
+			}
+		}
+		if(!r.atEnd())
+			return false;
+		
+		// All fine, now take it over
+		properties.swap(c.properties);
+		foreach(e, c.events)
+		{
+			std::vector< boost::shared_ptr<BaseAction> > actions;
+			foreach(a, e->actions)
+			{
+				actions.push_back( boost::shared_ptr<BaseAction>( a->first->create(a->second->params) ) );
+				delete a->second;
+				a->second = 0;
+			}
+			events.push_back(new GameEvent(e->def, e->params, actions));
+			e->params = 0;
+		}
+		
+		crc.reset(crcRem);
+		cur = 0; // see Parser::incomplete()
+		return true;
+	}
+	
 	std::istream& str;
 	std::string fileName;
 	std::map<std::string, Property*> properties;
 	std::list<GameEvent*> events;
 	boost::crc_32_type crc;
 	
+	// For the ScriptCache
+	std::string source;
+	size_t sourcePos;
+	bool buffered; // read() takes it from source
+	bool recording;
+	std::string lastActionName;
+	ScriptCache::Writer eventsRecord, actionsRecord; // see serialize()
+	Uint32 eventCount, actionCount;
+	
 	//
 	std::map<std::string, GameEventDef*> eventDef;
 	ActionFactory& actionFactory;
@@ -838,8 +1209,7 @@ TokenBase* Parser::getProperty(std::string const& a, std::string const& b)
 
 bool Parser::run()
 {
-	pimpl->rule_lines();
-	return pimpl->full();
+	return pimpl->run();
 }
 
 bool Parser::incomplete()
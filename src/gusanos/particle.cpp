@@ -316,17 +316,23 @@ void Particle::think()
 			float radius = m_type->radius;
 			float speedCorrection = m_type->bounceFactor;
 			float friction = m_type->groundFriction;
-			IVec iPos = IVec(Vec(pos()));
 			int n = 0;
-			int iradius = static_cast<int>(radius);
-			for ( int y = -iradius; y <= iradius; ++y )
-				for ( int x = -iradius; x <= iradius; ++x )
-				{
-					if ( !game.gameMap()->getMaterial( iPos.x + x, iPos.y + y ).particle_pass ) {
-						averageCorrection += getCorrectionBox( pos() , iPos + IVec( x, y ), radius );
-						++n;
+			if ( TerrainField::supportsRadius( radius ) ) {
+				// distance field lookup, already the averaged correction
+				if ( game.gameMap()->particleCorrection( pos(), radius, averageCorrection ) )
+					n = 1;
+			} else {
+				IVec iPos = IVec(Vec(pos()));
+				int iradius = static_cast<int>(radius);
+				for ( int y = -iradius; y <= iradius; ++y )
+					for ( int x = -iradius; x <= iradius; ++x )
+					{
+						if ( !game.gameMap()->getMaterial( iPos.x + x, iPos.y + y ).particle_pass ) {
+							averageCorrection += getCorrectionBox( pos() , iPos + IVec( x, y ), radius );
+							++n;
+						}
 					}
-				}
+			}
 			if ( n > 0 )
 			{
 				if ( averageCorrection.length() > 0 ) {
@@ -472,11 +478,31 @@ void Particle::drawLine2Origin( CViewport* viewport, BlitterContext const& blitt
 	}
 }
 
+bool Particle::getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h)
+{
+	if ( m_type->line2Origin || m_type->distortion || ( game.isLevelDarkMode() && m_type->lightHax ) )
+		return false;
+
+	IVec rPos = viewport->convertCoords( IVec(interpolatedPos()) );
+	if (!m_sprite) {
+		// like SimpleParticle
+		x = rPos.x - 1; y = rPos.y - 1;
+		w = h = 4;
+	} else {
+		// the culled drawing has the same bounds
+		Sprite* sprite = m_sprite->getSprite(m_animator->getFrame(), m_angle);
+		x = rPos.x - sprite->m_xPivot; y = rPos.y - sprite->m_yPivot;
+		w = sprite->getWidth(); h = sprite->getHeight();
+	}
+	return true;
+}
+
 void Particle::draw(CViewport* viewport)
 {
 
-	IVec rPos = viewport->convertCoords( IVec(Vec(pos())) );
-	Vec rPosPrec = viewport->convertCoordsPrec( pos() );
+	const Vec renderPos = interpolatedPos();
+	IVec rPos = viewport->convertCoords( IVec(renderPos) );
+	Vec rPosPrec = viewport->convertCoordsPrec( renderPos );
 	ALLEGRO_BITMAP* where = viewport->dest;
 	int x = rPos.x;
 	int y = rPos.y;
@@ -500,7 +526,7 @@ void Particle::draw(CViewport* viewport)
 			//Blitters::drawSpriteRotate_solid_32(where, m_sprite->getSprite(m_animator->getFrame())->m_bitmap, x, y, -m_angle.toRad());
 		} else {
 			Sprite* renderSprite = m_sprite->getSprite(m_animator->getFrame(), m_angle);
-			game.gameMap()->culledDrawSprite(renderSprite, viewport, IVec(Vec(pos())), (int)m_alpha );
+			game.gameMap()->culledDrawSprite(renderSprite, viewport, IVec(renderPos), (int)m_alpha );
 		}
 	}
 
@@ -41,6 +41,7 @@ public:
 	void assignNetworkRole( bool authority );
 #ifndef DEDICATED_ONLY
 	void draw(CViewport* viewport);
+	bool getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h);
 #endif
 	void think();
 	Angle getPointingAngle();
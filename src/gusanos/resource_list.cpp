@@ -1,2 +1,77 @@
 #include "resource_list.h"
+#include "FindFile.h"
+#include "StringUtils.h"
+#include <algorithm>
+#include <set>
 
+namespace
+{
+	// Deeper directories are not indexed, lookups there try all paths
+	const int MaxDepth = 8;
+	
+	struct NameCollector
+	{
+		std::set<std::string>& names;
+		NameCollector(std::set<std::string>& names_) : names(names_) {}
+		
+		bool operator()(std::string const& fileName)
+		{
+			names.insert(GetBaseFilename(fileName));
+			return true;
+		}
+	};
+}
+
+bool ResourceIndex::lookup(std::list<std::string> const& paths, std::string const& name, std::vector<size_t>& found)
+{
+	found.clear();
+	if(name.empty() || name[0] == '/' || name.find('\\') != std::string::npos || name.find("..") != std::string::npos)
+		return false;
+	if(std::count(name.begin(), name.end(), '/') >= MaxDepth)
+		return false;
+	
+	if(!m_built)
+		build(paths);
+	
+	std::map<std::string, std::vector<size_t> >::const_iterator i = m_names.find(stringtolower(name));
+	if(i != m_names.end())
+		found = i->second;
+	return true;
+}
+
+void ResourceIndex::build(std::list<std::string> const& paths)
+{
+	m_names.clear();
+	size_t n = 0;
+	for(std::list<std::string>::const_iterator i = paths.begin(); i != paths.end(); ++i, ++n)
+		add(n, *i, "", 0);
+	m_built = true;
+}
+
+void ResourceIndex::add(size_t path, std::string const& dir, std::string const& relDir, int depth)
+{
+	std::set<std::string> files, dirs;
+	NameCollector fileCollector(files), dirCollector(dirs);
+	// Over all search paths, like the loading of the resource itself
+	const bool absolute = IsAbsolutePath(dir);
+	FindFiles(fileCollector, dir, absolute, FM_REG);
+	FindFiles(dirCollector, dir, absolute, FM_DIR);
+	
+	files.insert(dirs.begin(), dirs.end());
+	for(std::set<std::string>::iterator i = files.begin(); i != files.end(); ++i)
+	{
+		std::string name = stringtolower(relDir + *i);
+		std::vector<size_t>* entries[2] = { &m_names[name], 0 };
+		size_t dot = name.rfind('.');
+		if(dot != std::string::npos && dot > relDir.size())
+			entries[1] = &m_names[name.substr(0, dot)];
+		
+		for(int e = 0; e < 2 && entries[e]; ++e)
+			if(entries[e]->empty() || entries[e]->back() != path)
+				entries[e]->push_back(path);
+	}
+	
+	if(depth + 1 < MaxDepth)
+		for(std::set<std::string>::iterator i = dirs.begin(); i != dirs.end(); ++i)
+			add(path, dir + "/" + *i, relDir + *i + "/", depth + 1);
+}
@@ -24,6 +24,36 @@ namespace fs {
 using std::cerr;
 using std::endl;
 
+/* Which of the paths of a ResourceList have which files and directories.
+
+  Built on the first lookup by listing the paths once, so loading a resource
+  only tries the paths which actually have it instead of every path in turn.
+  Names are indexed in lower case (the file lookup ignores the case) and also
+  without their extension, as some resources probe several extensions.
+  */
+class ResourceIndex
+{
+public:
+	ResourceIndex() : m_built(false) {}
+	
+	void invalidate()
+	{
+		m_built = false;
+		m_names.clear();
+	}
+	
+	// Indices into paths which might have name, in order.
+	// Returns false if the index can't tell, then all paths have to be tried.
+	bool lookup(std::list<std::string> const& paths, std::string const& name, std::vector<size_t>& found);
+	
+private:
+	void build(std::list<std::string> const& paths);
+	void add(size_t path, std::string const& dir, std::string const& relDir, int depth);
+	
+	bool m_built;
+	std::map<std::string, std::vector<size_t> > m_names;
+};
+
 template<typename T1>
 class ResourceList
 {
@@ -40,6 +70,7 @@ public:
 	void clear()
 	{
 		m_paths.clear();
+		m_index.invalidate();
 		typename MapT::iterator item = m_resItems.begin();
 		for (; item != m_resItems.end(); ++item)
 		{
@@ -55,10 +86,25 @@ public:
 		for(std::list<std::string>::iterator i = m_paths.begin(); i != m_paths.end(); ++i)
 			if(path == *i) return;
 		m_paths.push_back(path);
+		m_index.invalidate();
 	}
 	
 	bool load(std::string const& name, T1& resource)
 	{
+		std::vector<size_t> found;
+		if(m_index.lookup(m_paths, name, found))
+		{
+			std::list<std::string>::iterator i = m_paths.begin();
+			size_t n = 0;
+			for(std::vector<size_t>::iterator f = found.begin(); f != found.end(); ++f)
+			{
+				for(; n < *f; ++n) ++i;
+				if(resource.load(*i + "/" + name))
+					return true;
+			}
+			return false;
+		}
+		
 		std::list<std::string>::iterator i = m_paths.begin();
 		for(; i != m_paths.end(); ++i)
 		{
@@ -167,6 +213,7 @@ private:
 	std::vector<T1*> m_resItemsIndex;
 	MapT m_resItems;
 	std::list<std::string>     m_paths; // Paths to scan
+	ResourceIndex m_index;
 };
 
 #endif // _RESOURCE_LIST_H_
@@ -0,0 +1,102 @@
+#include "script_cache.h"
+#include "FindFile.h"
+#include "Options.h"
+#include "Debug.h"
+#include "util/StringConv.h"
+
+#include <cstdio>
+#include <istream>
+#include <iterator>
+#ifdef WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace ScriptCache
+{
+
+namespace
+{
+	char const Magic[8] = { 'O','L','X','G','U','S','C','1' };
+
+	struct Header
+	{
+		char magic[8];
+		Uint64 key;
+		Uint64 size;
+	};
+
+	std::string fileName(std::string const& kind, Uint64 key)
+	{
+		return "cache/gusanos/" + hex(key) + "." + kind;
+	}
+}
+
+bool enabled()
+{
+	return tLXOptions && tLXOptions->bGusanosScriptCache;
+}
+
+Uint64 hash(std::string const& data, Uint64 h)
+{
+	for(std::string::const_iterator i = data.begin(); i != data.end(); ++i)
+	{
+		h ^= (unsigned char)*i;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+void readAll(std::istream& stream, std::string& data)
+{
+	data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+bool read(std::string const& kind, Uint64 key, std::string& data)
+{
+	FILE* fp = OpenGameFile(fileName(kind, key), "rb");
+	if(!fp) return false;
+
+	Header head;
+	bool ok = fread(&head, sizeof(head), 1, fp) == 1
+		&& memcmp(head.magic, Magic, sizeof(Magic)) == 0
+		&& head.key == key
+		&& head.size < 64 * 1024 * 1024;
+	if(ok)
+	{
+		data.resize((size_t)head.size);
+		ok = head.size == 0 || fread(&data[0], (size_t)head.size, 1, fp) == 1;
+	}
+	fclose(fp);
+	return ok;
+}
+
+void write(std::string const& kind, Uint64 key, std::string const& data)
+{
+	const std::string fullFile = GetWriteFullFileName(fileName(kind, key), true);
+	const std::string tmpFile = fullFile + ".tmp" + itoa((int)getpid());
+	FILE* fp = OpenAbsFile(tmpFile, "wb");
+	if(!fp)
+	{
+		warnings << "ScriptCache: cannot write " << tmpFile << endl;
+		return;
+	}
+
+	Header head;
+	memcpy(head.magic, Magic, sizeof(Magic));
+	head.key = key;
+	head.size = data.size();
+	bool ok = fwrite(&head, sizeof(head), 1, fp) == 1
+		&& (data.empty() || fwrite(data.data(), data.size(), 1, fp) == 1);
+	fclose(fp);
+
+	if(!ok || rename(tmpFile.c_str(), fullFile.c_str()) != 0)
+	{
+		warnings << "ScriptCache: writing " << fullFile << " failed" << endl;
+		remove(tmpFile.c_str());
+	}
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef SCRIPT_CACHE_H
+#define SCRIPT_CACHE_H
+
+#include <SDL.h>
+#include <string>
+#include <cstring>
+#include <iosfwd>
+
+/* On-disk cache of compiled Gusanos scripts (Lua bytecode, parsed OmfgScript).
+
+  Entries are stored as cache/gusanos/<key>.<kind>, where the key is a hash of
+  the source and of everything else the result depends on. A changed source
+  thus just gets a new entry. Entries are written to a temp file first and
+  renamed, so a parallel running game never sees a half-written one.
+  */
+
+namespace ScriptCache
+{
+	static const Uint64 HashInit = 14695981039346656037ULL;
+
+	bool enabled();
+
+	// FNV-1a, can be chained through h
+	Uint64 hash(std::string const& data, Uint64 h = HashInit);
+
+	bool read(std::string const& kind, Uint64 key, std::string& data);
+	void write(std::string const& kind, Uint64 key, std::string const& data);
+
+	// Reads the rest of the stream
+	void readAll(std::istream& stream, std::string& data);
+
+	struct Writer
+	{
+		std::string data;
+
+		void put(void const* p, size_t n) { data.append(static_cast<char const*>(p), n); }
+		template<typename T> void put(T const& v) { put(&v, sizeof(T)); }
+		void putString(std::string const& s)
+		{
+			put((Uint32)s.size());
+			put(s.data(), s.size());
+		}
+	};
+
+	// Bounds-checked
+	struct Reader
+	{
+		char const* p;
+		char const* end;
+		Reader(std::string const& data) : p(data.data()), end(data.data() + data.size()) {}
+
+		bool atEnd() const { return p == end; }
+		template<typename T> bool get(T& v)
+		{
+			if((size_t)(end - p) < sizeof(T)) return false;
+			memcpy(&v, p, sizeof(T));
+			p += sizeof(T);
+			return true;
+		}
+		bool getString(std::string& s)
+		{
+			Uint32 len = 0;
+			if(!get(len) || (size_t)(end - p) < len) return false;
+			s.assign(p, len);
+			p += len;
+			return true;
+		}
+	};
+}
+
+#endif // SCRIPT_CACHE_H
@@ -50,6 +50,15 @@ void SimpleParticle::think()
 }
 
 #ifndef DEDICATED_ONLY
+bool SimpleParticle::getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h)
+{
+	// 2x2 pixels, the wu variants can spread one pixel further
+	IVec rPos = viewport->convertCoords(IVec(Vec(pos())));
+	x = rPos.x - 1; y = rPos.y - 1;
+	w = h = 4;
+	return true;
+}
+
 void SimpleParticle::draw(CViewport* viewport)
 {
 	IVec rPos = viewport->convertCoords(IVec(Vec(pos())));
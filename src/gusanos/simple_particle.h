@@ -20,6 +20,7 @@ public:
 	}
 
 	void draw(CViewport* viewport);
+	bool getDrawRect(CViewport* viewport, int& x, int& y, int& w, int& h);
 	void think();
 		
 	void* operator new(size_t count);
@@ -0,0 +1,150 @@
+#include "terrain_field.h"
+
+#include "game/CMap.h"
+#include "material.h"
+#include "MathLib.h"
+
+#include <cmath>
+
+TerrainField::TerrainField()
+: m_width(0), m_height(0), m_tilesX(0), m_tilesY(0)
+{
+}
+
+void TerrainField::reset()
+{
+	m_width = m_height = 0;
+	m_tilesX = m_tilesY = 0;
+	std::vector<short>().swap(m_values);
+	std::vector<bool>().swap(m_dirty);
+}
+
+void TerrainField::init(CMap& map)
+{
+	m_width = map.material->w;
+	m_height = map.material->h;
+	m_tilesX = (m_width + TileSize - 1) >> TileShift;
+	m_tilesY = (m_height + TileSize - 1) >> TileShift;
+	m_values.assign(m_width * m_height, 0);
+	m_dirty.assign(m_tilesX * m_tilesY, true);
+}
+
+void TerrainField::invalidate(int x, int y, int w, int h)
+{
+	if(m_values.empty() || w <= 0 || h <= 0)
+		return;
+
+	// A changed pixel affects the distance of everything up to MaxDist away
+	int tx1 = MAX(x - MaxDist, 0) >> TileShift;
+	int ty1 = MAX(y - MaxDist, 0) >> TileShift;
+	int tx2 = MIN(x + w + MaxDist, m_width - 1) >> TileShift;
+	int ty2 = MIN(y + h + MaxDist, m_height - 1) >> TileShift;
+
+	for(int ty = ty1; ty <= ty2; ++ty)
+		for(int tx = tx1; tx <= tx2; ++tx)
+			m_dirty[ty * m_tilesX + tx] = true;
+}
+
+void TerrainField::rebuildTile(CMap& map, int tx, int ty)
+{
+	// The tile plus a MaxDist border is enough to find every blocking
+	// (or free) pixel in range. Pixels outside of the map count as blocking,
+	// like CMap::getMaterial() returns the solid material for them.
+	enum { Region = TileSize + 2 * MaxDist, Inf = 2 * Region };
+	bool solid[Region * Region];
+	short toSolid[Region * Region]; // vertical distance to nearest solid pixel
+	short toFree[Region * Region]; // vertical distance to nearest free pixel
+
+	const int rx = (tx << TileShift) - MaxDist;
+	const int ry = (ty << TileShift) - MaxDist;
+
+	for(int y = 0; y < Region; ++y)
+		for(int x = 0; x < Region; ++x)
+			solid[y * Region + x] = !map.getMaterial(rx + x, ry + y).particle_pass;
+
+	for(int x = 0; x < Region; ++x) {
+		short ds = Inf, df = Inf;
+		for(int y = 0; y < Region; ++y) {
+			const int i = y * Region + x;
+			if(solid[i]) { ds = 0; df = MIN(df + 1, (int)Inf); }
+			else { df = 0; ds = MIN(ds + 1, (int)Inf); }
+			toSolid[i] = ds; toFree[i] = df;
+		}
+		ds = Inf; df = Inf;
+		for(int y = Region - 1; y >= 0; --y) {
+			const int i = y * Region + x;
+			if(solid[i]) { ds = 0; df = MIN(df + 1, (int)Inf); }
+			else { df = 0; ds = MIN(ds + 1, (int)Inf); }
+			toSolid[i] = MIN(toSolid[i], ds); toFree[i] = MIN(toFree[i], df);
+		}
+	}
+
+	const int x2 = MIN(TileSize, m_width - (tx << TileShift));
+	const int y2 = MIN(TileSize, m_height - (ty << TileShift));
+	const int maxDistSqr = (MaxDist + 1) * (MaxDist + 1);
+
+	for(int y = 0; y < y2; ++y)
+		for(int x = 0; x < x2; ++x) {
+			const int ix = x + MaxDist, iy = y + MaxDist;
+			const bool inside = solid[iy * Region + ix];
+			const short* column = inside ? toFree : toSolid;
+
+			int best = maxDistSqr;
+			for(int dx = -MaxDist; dx <= MaxDist; ++dx) {
+				const int dy = column[iy * Region + ix + dx];
+				best = MIN(best, dx * dx + dy * dy);
+			}
+
+			// distance between pixel centers minus half a pixel is the distance
+			// to the edge of the nearest box, which is what getCorrectionBox() uses
+			float d = CLAMP((float)std::sqrt((float)best) - 0.5f, 0.0f, (float)MaxDist);
+			if(inside) d = -d;
+			m_values[((ty << TileShift) + y) * m_width + (tx << TileShift) + x] = (short)(d * Scale);
+		}
+
+	m_dirty[ty * m_tilesX + tx] = false;
+}
+
+float TerrainField::value(CMap& map, int x, int y)
+{
+	if((unsigned int)x >= (unsigned int)m_width || (unsigned int)y >= (unsigned int)m_height)
+		return -0.5f;
+
+	const int tile = (y >> TileShift) * m_tilesX + (x >> TileShift);
+	if(m_dirty[tile])
+		rebuildTile(map, x >> TileShift, y >> TileShift);
+
+	return (float)m_values[y * m_width + x] / Scale;
+}
+
+float TerrainField::sample(CMap& map, float x, float y)
+{
+	// values are stored for the pixel centers
+	x -= 0.5f; y -= 0.5f;
+	const float fx = std::floor(x), fy = std::floor(y);
+	const int ix = (int)fx, iy = (int)fy;
+	const float ax = x - fx, ay = y - fy;
+
+	const float top = value(map, ix, iy) * (1 - ax) + value(map, ix + 1, iy) * ax;
+	const float bottom = value(map, ix, iy + 1) * (1 - ax) + value(map, ix + 1, iy + 1) * ax;
+	return top * (1 - ay) + bottom * ay;
+}
+
+bool TerrainField::correction(CMap& map, const Vec& pos, float radius, Vec& correction)
+{
+	if(m_values.empty() || m_width != map.material->w || m_height != map.material->h)
+		init(map);
+
+	const float d = sample(map, pos.x, pos.y);
+	if(d >= radius)
+		return false;
+
+	Vec gradient(
+		sample(map, pos.x + 1, pos.y) - sample(map, pos.x - 1, pos.y),
+		sample(map, pos.x, pos.y + 1) - sample(map, pos.x, pos.y - 1));
+	if(gradient.lengthSqr() <= 0)
+		return false;
+
+	correction = gradient.normal() * (radius - d);
+	return true;
+}
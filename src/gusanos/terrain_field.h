@@ -0,0 +1,56 @@
+#ifndef TERRAIN_FIELD_H
+#define TERRAIN_FIELD_H
+
+/* Signed distance field over the particle-blocking material of a CMap.
+  Used by Particle::think() to resolve the collision of particles with a
+  radius in O(1) instead of scanning a (2r+1)^2 box of materials.
+
+  The field is split into tiles which are rebuilt lazily on first access
+  after they have been invalidated. Every code path which changes the
+  particle_pass property of a material pixel must call invalidate() for
+  the changed area (CMap does that in UpdateArea(), putMaterial() & co).
+  */
+
+#include <vector>
+#include "CVec.h"
+
+class CMap;
+
+class TerrainField
+{
+public:
+	// Distances are clamped to this (in pixels). Particles with a bigger
+	// radius fall back to the exact box scan.
+	static const int MaxDist = 8;
+
+	TerrainField();
+
+	void reset();
+	void invalidate(int x, int y, int w, int h);
+	void invalidatePixel(int x, int y)
+	{
+		if(!m_values.empty()) invalidate(x, y, 1, 1);
+	}
+
+	static bool supportsRadius(float radius) { return radius + 1.0f < (float)MaxDist; }
+
+	// Returns true and sets correction if a circle with radius at pos
+	// penetrates blocking material. correction moves it out again.
+	bool correction(CMap& map, const Vec& pos, float radius, Vec& correction);
+
+private:
+	enum { TileShift = 5, TileSize = 1 << TileShift };
+	static const int Scale = 256; // fixed point of m_values
+
+	void init(CMap& map);
+	void rebuildTile(CMap& map, int tx, int ty);
+	float value(CMap& map, int x, int y);
+	float sample(CMap& map, float x, float y);
+
+	int m_width, m_height;
+	int m_tilesX, m_tilesY;
+	std::vector<short> m_values; // signed distance * Scale, negative inside material
+	std::vector<bool> m_dirty;
+};
+
+#endif // TERRAIN_FIELD_H
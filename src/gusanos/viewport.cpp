@@ -17,6 +17,7 @@
 #include "game/Game.h"
 #include "FlagInfo.h"
 #include "CGameMode.h"
+#include "RenderQueue.h"
 #include <list>
 
 #include "sprite_set.h" // TEMP
@@ -39,6 +40,7 @@ void CViewport::gusReset()
 {
 	destroy_bitmap(dest); dest = 0;
 	destroy_bitmap(fadeBuffer); fadeBuffer = 0;
+	compositor.reset();
 }
 
 struct TestCuller : public Culler<TestCuller>
@@ -81,6 +83,19 @@ struct TestCuller : public Culler<TestCuller>
 
 static Sprite* testLight = 0;
 
+// Reused by all viewports, so the command buffer is allocated only once
+static RenderQueue renderQueue;
+
+static void DrawWormShadow(void* obj, SDL_Surface* bmpDest, CViewport* v)
+{
+	((CWorm*)obj)->DrawShadow(bmpDest, v);
+}
+
+static void DrawGameObject(void* obj, SDL_Surface*, CViewport* v)
+{
+	((CGameObject*)obj)->draw(v);
+}
+
 void CViewport::setDestination(int width, int height)
 {
 	destroy_bitmap(dest);
@@ -140,7 +155,7 @@ void CViewport::gusRender(SDL_Surface* bmpDest)
 	const int offX = static_cast<int>(WorldX);
 	const int offY = static_cast<int>(WorldY);
 
-	game.gameMap()->gusDraw(dest, offX, offY);
+	compositor.drawLevel(game.gameMap(), dest, offX, offY);
 
 	if ( game.isLevelDarkMode() && game.gameMap()->lightmap )
 		blit( game.gameMap()->lightmap, fadeBuffer, offX*2,offY*2, 0, 0, fadeBuffer->w, fadeBuffer->h );
@@ -164,18 +179,20 @@ void CViewport::gusRender(SDL_Surface* bmpDest)
 
 		if( tLXOptions->bShadows ) {
 			// Draw the projectile shadows
-			cClient->DrawProjectileShadows(bmpDest, v);
+			cClient->DrawProjectileShadows(renderQueue);
 
 			// Draw the worm shadows
 			for_each_iterator(CWorm*, w, game.aliveWorms())
-				w->get()->DrawShadow(bmpDest, v);
+				renderQueue.addCustom(RenderQueue::L_Shadow, &DrawWormShadow, w->get());
 		}
 
 		// Draw the entities
-		DrawEntities(bmpDest, v);
+		DrawEntities(renderQueue, v);
 
 		// Draw the projectiles
-		cClient->DrawProjectiles(bmpDest, v);
+		cClient->DrawProjectiles(renderQueue, v);
+
+		renderQueue.flush(bmpDest, v);
 
 		// Draw the bonuses
 		cClient->DrawBonuses(bmpDest, v);
@@ -188,17 +205,22 @@ void CViewport::gusRender(SDL_Surface* bmpDest)
 			w->get()->Draw(bmpDest, v);
 	}
 
-	for ( Grid::iterator iter = game.objects.beginAll(); iter; ++iter)
-		iter->draw(this);
+	// The grid is already ordered by render layer. Objects outside of the viewport are culled.
+	for ( Grid::iterator iter = game.objects.beginAll(); iter; ++iter) {
+		int x, y, w, h;
+		if(iter->getDrawRect(this, x, y, w, h))
+			renderQueue.addCustom(RenderQueue::L_Object, &DrawGameObject, &*iter, x, y, w, h);
+		else
+			renderQueue.addCustom(RenderQueue::L_Object, &DrawGameObject, &*iter);
+	}
+	renderQueue.flush(dest->surf.get(), this);
 
 	if(game.isLevelDarkMode() && pcTargetWorm) {
 		if(pcTargetWorm->isActive())
 			drawLight(pcTargetWorm->pos().get());
 	}
 
-	if(game.gameMap()->bmpForeground.get()) {
-		DrawImageAdv(dest->surf.get(), game.gameMap()->bmpForeground, offX*2, offY*2, 0, 0, dest->w, dest->h);
-	}
+	compositor.drawForeground(game.gameMap(), dest, offX, offY);
 
 	if(game.isLevelDarkMode())
 		drawSprite_mult_8(dest, fadeBuffer, 0, 0);
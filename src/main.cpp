@@ -38,6 +38,7 @@
 #include "FontHandling.h"
 #include "Timer.h"
 #include "CChannel.h"
+#include "NetworkImpairment.h"
 #include "Cache.h"
 #include "ProfileSystem.h"
 #include "IRC.h"
@@ -60,6 +61,8 @@
 #include "DeprecatedGUI/Menu.h"
 #include "DeprecatedGUI/CChatWidget.h"
 #include "SkinnedGUI/CGuiSkin.h"
+#include "DedicatedLoop.h"
+#include "Metrics.h"
 
 #include "breakpad/ExtractInfo.h"
 
@@ -254,6 +257,8 @@ startpoint:
 		return -1;
 	}
 
+	InitDirectoryIndex();
+
 	teeStdoutFile(GetWriteFullFileName("logs/OpenLieroX - " + GetDateTimeFilename() + ".txt", true));
 	activateStdinCLIHistory();
 	CrashHandler::init();
@@ -378,6 +383,7 @@ startpoint:
 
 	notes << "waiting for all left threads and tasks" << endl;
 	taskManager->finishQueuedTasks();
+	UnInitDirectoryIndex();
 	threadPool->waitAll(); // do that before uniniting task manager because some threads could access it
 
 	// do that after shutting down the timers and other threads
@@ -564,6 +570,7 @@ static void ParseArguments_AfterInit(int argc, char *argv[])
 			#ifdef DEBUG
      		printf("   -nettest      Test CChannel reliability\n");
 			#endif
+     		printf("   -netsim [n]   Simulate a server with n clients over a bad network link (Network.Sim* options)\n");
      		printf("   -skin         Turns on new skinned GUI - it's unfinished yet\n");
      		printf("   -noskin       Turns off new skinned GUI\n");
 
@@ -583,6 +590,28 @@ static void ParseArguments_AfterInit(int argc, char *argv[])
      		exit(0);
 		}
 		#endif
+
+		// -netsim
+		// Runs the network simulation test and quits
+		if( !stricmp(a, "-netsim") )
+		{
+			int numClients = 8;
+			if(argv[i + 1] != NULL && argv[i + 1][0] != '-')
+				numClients = from_string<int>(argv[++i]);
+			InitializeLieroX();
+			NetworkImpairmentSettings settings = NetworkImpairmentSettings::fromOptions();
+			if(!settings.isActive()) {
+				// some typical bad internet connection
+				settings.latency = 60;
+				settings.jitter = 40;
+				settings.loss = 0.05f;
+				settings.duplicate = 0.01f;
+				settings.reorder = 0.02f;
+			}
+			TestNetworkSimulation(numClients, settings);
+			ShutdownLieroX();
+			exit(0);
+		}
     }
 }
 
@@ -831,6 +860,8 @@ void ShutdownLieroX()
 	if(bDedicated)
 		DedicatedControl::Uninit();
 
+	Metrics::shutdownServer();
+
 	if( ! bDedicated )
 		ShutdownBackgroundMusic();
 
@@ -926,6 +957,7 @@ void ShutdownLieroX()
 
 	// Shutdown the timers
 	ShutdownTimers();
+	DedicatedLoopShutdown();
 
 	xmlCleanupParser();
 
@@ -37,6 +37,7 @@
 #include "Physics.h"
 #include "CServerNetEngine.h"
 #include "CChannel.h"
+#include "NetworkImpairment.h"
 #include "CServerConnection.h"
 #include "Debug.h"
 #include "CGameMode.h"
@@ -53,6 +54,7 @@
 #include "game/SettingsPreset.h"
 #include "CGameScript.h"
 #include "client/ClientConnectionRequestInfo.h" // for WormJoinInfo
+#include "FrameProfiler.h"
 
 
 GameServer	*cServer = NULL;
@@ -112,8 +114,10 @@ void GameServer::Clear()
 }
 
 void GameServer::ResetSockets() {
-	for( int i=0; i < MAX_SERVER_SOCKETS; i++ )
+	for( int i=0; i < MAX_SERVER_SOCKETS; i++ ) {
 		tSockets[i] = new NetworkSocket();
+		tSockets[i]->setLocalLoopback(true); // our local client talks to us in-process
+	}
 	tNatClients.clear();	
 }
 
@@ -182,6 +186,9 @@ int GameServer::StartServer()
 		}
 	}
 
+	for( int i = 0; i < MAX_SERVER_SOCKETS; i++ )
+		ApplyNetworkImpairmentFromOptions(*tSockets[i].get(), i);
+
 	NetworkAddr addr = tSockets[0]->localAddress();
 	// TODO: Why is that stored in debug_string ???
 	NetAddrToString(addr, tLX->debug_string);
@@ -801,6 +808,7 @@ bool GameServer::ReadPacketsFromSocket(const SmartPointer<NetworkSocket>& sock)
 // Read packets
 bool GameServer::ReadPackets()
 {	
+	PROFILE_ZONE("GameServer::ReadPackets");
 	bool anythingNew = false;
 	// Main sockets
 	for( int i = 0; i < MAX_SERVER_SOCKETS; i++ )
@@ -835,11 +843,50 @@ bool GameServer::ReadPackets()
 			(*it)->fLastUsed = tLX->currentTime;
 		}
 	}
+
+	// Our local client hands its packets over directly, see CChannel_Local
+	CServerConnection *cl = cClients;
+	for( int c = 0; cl && c < MAX_CLIENTS; c++, cl++ ) {
+		if( cl->getStatus() == NET_DISCONNECTED || cl->getChannel() == NULL )
+			continue;
+
+		std::list<CBytestream> packets;
+		if( !cl->getChannel()->ReceiveDirect(packets) )
+			continue;
+		anythingNew = true;
+
+		for( std::list<CBytestream>::iterator p = packets.begin(); p != packets.end(); ++p ) {
+			// The client might have been dropped by the previous packet
+			if( cl->getStatus() == NET_DISCONNECTED )
+				break;
+			iSuicidesInPacket = 0;
+			// Only process the actual packet for playing clients
+			if( cl->getStatus() != NET_ZOMBIE )
+				cl->getNetEngine()->ParsePacket(&*p);
+		}
+	}
 	
 	return anythingNew;
 }
 
 
+///////////////////
+// Get the sockets which ReadPackets reads from
+void GameServer::getSockets(std::vector<NetworkSocket*>& sockets)
+{
+	for( int i = 0; i < MAX_SERVER_SOCKETS; i++ )
+		if( tSockets[i].get() && tSockets[i]->isOpen() )
+			sockets.push_back(tSockets[i].get());
+
+	for (NatConnList::iterator it = tNatClients.begin(); it != tNatClients.end(); ++it)  {
+		if ((*it)->tTraverseSocket.get() && (*it)->tTraverseSocket->isOpen())
+			sockets.push_back((*it)->tTraverseSocket.get());
+		if ((*it)->tConnectHereSocket.get() && (*it)->tConnectHereSocket->isOpen())
+			sockets.push_back((*it)->tConnectHereSocket.get());
+	}
+}
+
+
 ///////////////////
 // Send packets
 void GameServer::SendPackets(bool sendPendingOnly)
@@ -208,6 +208,14 @@ CChannel * CServerConnection::createChannel(const Version& v)
 	return cNetChan;
 }
 
+CChannel * CServerConnection::createLocalChannel(NetworkSocket::Port clientPort)
+{
+	if( cNetChan )
+		delete cNetChan;
+	cNetChan = CChannel_Local::createForServer(clientPort);
+	return cNetChan;
+}
+
 
 std::string CServerConnection::getAddrAsString() {
 	std::string addr = "?.?.?.?";
@@ -508,24 +508,13 @@ void CServerNetEngineBeta7::ParseChatCommandCompletionRequest(CBytestream *bs) {
 		
 		// TODO: Move it out here and make it more general (add it to ChatCommand structure).
 		if(cmd->tProcFunc == &ProcessSetVar && cmdStart.size() == 2) {
-			for(CScriptableVars::const_iterator it = CScriptableVars::lower_bound(cmdStart[1]); it != CScriptableVars::Vars().end(); ++it) {
-				// ignore callbacks
-				if(it->second.var.type == SVT_CALLBACK) continue;
-				
-				if( subStrCaseEqual(cmdStart[1], it->first, cmdStart[1].size()) ) {
-					std::string nextComplete = it->first.substr(0, cmdStart[1].size());
-					for(size_t f = cmdStart[1].size();; ++f) {
-						if(f >= it->first.size()) { nextComplete += ' '; break; }
-						nextComplete += it->first[f];
-						if(it->first[f] == '.') break;
-					}
-					
-					if(possibilities.size() == 0 || *possibilities.rbegin() != nextComplete) {
-						possibilities.push_back(nextComplete);
-					}
-				}
+			std::vector<std::string> names;
+			CScriptableVars::CompleteVarName(cmdStart[1], names);
+			for(std::vector<std::string>::iterator it = names.begin(); it != names.end(); ++it) {
+				if(it->size() > 0 && (*it)[it->size() - 1] != '.')
+					possibilities.push_back(*it + ' ');
 				else
-					break;
+					possibilities.push_back(*it);
 			}
 
 			if(possibilities.size() == 0) {
@@ -1375,7 +1364,12 @@ void GameServer::ParseConnect(const SmartPointer<NetworkSocket>& net_socket, CBy
 	}
 
 	if( newcl->getChannel() == NULL) { 
-		if(! newcl->createChannel( std::min(clientVersion, GetGameVersion() ) ) )
+		// Our own client in this process gets the bytestreams handed over directly
+		const bool localDirect = newcl->isLocalClient() && tLXOptions->bLocalLoopback &&
+			cClient && cClient->getSocket() && cClient->getSocket()->localLoopbackPort() == GetNetAddrPort(adrFrom);
+		if( localDirect )
+			newcl->createLocalChannel( GetNetAddrPort(adrFrom) );
+		else if(! newcl->createChannel( std::min(clientVersion, GetGameVersion() ) ) )
 		{	// This should not happen - just in case
 			errors << "Cannot create CChannel for client - invalid client version " << clientVersion.asString() << endl;
 			CBytestream bytestr;
@@ -40,6 +40,7 @@
 #include "CGameScript.h"
 #include "Utils.h"
 #include "game/GameState.h"
+#include "FrameProfiler.h"
 
 
 // declare them only locally here as nobody really should use them explicitly
@@ -420,6 +421,7 @@ static float maxRateForClient(CServerConnection* cl) {
 // Returns true if we sent an update
 bool GameServer::SendUpdate()
 {
+	PROFILE_ZONE("GameServer::SendUpdate");
 	if(NewNet::Active())
 		return false;
 		
@@ -0,0 +1,160 @@
+/*
+ *  DedicatedLoop.cpp
+ *  OpenLieroX
+ *
+ *  code under LGPL
+ *
+ */
+
+#include "DedicatedLoop.h"
+
+#ifdef __linux__
+
+#include <set>
+#include <vector>
+#include <cstring>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "LieroX.h"
+#include "Options.h"
+#include "CServer.h"
+#include "CClient.h"
+#include "Networking.h"
+#include "Debug.h"
+#include "MathLib.h"
+
+
+// The eventfd is never closed, other threads might still signal it at any time
+static volatile int wakeupFd = -1;
+
+static int epollFd = -1;
+static bool epollFailed = false;
+static unsigned int epollCloseCount = 0; // NetworkSocket::closeCount() when the set was created
+static std::set<int> epollSockets;
+
+static bool initLoop() {
+	if(epollFailed) return false;
+	if(epollFd >= 0) return true;
+
+	if(wakeupFd < 0) {
+		wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(wakeupFd < 0) {
+			warnings << "DedicatedLoop: eventfd failed: " << strerror(errno) << ", using the old frame sleep" << endl;
+			epollFailed = true;
+			return false;
+		}
+	}
+
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if(epollFd < 0) {
+		warnings << "DedicatedLoop: epoll_create1 failed: " << strerror(errno) << ", using the old frame sleep" << endl;
+		epollFailed = true;
+		return false;
+	}
+
+	epoll_event ev = epoll_event();
+	ev.events = EPOLLIN;
+	ev.data.fd = wakeupFd;
+	if(epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &ev) != 0) {
+		warnings << "DedicatedLoop: cannot watch the eventfd: " << strerror(errno) << endl;
+		close(epollFd); epollFd = -1;
+		epollFailed = true;
+		return false;
+	}
+
+	epollSockets.clear();
+	epollCloseCount = NetworkSocket::closeCount();
+	return true;
+}
+
+// Brings the epoll set up to date with the sockets of the server and the local client
+static void updateSockets() {
+	// A closed socket leaves the epoll set on its own and its number might be used again.
+	// That is rare, so just start with a new set then.
+	if(epollCloseCount != NetworkSocket::closeCount()) {
+		close(epollFd); epollFd = -1;
+		if(!initLoop()) return;
+	}
+
+	std::vector<NetworkSocket*> sockets;
+	if(cServer) cServer->getSockets(sockets);
+	if(cClient && cClient->getSocket() && cClient->getSocket()->isOpen())
+		sockets.push_back(cClient->getSocket());
+
+	std::set<int> fds;
+	for(std::vector<NetworkSocket*>::iterator i = sockets.begin(); i != sockets.end(); ++i) {
+		int fd = (*i)->systemSocket();
+		if(fd >= 0) fds.insert(fd);
+	}
+
+	for(std::set<int>::iterator i = fds.begin(); i != fds.end(); ++i) {
+		if(epollSockets.count(*i)) continue;
+		epoll_event ev = epoll_event();
+		ev.events = EPOLLIN;
+		ev.data.fd = *i;
+		if(epoll_ctl(epollFd, EPOLL_CTL_ADD, *i, &ev) == 0 || errno == EEXIST)
+			epollSockets.insert(*i);
+		else
+			warnings << "DedicatedLoop: cannot watch socket " << *i << ": " << strerror(errno) << endl;
+	}
+
+	for(std::set<int>::iterator i = epollSockets.begin(); i != epollSockets.end(); ) {
+		if(fds.count(*i)) { ++i; continue; }
+		epoll_event ev = epoll_event(); // needed by old kernels
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, *i, &ev);
+		epollSockets.erase(i++);
+	}
+}
+
+bool DedicatedLoopWait(TimeDiff timeout) {
+	if(!tLXOptions->bDedicatedEventLoop) {
+		if(epollFd >= 0) DedicatedLoopShutdown();
+		return false;
+	}
+	if(!initLoop()) return false;
+	updateSockets();
+	if(epollFd < 0) return false;
+
+	const int ms = (int)MIN(timeout.milliseconds(), (Uint64)10000);
+	epoll_event events[16];
+	int n = epoll_wait(epollFd, events, sizeof(events) / sizeof(events[0]), ms);
+	if(n < 0 && errno != EINTR) {
+		warnings << "DedicatedLoop: epoll_wait failed: " << strerror(errno) << ", using the old frame sleep" << endl;
+		DedicatedLoopShutdown();
+		epollFailed = true;
+		return false;
+	}
+
+	// Reset the eventfd. The sockets are read by the next frame.
+	for(int i = 0; i < n; ++i)
+		if(events[i].data.fd == wakeupFd) {
+			eventfd_t value;
+			eventfd_read(wakeupFd, &value);
+		}
+
+	return true;
+}
+
+void DedicatedLoopWakeup() {
+	const int fd = wakeupFd;
+	if(fd >= 0)
+		eventfd_write(fd, 1);
+}
+
+void DedicatedLoopShutdown() {
+	if(epollFd >= 0) {
+		close(epollFd);
+		epollFd = -1;
+	}
+	epollSockets.clear();
+}
+
+#else // __linux__
+
+bool DedicatedLoopWait(TimeDiff) { return false; }
+void DedicatedLoopWakeup() {}
+void DedicatedLoopShutdown() {}
+
+#endif
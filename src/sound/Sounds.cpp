@@ -114,8 +114,7 @@ SmartPointer<SoundSample> LoadSample(const std::string& _filename, int maxplayin
 	
 	if(Sample.get() && Sample->avail()) {
 		Sample->maxSimultaniousPlays = maxplaying;
-		cCache.SaveSound(filenameWithoutExt, Sample); // Save to cache
-		return Sample;
+		return cCache.SaveSound(filenameWithoutExt, Sample); // Save to cache
 	}
 
 	// dont print additional warnings here, we will print all warnings inside of load
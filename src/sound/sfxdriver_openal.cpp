@@ -14,6 +14,8 @@
 #include "sfxdriver_openal.h"
 #include "sound_sample_openal.h"
 #include "sound_sample.h"
+#include "voice_mixer.h"
+#include "CScriptableVars.h"
 
 #include <boost/assign/list_inserter.hpp>
 using namespace boost::assign;
@@ -22,7 +24,45 @@ using namespace std;
 
 namespace
 {
-	std::list< Sound* > chanObject;
+	int cfgMaxVoices = 32;
+	bool bRegisteredOpenALVars = CScriptableVars::RegisterVars("GameOptions")
+		( cfgMaxVoices, "Audio.MaxVoices", 32, "Max sounds", "How many sounds can play at the same time", GIG_Invalid, ALT_VeryAdvanced, true, 4, 256 );
+
+	class OpenALVoiceOutput : public VoiceMixer::Output
+	{
+	public:
+		bool isPlaying(VoiceMixer::SourceId source)
+		{
+			ALint state = AL_STOPPED;
+			alGetSourcei(source, AL_SOURCE_STATE, &state);
+			return state == AL_PLAYING;
+		}
+
+		void stop(VoiceMixer::SourceId source)
+		{
+			alSourceStop(source);
+		}
+
+		void start(std::vector<VoiceMixer::Request> const& voices)
+		{
+			m_sources.clear();
+			for(std::vector<VoiceMixer::Request>::const_iterator v = voices.begin(); v != voices.end(); ++v)
+			{
+				ALfloat pos[3] = { v->pos.x, v->pos.y, 0 };
+				alSourcefv(v->source, AL_POSITION, pos);
+				alSourcef(v->source, AL_PITCH, v->pitch);
+				alSourcef(v->source, AL_GAIN, v->gain);
+				alSourcef(v->source, AL_REFERENCE_DISTANCE, v->refDistance);
+				m_sources.push_back(v->source);
+			}
+			alSourcePlayv((ALsizei)m_sources.size(), &m_sources[0]);
+		}
+
+	private:
+		std::vector<ALuint> m_sources;
+	};
+
+	OpenALVoiceOutput voiceOutput;
 }
 
 
@@ -39,18 +79,22 @@ bool SfxDriverOpenAL::init()
 	ALfloat listenerOri[]={0.0,0.0,-1.0, 0.0,1.0,0.0};
 	alListenerfv(AL_ORIENTATION,listenerOri);
 
+	voiceMixer.setOutput(&voiceOutput);
+	voiceMixer.setMaxVoices(cfgMaxVoices);
+
 	hints << "OpenAL lib initialized" << endl;
 	return true;
 }
 
 void SfxDriverOpenAL::shutDown()
 {
+	voiceMixer.setOutput(NULL);
 	alutExit();
 }
 
 void SfxDriverOpenAL::think()
 {
-	
+	Vec listener;
 	for (size_t i = 0; i < listeners.size(); ++i )
 	{
 		ALfloat listenerPos[]={listeners[i]->pos.x,listeners[i]->pos.y,(ALfloat)-SFX_LISTENER_DISTANCE };
@@ -59,25 +103,23 @@ void SfxDriverOpenAL::think()
 		//multi listeners are not supported in OpenAL
 		break;
 	}
-	
-	foreach_delete(obj, chanObject)
+	if(listeners.empty())
 	{
-
-		if( !(*obj)->isValid())
-		{
-			chanObject.erase(obj);
-		}
-		else
-		{
-			(*obj)->updateObjSound();
-		}
+		ALfloat listenerPos[3];
+		alGetListenerfv(AL_POSITION, listenerPos);
+		listener = Vec(listenerPos[0], listenerPos[1]);
 	}
+	else
+		listener = listeners[0]->pos;
 
+	// start all sounds of this frame together
+	voiceMixer.setMaxVoices(cfgMaxVoices);
+	voiceMixer.commit(listener, SFX_LISTENER_DISTANCE);
 }
 	
 void SfxDriverOpenAL::clear()
 {
-	chanObject.clear();
+	voiceMixer.clear();
 }
 
 
@@ -1,6 +1,7 @@
 #ifndef DEDICATED_ONLY
 
 #include "sound_sample_openal.h"
+#include "voice_mixer.h"
 #include "gusanos/resource_list.h"
 #include "game/CGameObject.h"
 #include "gusanos/allegro.h"
@@ -27,6 +28,7 @@ using namespace std;
 namespace
 {
 	const int BUFFER_SIZE = 32768;       // 32 KB buffers
+	const float DefaultGain = 0.7f;
 }
 
 
@@ -158,6 +160,7 @@ template <> void SmartPointer_ObjectDeinit<OpenALBuffer> ( OpenALBuffer * obj )
 SoundSampleOpenAL::SoundSampleOpenAL(std::string const& filename)
 {	
 	m_sound = 0;
+	m_gain = DefaultGain;
 
 	if(!IsFileAvailable(filename))
 		// we silently ignore this
@@ -187,12 +190,15 @@ SoundSampleOpenAL::SoundSampleOpenAL(std::string const& filename)
 
 SoundSampleOpenAL::~SoundSampleOpenAL()
 {
-	if ( m_sound)  
+	if ( m_sound) {
+		voiceMixer.forget(m_sound);
 		alDeleteSources(1,&m_sound);
+	}
 }
 
 SoundSampleOpenAL::SoundSampleOpenAL(const SoundSampleOpenAL& s) {
 	m_sound = 0;
+	m_gain = DefaultGain;
 
 	buffer = s.buffer;
 	if(buffer.get())
@@ -205,8 +211,8 @@ void SoundSampleOpenAL::initSound() {
 	
     // Attach sound buffer to source
     alSourcei(sourceID, AL_BUFFER, buffer->bufferID);
-	alSourcef(sourceID,AL_ROLLOFF_FACTOR,2);
-	alSourcef(sourceID,AL_GAIN,0.7f);
+	alSourcef(sourceID,AL_ROLLOFF_FACTOR,VoiceMixer::RolloffFactor);
+	alSourcef(sourceID,AL_GAIN,m_gain);
 	//alSourcef(	 mALSource,AL_REFERENCE_DISTANCE,20);
     /*alSource3f(mALSource, AL_POSITION,        0.0, 0.0, 0.0);
 	 alSource3f(mALSource, AL_VELOCITY,        0.0, 0.0, 0.0);
@@ -230,23 +236,19 @@ bool SoundSampleOpenAL::avail()
 }
 
 
+// The sources are started by the voice mixer in SfxDriverOpenAL::think()
 void SoundSampleOpenAL::play( float pitch,float volume)
 {
 	if( m_sound ) 
 	{
-		//cout<<"Play "<<endl;
-
-		float _pos[3];
-		alGetListenerfv(AL_POSITION, _pos);
-		_pos[2] = 0;
-		
-		alSourcefv( m_sound , AL_POSITION, _pos);		
-		alSourcef(	 m_sound ,AL_REFERENCE_DISTANCE,100.0/100*50); //ok?
-
-		
-		alSourcef(	 m_sound ,AL_PITCH,pitch);
-		alSourcef(	 m_sound ,AL_GAIN,volume );
-		alSourcePlay( m_sound) ;			
+		VoiceMixer::Request r;
+		r.source = m_sound;
+		r.buffer = buffer->bufferID;
+		r.positional = false; // at the listener
+		r.gain = m_gain = volume;
+		r.refDistance = 100.0/100*50; //ok?
+		r.pitch = pitch;
+		voiceMixer.request(r);
 	}
 }
 
@@ -255,13 +257,15 @@ void SoundSampleOpenAL::play2D(const Vec& pos, float loudness, float pitch)
 {
 	if( m_sound ) 
 	{
-		//cout<<"Play 2D"<<endl;
-			float _pos[3] = { pos.x, pos.y, 0 };
-			//cout<<"sound: x,y: "<<pos.x<<" "<<pos.y<<endl;
-			alSourcefv( m_sound , AL_POSITION, _pos);
-			alSourcef(	 m_sound ,AL_PITCH,pitch);
-			alSourcef(	 m_sound ,AL_REFERENCE_DISTANCE,loudness/100*50); //ok?
-			alSourcePlay( m_sound) ;			
+		VoiceMixer::Request r;
+		r.source = m_sound;
+		r.buffer = buffer->bufferID;
+		r.positional = true;
+		r.pos = pos;
+		r.gain = m_gain;
+		r.refDistance = loudness/100*50; //ok?
+		r.pitch = pitch;
+		voiceMixer.request(r);
 	}
 }
 
@@ -274,6 +278,7 @@ void SoundSampleOpenAL::play2D(CGameObject* obj, float loudness, float pitch)
 bool SoundSampleOpenAL::isPlaying()
 {
 	if(!m_sound) return false;
+	if(voiceMixer.isPending(m_sound)) return true;
 	
 	ALint state;
 	alGetSourcei(m_sound,AL_SOURCE_STATE,&state);
@@ -35,6 +35,7 @@ private:
 	void initSound();
 	SmartPointer<OpenALBuffer> buffer;
 	ALuint m_sound;
+	float m_gain; // AL_GAIN of m_sound, set by play()
 	
 };
 
@@ -0,0 +1,195 @@
+#ifndef DEDICATED_ONLY
+
+#include "voice_mixer.h"
+#include "MathLib.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+VoiceMixer voiceMixer;
+
+const float VoiceMixer::RolloffFactor = 2.0f;
+
+namespace
+{
+	// Requests which would be quieter than this are not played at all
+	const float MinAudibleGain = 0.01f;
+
+	// Same buffer together, the loudest request first
+	bool byBufferThenPriority(VoiceMixer::Request const& a, VoiceMixer::Request const& b)
+	{
+		if(a.buffer != b.buffer) return a.buffer < b.buffer;
+		return a.priority > b.priority;
+	}
+
+	bool sameBuffer(VoiceMixer::Request const& a, VoiceMixer::Request const& b)
+	{
+		return a.buffer == b.buffer;
+	}
+
+	bool byPriority(VoiceMixer::Request const& a, VoiceMixer::Request const& b)
+	{
+		return a.priority > b.priority;
+	}
+}
+
+VoiceMixer::VoiceMixer()
+: m_output(0), m_maxVoices(32)
+{
+}
+
+void VoiceMixer::setOutput(Output* output)
+{
+	m_output = output;
+	m_pending.clear();
+	m_active.clear();
+}
+
+void VoiceMixer::setMaxVoices(size_t n)
+{
+	m_maxVoices = MAX(n, (size_t)1);
+}
+
+void VoiceMixer::request(Request const& r)
+{
+	if(!m_output) return;
+	m_pending.push_back(r);
+}
+
+float VoiceMixer::audibleGain(Request const& r, Vec const& listener, float listenerDistance) const
+{
+	if(!r.positional)
+		return r.gain;
+
+	const float dx = r.pos.x - listener.x, dy = r.pos.y - listener.y;
+	const float dist = sqrt(dx*dx + dy*dy + listenerDistance*listenerDistance);
+	const float ref = r.refDistance;
+	if(ref <= 0) return 0;
+	if(dist <= ref) return r.gain;
+	return r.gain * ref / (ref + RolloffFactor * (dist - ref));
+}
+
+void VoiceMixer::startVoice(Request const& r)
+{
+	m_active.push_back(r);
+	m_start.push_back(r);
+	++m_stats.started;
+}
+
+void VoiceMixer::commit(Vec const& listener, float listenerDistance)
+{
+	m_stats = Stats();
+	m_stats.requested = m_pending.size();
+	if(!m_output) {
+		m_pending.clear();
+		return;
+	}
+
+	// Free the voices which are done and rank the others at the current listener position
+	for(size_t i = 0; i < m_active.size(); ) {
+		if(!m_output->isPlaying(m_active[i].source)) {
+			m_active[i] = m_active.back();
+			m_active.pop_back();
+			continue;
+		}
+		m_active[i].priority = audibleGain(m_active[i], listener, listenerDistance);
+		++i;
+	}
+
+	if(m_pending.empty()) {
+		m_stats.active = m_active.size();
+		return;
+	}
+
+	for(vector<Request>::iterator r = m_pending.begin(); r != m_pending.end(); ++r) {
+		if(!r->positional) r->pos = listener;
+		r->priority = audibleGain(*r, listener, listenerDistance);
+	}
+
+	// Coalesce the same samples of this frame into the loudest one
+	sort(m_pending.begin(), m_pending.end(), byBufferThenPriority);
+	vector<Request>::iterator end = unique(m_pending.begin(), m_pending.end(), sameBuffer);
+	m_stats.coalesced = m_pending.end() - end;
+	m_pending.erase(end, m_pending.end());
+	sort(m_pending.begin(), m_pending.end(), byPriority);
+
+	m_start.clear();
+	for(vector<Request>::iterator r = m_pending.begin(); r != m_pending.end(); ++r) {
+		if(r->priority < MinAudibleGain) {
+			++m_stats.dropped;
+			continue;
+		}
+
+		// A restarted source keeps its voice, it does not need a free one
+		bool restarted = false;
+		for(size_t i = 0; i < m_active.size(); ++i)
+			if(m_active[i].source == r->source) {
+				m_active[i] = m_active.back();
+				m_active.pop_back();
+				restarted = true;
+				break;
+			}
+
+		if(restarted || m_active.size() < m_maxVoices) {
+			startVoice(*r);
+			continue;
+		}
+
+		size_t quietest = 0;
+		for(size_t i = 1; i < m_active.size(); ++i)
+			if(m_active[i].priority < m_active[quietest].priority)
+				quietest = i;
+
+		if(m_active[quietest].priority >= r->priority) {
+			// The remaining requests are even quieter
+			m_stats.dropped += m_pending.end() - r;
+			break;
+		}
+
+		m_output->stop(m_active[quietest].source);
+		m_active[quietest] = m_active.back();
+		m_active.pop_back();
+		++m_stats.stolen;
+		startVoice(*r);
+	}
+
+	m_pending.clear();
+	if(!m_start.empty())
+		m_output->start(m_start);
+	m_stats.active = m_active.size();
+}
+
+void VoiceMixer::forget(SourceId source)
+{
+	for(size_t i = 0; i < m_pending.size(); ) {
+		if(m_pending[i].source == source)
+			m_pending.erase(m_pending.begin() + i);
+		else
+			++i;
+	}
+	for(size_t i = 0; i < m_active.size(); ) {
+		if(m_active[i].source == source) {
+			m_active[i] = m_active.back();
+			m_active.pop_back();
+		}
+		else
+			++i;
+	}
+}
+
+bool VoiceMixer::isPending(SourceId source) const
+{
+	for(size_t i = 0; i < m_pending.size(); ++i)
+		if(m_pending[i].source == source)
+			return true;
+	return false;
+}
+
+void VoiceMixer::clear()
+{
+	m_pending.clear();
+}
+
+#endif
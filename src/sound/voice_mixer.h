@@ -0,0 +1,95 @@
+#ifndef VOICE_MIXER_H
+#define VOICE_MIXER_H
+
+#ifdef DEDICATED_ONLY
+#error "Can't use this in dedicated server"
+#endif //DEDICATED_ONLY
+
+#include <vector>
+#include <cstddef>
+#include "CVec.h"
+
+/* Limits the number of sounds which play at the same time.
+
+  The samples don't start their sources right away but request a voice.
+  Once per frame (SfxDriverOpenAL::think) the requests are committed:
+  requests of the same sample in one frame are merged into the loudest one,
+  all requests are ranked by their audible gain at the listener, and only
+  up to maxVoices sources play at once. If all voices are busy, a louder
+  request takes the voice of the quietest playing sound.
+
+  The mixer doesn't call OpenAL itself but goes through an Output, so it
+  also runs without a sound device.
+  */
+
+class VoiceMixer
+{
+public:
+	typedef unsigned int SourceId; // OpenAL source name
+	typedef unsigned int BufferId; // OpenAL buffer name
+
+	struct Request
+	{
+		SourceId source;
+		BufferId buffer;
+		bool positional; // if false, the sound plays at the listener
+		Vec pos;
+		float gain;
+		float refDistance;
+		float pitch;
+		float priority; // set by the mixer
+	};
+
+	class Output
+	{
+	public:
+		virtual ~Output() {}
+		virtual bool isPlaying(SourceId source) = 0;
+		virtual void stop(SourceId source) = 0;
+		// Sets up and starts all sources at once
+		virtual void start(std::vector<Request> const& voices) = 0;
+	};
+
+	// Of the last commit()
+	struct Stats
+	{
+		size_t requested, coalesced, started, stolen, dropped, active;
+		Stats() : requested(0), coalesced(0), started(0), stolen(0), dropped(0), active(0) {}
+	};
+
+	VoiceMixer();
+
+	// Without an output, all requests are dropped
+	void setOutput(Output* output);
+	void setMaxVoices(size_t n);
+
+	void request(Request const& r);
+	// listenerDistance is the distance of the listener to the plane of the sounds
+	void commit(Vec const& listener, float listenerDistance);
+
+	// Must be called before the source gets deleted
+	void forget(SourceId source);
+	bool isPending(SourceId source) const;
+	// Drops the pending requests
+	void clear();
+
+	Stats const& lastStats() const { return m_stats; }
+
+	// The distance model of the OpenAL sources (AL_INVERSE_DISTANCE_CLAMPED)
+	static const float RolloffFactor;
+
+private:
+	float audibleGain(Request const& r, Vec const& listener, float listenerDistance) const;
+	void startVoice(Request const& r);
+
+	Output* m_output;
+	size_t m_maxVoices;
+	std::vector<Request> m_pending;
+	std::vector<Request> m_active;
+	std::vector<Request> m_start;
+	Stats m_stats;
+};
+
+extern VoiceMixer voiceMixer;
+
+#endif // VOICE_MIXER_H
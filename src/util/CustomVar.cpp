@@ -42,8 +42,7 @@ bool CustomVar::operator==(const CustomVar& v) const {
 
 	std::vector<const AttrDesc*> attribs = getAttrDescs(thisRef.classId, true);
 	foreach(a, attribs) {
-		ScriptVar_t value = (*a)->get(this);
-		if(value != (*a)->get(&v)) return false;
+		if(!(*a)->valueEquals(this, &v)) return false;
 	}
 
 	return true;
@@ -86,9 +85,8 @@ void CustomVar::copyFrom(const CustomVar& v) {
 
 	std::vector<const AttrDesc*> attribs = getAttrDescs(thisRef.classId, true);
 	foreach(a, attribs) {
-		ScriptVar_t value = (*a)->get(&v);
-		if(value == (*a)->get(this)) continue;
-		(*a)->set(this, value);
+		if((*a)->valueEquals(this, &v)) continue;
+		(*a)->set(this, (*a)->get(&v));
 	}
 }
 
@@ -119,9 +117,8 @@ Result CustomVar::toBytestream(CBytestream *bs, const CustomVar* diffTo) const {
 	size_t numChangesDefault = 0;
 	if(diffTo) {
 		foreach(a, attribs) {
-			ScriptVar_t value = (*a)->get(this);
-			if(value != (*a)->defaultValue) numChangesDefault++;
-			if(diffTo && value != (*a)->get(diffTo)) numChangesOld++;
+			if(!(*a)->valueEquals(this, (*a)->defaultValue)) numChangesDefault++;
+			if(diffTo && !(*a)->valueEquals(this, diffTo)) numChangesOld++;
 		}
 	}
 	bool shouldUpdateAll = this->shouldUpdateAll();
@@ -131,24 +128,22 @@ Result CustomVar::toBytestream(CBytestream *bs, const CustomVar* diffTo) const {
 	if(diffTo && (!shouldUpdateAll || (numChangesOld < numChangesDefault))) {
 		bs->writeInt(CUSTOMVAR_STREAM_DiffToOld, 1);
 		foreach(a, attribs) {
-			ScriptVar_t value = (*a)->get(this);
-			if(value == (*a)->get(diffTo)) continue;
+			if((*a)->valueEquals(this, diffTo)) continue;
 			if(isRegistered() && !(*a)->shouldUpdate(this)) continue;
 			bs->writeInt16((*a)->objTypeId);
 			bs->writeInt16((*a)->attrId);
-			bs->writeVar(value);
+			(*a)->writeValueToBs(bs, this);
 		}
 		bs->writeInt16(ClassId(-1));
 	}
 	else {
 		bs->writeInt(CUSTOMVAR_STREAM_DiffToDefault, 1);
 		foreach(a, attribs) {
-			ScriptVar_t value = (*a)->get(this);
-			if(value == (*a)->defaultValue) continue;
+			if((*a)->valueEquals(this, (*a)->defaultValue)) continue;
 			if(isRegistered() && !(*a)->shouldUpdate(this)) continue;
 			bs->writeInt16((*a)->objTypeId);
 			bs->writeInt16((*a)->attrId);
-			bs->writeVar(value);
+			(*a)->writeValueToBs(bs, this);
 		}
 		bs->writeInt16(ClassId(-1));
 	}
@@ -32,6 +32,8 @@ struct Location
 		
 	void print(std::string const& msg) const;
 	
+	int getLine() const { return line; }
+	
 private:
 	std::string const* file;
 	int line;